@@ -20,6 +20,7 @@
 #include <errno.h>
 
 #include "nt-bitmap.h"
+#include "nt-pool.h"
 /**
  * @addtogroup MyNaiveUtilitiesModule
  * @{
@@ -37,8 +38,8 @@ nt_bitmap_t nt_bitmap_create(unsigned int n_size) {
     struct nt_bitmap *ret_val = NULL;
     if (n_size > 0) {
         unsigned long arr_size = 1 + (n_size - 1) / (8 * sizeof(unsigned long));
-        ret_val =
-            (struct nt_bitmap *)malloc(sizeof(struct nt_bitmap) + sizeof(unsigned long) * arr_size);
+        ret_val = (struct nt_bitmap *)nt_pool_alloc(sizeof(struct nt_bitmap) +
+                                                    sizeof(unsigned long) * arr_size);
         if (NULL != ret_val) {
             memset(&ret_val->bitmap_[0], 0, sizeof(unsigned long) * arr_size);
             ret_val->size_ = arr_size;
@@ -51,7 +52,7 @@ nt_bitmap_t nt_bitmap_create(unsigned int n_size) {
     return ret_val;
 }
 
-void nt_bitmap_free(nt_bitmap_t a_bitmap) { free(a_bitmap); }
+void nt_bitmap_free(nt_bitmap_t a_bitmap) { nt_pool_free(a_bitmap); }
 
 /**
  * @fn FFC
@@ -60,11 +61,10 @@ void nt_bitmap_free(nt_bitmap_t a_bitmap) { free(a_bitmap); }
 #if defined MSVC
 static inline int FFC(unsigned long x) {
     unsigned long idx;
-    _BitScanForward(&idx, ~x);
-    return (int)idx;
+    return _BitScanForward(&idx, ~x) ? (int)idx + 1 : 0;
 }
 #else
-static inline int FFC(unsigned long x) { return __builtin_ffs(~x); }
+static inline int FFC(unsigned long x) { return __builtin_ffsl(~x); }
 #endif
 
 unsigned long nt_bitmap_ffc(nt_bitmap_t a_bitmap) {
@@ -0,0 +1,82 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-budget.c
+ * @brief Memory budget's implementation file
+ * @details The peak is raised with a compare and swap loop, which only loops while another
+ * thread raises it at the same time.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "nt-budget.h"
+#include "nt-pool.h"
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+void nt_budget_init(nt_budget_t *budget, size_t limit) {
+    budget->limit_ = limit;
+    budget->used_ = 0;
+    budget->peak_ = 0;
+}
+
+void nt_budget_charge(nt_budget_t *budget, size_t bytes) {
+    size_t used, peak;
+    if (NULL == budget) {
+        return;
+    }
+    used = __atomic_add_fetch(&budget->used_, bytes, __ATOMIC_RELAXED);
+    peak = __atomic_load_n(&budget->peak_, __ATOMIC_RELAXED);
+    while (used > peak && !__atomic_compare_exchange_n(&budget->peak_, &peak, used, 1,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void nt_budget_release(nt_budget_t *budget, size_t bytes) {
+    if (NULL != budget) {
+        __atomic_sub_fetch(&budget->used_, bytes, __ATOMIC_RELAXED);
+    }
+}
+
+size_t nt_budget_used(const nt_budget_t *budget) {
+    return __atomic_load_n(&budget->used_, __ATOMIC_RELAXED);
+}
+
+size_t nt_budget_peak(const nt_budget_t *budget) {
+    return __atomic_load_n(&budget->peak_, __ATOMIC_RELAXED);
+}
+
+size_t nt_budget_room(const nt_budget_t *budget) {
+    size_t used = nt_budget_used(budget);
+    if (0 == budget->limit_) {
+        return SIZE_MAX;
+    }
+    return used < budget->limit_ ? budget->limit_ - used : 0;
+}
+
+void *nt_budget_alloc(nt_budget_t *budget, size_t size) {
+    void *ptr = nt_pool_alloc(size);
+    if (NULL != ptr && NULL != budget) {
+        nt_budget_charge(budget, nt_pool_usable_size(ptr));
+    }
+    return ptr;
+}
+
+void nt_budget_free(nt_budget_t *budget, void *ptr) {
+    if (NULL != ptr && NULL != budget) {
+        nt_budget_release(budget, nt_pool_usable_size(ptr));
+    }
+    nt_pool_free(ptr);
+}
+
+/** @} */
@@ -0,0 +1,103 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-budget.h
+ * @brief Memory budget's header file
+ * @details Keeps count of the memory a set of buffers holds, say those of a session, against
+ * a limit. A budget only counts: buffers are charged as they are allocated and released as
+ * they are freed, whichever thread does it, and the owner of the budget asks how much room is
+ * left before it takes in more data, stalling its producer rather than going over. @n
+ * Blocks are charged the size of their pool class, not the size asked for, which is what they
+ * actually keep from other sessions.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#ifndef NT_BUDGET_H
+#define NT_BUDGET_H
+
+#include <stddef.h>
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/**
+ * @brief A memory budget.
+ * @details Counters are updated atomically, buffers may be freed by other threads than the one
+ * that allocated them.
+ */
+typedef struct nt_budget_t {
+    size_t limit_; /**< Most bytes the owner lets in, 0 for no limit */
+    size_t used_;  /**< Bytes charged and not released yet */
+    size_t peak_;  /**< Most bytes charged at the same time */
+} nt_budget_t;
+
+/**
+ * @brief Initialises a budget.
+ * @param budget the budget.
+ * @param limit most bytes the owner lets in, 0 for no limit.
+ */
+void nt_budget_init(nt_budget_t *budget, size_t limit);
+
+/**
+ * @brief Charges a budget.
+ * @details Never refused, it is up to the owner not to take in more than the room left.
+ * @param budget the budget, may be @c NULL.
+ * @param bytes number of bytes.
+ */
+void nt_budget_charge(nt_budget_t *budget, size_t bytes);
+
+/**
+ * @brief Gives bytes charged earlier back to a budget.
+ * @param budget the budget, may be @c NULL.
+ * @param bytes number of bytes.
+ */
+void nt_budget_release(nt_budget_t *budget, size_t bytes);
+
+/**
+ * @brief Returns the number of bytes charged and not released yet.
+ * @param budget the budget.
+ * @return Number of bytes.
+ */
+size_t nt_budget_used(const nt_budget_t *budget);
+
+/**
+ * @brief Returns the most bytes charged at the same time so far.
+ * @param budget the budget.
+ * @return Number of bytes.
+ */
+size_t nt_budget_peak(const nt_budget_t *budget);
+
+/**
+ * @brief Returns the number of bytes that may still be charged within the limit.
+ * @param budget the budget.
+ * @return Number of bytes, 0 if over the limit, @c SIZE_MAX for a budget without a limit.
+ */
+size_t nt_budget_room(const nt_budget_t *budget);
+
+/**
+ * @brief Allocates a block from the pool and charges a budget with it.
+ * @param budget the budget, may be @c NULL.
+ * @param size requested size in bytes.
+ * @return Pointer to the block or @c NULL.
+ * @sa nt_budget_free()
+ */
+void *nt_budget_alloc(nt_budget_t *budget, size_t size);
+
+/**
+ * @brief Returns a block to the pool and gives its size back to a budget.
+ * @param budget the budget the block was charged to, may be @c NULL.
+ * @param ptr block returned by @ref nt_budget_alloc(), may be @c NULL.
+ */
+void nt_budget_free(nt_budget_t *budget, void *ptr);
+
+/** @} */
+
+#endif /* NT_BUDGET_H */
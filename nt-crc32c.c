@@ -0,0 +1,193 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-crc32c.c
+ * @brief CRC-32C checksum's implementation file
+ * @details Slicing by eight: table @c k gives the checksum of a byte followed by @c k zero
+ * bytes, so eight bytes are folded in with eight lookups and no dependency between them. @n
+ * Processors with SSE4.2 have an instruction folding in eight bytes, taking three cycles but
+ * able to start every cycle. The data is cut into three lanes, checksummed side by side, and
+ * the checksums of the first two lanes are moved past the lanes after them: the checksum of
+ * data followed by zeros, which is linear, comes from four lookups in tables built for the
+ * length of one and two lanes. The tables and the implementation are chosen once, on first
+ * use.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined __x86_64__
+#include <nmmintrin.h>
+#endif
+
+#include "nt-crc32c.h"
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief The Castagnoli polynomial, reflected. */
+#define CRC32C_POLY (0x82f63b78U)
+
+/**
+ * @brief Length of a lane of the SSE4.2 implementation.
+ * @details Long enough for the lookups moving the checksums along to not matter, short
+ * enough for blocks of a few KiB to go through three lanes.
+ */
+#define CRC32C_LANE (512)
+
+/** @brief Tables of the checksum of a byte followed by 0 to 7 zero bytes. */
+static uint32_t s_tables[8][256];
+
+/**
+ * @brief Tables moving a checksum past one and two lanes of zeros, a byte of it at a time.
+ */
+static uint32_t s_shift[2][4][256];
+
+/** @brief The implementation chosen, working on the checksum without its inversions. */
+static uint32_t (*s_update)(uint32_t crc, const uint8_t *bytes, size_t len);
+
+/** @brief Name of the implementation chosen. */
+static const char *s_name;
+
+/** @brief Builds the tables and chooses the implementation once. */
+static pthread_once_t s_tables_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Folds data into a checksum, eight bytes at a time.
+ */
+static uint32_t crc32c_update_table(uint32_t crc, const uint8_t *bytes, size_t len) {
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+        word ^= crc;
+        crc = s_tables[7][word & 0xff] ^ s_tables[6][(word >> 8) & 0xff] ^
+              s_tables[5][(word >> 16) & 0xff] ^ s_tables[4][(word >> 24) & 0xff] ^
+              s_tables[3][(word >> 32) & 0xff] ^ s_tables[2][(word >> 40) & 0xff] ^
+              s_tables[1][(word >> 48) & 0xff] ^ s_tables[0][word >> 56];
+        bytes += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        crc = (crc >> 8) ^ s_tables[0][(crc ^ *bytes++) & 0xff];
+    }
+    return crc;
+}
+
+/**
+ * @brief Moves a checksum past a lane of zeros, or two.
+ * @param shift the tables of the length.
+ * @param crc the checksum.
+ * @return Checksum of the data followed by the zeros.
+ */
+static inline uint32_t crc32c_shift(const uint32_t shift[4][256], uint32_t crc) {
+    return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^ shift[2][(crc >> 16) & 0xff] ^
+           shift[3][crc >> 24];
+}
+
+#if defined __x86_64__
+/**
+ * @brief Folds data into a checksum with the SSE4.2 instruction, three lanes at a time.
+ */
+__attribute__((target("sse4.2"))) static uint32_t crc32c_update_sse42(uint32_t crc,
+                                                                      const uint8_t *bytes,
+                                                                      size_t len) {
+    uint64_t word;
+    while (len >= 3 * CRC32C_LANE) {
+        uint64_t crc0 = crc, crc1 = 0, crc2 = 0, word1, word2;
+        size_t idx;
+        for (idx = 0; idx < CRC32C_LANE; idx += 8) {
+            memcpy(&word, bytes + idx, sizeof(word));
+            memcpy(&word1, bytes + CRC32C_LANE + idx, sizeof(word1));
+            memcpy(&word2, bytes + 2 * CRC32C_LANE + idx, sizeof(word2));
+            crc0 = _mm_crc32_u64(crc0, word);
+            crc1 = _mm_crc32_u64(crc1, word1);
+            crc2 = _mm_crc32_u64(crc2, word2);
+        }
+        crc = crc32c_shift(s_shift[1], (uint32_t)crc0) ^ crc32c_shift(s_shift[0], (uint32_t)crc1) ^
+              (uint32_t)crc2;
+        bytes += 3 * CRC32C_LANE;
+        len -= 3 * CRC32C_LANE;
+    }
+    while (len >= 8) {
+        memcpy(&word, bytes, sizeof(word));
+        crc = (uint32_t)_mm_crc32_u64(crc, word);
+        bytes += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        crc = _mm_crc32_u8(crc, *bytes++);
+    }
+    return crc;
+}
+#endif
+
+/**
+ * @brief Builds the tables and chooses the implementation.
+ */
+static void crc32c_init(void) {
+    static const uint8_t zeros[2 * CRC32C_LANE];
+    unsigned int byte, bit, table, lanes;
+    for (byte = 0; byte < 256; ++byte) {
+        uint32_t crc = byte;
+        for (bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0U - (crc & 1)));
+        }
+        s_tables[0][byte] = crc;
+    }
+    for (byte = 0; byte < 256; ++byte) {
+        for (table = 1; table < 8; ++table) {
+            uint32_t crc = s_tables[table - 1][byte];
+            s_tables[table][byte] = (crc >> 8) ^ s_tables[0][crc & 0xff];
+        }
+    }
+    /* Moving along zeros is linear, the tables are made of what it does to each bit */
+    for (lanes = 0; lanes < 2; ++lanes) {
+        uint32_t bits[32];
+        for (bit = 0; bit < 32; ++bit) {
+            bits[bit] = crc32c_update_table(1U << bit, zeros, (lanes + 1) * CRC32C_LANE);
+        }
+        for (table = 0; table < 4; ++table) {
+            for (byte = 0; byte < 256; ++byte) {
+                uint32_t crc = 0;
+                for (bit = 0; bit < 8; ++bit) {
+                    crc ^= bits[table * 8 + bit] & (0U - ((byte >> bit) & 1));
+                }
+                s_shift[lanes][table][byte] = crc;
+            }
+        }
+    }
+    s_update = crc32c_update_table;
+    s_name = "table";
+#if defined __x86_64__
+    if (__builtin_cpu_supports("sse4.2")) {
+        s_update = crc32c_update_sse42;
+        s_name = "sse4.2";
+    }
+#endif
+}
+
+uint32_t nt_crc32c(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&s_tables_once, crc32c_init);
+    return ~s_update(~crc, data, len);
+}
+
+uint32_t nt_crc32c_table(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&s_tables_once, crc32c_init);
+    return ~crc32c_update_table(~crc, data, len);
+}
+
+const char *nt_crc32c_name(void) {
+    pthread_once(&s_tables_once, crc32c_init);
+    return s_name;
+}
+
+/** @} */
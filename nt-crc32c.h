@@ -0,0 +1,60 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-crc32c.h
+ * @brief CRC-32C checksum's header file
+ * @details The Castagnoli CRC, as used by iSCSI, ext4 and btrfs, reflected, with an initial
+ * value and a final xor of all ones. It catches any burst error of up to 32 bits and every
+ * error of an odd number of bits. It is computed with the SSE4.2 instruction where the
+ * processor has it, eight bytes at a time from eight tables otherwise.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#ifndef NT_CRC32C_H
+#define NT_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/**
+ * @brief Extends a checksum over more data.
+ * @details The checksum of data given in pieces is that of the data given at once:
+ * @c nt_crc32c(nt_crc32c(0, a, len_a), b, len_b) equals the checksum of @c a followed by
+ * @c b.
+ * @param crc checksum of the data so far, 0 to start.
+ * @param data the data.
+ * @param len its length.
+ * @return Checksum of the data so far followed by @p data.
+ */
+uint32_t nt_crc32c(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief Extends a checksum over more data, from the tables whatever the processor.
+ * @details Same result as @ref nt_crc32c(), for comparing the implementations.
+ * @param crc checksum of the data so far, 0 to start.
+ * @param data the data.
+ * @param len its length.
+ * @return Checksum of the data so far followed by @p data.
+ */
+uint32_t nt_crc32c_table(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief Returns the name of the implementation @ref nt_crc32c() uses.
+ * @return @c "sse4.2" or @c "table".
+ */
+const char *nt_crc32c_name(void);
+
+/** @} */
+
+#endif /* NT_CRC32C_H */
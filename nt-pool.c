@@ -0,0 +1,325 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-pool.c
+ * @brief Naive slab pool's implementation file
+ * @details The pool reserves one contiguous range of address space (the arena) and splits it
+ * into slabs of @ref NT_POOL_SLAB_SIZE bytes. Each slab serves blocks of a single size class.
+ * The descriptor of a slab is found from a block address with a shift, so blocks carry no
+ * header and keep their natural alignment.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#if defined __FreeBSD__
+#include <malloc_np.h>
+#else
+#include <malloc.h>
+#endif
+
+#include "nt-pool.h"
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief log2 of @ref NT_POOL_SLAB_SIZE */
+#define SLAB_SHIFT (21)
+
+/**
+ * @brief Slab descriptor.
+ * @details Descriptors live outside of the arena, in an array indexed by slab number.
+ */
+struct nt_pool_slab {
+    struct nt_pool_slab *next_; /**< Next slab on the partial or free list */
+    struct nt_pool_slab *prev_; /**< Previous slab on the partial list */
+    void *free_;                /**< Singly linked list of returned blocks */
+    uint32_t live_;             /**< Number of blocks handed out */
+    uint32_t bump_;             /**< Number of blocks ever carved from this slab */
+    int cls_;                   /**< Size class, or -1 if the slab is unused */
+};
+
+/**
+ * @brief The process wide pool.
+ */
+static struct {
+    pthread_mutex_t lock_;                            /**< Guards everything below */
+    int initialised_;                                 /**< Set once the arena is reserved */
+    nt_pool_config_t config_;                         /**< Active configuration */
+    uint8_t *base_;                                   /**< First byte of the arena */
+    size_t n_slabs_;                                  /**< Number of slabs in the arena */
+    size_t n_carved_;                                 /**< Slabs ever taken from the arena */
+    struct nt_pool_slab *slabs_;                      /**< Descriptors of all slabs */
+    struct nt_pool_slab *free_slabs_;                 /**< Slabs returned to the arena */
+    struct nt_pool_slab *partial_[NT_POOL_CLASSES];   /**< Slabs with free blocks per class */
+    nt_pool_stats_t stats_;                           /**< Running statistics */
+} g_pool = {.lock_ = PTHREAD_MUTEX_INITIALIZER, .config_ = {NT_POOL_DEFAULT_ARENA_SIZE, 0}};
+
+static inline size_t class_block_size(int cls) { return (size_t)1 << (cls + NT_POOL_MIN_SHIFT); }
+
+static inline uint32_t class_block_count(int cls) {
+    return (uint32_t)(NT_POOL_SLAB_SIZE >> (cls + NT_POOL_MIN_SHIFT));
+}
+
+/**
+ * @brief Returns the size class for a request, or -1 if it does not fit into any.
+ */
+static inline int size_to_class(size_t size) {
+    int shift = NT_POOL_MIN_SHIFT;
+    if (size > ((size_t)1 << NT_POOL_MAX_SHIFT)) {
+        return -1;
+    }
+    if (size > ((size_t)1 << NT_POOL_MIN_SHIFT)) {
+        shift = (int)(8 * sizeof(unsigned long)) - __builtin_clzl((unsigned long)size - 1);
+    }
+    return shift - NT_POOL_MIN_SHIFT;
+}
+
+static inline int is_in_arena(const void *ptr) {
+    return g_pool.initialised_ && (const uint8_t *)ptr >= g_pool.base_ &&
+           (const uint8_t *)ptr < g_pool.base_ + (g_pool.n_slabs_ << SLAB_SHIFT);
+}
+
+static inline struct nt_pool_slab *slab_of(const void *ptr) {
+    return &g_pool.slabs_[((const uint8_t *)ptr - g_pool.base_) >> SLAB_SHIFT];
+}
+
+static inline uint8_t *slab_base(const struct nt_pool_slab *slab) {
+    return g_pool.base_ + ((size_t)(slab - g_pool.slabs_) << SLAB_SHIFT);
+}
+
+/**
+ * @brief Reserves the arena, called with the lock held.
+ * @details The reservation is over-sized by one slab so that it can be trimmed to a
+ * slab aligned range.
+ */
+static int pool_init_locked(void) {
+    size_t n_slabs = (g_pool.config_.arena_size_ + NT_POOL_SLAB_SIZE - 1) >> SLAB_SHIFT;
+    size_t size = n_slabs << SLAB_SHIFT;
+    uint8_t *raw, *aligned;
+    if (0 == n_slabs) {
+        errno = EINVAL;
+        return -1;
+    }
+    raw = mmap(NULL, size + NT_POOL_SLAB_SIZE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == raw) {
+        return -1;
+    }
+    aligned = (uint8_t *)(((uintptr_t)raw + NT_POOL_SLAB_SIZE - 1) & ~(NT_POOL_SLAB_SIZE - 1));
+    if (aligned != raw) {
+        munmap(raw, aligned - raw);
+    }
+    munmap(aligned + size, (raw + NT_POOL_SLAB_SIZE) - aligned);
+    g_pool.slabs_ = calloc(n_slabs, sizeof(struct nt_pool_slab));
+    if (NULL == g_pool.slabs_) {
+        munmap(aligned, size);
+        errno = ENOMEM;
+        return -1;
+    }
+#if defined MADV_HUGEPAGE
+    if (g_pool.config_.hugepages_) {
+        /* Best effort: transparent huge pages might be disabled system wide */
+        madvise(aligned, size, MADV_HUGEPAGE);
+    }
+#endif
+    g_pool.base_ = aligned;
+    g_pool.n_slabs_ = n_slabs;
+    g_pool.initialised_ = 1;
+    for (int cls = 0; cls < NT_POOL_CLASSES; ++cls) {
+        g_pool.stats_.classes_[cls].block_size_ = class_block_size(cls);
+    }
+    return 0;
+}
+
+static void partial_push(int cls, struct nt_pool_slab *slab) {
+    slab->prev_ = NULL;
+    slab->next_ = g_pool.partial_[cls];
+    if (NULL != slab->next_) {
+        slab->next_->prev_ = slab;
+    }
+    g_pool.partial_[cls] = slab;
+}
+
+static void partial_remove(int cls, struct nt_pool_slab *slab) {
+    if (NULL != slab->prev_) {
+        slab->prev_->next_ = slab->next_;
+    } else {
+        g_pool.partial_[cls] = slab->next_;
+    }
+    if (NULL != slab->next_) {
+        slab->next_->prev_ = slab->prev_;
+    }
+    slab->next_ = slab->prev_ = NULL;
+}
+
+/**
+ * @brief Takes a fresh slab for a size class, called with the lock held.
+ * @return The slab, already on the partial list, or @c NULL if the arena is exhausted.
+ */
+static struct nt_pool_slab *slab_get_locked(int cls) {
+    struct nt_pool_slab *slab = g_pool.free_slabs_;
+    if (NULL != slab) {
+        g_pool.free_slabs_ = slab->next_;
+    } else if (g_pool.n_carved_ < g_pool.n_slabs_) {
+        slab = &g_pool.slabs_[g_pool.n_carved_++];
+    } else {
+        return NULL;
+    }
+    slab->free_ = NULL;
+    slab->live_ = 0;
+    slab->bump_ = 0;
+    slab->cls_ = cls;
+    partial_push(cls, slab);
+    if (++g_pool.stats_.slabs_in_use_ > g_pool.stats_.slabs_high_water_) {
+        g_pool.stats_.slabs_high_water_ = g_pool.stats_.slabs_in_use_;
+    }
+    return slab;
+}
+
+/**
+ * @brief Gives an empty slab back to the arena, called with the lock held.
+ */
+static void slab_put_locked(struct nt_pool_slab *slab) {
+    partial_remove(slab->cls_, slab);
+    madvise(slab_base(slab), NT_POOL_SLAB_SIZE, MADV_DONTNEED);
+    slab->cls_ = -1;
+    slab->next_ = g_pool.free_slabs_;
+    g_pool.free_slabs_ = slab;
+    --g_pool.stats_.slabs_in_use_;
+}
+
+static void *oversize_alloc(size_t size) {
+    void *ptr = malloc(size);
+    if (NULL != ptr) {
+        pthread_mutex_lock(&g_pool.lock_);
+        ++g_pool.stats_.oversize_in_use_;
+        pthread_mutex_unlock(&g_pool.lock_);
+    } else {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+int nt_pool_configure(const nt_pool_config_t *config) {
+    int result = -1;
+    pthread_mutex_lock(&g_pool.lock_);
+    if (!g_pool.initialised_) {
+        g_pool.config_ = *config;
+        result = pool_init_locked();
+    } else {
+        errno = EBUSY;
+    }
+    pthread_mutex_unlock(&g_pool.lock_);
+    return result;
+}
+
+void *nt_pool_alloc(size_t size) {
+    int cls = size_to_class(0 == size ? 1 : size);
+    struct nt_pool_slab *slab;
+    void *block;
+    if (cls < 0) {
+        return oversize_alloc(size);
+    }
+    pthread_mutex_lock(&g_pool.lock_);
+    if (!g_pool.initialised_ && 0 != pool_init_locked()) {
+        pthread_mutex_unlock(&g_pool.lock_);
+        return oversize_alloc(size);
+    }
+    slab = g_pool.partial_[cls];
+    if (NULL == slab && NULL == (slab = slab_get_locked(cls))) {
+        pthread_mutex_unlock(&g_pool.lock_);
+        return oversize_alloc(size);
+    }
+    if (NULL != slab->free_) {
+        block = slab->free_;
+        slab->free_ = *(void **)block;
+    } else {
+        block = slab_base(slab) + ((size_t)slab->bump_++ << (cls + NT_POOL_MIN_SHIFT));
+    }
+    if (++slab->live_ == class_block_count(cls)) {
+        partial_remove(cls, slab);
+    }
+    nt_pool_class_stats_t *cs = &g_pool.stats_.classes_[cls];
+    if (++cs->in_use_ > cs->high_water_) {
+        cs->high_water_ = cs->in_use_;
+    }
+    g_pool.stats_.bytes_in_use_ += cs->block_size_;
+    if (g_pool.stats_.bytes_in_use_ > g_pool.stats_.bytes_high_water_) {
+        g_pool.stats_.bytes_high_water_ = g_pool.stats_.bytes_in_use_;
+    }
+    pthread_mutex_unlock(&g_pool.lock_);
+    return block;
+}
+
+void *nt_pool_zalloc(size_t size) {
+    void *ptr = nt_pool_alloc(size);
+    if (NULL != ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+void nt_pool_free(void *ptr) {
+    struct nt_pool_slab *slab;
+    int cls;
+    if (NULL == ptr) {
+        return;
+    }
+    pthread_mutex_lock(&g_pool.lock_);
+    if (!is_in_arena(ptr)) {
+        --g_pool.stats_.oversize_in_use_;
+        pthread_mutex_unlock(&g_pool.lock_);
+        free(ptr);
+        return;
+    }
+    slab = slab_of(ptr);
+    cls = slab->cls_;
+    if (slab->live_ == class_block_count(cls)) {
+        partial_push(cls, slab);
+    }
+    *(void **)ptr = slab->free_;
+    slab->free_ = ptr;
+    --g_pool.stats_.classes_[cls].in_use_;
+    g_pool.stats_.bytes_in_use_ -= class_block_size(cls);
+    /* Keep the last slab of a class around, so a session that frees and reallocates
+     * its buffers does not bounce pages to and from the kernel */
+    if (0 == --slab->live_ && (g_pool.partial_[cls] != slab || NULL != slab->next_)) {
+        slab_put_locked(slab);
+    }
+    pthread_mutex_unlock(&g_pool.lock_);
+}
+
+size_t nt_pool_usable_size(const void *ptr) {
+    size_t result = 0;
+    if (NULL != ptr) {
+        pthread_mutex_lock(&g_pool.lock_);
+        if (is_in_arena(ptr)) {
+            result = class_block_size(slab_of(ptr)->cls_);
+        } else {
+            result = malloc_usable_size((void *)ptr);
+        }
+        pthread_mutex_unlock(&g_pool.lock_);
+    }
+    return result;
+}
+
+void nt_pool_get_stats(nt_pool_stats_t *stats) {
+    pthread_mutex_lock(&g_pool.lock_);
+    *stats = g_pool.stats_;
+    pthread_mutex_unlock(&g_pool.lock_);
+}
+
+/** @} */
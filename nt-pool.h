@@ -0,0 +1,131 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-pool.h
+ * @brief Naive slab pool's header file
+ * @details Contains declarations for a process wide slab allocator with power-of-two
+ * size classes. Buffers, bitmaps and session objects are carved from it, so that the
+ * memory released by one session is recycled by the next one instead of fragmenting
+ * the C library heap.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#ifndef NT_POOL_H
+#define NT_POOL_H
+
+#include <stddef.h>
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief log2 of the smallest size class. */
+#define NT_POOL_MIN_SHIFT (6)
+
+/** @brief log2 of the largest size class. */
+#define NT_POOL_MAX_SHIFT (20)
+
+/** @brief Number of size classes, from 64 bytes up to 1 MiB. */
+#define NT_POOL_CLASSES (NT_POOL_MAX_SHIFT - NT_POOL_MIN_SHIFT + 1)
+
+/**
+ * @brief Size of a single slab.
+ * @details Slabs are aligned to their size, which equals the size of a huge page on x86-64,
+ * so every block is aligned to its own (power-of-two) size.
+ */
+#define NT_POOL_SLAB_SIZE (1UL << 21)
+
+/** @brief Default amount of address space reserved for the arena, 256 MiB. */
+#define NT_POOL_DEFAULT_ARENA_SIZE (256UL << 20)
+
+/**
+ * @brief Pool configuration.
+ */
+typedef struct nt_pool_config_t {
+    size_t arena_size_; /**< Amount of address space reserved for slabs, rounded to slabs */
+    int hugepages_;     /**< If non-zero, the arena is backed by huge pages, if possible */
+} nt_pool_config_t;
+
+/**
+ * @brief Per size class statistics.
+ */
+typedef struct nt_pool_class_stats_t {
+    size_t block_size_; /**< Size of a block in this class */
+    size_t in_use_;     /**< Number of blocks currently handed out */
+    size_t high_water_; /**< Maximal number of blocks handed out at the same time */
+} nt_pool_class_stats_t;
+
+/**
+ * @brief Pool statistics.
+ */
+typedef struct nt_pool_stats_t {
+    nt_pool_class_stats_t classes_[NT_POOL_CLASSES]; /**< Per size class figures */
+    size_t slabs_in_use_;     /**< Number of slabs backing the size classes */
+    size_t slabs_high_water_; /**< Maximal number of slabs in use at the same time */
+    size_t bytes_in_use_;     /**< Bytes handed out, rounded up to the block size */
+    size_t bytes_high_water_; /**< Maximal value of @c bytes_in_use_ */
+    size_t oversize_in_use_;  /**< Allocations that did not fit into any size class */
+} nt_pool_stats_t;
+
+/**
+ * @brief Configures the pool.
+ * @details Must be called before the first allocation, otherwise the defaults are used:
+ * @ref NT_POOL_DEFAULT_ARENA_SIZE of reserved (not committed) address space, no huge pages.
+ * @param[in] config the configuration to use.
+ * @return Returned values:
+ * - 0 on success;
+ * - -1 on failure, @c errno is set to @c EBUSY if the pool is already in use, or to the
+ * reason the arena could not be reserved.
+ */
+int nt_pool_configure(const nt_pool_config_t *config);
+
+/**
+ * @brief Allocates a block of at least @c size bytes.
+ * @details Requests up to 1 MiB are served from the slab of the smallest fitting size class.
+ * Larger requests, and requests that do not fit into the arena anymore, fall back to
+ * @c malloc().
+ * @param size requested size in bytes.
+ * @return Pointer to the block or @c NULL, with @c errno set to @c ENOMEM.
+ * @sa nt_pool_free()
+ */
+void *nt_pool_alloc(size_t size);
+
+/**
+ * @brief Same as @ref nt_pool_alloc(), but the returned block is zeroed.
+ * @param size requested size in bytes.
+ * @return Pointer to the block or @c NULL.
+ */
+void *nt_pool_zalloc(size_t size);
+
+/**
+ * @brief Returns a block to the pool.
+ * @details Passing @c NULL is a no operation. Slabs that become empty give their pages
+ * back to the kernel.
+ * @param ptr block previously returned by @ref nt_pool_alloc() or @ref nt_pool_zalloc().
+ */
+void nt_pool_free(void *ptr);
+
+/**
+ * @brief Returns the number of bytes usable in a block.
+ * @param ptr block previously returned by @ref nt_pool_alloc().
+ * @return Size of the block's class, or the size reported by the C library for blocks that
+ * were served by @c malloc().
+ */
+size_t nt_pool_usable_size(const void *ptr);
+
+/**
+ * @brief Takes a snapshot of the pool statistics.
+ * @param[out] stats the statistics.
+ */
+void nt_pool_get_stats(nt_pool_stats_t *stats);
+
+/** @} */
+
+#endif /* NT_POOL_H */
@@ -0,0 +1,456 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-redact.c
+ * @brief Streaming multi-pattern redaction implementation file
+ * @details Bytes that occur in no pattern share one input class, every other byte gets a class
+ * of its own, which keeps the transition table at a few dozen columns for typical pattern sets.
+ * @n
+ * Most of the stream leaves the automaton in its root state. There, the redactor looks for the
+ * next byte that starts a pattern with a shufti scan (two nibble lookups with @c pshufb), then
+ * checks the byte pair against a bitmap of pattern prefixes before handing over to the
+ * automaton. When so many bytes start a pattern that shufti finds a candidate at nearly every
+ * position, which is typical of hundreds of alphanumeric secrets, the pair bitmap is checked
+ * at every position instead. Skipping bytes in the root state is exact: a byte that starts no
+ * pattern, or a pair that begins none, leads back to the root anyway.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined __SSSE3__
+#include <immintrin.h>
+#endif
+
+#include "nt-pool.h"
+#include "nt-redact.h"
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief Marks a transition not resolved yet. */
+#define NO_STATE (0xffffffffU)
+
+/** @brief The root state. */
+#define ROOT (0)
+
+/**
+ * @brief Number of distinct starting bytes past which shufti stops paying off.
+ * @details With that many, nearly every byte of text is a candidate.
+ */
+#define DENSE_FIRST_BYTES (16)
+
+/**
+ * @brief A compiled set of patterns.
+ */
+struct nt_redact_set {
+    uint32_t n_states_;          /**< Number of states */
+    uint32_t n_classes_;         /**< Number of input classes */
+    uint16_t class_[256];        /**< Input class of each byte */
+    uint8_t first_[256];         /**< Non-zero for bytes that start a pattern */
+    uint8_t shufti_lo_[16];      /**< Buckets of starting bytes, by their low nibble */
+    uint8_t shufti_hi_[16];      /**< Buckets of starting bytes, by their high nibble */
+    int pair_filter_;            /**< Non-zero if every pattern is at least 2 bytes long */
+    int dense_;                  /**< Non-zero if too many bytes start a pattern for shufti */
+    uint64_t pairs_[1U << 10];   /**< Bitmap of the first two bytes of patterns */
+    uint32_t *delta_;            /**< Transitions, @c n_classes_ per state */
+    uint16_t *depth_;            /**< Length of the pattern prefix each state stands for */
+    uint16_t *match_len_;        /**< Length of the longest match ending in a state, or 0 */
+    uint8_t *token_;             /**< Non-zero if that match is a token prefix */
+};
+
+/**
+ * @brief Tells whether a byte belongs to a token following a token prefix.
+ * @details Tokens end at white space, control characters, quotes and non-ASCII bytes.
+ */
+static inline int is_token_byte(uint8_t byte) {
+    return byte > ' ' && byte < 0x7f && '"' != byte && '\'' != byte && '`' != byte;
+}
+
+/**
+ * @brief Finds the next byte that starts a pattern.
+ * @param set the patterns.
+ * @param p start of the input.
+ * @param end end of the input.
+ * @return Address of the byte, or @p end. A few other bytes may be reported as well.
+ */
+static inline const uint8_t *find_first(const struct nt_redact_set *set, const uint8_t *p,
+                                        const uint8_t *end) {
+#if defined __AVX2__
+    const __m256i lo_tbl32 =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->shufti_lo_));
+    const __m256i hi_tbl32 =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->shufti_hi_));
+    const __m256i nibble32 = _mm256_set1_epi8(0x0f);
+    while (end - p >= 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)p);
+        __m256i lo = _mm256_shuffle_epi8(lo_tbl32, _mm256_and_si256(bytes, nibble32));
+        __m256i hi = _mm256_shuffle_epi8(
+            hi_tbl32, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble32));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256()));
+        if (0 != mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined __SSSE3__
+    const __m128i lo_tbl = _mm_loadu_si128((const __m128i *)set->shufti_lo_);
+    const __m128i hi_tbl = _mm_loadu_si128((const __m128i *)set->shufti_hi_);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    while (end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+        __m128i lo = _mm_shuffle_epi8(lo_tbl, _mm_and_si128(bytes, nibble));
+        __m128i hi = _mm_shuffle_epi8(hi_tbl, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+        /* A byte is a candidate if its two nibbles share a bucket */
+        uint32_t mask = 0xffffU ^ (uint32_t)_mm_movemask_epi8(
+                                      _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128()));
+        if (0 != mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && !set->first_[*p]) {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * @brief Skips the bytes that leave the automaton in its root state.
+ * @return Address of the first byte that may not, or @p end.
+ */
+static inline const uint8_t *skip_root(const struct nt_redact_set *set, const uint8_t *p,
+                                       const uint8_t *end) {
+    if (set->dense_ && set->pair_filter_) {
+        /* Most bytes are candidates, checking pairs straight away is cheaper */
+        for (; end - p >= 2; ++p) {
+            unsigned int pair = (unsigned int)p[0] << 8 | p[1];
+            if (set->pairs_[pair >> 6] & (1ULL << (pair & 63))) {
+                return p;
+            }
+        }
+        return p;
+    }
+    for (;;) {
+        p = find_first(set, p, end);
+        if (end - p < 2 || !set->pair_filter_) {
+            return p;
+        }
+        unsigned int pair = (unsigned int)p[0] << 8 | p[1];
+        if (set->pairs_[pair >> 6] & (1ULL << (pair & 63))) {
+            return p;
+        }
+        ++p;
+    }
+}
+
+nt_redact_set_t nt_redact_compile(const nt_redact_pattern_t *patterns, size_t count) {
+    struct nt_redact_set *set;
+    uint32_t *fail = NULL, *queue = NULL;
+    size_t total = 1, idx, pos, head = 0, tail = 0;
+    uint32_t cls, nc;
+    for (idx = 0; idx < count; ++idx) {
+        if (0 == patterns[idx].len_ || patterns[idx].len_ > NT_REDACT_MAX_PATTERN) {
+            errno = EINVAL;
+            return NULL;
+        }
+        total += patterns[idx].len_;
+    }
+    set = nt_pool_zalloc(sizeof(struct nt_redact_set));
+    if (NULL == set) {
+        return NULL;
+    }
+    for (idx = 0; idx < count; ++idx) {
+        for (pos = 0; pos < patterns[idx].len_; ++pos) {
+            uint8_t byte = patterns[idx].bytes_[pos];
+            if (0 == set->class_[byte]) {
+                set->class_[byte] = (uint16_t)++set->n_classes_;
+            }
+        }
+    }
+    nc = ++set->n_classes_;
+    set->delta_ = nt_pool_alloc(total * nc * sizeof(uint32_t));
+    set->depth_ = nt_pool_zalloc(total * sizeof(uint16_t));
+    set->match_len_ = nt_pool_zalloc(total * sizeof(uint16_t));
+    set->token_ = nt_pool_zalloc(total);
+    fail = nt_pool_alloc(total * sizeof(uint32_t));
+    queue = nt_pool_alloc(total * sizeof(uint32_t));
+    if (NULL == set->delta_ || NULL == set->depth_ || NULL == set->match_len_ ||
+        NULL == set->token_ || NULL == fail || NULL == queue) {
+        nt_pool_free(queue);
+        nt_pool_free(fail);
+        nt_redact_free(set);
+        return NULL;
+    }
+    memset(set->delta_, 0xff, total * nc * sizeof(uint32_t));
+    /* Build the trie */
+    set->n_states_ = 1;
+    set->pair_filter_ = 1;
+    for (idx = 0; idx < count; ++idx) {
+        const nt_redact_pattern_t *pattern = &patterns[idx];
+        uint32_t state = ROOT;
+        for (pos = 0; pos < pattern->len_; ++pos) {
+            uint32_t *next = &set->delta_[state * nc + set->class_[pattern->bytes_[pos]]];
+            if (NO_STATE == *next) {
+                *next = set->n_states_++;
+                set->depth_[*next] = (uint16_t)(set->depth_[state] + 1);
+            }
+            state = *next;
+        }
+        set->match_len_[state] = (uint16_t)pattern->len_;
+        set->token_[state] |= 0 != pattern->token_;
+        set->first_[pattern->bytes_[0]] = 1;
+        if (pattern->len_ < 2) {
+            set->pair_filter_ = 0;
+        } else {
+            unsigned int pair = (unsigned int)pattern->bytes_[0] << 8 | pattern->bytes_[1];
+            set->pairs_[pair >> 6] |= 1ULL << (pair & 63);
+        }
+    }
+    /* Resolve every transition, breadth first so that failure states come first */
+    for (cls = 0; cls < nc; ++cls) {
+        uint32_t *next = &set->delta_[ROOT * nc + cls];
+        if (NO_STATE == *next) {
+            *next = ROOT;
+        } else {
+            fail[*next] = ROOT;
+            queue[tail++] = *next;
+        }
+    }
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        uint32_t failure = fail[state];
+        if (0 == set->match_len_[state]) {
+            /* The longest match ending here is the one ending in the failure state */
+            set->match_len_[state] = set->match_len_[failure];
+            set->token_[state] = set->token_[failure];
+        }
+        for (cls = 0; cls < nc; ++cls) {
+            uint32_t *next = &set->delta_[state * nc + cls];
+            if (NO_STATE == *next) {
+                *next = set->delta_[failure * nc + cls];
+            } else {
+                fail[*next] = set->delta_[failure * nc + cls];
+                queue[tail++] = *next;
+            }
+        }
+    }
+    nt_pool_free(queue);
+    nt_pool_free(fail);
+    /* Shufti buckets; high nibbles 8 apart share a bucket, which only adds candidates */
+    for (idx = 0; idx < 256; ++idx) {
+        set->dense_ += set->first_[idx];
+        if (set->first_[idx]) {
+            set->shufti_lo_[idx & 0x0f] |= (uint8_t)(1U << ((idx >> 4) & 7));
+            set->shufti_hi_[idx >> 4] |= (uint8_t)(1U << ((idx >> 4) & 7));
+        }
+    }
+    set->dense_ = set->dense_ > DENSE_FIRST_BYTES;
+    return set;
+}
+
+/**
+ * @brief Decodes a pattern from a line of the pattern file.
+ * @return Length of the pattern or 0 if it is malformed.
+ */
+static size_t decode_pattern(const char *text, uint8_t *out) {
+    size_t len = 0;
+    while ('\0' != *text) {
+        uint8_t byte = (uint8_t)*text++;
+        if ('\\' == byte) {
+            switch (*text++) {
+            case 's':
+                byte = ' ';
+                break;
+            case 't':
+                byte = '\t';
+                break;
+            case '\\':
+                byte = '\\';
+                break;
+            case 'x': {
+                char hex[3] = {0, 0, 0};
+                char *end;
+                if ('\0' == text[0] || '\0' == text[1]) {
+                    return 0;
+                }
+                memcpy(hex, text, 2);
+                byte = (uint8_t)strtoul(hex, &end, 16);
+                if ('\0' != *end) {
+                    return 0;
+                }
+                text += 2;
+                break;
+            }
+            default:
+                return 0;
+            }
+        }
+        if (len == NT_REDACT_MAX_PATTERN) {
+            return 0;
+        }
+        out[len++] = byte;
+    }
+    return len;
+}
+
+nt_redact_set_t nt_redact_load(const char *file_name) {
+    FILE *file = fopen(file_name, "r");
+    char line[4 * NT_REDACT_MAX_PATTERN + 16];
+    nt_redact_pattern_t *patterns = NULL;
+    size_t count = 0, capacity = 0, idx;
+    nt_redact_set_t set = NULL;
+    int error = 0;
+    if (NULL == file) {
+        return NULL;
+    }
+    while (0 == error && NULL != fgets(line, sizeof(line), file)) {
+        char *text = line + strspn(line, " \t");
+        char *value;
+        size_t len = strcspn(text, "\r\n");
+        while (len > 0 && (' ' == text[len - 1] || '\t' == text[len - 1])) {
+            --len;
+        }
+        text[len] = '\0';
+        if ('\0' == *text || '#' == *text) {
+            continue;
+        }
+        value = text + strcspn(text, " \t");
+        if ('\0' != *value) {
+            *value++ = '\0';
+            value += strspn(value, " \t");
+        }
+        if (count == capacity) {
+            nt_redact_pattern_t *grown;
+            capacity = 0 == capacity ? 64 : 2 * capacity;
+            grown = realloc(patterns, capacity * sizeof(nt_redact_pattern_t));
+            if (NULL == grown) {
+                error = errno;
+                break;
+            }
+            patterns = grown;
+        }
+        nt_redact_pattern_t *pattern = &patterns[count];
+        pattern->token_ = 0 == strcmp(text, "token");
+        if (!pattern->token_ && 0 != strcmp(text, "literal")) {
+            error = EINVAL;
+            break;
+        }
+        uint8_t *bytes = malloc(NT_REDACT_MAX_PATTERN);
+        if (NULL == bytes) {
+            error = errno;
+            break;
+        }
+        pattern->bytes_ = bytes;
+        pattern->len_ = decode_pattern(value, bytes);
+        ++count;
+        if (0 == pattern->len_) {
+            error = EINVAL;
+        }
+    }
+    if (0 == error && ferror(file)) {
+        error = EIO;
+    }
+    fclose(file);
+    if (0 == error) {
+        set = nt_redact_compile(patterns, count);
+        error = NULL == set ? errno : 0;
+    }
+    for (idx = 0; idx < count; ++idx) {
+        free((void *)patterns[idx].bytes_);
+    }
+    free(patterns);
+    errno = error;
+    return set;
+}
+
+void nt_redact_free(nt_redact_set_t set) {
+    if (NULL == set) {
+        return;
+    }
+    nt_pool_free(set->token_);
+    nt_pool_free(set->match_len_);
+    nt_pool_free(set->depth_);
+    nt_pool_free(set->delta_);
+    nt_pool_free(set);
+}
+
+size_t nt_redact_states(nt_redact_set_t set) { return set->n_states_; }
+
+void nt_redact_init(nt_redact_t *redact, nt_redact_set_t set) {
+    redact->set_ = set;
+    redact->state_ = ROOT;
+    redact->in_token_ = 0;
+    redact->hold_len_ = 0;
+    redact->matches_ = 0;
+}
+
+size_t nt_redact_feed(nt_redact_t *redact, const void *input, size_t len, void *output) {
+    const struct nt_redact_set *set = redact->set_;
+    const uint32_t nc = set->n_classes_;
+    uint8_t *out = output;
+    size_t total = redact->hold_len_ + len;
+    uint8_t *p = out + redact->hold_len_;
+    uint8_t *end = out + total;
+    uint32_t state = redact->state_;
+    int in_token = redact->in_token_;
+    size_t keep;
+    /* The output doubles as the working buffer, matches are masked in place */
+    memcpy(out, redact->hold_, redact->hold_len_);
+    memcpy(p, input, len);
+    while (p < end) {
+        if (in_token) {
+            if (is_token_byte(*p)) {
+                *p++ = NT_REDACT_MASK;
+                continue;
+            }
+            in_token = 0;
+        }
+        if (ROOT == state) {
+            p = (uint8_t *)skip_root(set, p, end);
+            if (p == end) {
+                break;
+            }
+        }
+        state = set->delta_[state * nc + set->class_[*p++]];
+        if (0 != set->match_len_[state]) {
+            /* The match lies within the current state's depth, all of it is still here */
+            memset(p - set->match_len_[state], NT_REDACT_MASK, set->match_len_[state]);
+            ++redact->matches_;
+            if (set->token_[state]) {
+                in_token = 1;
+                state = ROOT;
+            }
+        }
+    }
+    keep = set->depth_[state];
+    memcpy(redact->hold_, out + total - keep, keep);
+    redact->hold_len_ = keep;
+    redact->state_ = state;
+    redact->in_token_ = in_token;
+    return total - keep;
+}
+
+size_t nt_redact_finish(nt_redact_t *redact, void *output) {
+    size_t len = redact->hold_len_;
+    memcpy(output, redact->hold_, len);
+    redact->hold_len_ = 0;
+    redact->state_ = ROOT;
+    redact->in_token_ = 0;
+    return len;
+}
+
+/** @} */
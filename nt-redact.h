@@ -0,0 +1,132 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-redact.h
+ * @brief Streaming multi-pattern redaction header file
+ * @details Masks every occurrence of a set of patterns in a stream of bytes, so that secrets
+ * never reach the disk. The patterns are compiled into an Aho-Corasick automaton with all
+ * transitions resolved (a DFA), which looks at every byte once, whatever the number of
+ * patterns. @n
+ * A pattern is either a literal, masked where it occurs, or a token prefix, masked together
+ * with the token that follows it, such as @c ghp_ for GitHub tokens. Masking replaces bytes
+ * with @ref NT_REDACT_MASK and never changes the length of the stream, so offsets into it stay
+ * valid. @n
+ * Matches may span chunk boundaries: the redactor holds back the bytes that could still turn
+ * out to be the beginning of a match, never more than the longest pattern.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#ifndef NT_REDACT_H
+#define NT_REDACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief Longest pattern accepted. */
+#define NT_REDACT_MAX_PATTERN (256)
+
+/** @brief Byte that replaces redacted ones. */
+#define NT_REDACT_MASK ('*')
+
+/**
+ * @brief Size of an output buffer large enough for a given input length.
+ */
+#define NT_REDACT_OUTPUT_SIZE(len) ((len) + NT_REDACT_MAX_PATTERN)
+
+/**
+ * @brief A pattern to redact.
+ */
+typedef struct nt_redact_pattern_t {
+    const uint8_t *bytes_; /**< The pattern */
+    size_t len_;           /**< Its length, up to @ref NT_REDACT_MAX_PATTERN */
+    int token_;            /**< Non-zero to mask the token that follows the pattern as well */
+} nt_redact_pattern_t;
+
+/**
+ * @brief A compiled, immutable set of patterns. It may be shared by many redactors.
+ */
+typedef struct nt_redact_set *nt_redact_set_t;
+
+/**
+ * @brief State of a redactor.
+ */
+typedef struct nt_redact_t {
+    nt_redact_set_t set_;                  /**< Patterns */
+    uint32_t state_;                       /**< State of the automaton */
+    int in_token_;                         /**< Non-zero while masking a token */
+    size_t hold_len_;                      /**< Length of @c hold_ */
+    uint64_t matches_;                     /**< Number of matches so far */
+    uint8_t hold_[NT_REDACT_MAX_PATTERN];  /**< Bytes held back, a match may start there */
+} nt_redact_t;
+
+/**
+ * @brief Compiles a set of patterns.
+ * @param patterns the patterns.
+ * @param count number of patterns.
+ * @return The set or @c NULL, with @c errno set.
+ */
+nt_redact_set_t nt_redact_compile(const nt_redact_pattern_t *patterns, size_t count);
+
+/**
+ * @brief Loads and compiles patterns from a file.
+ * @details Each line holds one pattern, either <tt>literal text</tt> or <tt>token prefix</tt>.
+ * Empty lines and lines starting with @c # are skipped. In the pattern, @c \\s stands for
+ * a space, @c \\t for a tab, @c \\\\ for a backslash and @c \\xNN for any byte.
+ * @param file_name name of the file.
+ * @return The set or @c NULL, with @c errno set; @c EINVAL for a malformed file.
+ */
+nt_redact_set_t nt_redact_load(const char *file_name);
+
+/**
+ * @brief Releases a set of patterns.
+ * @param set the set, may be @c NULL.
+ */
+void nt_redact_free(nt_redact_set_t set);
+
+/**
+ * @brief Returns the number of states of the automaton.
+ * @param set the set.
+ * @return Number of states.
+ */
+size_t nt_redact_states(nt_redact_set_t set);
+
+/**
+ * @brief Initialises a redactor.
+ * @param redact the redactor.
+ * @param set patterns to redact.
+ */
+void nt_redact_init(nt_redact_t *redact, nt_redact_set_t set);
+
+/**
+ * @brief Redacts a chunk of the stream.
+ * @details Bytes that may still be the beginning of a match are held back until the next call.
+ * @param redact the redactor.
+ * @param[in] input the chunk.
+ * @param len length of the chunk.
+ * @param[out] output buffer of at least @ref NT_REDACT_OUTPUT_SIZE(len) bytes.
+ * @return Number of bytes placed in @p output.
+ */
+size_t nt_redact_feed(nt_redact_t *redact, const void *input, size_t len, void *output);
+
+/**
+ * @brief Returns the bytes held back, at the end of the stream.
+ * @param redact the redactor.
+ * @param[out] output buffer of at least @ref NT_REDACT_MAX_PATTERN bytes.
+ * @return Number of bytes placed in @p output.
+ */
+size_t nt_redact_finish(nt_redact_t *redact, void *output);
+
+/** @} */
+
+#endif /* NT_REDACT_H */
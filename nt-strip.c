@@ -0,0 +1,280 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-strip.c
+ * @brief Terminal escape stripper's implementation file
+ * @details The escape sequence parser follows the ECMA-48 structure, as summarised in
+ * Paul Williams' DEC compatible parser: CSI sequences end with a byte from 0x40..0x7e,
+ * other escape sequences with a byte from 0x30..0x7e, and control strings (OSC, DCS, SOS, PM,
+ * APC) with ST or, as xterm allows, with BEL. 8-bit C1 controls are not recognised, as those
+ * bytes are UTF-8 continuation bytes in practice. @n
+ * Lines are built directly in the output buffer, where a carriage return just moves the write
+ * position back. Only the unfinished line at the end of a chunk is copied aside.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#include <string.h>
+#if defined __SSE2__
+#include <immintrin.h>
+#endif
+
+#include "nt-strip.h"
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/**
+ * @brief States of the escape sequence parser.
+ */
+enum strip_state_t {
+    STRIP_GROUND = 0,    /**< Plain text */
+    STRIP_ESC = 1,       /**< After ESC */
+    STRIP_ESC_INTER = 2, /**< In the intermediate bytes of an escape sequence */
+    STRIP_CSI = 3,       /**< In a control sequence */
+    STRIP_STRING = 4,    /**< In a control string */
+    STRIP_STRING_ESC = 5 /**< After ESC in a control string, possibly the start of ST */
+};
+
+/** @brief Escape. */
+#define C_ESC (0x1b)
+
+/** @brief Cancel, aborts an escape sequence. */
+#define C_CAN (0x18)
+
+/** @brief Substitute, aborts an escape sequence. */
+#define C_SUB (0x1a)
+
+/** @brief Bell, ends a control string in xterm. */
+#define C_BEL (0x07)
+
+/** @brief Delete. */
+#define C_DEL (0x7f)
+
+/** @brief Value of the CSI parameter that matches no sequence of interest. */
+#define CSI_PARAM_NONE (0xffffffffU)
+
+/**
+ * @brief Finds the first byte that is not printable text.
+ * @details Printable text is everything but the C0 controls and DEL. Bytes above DEL are left
+ * alone, they make up UTF-8 sequences.
+ * @param p start of the input.
+ * @param end end of the input.
+ * @return Address of the first control byte, or @p end.
+ */
+static inline const uint8_t *find_control(const uint8_t *p, const uint8_t *end) {
+#if defined __AVX2__
+    const __m256i limit32 = _mm256_set1_epi8(0x1f);
+    const __m256i del32 = _mm256_set1_epi8(C_DEL);
+    while (end - p >= 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)p);
+        __m256i below = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, limit32), bytes);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(below, _mm256_cmpeq_epi8(bytes, del32)));
+        if (0 != mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined __SSE2__
+    const __m128i limit = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(C_DEL);
+    while (end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+        /* min(x, 0x1f) == x holds exactly for the bytes below 0x20 */
+        __m128i below = _mm_cmpeq_epi8(_mm_min_epu8(bytes, limit), bytes);
+        uint32_t mask =
+            (uint32_t)_mm_movemask_epi8(_mm_or_si128(below, _mm_cmpeq_epi8(bytes, del)));
+        if (0 != mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p >= 0x20 && *p != C_DEL) {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * @brief The line being built in the output buffer.
+ */
+struct strip_line_t {
+    uint8_t *out_;  /**< Output buffer */
+    size_t start_;  /**< Start of the line in @c out_ */
+    size_t cursor_; /**< Write position, relative to @c start_ */
+    size_t fill_;   /**< Length of the line */
+};
+
+/**
+ * @brief Applies a C0 control to the line.
+ * @details Controls are executed in the middle of escape sequences too, as terminals do.
+ * Those other than line feed, carriage return, backspace and tab are dropped.
+ */
+static inline void apply_control(struct strip_line_t *line, uint8_t byte) {
+    switch (byte) {
+    case '\n':
+        line->out_[line->start_ + line->fill_] = '\n';
+        line->start_ += line->fill_ + 1;
+        line->fill_ = line->cursor_ = 0;
+        break;
+    case '\r':
+        line->cursor_ = 0;
+        break;
+    case '\b':
+        if (line->cursor_ > 0) {
+            --line->cursor_;
+        }
+        break;
+    case '\t':
+        line->out_[line->start_ + line->cursor_++] = byte;
+        if (line->cursor_ > line->fill_) {
+            line->fill_ = line->cursor_;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void nt_strip_init(nt_strip_t *strip) {
+    strip->state_ = STRIP_GROUND;
+    strip->param_ = 0;
+    strip->cursor_ = 0;
+    strip->line_len_ = 0;
+}
+
+size_t nt_strip_feed(nt_strip_t *strip, const void *input, size_t len, void *output) {
+    const uint8_t *in = input;
+    const uint8_t *end = in + len;
+    struct strip_line_t line = {output, 0, strip->cursor_, strip->line_len_};
+    uint8_t state = strip->state_;
+    uint32_t param = strip->param_;
+    memcpy(line.out_, strip->line_, line.fill_);
+    while (in < end) {
+        uint8_t byte;
+        if (STRIP_GROUND == state) {
+            const uint8_t *run_end = find_control(in, end);
+            if (run_end != in) {
+                memcpy(line.out_ + line.start_ + line.cursor_, in, (size_t)(run_end - in));
+                line.cursor_ += (size_t)(run_end - in);
+                if (line.cursor_ > line.fill_) {
+                    line.fill_ = line.cursor_;
+                }
+                in = run_end;
+                if (in == end) {
+                    break;
+                }
+            }
+            byte = *in++;
+            if (C_ESC == byte) {
+                state = STRIP_ESC;
+            } else {
+                apply_control(&line, byte);
+            }
+            continue;
+        }
+        byte = *in++;
+        if (C_CAN == byte || C_SUB == byte) {
+            state = STRIP_GROUND;
+            continue;
+        }
+        if (C_DEL == byte) {
+            continue;
+        }
+        if (byte < 0x20 && C_ESC != byte && STRIP_STRING != state) {
+            apply_control(&line, byte);
+            continue;
+        }
+        switch (state) {
+        case STRIP_ESC:
+            if ('[' == byte) {
+                state = STRIP_CSI;
+                param = 0;
+            } else if (']' == byte || 'P' == byte || 'X' == byte || '^' == byte || '_' == byte) {
+                state = STRIP_STRING;
+            } else if (byte >= 0x20 && byte <= 0x2f) {
+                state = STRIP_ESC_INTER;
+            } else if (C_ESC != byte) {
+                state = STRIP_GROUND;
+            }
+            break;
+        case STRIP_ESC_INTER:
+            if (C_ESC == byte) {
+                state = STRIP_ESC;
+            } else if (byte >= 0x30) {
+                state = STRIP_GROUND;
+            }
+            break;
+        case STRIP_CSI:
+            if (byte >= '0' && byte <= '9') {
+                if (param < CSI_PARAM_NONE / 10) {
+                    param = param * 10 + (uint32_t)(byte - '0');
+                }
+            } else if (byte >= ':' && byte <= '?') {
+                /* More than one parameter, or a private one: not an erase we know */
+                param = CSI_PARAM_NONE;
+            } else if (C_ESC == byte) {
+                state = STRIP_ESC;
+            } else if (byte >= 0x40) {
+                /* Erase in line is the only sequence with an effect on plain text */
+                if ('K' == byte && 0 == param) {
+                    line.fill_ = line.cursor_;
+                } else if ('K' == byte && 2 == param) {
+                    line.fill_ = line.cursor_ = 0;
+                }
+                state = STRIP_GROUND;
+            }
+            break;
+        case STRIP_STRING:
+            if (C_BEL == byte) {
+                state = STRIP_GROUND;
+            } else if (C_ESC == byte) {
+                state = STRIP_STRING_ESC;
+            }
+            break;
+        case STRIP_STRING_ESC:
+            if ('\\' == byte) {
+                state = STRIP_GROUND;
+            } else {
+                /* Not ST, the string is cut short by another escape sequence */
+                state = STRIP_ESC;
+                --in;
+            }
+            break;
+        default:
+            state = STRIP_GROUND;
+            break;
+        }
+    }
+    strip->state_ = state;
+    strip->param_ = param;
+    if (line.fill_ > NT_STRIP_LINE_MAX) {
+        /* Too long to carry over, give it out as it is */
+        strip->cursor_ = strip->line_len_ = 0;
+        return line.start_ + line.fill_;
+    }
+    memcpy(strip->line_, line.out_ + line.start_, line.fill_);
+    strip->cursor_ = line.cursor_;
+    strip->line_len_ = line.fill_;
+    return line.start_;
+}
+
+size_t nt_strip_finish(nt_strip_t *strip, void *output) {
+    size_t len = strip->line_len_;
+    memcpy(output, strip->line_, len);
+    strip->cursor_ = strip->line_len_ = 0;
+    strip->state_ = STRIP_GROUND;
+    return len;
+}
+
+/** @} */
@@ -0,0 +1,82 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-strip.h
+ * @brief Terminal escape stripper's header file
+ * @details Turns the output of a terminal session into plain text: escape sequences (CSI, OSC,
+ * DCS and friends) and control characters are dropped, and carriage returns, backspaces and
+ * line erasures are applied to the line they act on, so that a progress bar redrawn a hundred
+ * times ends up as its last state only. @n
+ * The stripper is a resumable state machine, input may be split anywhere. Runs of printable
+ * bytes are found with SIMD instructions where available.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#ifndef NT_STRIP_H
+#define NT_STRIP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/**
+ * @brief Longest unfinished line carried over between calls.
+ * @details A line growing past that is emitted as it is, later carriage returns can no longer
+ * rewrite its beginning.
+ */
+#define NT_STRIP_LINE_MAX (4096)
+
+/**
+ * @brief Size of an output buffer large enough for a given input length.
+ */
+#define NT_STRIP_OUTPUT_SIZE(len) ((len) + NT_STRIP_LINE_MAX)
+
+/**
+ * @brief State of a stripper.
+ */
+typedef struct nt_strip_t {
+    uint8_t state_;                   /**< State of the escape sequence parser */
+    uint32_t param_;                  /**< First numeric parameter of the current CSI */
+    size_t cursor_;                   /**< Cursor position within @c line_ */
+    size_t line_len_;                 /**< Length of @c line_ */
+    uint8_t line_[NT_STRIP_LINE_MAX]; /**< Unfinished line */
+} nt_strip_t;
+
+/**
+ * @brief Initialises a stripper.
+ * @param strip the stripper.
+ */
+void nt_strip_init(nt_strip_t *strip);
+
+/**
+ * @brief Strips a chunk of terminal output.
+ * @details Only complete lines are output, the unfinished one is kept until its end shows up.
+ * @param strip the stripper.
+ * @param[in] input the chunk.
+ * @param len length of the chunk.
+ * @param[out] output buffer of at least @ref NT_STRIP_OUTPUT_SIZE(len) bytes.
+ * @return Number of bytes placed in @p output.
+ */
+size_t nt_strip_feed(nt_strip_t *strip, const void *input, size_t len, void *output);
+
+/**
+ * @brief Returns the unfinished line, at the end of the input.
+ * @param strip the stripper.
+ * @param[out] output buffer of at least @ref NT_STRIP_LINE_MAX bytes.
+ * @return Number of bytes placed in @p output.
+ */
+size_t nt_strip_finish(nt_strip_t *strip, void *output);
+
+/** @} */
+
+#endif /* NT_STRIP_H */
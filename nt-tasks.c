@@ -0,0 +1,180 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-tasks.c
+ * @brief Work-stealing parallel loop implementation file
+ * @details A share is stored as <tt>(end << 32) | next</tt>. The owner moves @c next forward,
+ * a thief moves @c end back to the middle of the range and publishes the back half as its own
+ * share. Both are a single compare-and-swap on the victim, so a task is handed out exactly
+ * once. Shares sit on cache lines of their own, as the owners update them all the time. @n
+ * A thread quits once a full round over the other shares finds nothing to steal. A range a
+ * thief has taken but not published yet is missed by that round, which only means that the
+ * thief runs all of it.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#include <errno.h>
+#include <pthread.h>
+
+#include "nt-pool.h"
+#include "nt-tasks.h"
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief Size of a cache line. */
+#define TASKS_CACHE_LINE (64)
+
+/**
+ * @brief Share of the tasks of a thread.
+ */
+struct tasks_share_t {
+    uint64_t range_;                                  /**< <tt>(end << 32) | next</tt> */
+    char pad_[TASKS_CACHE_LINE - sizeof(uint64_t)];   /**< Keeps shares apart */
+};
+
+/**
+ * @brief State of a loop.
+ */
+struct tasks_t {
+    struct tasks_share_t *shares_; /**< A share per thread */
+    unsigned int workers_;         /**< Number of threads */
+    nt_tasks_fn_t fn_;             /**< The task */
+    void *context_;                /**< Its context */
+};
+
+/**
+ * @brief Start of a thread, other than the calling one.
+ */
+struct tasks_start_t {
+    struct tasks_t *tasks_; /**< The loop */
+    unsigned int worker_;   /**< Number of the thread */
+};
+
+static inline uint64_t tasks_pack(uint32_t next, uint32_t end) {
+    return ((uint64_t)end << 32) | next;
+}
+
+/**
+ * @brief Takes the next task of a share.
+ * @param share the share.
+ * @param[out] task the task.
+ * @return Non-zero if a task was taken, 0 if the share is empty.
+ */
+static int tasks_take(struct tasks_share_t *share, uint32_t *task) {
+    uint64_t range = __atomic_load_n(&share->range_, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t next = (uint32_t)range, end = (uint32_t)(range >> 32);
+        if (next >= end) {
+            return 0;
+        }
+        if (__atomic_compare_exchange_n(&share->range_, &range, tasks_pack(next + 1, end), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *task = next;
+            return 1;
+        }
+    }
+}
+
+/**
+ * @brief Steals the back half of the share of another thread.
+ * @details Victims are tried in turn, starting with the next thread.
+ * @param tasks the loop.
+ * @param worker number of the thief, whose share is empty.
+ * @return Non-zero if something was stolen into the share of the thief.
+ */
+static int tasks_steal(struct tasks_t *tasks, unsigned int worker) {
+    unsigned int round;
+    for (round = 1; round < tasks->workers_; ++round) {
+        struct tasks_share_t *victim = &tasks->shares_[(worker + round) % tasks->workers_];
+        uint64_t range = __atomic_load_n(&victim->range_, __ATOMIC_ACQUIRE);
+        for (;;) {
+            uint32_t next = (uint32_t)range, end = (uint32_t)(range >> 32);
+            uint32_t middle = next + (end - next) / 2;
+            if (next >= end) {
+                break;
+            }
+            if (__atomic_compare_exchange_n(&victim->range_, &range, tasks_pack(next, middle),
+                                            0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&tasks->shares_[worker].range_, tasks_pack(middle, end),
+                                 __ATOMIC_RELEASE);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs tasks until there is nothing left to take or to steal.
+ */
+static void tasks_work(struct tasks_t *tasks, unsigned int worker) {
+    uint32_t task;
+    for (;;) {
+        if (tasks_take(&tasks->shares_[worker], &task)) {
+            tasks->fn_(tasks->context_, worker, task);
+        } else if (!tasks_steal(tasks, worker)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Entry point of the threads other than the calling one.
+ * @param arg start of the thread.
+ * @return @c NULL.
+ */
+static void *tasks_thread(void *arg) {
+    struct tasks_start_t *start = arg;
+    tasks_work(start->tasks_, start->worker_);
+    return NULL;
+}
+
+int nt_tasks_run(size_t count, unsigned int workers, nt_tasks_fn_t fn, void *context) {
+    struct tasks_t tasks = {.workers_ = workers, .fn_ = fn, .context_ = context};
+    struct tasks_start_t *starts;
+    pthread_t *threads;
+    unsigned int worker, started;
+    if (0 == workers || count > NT_TASKS_MAX) {
+        return EINVAL;
+    }
+    tasks.shares_ = nt_pool_alloc(sizeof(struct tasks_share_t) * workers);
+    starts = nt_pool_alloc(sizeof(struct tasks_start_t) * workers);
+    threads = nt_pool_alloc(sizeof(pthread_t) * workers);
+    if (NULL == tasks.shares_ || NULL == starts || NULL == threads) {
+        nt_pool_free(threads);
+        nt_pool_free(starts);
+        nt_pool_free(tasks.shares_);
+        return ENOMEM;
+    }
+    for (worker = 0; worker < workers; ++worker) {
+        tasks.shares_[worker].range_ = tasks_pack((uint32_t)(count * worker / workers),
+                                                  (uint32_t)(count * (worker + 1) / workers));
+    }
+    /* Threads that do not start leave their share to be stolen */
+    for (started = 0, worker = 1; worker < workers; ++worker) {
+        starts[worker].tasks_ = &tasks;
+        starts[worker].worker_ = worker;
+        if (0 == pthread_create(&threads[started], NULL, tasks_thread, &starts[worker])) {
+            ++started;
+        }
+    }
+    tasks_work(&tasks, 0);
+    while (started > 0) {
+        pthread_join(threads[--started], NULL);
+    }
+    nt_pool_free(threads);
+    nt_pool_free(starts);
+    nt_pool_free(tasks.shares_);
+    return 0;
+}
+
+/** @} */
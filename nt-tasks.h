@@ -0,0 +1,60 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-tasks.h
+ * @brief Work-stealing parallel loop header file
+ * @details Runs a number of independent tasks, numbered from 0, on a number of threads. Each
+ * thread starts with an equal share of the task numbers and takes them one by one from the
+ * front of its share. A thread that runs out steals the back half of what another one has
+ * left, so threads that drew long tasks hand their remaining work over to the others and all
+ * of them finish at about the same time. @n
+ * A share is a range of task numbers packed in a single word, taken from and split with
+ * compare-and-swap, so neither taking nor stealing a task ever blocks. @n
+ * Tasks learn the number of the thread running them, which lets them accumulate results in
+ * per-thread partials that the caller merges once the loop is over, with no locking.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#ifndef NT_TASKS_H
+#define NT_TASKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief Largest number of tasks in a loop, task numbers are 32 bits wide. */
+#define NT_TASKS_MAX (UINT32_MAX)
+
+/**
+ * @brief A task.
+ * @param context context given to @ref nt_tasks_run().
+ * @param worker number of the thread running the task, from 0.
+ * @param task number of the task, from 0.
+ */
+typedef void (*nt_tasks_fn_t)(void *context, unsigned int worker, uint32_t task);
+
+/**
+ * @brief Runs tasks in parallel and waits until all of them are done.
+ * @details The calling thread is worker 0. Should some threads fail to start, the others run
+ * their share of the tasks.
+ * @param count number of tasks, at most @ref NT_TASKS_MAX.
+ * @param workers number of threads, at least 1.
+ * @param fn the task.
+ * @param context passed to @p fn.
+ * @return 0 on success, @c errno value otherwise; the tasks have not run then.
+ */
+int nt_tasks_run(size_t count, unsigned int workers, nt_tasks_fn_t fn, void *context);
+
+/** @} */
+
+#endif /* NT_TASKS_H */
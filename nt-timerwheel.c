@@ -0,0 +1,200 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-timerwheel.c
+ * @brief Hierarchical timer wheel's implementation file
+ * @details A timer sits at the level of the highest bit its tick differs from the current
+ * tick in, in the slot its tick has at that level; all the bits above are those of the
+ * current tick. The timers of a slot of an upper level thus all move down at once, when the
+ * current tick reaches the first tick of the slot. Each level keeps a bitmap of the slots
+ * holding timers, so that finding what comes next and skipping over idle time take a few
+ * instructions per level rather than a walk over the ticks.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "nt-timerwheel.h"
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief Mask of the slot index within a level. */
+#define SLOT_MASK ((uint64_t)NT_TIMERWHEEL_SLOTS - 1)
+
+/**
+ * @brief Links a timer into the slot its tick belongs to.
+ * @param wheel the wheel.
+ * @param timer the timer, not linked.
+ */
+static void wheel_insert(nt_timerwheel_t *wheel, nt_timer_t *timer) {
+    uint64_t differ;
+    unsigned int level = 0, slot;
+    nt_timer_t **head;
+    if (timer->expires_ < wheel->now_) {
+        timer->expires_ = wheel->now_;
+    }
+    differ = timer->expires_ ^ wheel->now_;
+    if (0 != differ) {
+        level = (unsigned int)(63 - __builtin_clzll(differ)) / NT_TIMERWHEEL_SLOT_BITS;
+    }
+    slot = (unsigned int)((timer->expires_ >> (level * NT_TIMERWHEEL_SLOT_BITS)) & SLOT_MASK);
+    head = &wheel->slots_[level][slot];
+    timer->next_ = *head;
+    if (NULL != timer->next_) {
+        timer->next_->prev_ = &timer->next_;
+    }
+    *head = timer;
+    timer->prev_ = head;
+    wheel->occupied_[level] |= 1ULL << slot;
+}
+
+/**
+ * @brief Unlinks a timer from wherever it is linked.
+ * @param wheel the wheel.
+ * @param timer the timer, linked.
+ */
+static void wheel_unlink(nt_timerwheel_t *wheel, nt_timer_t *timer) {
+    nt_timer_t **prev = timer->prev_;
+    uintptr_t first = (uintptr_t)&wheel->slots_[0][0];
+    uintptr_t link = (uintptr_t)prev;
+    *prev = timer->next_;
+    if (NULL != timer->next_) {
+        timer->next_->prev_ = prev;
+    }
+    timer->next_ = NULL;
+    timer->prev_ = NULL;
+    /* The timer was the last of its slot if the slot itself pointed at it */
+    if (NULL == *prev && link >= first && link < first + sizeof(wheel->slots_)) {
+        size_t idx = (link - first) / sizeof(nt_timer_t *);
+        wheel->occupied_[idx / NT_TIMERWHEEL_SLOTS] &= ~(1ULL << (idx % NT_TIMERWHEEL_SLOTS));
+    }
+}
+
+/**
+ * @brief Takes every timer out of a slot.
+ * @param wheel the wheel.
+ * @param level the level of the slot.
+ * @param slot the slot.
+ * @param[out] list the head of the list the timers are moved to, still linked to each other.
+ */
+static void wheel_detach(nt_timerwheel_t *wheel, unsigned int level, unsigned int slot,
+                         nt_timer_t **list) {
+    *list = wheel->slots_[level][slot];
+    wheel->slots_[level][slot] = NULL;
+    wheel->occupied_[level] &= ~(1ULL << slot);
+    if (NULL != *list) {
+        (*list)->prev_ = list;
+    }
+}
+
+/**
+ * @brief Finds the first tick the wheel has something to do at.
+ * @details That is firing the timers of a slot of the lowest level, or moving those of a slot
+ * of an upper level down once the current tick reaches the first tick of the slot.
+ * @param wheel the wheel.
+ * @return The tick, @c UINT64_MAX if no timer is armed.
+ */
+static uint64_t wheel_next_tick(const nt_timerwheel_t *wheel) {
+    uint64_t next = UINT64_MAX;
+    unsigned int level;
+    for (level = 0; level < NT_TIMERWHEEL_LEVELS; ++level) {
+        unsigned int shift = level * NT_TIMERWHEEL_SLOT_BITS;
+        unsigned int current = (unsigned int)((wheel->now_ >> shift) & SLOT_MASK);
+        uint64_t occupied = wheel->occupied_[level];
+        unsigned int turn = shift + NT_TIMERWHEEL_SLOT_BITS;
+        uint64_t tick;
+        /* The current slot of an upper level is still due if its first tick is not run yet */
+        if (0 != level && 0 != (wheel->now_ & ((1ULL << shift) - 1))) {
+            occupied = SLOT_MASK == current ? 0 : occupied & (~0ULL << (current + 1));
+        } else {
+            occupied &= ~0ULL << current;
+        }
+        if (0 == occupied) {
+            continue;
+        }
+        tick = turn < 64 ? (wheel->now_ >> turn) << turn : 0;
+        tick |= (uint64_t)__builtin_ctzll(occupied) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+void nt_timerwheel_init(nt_timerwheel_t *wheel, uint64_t tick_ns, uint64_t now_ns) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->tick_ns_ = 0 != tick_ns ? tick_ns : 1;
+    wheel->now_ = now_ns / wheel->tick_ns_;
+}
+
+void nt_timer_arm(nt_timerwheel_t *wheel, nt_timer_t *timer, uint64_t deadline_ns) {
+    if (nt_timer_armed(timer)) {
+        wheel_unlink(wheel, timer);
+    }
+    /* Rounded up, never early */
+    timer->expires_ = deadline_ns / wheel->tick_ns_ + (0 != deadline_ns % wheel->tick_ns_);
+    wheel_insert(wheel, timer);
+}
+
+void nt_timer_cancel(nt_timerwheel_t *wheel, nt_timer_t *timer) {
+    if (nt_timer_armed(timer)) {
+        wheel_unlink(wheel, timer);
+    }
+}
+
+uint64_t nt_timerwheel_next(const nt_timerwheel_t *wheel) {
+    uint64_t tick = wheel_next_tick(wheel);
+    if (UINT64_MAX == tick || tick > UINT64_MAX / wheel->tick_ns_) {
+        return NT_TIMERWHEEL_NEVER;
+    }
+    return tick * wheel->tick_ns_;
+}
+
+unsigned int nt_timerwheel_run(nt_timerwheel_t *wheel, uint64_t now_ns) {
+    uint64_t target = now_ns / wheel->tick_ns_;
+    unsigned int fired = 0;
+    uint64_t tick;
+    while ((tick = wheel_next_tick(wheel)) <= target) {
+        nt_timer_t *list;
+        unsigned int level;
+        wheel->now_ = tick;
+        /* Upper levels first, what they move down may belong to a slot moving down as well */
+        for (level = NT_TIMERWHEEL_LEVELS - 1; level > 0; --level) {
+            unsigned int shift = level * NT_TIMERWHEEL_SLOT_BITS;
+            if (0 != (tick & ((1ULL << shift) - 1))) {
+                continue;
+            }
+            wheel_detach(wheel, level, (unsigned int)((tick >> shift) & SLOT_MASK), &list);
+            while (NULL != list) {
+                nt_timer_t *timer = list;
+                wheel_unlink(wheel, timer);
+                wheel_insert(wheel, timer);
+            }
+        }
+        wheel_detach(wheel, 0, (unsigned int)(tick & SLOT_MASK), &list);
+        /* Timers armed again from the callbacks go after this tick */
+        wheel->now_ = tick + 1;
+        while (NULL != list) {
+            nt_timer_t *timer = list;
+            wheel_unlink(wheel, timer);
+            timer->fire_(timer->context_);
+            ++fired;
+        }
+    }
+    if (target >= wheel->now_) {
+        wheel->now_ = target + 1;
+    }
+    return fired;
+}
+
+/** @} */
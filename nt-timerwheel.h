@@ -0,0 +1,126 @@
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ * @file nt-timerwheel.h
+ * @brief Hierarchical timer wheel's header file
+ * @details Keeps any number of timers for an event loop, so that it needs no system call
+ * per timer: the loop asks the wheel how long it may block, and lets it fire whatever has
+ * expired once it wakes up. Arming and cancelling a timer take constant time whatever the
+ * number of timers. @n
+ * Time goes by in ticks of a length given to the wheel. Deadlines are rounded up to a whole
+ * tick, which never fires a timer early and coalesces timers due within the same tick into a
+ * single wake-up. The wheel has @ref NT_TIMERWHEEL_LEVELS levels of
+ * @ref NT_TIMERWHEEL_SLOTS slots each, a slot of a level spanning a whole turn of the level
+ * below. A timer is kept at the lowest level its deadline differs from the current tick at,
+ * and moves down a level once the current tick catches up with its slot. @n
+ * Timers are owned by the caller, usually embedded in whatever they act on; the wheel only
+ * links them together.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa MyNaiveUtilitiesModule
+ * @}
+ */
+
+#ifndef NT_TIMERWHEEL_H
+#define NT_TIMERWHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup MyNaiveUtilitiesModule
+ * @{
+ */
+
+/** @brief Number of bits of a tick each level of the wheel covers. */
+#define NT_TIMERWHEEL_SLOT_BITS (6)
+
+/** @brief Number of slots of each level. */
+#define NT_TIMERWHEEL_SLOTS (1U << NT_TIMERWHEEL_SLOT_BITS)
+
+/** @brief Number of levels, enough for any 64-bit tick. */
+#define NT_TIMERWHEEL_LEVELS ((64 + NT_TIMERWHEEL_SLOT_BITS - 1) / NT_TIMERWHEEL_SLOT_BITS)
+
+/** @brief Returned by @ref nt_timerwheel_next() if no timer is armed. */
+#define NT_TIMERWHEEL_NEVER (UINT64_MAX)
+
+/**
+ * @brief A timer.
+ * @details Set @c fire_ and @c context_, and the rest to zero, before the timer is first
+ * armed.
+ */
+typedef struct nt_timer_t {
+    struct nt_timer_t *next_;        /**< Next timer in the same slot */
+    struct nt_timer_t **prev_;       /**< Link pointing at the timer, @c NULL while not armed */
+    uint64_t expires_;               /**< Tick the timer expires at */
+    void (*fire_)(void *context);    /**< Called once the timer expires */
+    void *context_;                  /**< Passed to @c fire_ */
+} nt_timer_t;
+
+/**
+ * @brief A timer wheel.
+ */
+typedef struct nt_timerwheel_t {
+    uint64_t tick_ns_;                                           /**< Length of a tick */
+    uint64_t now_;                                               /**< First tick not yet run */
+    uint64_t occupied_[NT_TIMERWHEEL_LEVELS];                    /**< Slots holding timers */
+    nt_timer_t *slots_[NT_TIMERWHEEL_LEVELS][NT_TIMERWHEEL_SLOTS]; /**< Timers of each slot */
+} nt_timerwheel_t;
+
+/**
+ * @brief Initialises a wheel.
+ * @param wheel the wheel.
+ * @param tick_ns length of a tick, in nanoseconds, at least one.
+ * @param now_ns the current time, in nanoseconds, on whatever clock the caller uses.
+ */
+void nt_timerwheel_init(nt_timerwheel_t *wheel, uint64_t tick_ns, uint64_t now_ns);
+
+/**
+ * @brief Arms a timer, or moves it if it is already armed.
+ * @details A deadline already gone fires the timer on the next @ref nt_timerwheel_run().
+ * @param wheel the wheel.
+ * @param timer the timer.
+ * @param deadline_ns when the timer expires, on the clock of the wheel.
+ */
+void nt_timer_arm(nt_timerwheel_t *wheel, nt_timer_t *timer, uint64_t deadline_ns);
+
+/**
+ * @brief Cancels a timer, if armed.
+ * @param wheel the wheel the timer was armed on.
+ * @param timer the timer.
+ */
+void nt_timer_cancel(nt_timerwheel_t *wheel, nt_timer_t *timer);
+
+/**
+ * @brief Tells whether a timer is armed.
+ * @param timer the timer.
+ * @return Non-zero if armed.
+ */
+static inline int nt_timer_armed(const nt_timer_t *timer) { return NULL != timer->prev_; }
+
+/**
+ * @brief Returns when the wheel next needs to run.
+ * @details That is when the earliest timer expires, or earlier, when the timers of a slot
+ * of an upper level are due to move down: at most one early wake-up per level.
+ * @param wheel the wheel.
+ * @return Time on the clock of the wheel, @ref NT_TIMERWHEEL_NEVER if no timer is armed.
+ */
+uint64_t nt_timerwheel_next(const nt_timerwheel_t *wheel);
+
+/**
+ * @brief Fires every timer expired by a given time.
+ * @details Timers fire in the order of their ticks, those of the same tick in no particular
+ * order. A timer is no longer armed by the time it fires, and may be armed again from its
+ * callback, as may any other timer be armed or cancelled.
+ * @param wheel the wheel.
+ * @param now_ns the current time, on the clock of the wheel.
+ * @return Number of timers fired.
+ */
+unsigned int nt_timerwheel_run(nt_timerwheel_t *wheel, uint64_t now_ns);
+
+/** @} */
+
+#endif /* NT_TIMERWHEEL_H */
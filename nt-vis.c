@@ -12,6 +12,10 @@
  * @}
  */
 #include <ctype.h>
+#include <string.h>
+#if defined __SSE2__
+#include <immintrin.h>
+#endif
 #include "nt-vis.h"
 
 /**
@@ -43,6 +47,9 @@ static const char s_transTable[] = "0123456789ABCDEF";
  */
 #define MINIMAL_BUFFER_SIZE_C (5)
 
+/** @brief JSON encoding of U+FFFD, which stands in for malformed UTF-8. */
+#define JSON_REPLACEMENT "\\ufffd"
+
 unsigned int nt_vis(nt_vis_format_type_t format, const char* buf, unsigned int len, char* p_output,
                     unsigned int output_size) {
     /* Number of characters printed */
@@ -144,4 +151,157 @@ unsigned int nt_vis(nt_vis_format_type_t format, const char* buf, unsigned int l
     return out_char_count;
 }
 
+/**
+ * @brief Finds the first byte a JSON string cannot hold as it is.
+ * @details Those are the C0 controls, the quote, the backslash and, as they need checking,
+ * all bytes above 0x7f. Compared as signed, the latter are negative, so a single comparison
+ * against 0x20 finds them together with the controls.
+ * @param p start of the input.
+ * @param end end of the input.
+ * @return Address of the first such byte, or @p end.
+ */
+static inline const uint8_t *json_find_special(const uint8_t *p, const uint8_t *end) {
+#if defined __AVX2__
+    const __m256i space32 = _mm256_set1_epi8(0x20);
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i backslash32 = _mm256_set1_epi8('\\');
+    while (end - p >= 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)p);
+        __m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space32, bytes),
+                                          _mm256_or_si256(_mm256_cmpeq_epi8(bytes, quote32),
+                                                          _mm256_cmpeq_epi8(bytes, backslash32)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+        if (0 != mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined __SSE2__
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+        __m128i special = _mm_or_si128(
+            _mm_cmplt_epi8(bytes, space),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+        if (0 != mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p >= 0x20 && *p < 0x80 && '"' != *p && '\\' != *p) {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * @brief Checks the UTF-8 sequence starting at a byte above 0x7f.
+ * @details Overlong encodings, surrogates and code points above U+10FFFF are malformed.
+ * @param p start of the sequence.
+ * @param end end of the input.
+ * @return Length of the sequence if it is well-formed; 0 if it is well-formed so far but cut
+ * short by @p end; minus the length of its longest well-formed start otherwise, at least 1.
+ */
+static inline int json_utf8_length(const uint8_t *p, const uint8_t *end) {
+    uint8_t low = 0x80, high = 0xbf;
+    int follow, idx;
+    if (p[0] < 0xc2) {
+        return -1;
+    } else if (p[0] < 0xe0) {
+        follow = 1;
+    } else if (p[0] < 0xf0) {
+        follow = 2;
+        low = 0xe0 == p[0] ? 0xa0 : low;
+        high = 0xed == p[0] ? 0x9f : high;
+    } else if (p[0] < 0xf5) {
+        follow = 3;
+        low = 0xf0 == p[0] ? 0x90 : low;
+        high = 0xf4 == p[0] ? 0x8f : high;
+    } else {
+        return -1;
+    }
+    for (idx = 1; idx <= follow; ++idx) {
+        if (p + idx == end) {
+            return 0;
+        }
+        if (p[idx] < low || p[idx] > high) {
+            return -idx;
+        }
+        low = 0x80;
+        high = 0xbf;
+    }
+    return follow + 1;
+}
+
+size_t nt_vis_json(const uint8_t *buf, size_t len, int last, char *p_output, size_t *consumed) {
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+    char *out = p_output;
+    while (p < end) {
+        const uint8_t *run_end = json_find_special(p, end);
+        memcpy(out, p, (size_t)(run_end - p));
+        out += run_end - p;
+        p = run_end;
+        if (p == end) {
+            break;
+        }
+        if (*p >= 0x80) {
+            int seq = json_utf8_length(p, end);
+            if (seq > 0) {
+                memcpy(out, p, (size_t)seq);
+                out += seq;
+                p += seq;
+                continue;
+            }
+            if (0 == seq && !last) {
+                break;
+            }
+            /* The longest well-formed start of a malformed sequence is replaced as a whole,
+             * as the Unicode standard recommends; a cut short one is all of what is left */
+            memcpy(out, JSON_REPLACEMENT, sizeof(JSON_REPLACEMENT) - 1);
+            out += sizeof(JSON_REPLACEMENT) - 1;
+            p += 0 == seq ? end - p : -seq;
+            continue;
+        }
+        *out++ = '\\';
+        switch (*p) {
+        case '"':
+        case '\\':
+            *out++ = (char)*p;
+            break;
+        case '\b':
+            *out++ = 'b';
+            break;
+        case '\f':
+            *out++ = 'f';
+            break;
+        case '\n':
+            *out++ = 'n';
+            break;
+        case '\r':
+            *out++ = 'r';
+            break;
+        case '\t':
+            *out++ = 't';
+            break;
+        default:
+            /* The other controls only have the six character form */
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = s_transTable[(*p >> 4) & 0x0f];
+            *out++ = s_transTable[*p & 0x0f];
+            break;
+        }
+        ++p;
+    }
+    *consumed = (size_t)(p - buf);
+    return (size_t)(out - p_output);
+}
+
 /** @} */
@@ -13,6 +13,7 @@
 #ifndef NT_VIS_H
 #define NT_VIS_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -56,6 +57,29 @@ unsigned int nt_vis(nt_vis_format_type_t format, const char* buf, unsigned int l
 unsigned int nt_unvis(nt_vis_format_type_t format, const char* buf, unsigned int len,
                     char* p_output, unsigned int output_size);
 
+/**
+ * @brief Size of an output buffer large enough for the JSON encoding of a given input length.
+ * @details The worst case is six bytes per input byte, @c \u001b or @c \ufffd.
+ */
+#define NT_VIS_JSON_SIZE(len) ((len) * 6)
+
+/**
+ * @brief Encodes bytes as the contents of a JSON string.
+ * @details The quotes around the string are not added, nor is a terminating @c \0. Quotes,
+ * backslashes and C0 controls are escaped. The input is taken as UTF-8: malformed sequences
+ * are replaced by U+FFFD, one for each longest well-formed start. A sequence cut short by the end
+ * of the input is left out, unless @p last is set, for the caller to pass it again together
+ * with what follows. @n
+ * Runs of bytes that need no escaping are found 16 or 32 at a time, with SSE2 or AVX2.
+ * @param[in] buf input buffer.
+ * @param[in] len length of the input buffer.
+ * @param[in] last non-zero if no input follows this one.
+ * @param[out] p_output buffer of at least @ref NT_VIS_JSON_SIZE(len) bytes.
+ * @param[out] consumed number of input bytes encoded, @p len unless a sequence was left out.
+ * @return Number of bytes placed in the output buffer.
+ */
+size_t nt_vis_json(const uint8_t *buf, size_t len, int last, char *p_output, size_t *consumed);
+
 /** @} */
 
 #endif /* NT_VIS_H */
@@ -0,0 +1,465 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-analyze.c
+ * @brief Session archive analyzer implementation file
+ * @details The metadata and the log of a session are mapped rather than read: the metadata is
+ * walked once from start to end, and of the log only the pages holding command lines are ever
+ * touched. @n
+ * Output records split the output into bursts, each timed by its record: the bytes up to the
+ * next record are counted in the second of the session the burst started in, and the time
+ * between two records is a pause. @n
+ * Command names are counted in an open addressing hash table per thread; the tables of all
+ * threads are added into the first one at the end, which is then sorted.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nt-pool.h"
+#include "nt-strip.h"
+#include "nt-tasks.h"
+#include "ps-analyze.h"
+#include "ps-cmd.h"
+#include "ps-meta.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Initial number of entries of a command table, a power of two. */
+#define ANALYZE_TABLE_INITIAL (256)
+
+/** @brief Length of the window the output rate is measured over, in nanoseconds. */
+#define ANALYZE_RATE_NS (1000000000ULL)
+
+/**
+ * @brief Table of command names, an empty entry has a zero count.
+ */
+struct analyze_table_t {
+    ps_analyze_command_t *entries_; /**< The entries */
+    size_t capacity_;               /**< Their number, a power of two */
+    size_t used_;                   /**< Number of entries in use */
+};
+
+/**
+ * @brief What a thread has found so far.
+ */
+struct analyze_partial_t {
+    ps_analyze_stats_t stats_;    /**< Statistics of the logs it analysed */
+    struct analyze_table_t table_; /**< Commands of those logs */
+    int error_;                   /**< First error, @c ENOMEM when the table cannot grow */
+    nt_strip_t strip_;            /**< Strips command lines */
+    /** @brief A stripped command line. */
+    uint8_t text_[NT_STRIP_OUTPUT_SIZE(NT_STRIP_LINE_MAX)];
+};
+
+/**
+ * @brief State of an analysis.
+ */
+struct analyze_t {
+    const char *const *logs_;             /**< Names of the logs */
+    const ps_analyze_config_t *config_;   /**< Its configuration */
+    struct analyze_partial_t **partials_; /**< A partial per thread */
+};
+
+/**
+ * @brief A mapped file.
+ */
+struct analyze_map_t {
+    const uint8_t *data_; /**< The mapping, @c NULL if the file is empty */
+    uint64_t size_;       /**< Length of the file */
+};
+
+/**
+ * @brief Maps a file read only.
+ * @param name name of the file.
+ * @param[out] map the mapping.
+ * @return 0 on success, -1 on error.
+ */
+static int analyze_map(const char *name, struct analyze_map_t *map) {
+    struct stat file_stat;
+    int fd = open(name, O_RDONLY | O_CLOEXEC);
+    void *data = MAP_FAILED;
+    if (fd < 0) {
+        return -1;
+    }
+    if (0 == fstat(fd, &file_stat)) {
+        map->size_ = (uint64_t)file_stat.st_size;
+        data = 0 == map->size_ ? NULL : mmap(NULL, map->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    map->data_ = MAP_FAILED != data ? data : NULL;
+    return MAP_FAILED != data ? 0 : -1;
+}
+
+static void analyze_unmap(struct analyze_map_t *map) {
+    if (NULL != map->data_) {
+        munmap((void *)map->data_, map->size_);
+    }
+}
+
+/**
+ * @brief FNV-1a hash of a command name.
+ */
+static uint64_t analyze_hash(const char *name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; '\0' != *name; ++name) {
+        hash = (hash ^ (uint8_t)*name) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Finds the entry of a command name, or the empty one it would go to.
+ */
+static ps_analyze_command_t *analyze_slot(const struct analyze_table_t *table, const char *name) {
+    size_t idx = (size_t)analyze_hash(name) & (table->capacity_ - 1);
+    while (0 != table->entries_[idx].count_ && 0 != strcmp(table->entries_[idx].name_, name)) {
+        idx = (idx + 1) & (table->capacity_ - 1);
+    }
+    return &table->entries_[idx];
+}
+
+/**
+ * @brief Adds to the count of a command name, growing the table once it is 3/4 full.
+ * @return 0 on success, @c ENOMEM if the table could not grow.
+ */
+static int analyze_count(struct analyze_table_t *table, const char *name, uint64_t count) {
+    ps_analyze_command_t *entry;
+    if (4 * (table->used_ + 1) > 3 * table->capacity_) {
+        struct analyze_table_t grown = {.capacity_ = 2 * table->capacity_, .used_ = table->used_};
+        size_t idx;
+        grown.entries_ = nt_pool_zalloc(sizeof(ps_analyze_command_t) * grown.capacity_);
+        if (NULL == grown.entries_) {
+            return ENOMEM;
+        }
+        for (idx = 0; idx < table->capacity_; ++idx) {
+            if (0 != table->entries_[idx].count_) {
+                *analyze_slot(&grown, table->entries_[idx].name_) = table->entries_[idx];
+            }
+        }
+        nt_pool_free(table->entries_);
+        *table = grown;
+    }
+    entry = analyze_slot(table, name);
+    if (0 == entry->count_) {
+        memcpy(entry->name_, name, strlen(name) + 1);
+        ++table->used_;
+    }
+    entry->count_ += count;
+    return 0;
+}
+
+/**
+ * @brief Takes the name of a command: the first word of its command line, stripped.
+ * @param partial partial of the thread.
+ * @param line the command line, as in the log.
+ * @param len its length.
+ * @param[out] name the name, empty for a blank command line.
+ */
+static void analyze_name(struct analyze_partial_t *partial, const uint8_t *line, size_t len,
+                         char name[PS_ANALYZE_NAME_MAX]) {
+    size_t text_len, idx = 0, fill = 0;
+    if (len > NT_STRIP_LINE_MAX) {
+        len = NT_STRIP_LINE_MAX;
+    }
+    nt_strip_init(&partial->strip_);
+    text_len = nt_strip_feed(&partial->strip_, line, len, partial->text_);
+    text_len += nt_strip_finish(&partial->strip_, partial->text_ + text_len);
+    while (idx < text_len && partial->text_[idx] <= ' ') {
+        ++idx;
+    }
+    while (idx < text_len && partial->text_[idx] > ' ' && fill + 1 < PS_ANALYZE_NAME_MAX) {
+        name[fill++] = (char)partial->text_[idx++];
+    }
+    name[fill] = '\0';
+}
+
+/**
+ * @brief Walks the output records of a session for its output rate and its pauses.
+ * @param stats statistics to add to.
+ * @param records metadata records, the header first.
+ * @param count their number.
+ * @param log_size length of the log.
+ * @param idle_ns shortest pause counted.
+ */
+static void analyze_output(ps_analyze_stats_t *stats, const ps_meta_record_t *records,
+                           size_t count, uint64_t log_size, uint64_t idle_ns) {
+    const ps_meta_record_t *previous = NULL;
+    uint64_t second = 0, in_second = 0, peak = 0;
+    size_t idx;
+    for (idx = 1; idx <= count; ++idx) {
+        const ps_meta_record_t *record = idx < count ? &records[idx] : NULL;
+        uint64_t burst_second;
+        if (NULL != record && PS_META_OUTPUT != record->type_) {
+            continue;
+        }
+        if (NULL != previous) {
+            uint64_t end = NULL != record ? record->offset_ : log_size;
+            /* The wall clock may have been stepped back, such bursts count as the first */
+            burst_second = previous->time_ns_ > records[0].time_ns_
+                               ? (previous->time_ns_ - records[0].time_ns_) / ANALYZE_RATE_NS
+                               : 0;
+            if (burst_second != second) {
+                peak = in_second > peak ? in_second : peak;
+                second = burst_second;
+                in_second = 0;
+            }
+            in_second += end > previous->offset_ ? end - previous->offset_ : 0;
+            if (NULL != record && record->time_ns_ > previous->time_ns_ &&
+                record->time_ns_ - previous->time_ns_ >= idle_ns) {
+                uint64_t idle = record->time_ns_ - previous->time_ns_;
+                ++stats->idle_gaps_;
+                stats->idle_ns_ += idle;
+                if (idle > stats->longest_idle_ns_) {
+                    stats->longest_idle_ns_ = idle;
+                }
+            }
+        }
+        previous = record;
+    }
+    peak = in_second > peak ? in_second : peak;
+    stats->peak_rate_sum_ += peak;
+    if (peak > stats->peak_rate_) {
+        stats->peak_rate_ = peak;
+    }
+}
+
+/**
+ * @brief Finds the most memory a session held, from its memory records.
+ * @param stats statistics to add to.
+ * @param records metadata records, the header first.
+ * @param count their number.
+ */
+static void analyze_memory(ps_analyze_stats_t *stats, const ps_meta_record_t *records,
+                           size_t count) {
+    uint64_t peak = 0;
+    size_t idx;
+    int noted = 0;
+    for (idx = 1; idx < count; ++idx) {
+        if (PS_META_MEMORY == records[idx].type_) {
+            uint64_t memory = (uint64_t)records[idx].arg2_ << 10;
+            peak = memory > peak ? memory : peak;
+            noted = 1;
+        }
+    }
+    if (noted) {
+        ++stats->noted_;
+        stats->memory_sum_ += peak;
+        if (peak > stats->memory_) {
+            stats->memory_ = peak;
+        }
+    }
+}
+
+/**
+ * @brief Counts the commands of a session.
+ * @param partial partial of the thread.
+ * @param log_name name of the log.
+ * @param log the log, mapped.
+ */
+static void analyze_commands(struct analyze_partial_t *partial, const char *log_name,
+                             const struct analyze_map_t *log) {
+    size_t len = strlen(log_name) + sizeof(PS_CMD_SUFFIX);
+    char *name = nt_pool_alloc(len);
+    char command[PS_ANALYZE_NAME_MAX];
+    ps_cmd_header_t header;
+    ps_cmd_record_t record;
+    uint64_t idx;
+    int fd = -1;
+    if (NULL != name) {
+        snprintf(name, len, "%s%s", log_name, PS_CMD_SUFFIX);
+        fd = open(name, O_RDONLY | O_CLOEXEC);
+        nt_pool_free(name);
+    }
+    if (fd < 0) {
+        return;
+    }
+    if (sizeof(header) == pread(fd, &header, sizeof(header), 0) &&
+        PS_CMD_MAGIC == header.magic_ && sizeof(record) == header.record_size_) {
+        for (idx = 0; 0 == ps_cmd_read(fd, idx, &record); ++idx) {
+            ++partial->stats_.commands_;
+            if (PS_CMD_STATUS_UNKNOWN != record.status_ && 0 != record.status_) {
+                ++partial->stats_.failed_;
+            }
+            if (record.input_ < record.output_ && record.output_ <= log->size_) {
+                analyze_name(partial, log->data_ + record.input_,
+                             (size_t)(record.output_ - record.input_), command);
+                if ('\0' != command[0] && 0 == partial->error_) {
+                    partial->error_ = analyze_count(&partial->table_, command, 1);
+                }
+            }
+        }
+    }
+    close(fd);
+}
+
+/**
+ * @brief Analyses a single log, the task of the parallel loop.
+ */
+static void analyze_log(void *context, unsigned int worker, uint32_t task) {
+    struct analyze_t *analyze = context;
+    struct analyze_partial_t *partial = analyze->partials_[worker];
+    const char *log_name = analyze->logs_[task];
+    size_t len = strlen(log_name) + sizeof(PS_META_SUFFIX);
+    char *meta_name = nt_pool_alloc(len);
+    struct analyze_map_t log = {NULL, 0}, meta = {NULL, 0};
+    const ps_meta_record_t *records;
+    size_t count;
+    uint64_t duration;
+    if (NULL != meta_name) {
+        snprintf(meta_name, len, "%s%s", log_name, PS_META_SUFFIX);
+    }
+    if (NULL == meta_name || 0 != analyze_map(log_name, &log) ||
+        0 != analyze_map(meta_name, &meta)) {
+        goto unreadable;
+    }
+    records = (const ps_meta_record_t *)meta.data_;
+    count = meta.size_ / sizeof(ps_meta_record_t);
+    if (0 == count || PS_META_HEADER != records[0].type_ || PS_META_MAGIC != records[0].arg_) {
+        goto unreadable;
+    }
+    ++partial->stats_.sessions_;
+    partial->stats_.bytes_ += log.size_;
+    if (log.size_ > partial->stats_.largest_) {
+        partial->stats_.largest_ = log.size_;
+    }
+    /* The last record is the footer, or the last event of a session that did not end cleanly */
+    duration = records[count - 1].time_ns_ > records[0].time_ns_
+                   ? records[count - 1].time_ns_ - records[0].time_ns_
+                   : 0;
+    partial->stats_.duration_ns_ += duration;
+    if (duration > partial->stats_.longest_ns_) {
+        partial->stats_.longest_ns_ = duration;
+    }
+    analyze_output(&partial->stats_, records, count, log.size_, analyze->config_->idle_ns_);
+    analyze_memory(&partial->stats_, records, count);
+    analyze_commands(partial, log_name, &log);
+    goto done;
+unreadable:
+    ++partial->stats_.unreadable_;
+done:
+    analyze_unmap(&meta);
+    analyze_unmap(&log);
+    nt_pool_free(meta_name);
+}
+
+/**
+ * @brief Orders commands by decreasing count, then by name.
+ */
+static int analyze_compare(const void *lhs, const void *rhs) {
+    const ps_analyze_command_t *left = lhs, *right = rhs;
+    if (left->count_ != right->count_) {
+        return left->count_ < right->count_ ? 1 : -1;
+    }
+    return strcmp(left->name_, right->name_);
+}
+
+/**
+ * @brief Adds the statistics of a partial to the total.
+ */
+static void analyze_merge(ps_analyze_stats_t *total, const ps_analyze_stats_t *partial) {
+    total->sessions_ += partial->sessions_;
+    total->unreadable_ += partial->unreadable_;
+    total->bytes_ += partial->bytes_;
+    total->duration_ns_ += partial->duration_ns_;
+    total->peak_rate_sum_ += partial->peak_rate_sum_;
+    total->idle_gaps_ += partial->idle_gaps_;
+    total->idle_ns_ += partial->idle_ns_;
+    total->commands_ += partial->commands_;
+    total->failed_ += partial->failed_;
+    total->noted_ += partial->noted_;
+    total->memory_sum_ += partial->memory_sum_;
+    if (partial->largest_ > total->largest_) {
+        total->largest_ = partial->largest_;
+    }
+    if (partial->longest_ns_ > total->longest_ns_) {
+        total->longest_ns_ = partial->longest_ns_;
+    }
+    if (partial->peak_rate_ > total->peak_rate_) {
+        total->peak_rate_ = partial->peak_rate_;
+    }
+    if (partial->longest_idle_ns_ > total->longest_idle_ns_) {
+        total->longest_idle_ns_ = partial->longest_idle_ns_;
+    }
+    if (partial->memory_ > total->memory_) {
+        total->memory_ = partial->memory_;
+    }
+}
+
+int ps_analyze(const char *const *logs, size_t count, const ps_analyze_config_t *config,
+               ps_analyze_stats_t *stats, ps_analyze_command_t *top, size_t *n_top) {
+    struct analyze_t analyze = {.logs_ = logs, .config_ = config};
+    struct analyze_table_t *table;
+    unsigned int worker;
+    size_t idx, fill = 0;
+    int result = ENOMEM;
+    memset(stats, 0, sizeof(*stats));
+    analyze.partials_ = nt_pool_zalloc(sizeof(struct analyze_partial_t *) * config->jobs_);
+    if (NULL == analyze.partials_) {
+        return ENOMEM;
+    }
+    /* Partials are separate blocks, so that threads never write to the same cache line */
+    for (worker = 0; worker < config->jobs_; ++worker) {
+        struct analyze_partial_t *partial = nt_pool_zalloc(sizeof(struct analyze_partial_t));
+        analyze.partials_[worker] = partial;
+        if (NULL == partial) {
+            goto done;
+        }
+        partial->table_.capacity_ = ANALYZE_TABLE_INITIAL;
+        partial->table_.entries_ =
+            nt_pool_zalloc(sizeof(ps_analyze_command_t) * ANALYZE_TABLE_INITIAL);
+        if (NULL == partial->table_.entries_) {
+            goto done;
+        }
+    }
+    result = nt_tasks_run(count, config->jobs_, analyze_log, &analyze);
+    table = &analyze.partials_[0]->table_;
+    for (worker = 0; 0 == result && worker < config->jobs_; ++worker) {
+        const struct analyze_partial_t *partial = analyze.partials_[worker];
+        analyze_merge(stats, &partial->stats_);
+        result = partial->error_;
+        for (idx = 0; worker > 0 && 0 == result && idx < partial->table_.capacity_; ++idx) {
+            if (0 != partial->table_.entries_[idx].count_) {
+                result = analyze_count(table, partial->table_.entries_[idx].name_,
+                                       partial->table_.entries_[idx].count_);
+            }
+        }
+    }
+    if (0 == result) {
+        for (idx = 0; idx < table->capacity_; ++idx) {
+            if (0 != table->entries_[idx].count_) {
+                table->entries_[fill++] = table->entries_[idx];
+            }
+        }
+        qsort(table->entries_, fill, sizeof(ps_analyze_command_t), analyze_compare);
+        *n_top = fill < *n_top ? fill : *n_top;
+        memcpy(top, table->entries_, sizeof(ps_analyze_command_t) * *n_top);
+    }
+done:
+    for (worker = 0; worker < config->jobs_; ++worker) {
+        if (NULL != analyze.partials_[worker]) {
+            nt_pool_free(analyze.partials_[worker]->table_.entries_);
+            nt_pool_free(analyze.partials_[worker]);
+        }
+    }
+    nt_pool_free(analyze.partials_);
+    return result;
+}
+
+/** @} */
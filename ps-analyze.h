@@ -0,0 +1,96 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-analyze.h
+ * @brief Session archive analyzer header file
+ * @details Computes statistics over many recorded sessions at once: how much output they
+ * produced, how long they lasted, how fast the output came in bursts, how long it paused, and
+ * which commands were run the most. Sessions are read through their companions only: the
+ * metadata for the timing of the output, the command table for the commands, and the log
+ * itself just where a command line is. @n
+ * Logs are analysed in parallel, a task per log, by a work-stealing loop, so an archive of
+ * logs of very different lengths still keeps every thread busy to the end. Each thread sums
+ * up into a partial of its own, the partials are merged once all logs are done.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_ANALYZE_H
+#define PS_ANALYZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Longest command name kept, null terminator included; longer ones are cut. */
+#define PS_ANALYZE_NAME_MAX (32)
+
+/** @brief Default shortest pause in the output counted as an idle gap, in nanoseconds. */
+#define PS_ANALYZE_DEFAULT_IDLE_NS (5000000000ULL)
+
+/**
+ * @brief Configuration of an analysis.
+ */
+typedef struct ps_analyze_config_t {
+    uint64_t idle_ns_;  /**< Shortest pause in the output counted as an idle gap */
+    unsigned int jobs_; /**< Number of threads, at least 1 */
+} ps_analyze_config_t;
+
+/**
+ * @brief Statistics of a set of sessions.
+ * @details Rates and pauses come from the output records of the metadata, sessions recorded
+ * without them only count towards the totals.
+ */
+typedef struct ps_analyze_stats_t {
+    uint64_t sessions_;        /**< Sessions analysed */
+    uint64_t unreadable_;      /**< Logs without valid metadata, left out of the rest */
+    uint64_t bytes_;           /**< Output, in total */
+    uint64_t largest_;         /**< Output of the largest session */
+    uint64_t duration_ns_;     /**< Duration, in total */
+    uint64_t longest_ns_;      /**< Duration of the longest session */
+    uint64_t peak_rate_;       /**< Most output in a second of a session, over all of them */
+    uint64_t peak_rate_sum_;   /**< Sum over the sessions of their most output in a second */
+    uint64_t idle_gaps_;       /**< Pauses in the output of at least the idle time */
+    uint64_t idle_ns_;         /**< Their duration, in total */
+    uint64_t longest_idle_ns_; /**< The longest one */
+    uint64_t commands_;        /**< Commands run */
+    uint64_t failed_;          /**< Commands that reported a non-zero exit status */
+    uint64_t noted_;           /**< Sessions that noted the memory they held */
+    uint64_t memory_;          /**< Most memory a session held, over all of them */
+    uint64_t memory_sum_;      /**< Sum over the sessions of the most memory they held */
+} ps_analyze_stats_t;
+
+/**
+ * @brief A command and the number of times it was run.
+ * @details The name is the first word of the command line, escape sequences stripped.
+ */
+typedef struct ps_analyze_command_t {
+    uint64_t count_;                 /**< Number of times it was run */
+    char name_[PS_ANALYZE_NAME_MAX]; /**< Its name, null terminated */
+} ps_analyze_command_t;
+
+/**
+ * @brief Analyses a set of logs.
+ * @param logs names of the logs.
+ * @param count number of logs.
+ * @param config configuration of the analysis.
+ * @param[out] stats statistics of the logs.
+ * @param[out] top commands run the most, most frequent first.
+ * @param[in,out] n_top room in @p top on input, number of commands in it on output.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_analyze(const char *const *logs, size_t count, const ps_analyze_config_t *config,
+               ps_analyze_stats_t *stats, ps_analyze_command_t *top, size_t *n_top);
+
+/** @} */
+
+#endif /* PS_ANALYZE_H */
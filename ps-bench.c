@@ -0,0 +1,2006 @@
+/**
+ * @file ps-bench.c
+ * @brief Benchmarks for the pseudoshell building blocks.
+ * @details Every benchmark case is run a number of times; the table printed at the end
+ * gives the mean time per operation, the throughput and the relative standard deviation
+ * across runs. Cases that time their operations one by one also give the median and the 99th
+ * percentile. Cases can be selected with a substring of their name. @n
+ * The results can be saved as a baseline, and a later run compared against it: each case then
+ * also gives how much its time per operation changed, and whether the change is larger than
+ * twice the deviation of either run, which is all a single run can tell from noise.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "compiler-defs.h"
+#include "event2/util.h"
+#include "nt-bitmap.h"
+#include "nt-budget.h"
+#include "nt-crc32c.h"
+#include "nt-timerwheel.h"
+#include "nt-pool.h"
+#include "nt-redact.h"
+#include "nt-strip.h"
+#include "nt-vis.h"
+#include "ps-analyze.h"
+#include "ps-cast.h"
+#include "ps-cmd.h"
+#include "ps-index.h"
+#include "ps-journal.h"
+#include "ps-log.h"
+#include "ps-pty.h"
+#include "ps-replay.h"
+#include "ps-sum.h"
+#include "ps-view.h"
+#include "yandu_log.h"
+#include "yanzc_buffer.h"
+#include "yanzc_chain.h"
+
+/** @brief Default number of runs of each case. */
+#define DEFAULT_RUNS (5)
+
+/** @brief Amount of data pushed through the log by the durability cases. */
+#define LOG_BENCH_BYTES (64UL << 20)
+
+/** @brief Size of a single write in the durability cases. */
+#define LOG_BENCH_CHUNK (4096)
+
+/** @brief Amount of terminal output the stripper cases go through. */
+#define STRIP_BENCH_BYTES (16UL << 20)
+
+/** @brief Size of a single chunk fed to the stripper, as the relay reads them. */
+#define STRIP_BENCH_CHUNK (4096)
+
+/** @brief Buffers created, or realignments made, by a run of the buffer cases. */
+#define BUFFER_BENCH_OPS (1000000UL)
+
+/** @brief Size of a buffer of the buffer cases. */
+#define BUFFER_BENCH_SIZE (4096UL)
+
+/** @brief Readers of the buffer being realigned. */
+#define BUFFER_BENCH_READERS (4)
+
+/** @brief Amount of data pushed through a pipe by the buffer pipe cases. */
+#define BUFFER_BENCH_BYTES (64UL << 20)
+
+/** @brief Operations a run of the bitmap cases makes. */
+#define BITMAP_BENCH_OPS (1000000UL)
+
+/** @brief Milliseconds of simulated time the timer wheel benchmark runs for. */
+#define TIMER_BENCH_TICKS (100000UL)
+
+/** @brief Timers pushed back on each tick of the timer wheel benchmark. */
+#define TIMER_BENCH_REARMS (16)
+
+/** @brief Latest deadline of a timer in the timer wheel benchmark, in milliseconds. */
+#define TIMER_BENCH_SPREAD_MS (10000U)
+
+/** @brief Amount of input the escaping cases go through. */
+#define VIS_BENCH_BYTES (16UL << 20)
+
+/** @brief Input escaped at a time. */
+#define VIS_BENCH_CHUNK (4096)
+
+/** @brief Room for the escaped chunk, at worst 4 bytes per input byte and a terminator. */
+#define VIS_BENCH_OUTPUT (4 * VIS_BENCH_CHUNK + 64)
+
+/** @brief Lines a run of the debug log case appends. */
+#define LOG_BENCH_LINES (2000)
+
+/** @brief Amount of data pushed through a pseudo terminal by the relay case. */
+#define RELAY_BENCH_BYTES (64UL << 20)
+
+/** @brief Length of the log the index case goes through. */
+#define INDEX_BENCH_BYTES (64UL << 20)
+
+/** @brief Length of the log the asciicast conversion cases go through. */
+#define CAST_BENCH_BYTES (64UL << 20)
+
+/** @brief Log bytes per output record in the asciicast conversion cases. */
+#define CAST_BENCH_RECORD (4096)
+
+/** @brief Number of logs the analyzer cases go through. */
+#define ANALYZE_BENCH_LOGS (64)
+
+/** @brief Length unit of the logs of the analyzer cases, the n-th is (n % 8 + 1) units long. */
+#define ANALYZE_BENCH_UNIT (256UL << 10)
+
+/** @brief Number of sessions a run of the startup cases starts. */
+#define STARTUP_BENCH_SESSIONS (50)
+
+/** @brief How long the startup cases wait for a prompt, in milliseconds. */
+#define STARTUP_BENCH_TIMEOUT_MS (10000)
+
+/** @brief Age of a segment of the log in the rotation case. */
+#define ROTATE_BENCH_AGE "age:1s"
+
+/** @brief Most segments the rotation case looks for. */
+#define ROTATE_BENCH_SEGMENTS (8)
+
+/** @brief Output of a run of the session/bulk case. */
+#define SESSION_BENCH_BULK_BYTES (32UL << 20)
+
+/** @brief Keystrokes a run of the session/keys case types. */
+#define SESSION_BENCH_KEYS (500)
+
+/** @brief Pastes a run of the session/paste case makes. */
+#define SESSION_BENCH_PASTES (50)
+
+/** @brief Size of a paste. */
+#define SESSION_BENCH_PASTE_SIZE (16UL << 10)
+
+/**
+ * @brief Outcome of a single run of a case.
+ */
+typedef struct bench_run_t {
+    uint64_t ops_;        /**< Number of operations performed */
+    uint64_t bytes_;      /**< Number of bytes processed */
+    uint64_t elapsed_ns_; /**< Time it took */
+    uint64_t p50_ns_;     /**< Median time of an operation, 0 if not measured */
+    uint64_t p99_ns_;     /**< 99th percentile of it */
+} bench_run_t;
+
+/**
+ * @brief A benchmark case.
+ */
+typedef struct bench_case_t {
+    const char *name_;                                           /**< Unique name */
+    int (*run_)(const struct bench_case_t *bc, bench_run_t *run); /**< Runs the case once */
+    const char *arg_;                                            /**< Case specific */
+} bench_case_t;
+
+/** @brief Directory benchmark files are created in. */
+static const char *s_dir = ".";
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Removes a log and its metadata.
+ */
+static void remove_log(const char *name) {
+    char meta[4096];
+    snprintf(meta, sizeof(meta), "%s%s", name, PS_META_SUFFIX);
+    unlink(name);
+    unlink(meta);
+    snprintf(meta, sizeof(meta), "%s%s", name, PS_SUM_SUFFIX);
+    unlink(meta);
+}
+
+/**
+ * @brief Turns the argument of a log case into a log configuration.
+ * @details The argument is a durability specification, optionally followed by
+ * @c ,direct and @c ,noprealloc.
+ */
+static int log_bench_config(const char *arg, ps_log_config_t *config) {
+    char spec[64];
+    char *option;
+    snprintf(spec, sizeof(spec), "%s", arg);
+    option = strchr(spec, ',');
+    if (NULL != option) {
+        *option++ = '\0';
+    }
+    config->prealloc_ = PS_LOG_DEFAULT_PREALLOC;
+    for (; NULL != option; option = strchr(option, ',') ? strchr(option, ',') + 1 : NULL) {
+        if (0 == strncmp(option, "direct", 6)) {
+            config->direct_ = 1;
+        } else if (0 == strncmp(option, "noprealloc", 10)) {
+            config->prealloc_ = 0;
+        }
+    }
+    return ps_log_parse_durability(spec, config);
+}
+
+/**
+ * @brief Pushes data through a session log configured as given in @c arg_.
+ * @details Closing the log is part of the measurement, as that is where the outstanding
+ * data is synced in every mode.
+ */
+static int run_log_write(const bench_case_t *bc, bench_run_t *run) {
+    static uint8_t chunk[LOG_BENCH_CHUNK];
+    char name[4096];
+    ps_log_config_t config = {.durability_ = PS_LOG_SYNC_NONE, .dir_ = s_dir};
+    yanzc_chain_t *chain = io_chain_new(LOG_BENCH_CHUNK * 2, 0);
+    yanzc_chain_reader_t reader;
+    ps_log_t log;
+    uint64_t start;
+    if (NULL == chain || 0 != log_bench_config(bc->arg_, &config)) {
+        io_chain_free(chain);
+        return -1;
+    }
+    log = ps_log_open(&config);
+    if (NULL == log) {
+        io_chain_free(chain);
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%s", ps_log_name(log));
+    io_chain_reader_attach(chain, &reader);
+    memset(chunk, 'x', sizeof(chunk));
+    start = now_ns();
+    for (run->bytes_ = 0; run->bytes_ < LOG_BENCH_BYTES; run->bytes_ += sizeof(chunk)) {
+        io_chain_append(chain, chunk, sizeof(chunk));
+        while (io_chain_reader_pending(&reader) > 0 && 0 == ps_log_write(log, &reader)) {
+        }
+        ++run->ops_;
+    }
+    ps_log_close(log);
+    run->elapsed_ns_ = now_ns() - start;
+    io_chain_reader_detach(&reader);
+    io_chain_free(chain);
+    remove_log(name);
+    return 0;
+}
+
+/**
+ * @brief Pushes data through a shared journal, a record per chunk, then reads it back.
+ * @details The read back, which checks every record, is part of the measurement.
+ */
+static int run_journal(const bench_case_t *bc, bench_run_t *run) {
+    static uint8_t chunk[LOG_BENCH_CHUNK];
+    char name[4096];
+    yanzc_chain_t *chain = io_chain_new(LOG_BENCH_CHUNK * 2, 0);
+    yanzc_chain_reader_t reader;
+    ps_journal_cursor_t cursor = {NULL, 0, 0, 0};
+    ps_journal_record_t record;
+    const uint8_t *payload;
+    ps_journal_t journal;
+    uint64_t start;
+    void *map;
+    int fd, result = 0;
+    (void)(bc);
+    snprintf(name, sizeof(name), "%s/journal_bench", s_dir);
+    unlink(name);
+    journal = ps_journal_open(name, "bench");
+    if (NULL == chain || NULL == journal) {
+        ps_journal_close(journal);
+        io_chain_free(chain);
+        return -1;
+    }
+    io_chain_reader_attach(chain, &reader);
+    memset(chunk, 'x', sizeof(chunk));
+    start = now_ns();
+    for (run->bytes_ = 0; run->bytes_ < LOG_BENCH_BYTES; run->bytes_ += sizeof(chunk)) {
+        io_chain_append(chain, chunk, sizeof(chunk));
+        if (0 != ps_journal_write(journal, &reader)) {
+            result = -1;
+            break;
+        }
+        ++run->ops_;
+    }
+    ps_journal_close(journal);
+    fd = open(name, O_RDONLY | O_CLOEXEC);
+    cursor.size_ = fd >= 0 ? (size_t)lseek(fd, 0, SEEK_END) : 0;
+    map = 0 != cursor.size_ ? mmap(NULL, cursor.size_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (MAP_FAILED != map) {
+        cursor.data_ = map;
+        while (ps_journal_next(&cursor, &record, &payload)) {
+        }
+        munmap(map, cursor.size_);
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    if (MAP_FAILED == map || 0 != cursor.skipped_) {
+        result = -1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    io_chain_reader_detach(&reader);
+    io_chain_free(chain);
+    unlink(name);
+    return result;
+}
+
+/**
+ * @brief Checksums data a block of the log at a time, with the implementation named in
+ * @c arg_: @c table, or the one the processor allows.
+ */
+static int run_crc32c(const bench_case_t *bc, bench_run_t *run) {
+    uint8_t *data = nt_pool_alloc(LOG_BENCH_BYTES);
+    uint32_t (*crc32c)(uint32_t, const void *, size_t) =
+        0 == strcmp(bc->arg_, "table") ? nt_crc32c_table : nt_crc32c;
+    uint32_t crc = 0;
+    uint64_t start;
+    size_t idx;
+    int result;
+    if (NULL == data) {
+        return -1;
+    }
+    for (idx = 0; idx < LOG_BENCH_BYTES; ++idx) {
+        data[idx] = (uint8_t)(idx * 2654435761U >> 24);
+    }
+    start = now_ns();
+    for (idx = 0; idx < LOG_BENCH_BYTES; idx += PS_SUM_BLOCK) {
+        crc = crc32c(crc, data + idx, PS_SUM_BLOCK);
+        ++run->ops_;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = LOG_BENCH_BYTES;
+    /* The implementations must agree, on the whole data at once as well */
+    result = crc == nt_crc32c_table(0, data, LOG_BENCH_BYTES) ? 0 : -1;
+    nt_pool_free(data);
+    return result;
+}
+
+/**
+ * @brief Fills a buffer with synthetic terminal output.
+ * @details With @p escapes set, the output looks like a coloured directory listing followed
+ * by a redrawn progress bar; otherwise it is plain lines of text.
+ */
+static void fill_terminal_output(uint8_t *buf, size_t len, int escapes) {
+    static const char *const colored[] = {
+        "\033[01;34mdirectory\033[0m  file.txt  \033[01;32mscript.sh\033[0m  README.md\r\n",
+        "\033]0;user@host: ~/src\007\033[?2004h$ make -j8 all\r\n",
+        "\r[=====>          ]  42% \033[K",
+        "\033[1;31merror:\033[0m expected ';' before '}' token\r\n",
+    };
+    static const char plain[] =
+        "The quick brown fox jumps over the lazy dog, then compiles the kernel again.\n";
+    size_t pos = 0, idx = 0;
+    while (pos < len) {
+        const char *line = escapes ? colored[idx++ % ARRAY_SIZE(colored)] : plain;
+        size_t line_len = strlen(line);
+        if (line_len > len - pos) {
+            line_len = len - pos;
+        }
+        memcpy(buf + pos, line, line_len);
+        pos += line_len;
+    }
+}
+
+/**
+ * @brief Strips synthetic terminal output, with escape sequences if @c arg_ is non-empty.
+ */
+static int run_strip(const bench_case_t *bc, bench_run_t *run) {
+    static nt_strip_t strip;
+    uint8_t *input = nt_pool_alloc(STRIP_BENCH_BYTES);
+    uint8_t *output = nt_pool_alloc(NT_STRIP_OUTPUT_SIZE(STRIP_BENCH_CHUNK));
+    uint64_t start;
+    size_t off, stripped = 0;
+    if (NULL == input || NULL == output) {
+        nt_pool_free(output);
+        nt_pool_free(input);
+        return -1;
+    }
+    fill_terminal_output(input, STRIP_BENCH_BYTES, '\0' != bc->arg_[0]);
+    nt_strip_init(&strip);
+    start = now_ns();
+    for (off = 0; off < STRIP_BENCH_BYTES; off += STRIP_BENCH_CHUNK) {
+        stripped += nt_strip_feed(&strip, input + off, STRIP_BENCH_CHUNK, output);
+        ++run->ops_;
+    }
+    stripped += nt_strip_finish(&strip, output);
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = STRIP_BENCH_BYTES;
+    nt_pool_free(output);
+    nt_pool_free(input);
+    return 0 == stripped ? -1 : 0;
+}
+
+/**
+ * @brief Creates and frees buffers, or realigns one with its readers.
+ * @details With @c arg_ set to @c new, a run creates and frees @ref BUFFER_BENCH_OPS buffers
+ * of @ref BUFFER_BENCH_SIZE bytes. With @c realign, it writes to a buffer, moves its
+ * @ref BUFFER_BENCH_READERS readers past what was written and realigns it as many times.
+ */
+static int run_buffer(const bench_case_t *bc, bench_run_t *run) {
+    struct yanz_read_slice_t readers[BUFFER_BENCH_READERS];
+    struct yanzc_buffer_t *buf = NULL;
+    uint64_t start;
+    size_t idx, reader;
+    int realigned = 0;
+    if (0 == strcmp(bc->arg_, "realign")) {
+        buf = io_buffer_new(BUFFER_BENCH_SIZE);
+        if (NULL == buf) {
+            return -1;
+        }
+        for (reader = 0; reader < BUFFER_BENCH_READERS; ++reader) {
+            readers[reader] = io_buffer_get_read_slice(buf, 0);
+        }
+    }
+    start = now_ns();
+    for (idx = 0; idx < BUFFER_BENCH_OPS; ++idx) {
+        if (NULL == buf) {
+            struct yanzc_buffer_t *fresh = io_buffer_new(BUFFER_BENCH_SIZE);
+            if (NULL == fresh) {
+                return -1;
+            }
+            io_buffer_free(fresh);
+            continue;
+        }
+        io_buffer_move_write_offset(buf, 1 + idx % BUFFER_BENCH_SIZE);
+        for (reader = 0; reader < BUFFER_BENCH_READERS; ++reader) {
+            yanz_read_slice_move_read_offset(&readers[reader],
+                                             yanz_read_slice_get_size_for_reads(&readers[reader]));
+        }
+        realigned += io_buffer_realign(buf, readers, BUFFER_BENCH_READERS);
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->ops_ = BUFFER_BENCH_OPS;
+    run->bytes_ = NULL == buf ? BUFFER_BENCH_OPS * BUFFER_BENCH_SIZE : 0;
+    io_buffer_free(buf);
+    return NULL == buf || BUFFER_BENCH_OPS == realigned ? 0 : -1;
+}
+
+/**
+ * @brief Pushes @ref BUFFER_BENCH_BYTES through a pipe, from a buffer and back into another.
+ * @details @c arg_ gives the size of the buffers, which is also how much a call moves.
+ */
+static int run_buffer_pipe(const bench_case_t *bc, bench_run_t *run) {
+    unsigned int chunk = (unsigned int)strtoul(bc->arg_, NULL, 10);
+    struct yanzc_buffer_t *source = io_buffer_new(chunk), *sink = io_buffer_new(chunk);
+    struct yanz_read_slice_t from_source, from_sink;
+    uint64_t start, moved = 0;
+    int pipe_fd[2];
+    int result = 0;
+    if (NULL == source || NULL == sink || 0 != pipe(pipe_fd)) {
+        io_buffer_free(sink);
+        io_buffer_free(source);
+        return -1;
+    }
+    /* A chunk always fits, so neither call ever blocks */
+    fcntl(pipe_fd[1], F_SETPIPE_SZ, chunk);
+    memset(source->data_, 'x', chunk);
+    from_source = io_buffer_get_read_slice(source, 0);
+    from_sink = io_buffer_get_read_slice(sink, 0);
+    start = now_ns();
+    while (0 == result && moved < BUFFER_BENCH_BYTES) {
+        source->offset_write_ = chunk;
+        from_source.offset_read_ = 0;
+        result = from_buffer_to_fd(&from_source, pipe_fd[1]);
+        if (0 == result) {
+            result = from_fd_to_buffer(pipe_fd[0], sink);
+        }
+        moved += yanz_read_slice_get_size_for_reads(&from_sink);
+        from_sink.offset_read_ = sink->offset_write_;
+        io_buffer_realign(sink, &from_sink, 1);
+        run->ops_ += 2;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = moved;
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+    io_buffer_free(sink);
+    io_buffer_free(source);
+    return result;
+}
+
+/**
+ * @brief Takes and gives back a bit of a bitmap, as an allocator of slots does.
+ * @details @c arg_ is <tt>bits/fill</tt>: the size of the bitmap and the percentage of its
+ * bits, the lowest ones, set before the run. An operation finds the first cleared bit, sets
+ * it and clears it again.
+ */
+static int run_bitmap(const bench_case_t *bc, bench_run_t *run) {
+    char *fill_arg;
+    unsigned long bits = strtoul(bc->arg_, &fill_arg, 10);
+    unsigned long fill = bits * strtoul(fill_arg + 1, NULL, 10) / 100;
+    nt_bitmap_t bitmap = nt_bitmap_create((unsigned int)bits);
+    unsigned long idx, found = 0;
+    uint64_t start;
+    if (NULL == bitmap) {
+        return -1;
+    }
+    for (idx = 0; idx < fill; ++idx) {
+        nt_bitmap_set(bitmap, (unsigned short)idx);
+    }
+    start = now_ns();
+    for (idx = 0; idx < BITMAP_BENCH_OPS; ++idx) {
+        unsigned long bit = nt_bitmap_ffc(bitmap);
+        nt_bitmap_set(bitmap, (unsigned short)bit);
+        nt_bitmap_clear(bitmap, (unsigned short)bit);
+        found += bit;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->ops_ = BITMAP_BENCH_OPS;
+    nt_bitmap_free(bitmap);
+    return found == fill * BITMAP_BENCH_OPS ? 0 : -1;
+}
+
+/**
+ * @brief State of the timer wheel benchmark, which expired timers arm themselves again with.
+ */
+typedef struct timer_bench_t {
+    nt_timerwheel_t wheel_; /**< The wheel */
+    uint64_t now_ns_;       /**< Simulated time */
+    unsigned int seed_;     /**< Random deadlines */
+} timer_bench_t;
+
+/**
+ * @brief A timer of the timer wheel benchmark.
+ */
+typedef struct timer_bench_timer_t {
+    nt_timer_t timer_;     /**< The timer */
+    timer_bench_t *bench_; /**< The benchmark */
+} timer_bench_timer_t;
+
+/**
+ * @brief Arms a timer of the benchmark at a random deadline.
+ */
+static void timer_bench_arm(timer_bench_timer_t *timer) {
+    timer_bench_t *bench = timer->bench_;
+    uint64_t delay = 1 + (uint64_t)(rand_r(&bench->seed_) % TIMER_BENCH_SPREAD_MS);
+    nt_timer_arm(&bench->wheel_, &timer->timer_, bench->now_ns_ + delay * 1000000ULL);
+}
+
+/**
+ * @brief Expired timer of the benchmark, armed again like a periodic one.
+ */
+static void timer_bench_fire(void *context) { timer_bench_arm(context); }
+
+/**
+ * @brief Keeps @c arg_ timers going on a wheel of millisecond ticks.
+ * @details For @ref TIMER_BENCH_TICKS simulated milliseconds, each tick pushes
+ * @ref TIMER_BENCH_REARMS random timers back, like output pushes an idle deadline back, and
+ * fires the expired timers, which arm themselves again. Each push and each fire is an op.
+ */
+static int run_timers(const bench_case_t *bc, bench_run_t *run) {
+    unsigned long count = strtoul(bc->arg_, NULL, 10), idx, tick;
+    timer_bench_t *bench = nt_pool_zalloc(sizeof(timer_bench_t));
+    timer_bench_timer_t *timers = nt_pool_zalloc(count * sizeof(timer_bench_timer_t));
+    uint64_t start;
+    if (NULL == bench || NULL == timers) {
+        nt_pool_free(timers);
+        nt_pool_free(bench);
+        return -1;
+    }
+    bench->seed_ = 1;
+    nt_timerwheel_init(&bench->wheel_, 1000000ULL, bench->now_ns_);
+    for (idx = 0; idx < count; ++idx) {
+        timers[idx].timer_.fire_ = timer_bench_fire;
+        timers[idx].timer_.context_ = &timers[idx];
+        timers[idx].bench_ = bench;
+        timer_bench_arm(&timers[idx]);
+    }
+    start = now_ns();
+    for (tick = 0; tick < TIMER_BENCH_TICKS; ++tick) {
+        bench->now_ns_ += 1000000ULL;
+        for (idx = 0; idx < TIMER_BENCH_REARMS; ++idx) {
+            timer_bench_arm(&timers[(unsigned long)rand_r(&bench->seed_) % count]);
+        }
+        run->ops_ += TIMER_BENCH_REARMS + nt_timerwheel_run(&bench->wheel_, bench->now_ns_);
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    nt_pool_free(timers);
+    nt_pool_free(bench);
+    return 0;
+}
+
+/**
+ * @brief Escapes @ref VIS_BENCH_BYTES of input, @ref VIS_BENCH_CHUNK bytes at a time.
+ * @details @c arg_ is <tt>format/input</tt>: @c hex or @c c, and @c printable for lines of
+ * text, @c binary for random bytes or @c mixed for coloured terminal output.
+ */
+static int run_vis(const bench_case_t *bc, bench_run_t *run) {
+    nt_vis_format_type_t format = 'h' == bc->arg_[0] ? NT_VIS_FORMAT_HEX : NT_VIS_FORMAT_C_SYTAX;
+    const char *input_type = strchr(bc->arg_, '/') + 1;
+    uint8_t *input = nt_pool_alloc(VIS_BENCH_BYTES);
+    char *output = nt_pool_alloc(VIS_BENCH_OUTPUT);
+    uint64_t start, escaped = 0;
+    size_t off;
+    if (NULL == input || NULL == output) {
+        nt_pool_free(output);
+        nt_pool_free(input);
+        return -1;
+    }
+    if (0 == strcmp(input_type, "binary")) {
+        unsigned int seed = 1;
+        for (off = 0; off < VIS_BENCH_BYTES; ++off) {
+            input[off] = (uint8_t)rand_r(&seed);
+        }
+    } else {
+        fill_terminal_output(input, VIS_BENCH_BYTES, 0 == strcmp(input_type, "mixed"));
+    }
+    start = now_ns();
+    for (off = 0; off < VIS_BENCH_BYTES; off += VIS_BENCH_CHUNK) {
+        escaped += nt_vis(format, (const char *)input + off, VIS_BENCH_CHUNK, output,
+                          VIS_BENCH_OUTPUT);
+        ++run->ops_;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = VIS_BENCH_BYTES;
+    nt_pool_free(output);
+    nt_pool_free(input);
+    return 0 == escaped ? -1 : 0;
+}
+
+/**
+ * @brief Appends @ref LOG_BENCH_LINES lines to a debug log.
+ * @details Each line is flushed and synchronised to the disk, as the debug builds do.
+ */
+static int run_debug_log(const bench_case_t *bc, bench_run_t *run) {
+    char name[4096];
+    FILE *stream;
+    uint64_t start;
+    size_t idx;
+    int result = 0;
+    (void)(bc);
+    snprintf(name, sizeof(name), "%s/debug_bench", s_dir);
+    stream = fopen(name, "w");
+    if (NULL == stream) {
+        return -1;
+    }
+    start = now_ns();
+    for (idx = 0; 0 == result && idx < LOG_BENCH_LINES; ++idx) {
+        result = 1 == append_formatted_string_to_stream(__func__, __LINE__, stream,
+                                                        "%zu bytes left, %s", idx, name)
+                     ? 0 : -1;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->ops_ = LOG_BENCH_LINES;
+    run->bytes_ = (uint64_t)ftell(stream);
+    fclose(stream);
+    unlink(name);
+    return result;
+}
+
+/**
+ * @brief Writes @ref RELAY_BENCH_BYTES to the slave part of a pseudo terminal, then closes it.
+ */
+static void *relay_writer(void *arg) {
+    static uint8_t chunk[4096];
+    int fd = *(int *)arg;
+    unsigned long written = 0;
+    memset(chunk, 'x', sizeof(chunk));
+    chunk[sizeof(chunk) - 1] = '\n';
+    while (written < RELAY_BENCH_BYTES) {
+        ssize_t result = write(fd, chunk, sizeof(chunk));
+        if (result <= 0) {
+            break;
+        }
+        written += (unsigned long)result;
+    }
+    close(fd);
+    return NULL;
+}
+
+/**
+ * @brief Reads a pseudo terminal into a chain, as the relay does.
+ * @details Gives the throughput the other stages of the relay have to keep up with. With
+ * @c arg_ @c budget, the chain is charged to a memory budget as that of a session is.
+ */
+static int run_relay_pty(const bench_case_t *bc, bench_run_t *run) {
+    int master, slave;
+    struct termios raw;
+    pthread_t writer;
+    nt_budget_t budget;
+    yanzc_chain_t *chain;
+    yanzc_chain_reader_t reader;
+    uint64_t start;
+    nt_budget_init(&budget, 0);
+    chain = io_chain_new_charged(4096, 0, 0 == strcmp(bc->arg_, "budget") ? &budget : NULL);
+    if (NULL == chain || 0 != openpty(&master, &slave, NULL, NULL, NULL)) {
+        io_chain_free(chain);
+        return -1;
+    }
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+    io_chain_reader_attach(chain, &reader);
+    start = now_ns();
+    if (0 != pthread_create(&writer, NULL, relay_writer, &slave)) {
+        close(slave);
+        close(master);
+        io_chain_reader_detach(&reader);
+        io_chain_free(chain);
+        return -1;
+    }
+    /* The master reports an error once the slave is closed and drained */
+    while (0 == from_fd_to_chain(master, chain)) {
+        io_chain_reader_advance(&reader, io_chain_reader_pending(&reader));
+        ++run->ops_;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = chain->offset_write_;
+    pthread_join(writer, NULL);
+    close(master);
+    io_chain_reader_detach(&reader);
+    io_chain_free(chain);
+    return 0;
+}
+
+/**
+ * @brief Compiles a set of secrets to redact, @c count patterns in total.
+ * @details A few token prefixes of well known services, the rest random literals.
+ */
+static nt_redact_set_t make_redact_set(size_t count) {
+    static const char *const tokens[] = {"ghp_", "glpat-", "xoxb-", "AKIA", "sk_live_"};
+    static const char alnum[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    nt_redact_pattern_t *patterns = calloc(count, sizeof(nt_redact_pattern_t));
+    uint8_t *storage = malloc(count * 24);
+    nt_redact_set_t set = NULL;
+    unsigned int seed = 12345;
+    size_t idx, pos;
+    if (NULL != patterns && NULL != storage) {
+        for (idx = 0; idx < count; ++idx) {
+            if (idx < ARRAY_SIZE(tokens)) {
+                patterns[idx].bytes_ = (const uint8_t *)tokens[idx];
+                patterns[idx].len_ = strlen(tokens[idx]);
+                patterns[idx].token_ = 1;
+                continue;
+            }
+            patterns[idx].bytes_ = storage + idx * 24;
+            patterns[idx].len_ = 12 + rand_r(&seed) % 13;
+            for (pos = 0; pos < patterns[idx].len_; ++pos) {
+                storage[idx * 24 + pos] = (uint8_t)alnum[rand_r(&seed) % (sizeof(alnum) - 1)];
+            }
+        }
+        set = nt_redact_compile(patterns, count);
+    }
+    free(storage);
+    free(patterns);
+    return set;
+}
+
+/**
+ * @brief Redacts synthetic terminal output, with the number of patterns given in @c arg_.
+ */
+static int run_redact(const bench_case_t *bc, bench_run_t *run) {
+    static nt_redact_t redact;
+    nt_redact_set_t set = make_redact_set(strtoul(bc->arg_, NULL, 10));
+    uint8_t *input = nt_pool_alloc(STRIP_BENCH_BYTES);
+    uint8_t *output = nt_pool_alloc(NT_REDACT_OUTPUT_SIZE(STRIP_BENCH_CHUNK));
+    uint64_t start;
+    size_t off, redacted = 0;
+    if (NULL == set || NULL == input || NULL == output) {
+        nt_pool_free(output);
+        nt_pool_free(input);
+        nt_redact_free(set);
+        return -1;
+    }
+    fill_terminal_output(input, STRIP_BENCH_BYTES, 1);
+    nt_redact_init(&redact, set);
+    start = now_ns();
+    for (off = 0; off < STRIP_BENCH_BYTES; off += STRIP_BENCH_CHUNK) {
+        redacted += nt_redact_feed(&redact, input + off, STRIP_BENCH_CHUNK, output);
+        ++run->ops_;
+    }
+    redacted += nt_redact_finish(&redact, output);
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = STRIP_BENCH_BYTES;
+    nt_pool_free(output);
+    nt_pool_free(input);
+    nt_redact_free(set);
+    return STRIP_BENCH_BYTES == redacted ? 0 : -1;
+}
+
+/**
+ * @brief Indexes a log of synthetic terminal output, with segments of @c arg_ bytes.
+ * @details The log is written beforehand, the measurement covers reading it back through the
+ * page cache, stripping it and writing the index, as the index thread does.
+ */
+static int run_index(const bench_case_t *bc, bench_run_t *run) {
+    char name[4096], index_name[sizeof(name) + sizeof(PS_INDEX_SUFFIX)];
+    uint8_t *data = nt_pool_alloc(INDEX_BENCH_BYTES);
+    ps_index_t index;
+    uint64_t start;
+    int fd;
+    snprintf(name, sizeof(name), "%s/index_XXXXXX", s_dir);
+    fd = NULL != data ? mkstemp(name) : -1;
+    if (fd < 0) {
+        nt_pool_free(data);
+        return -1;
+    }
+    fill_terminal_output(data, INDEX_BENCH_BYTES, 1);
+    if (INDEX_BENCH_BYTES != write(fd, data, INDEX_BENCH_BYTES)) {
+        close(fd);
+        unlink(name);
+        nt_pool_free(data);
+        return -1;
+    }
+    close(fd);
+    nt_pool_free(data);
+    start = now_ns();
+    index = ps_index_open(name, strtoul(bc->arg_, NULL, 10) << 10);
+    if (NULL == index) {
+        unlink(name);
+        return -1;
+    }
+    ps_index_advance(index, INDEX_BENCH_BYTES);
+    ps_index_close(index);
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = INDEX_BENCH_BYTES;
+    run->ops_ = 1;
+    snprintf(index_name, sizeof(index_name), "%s%s", name, PS_INDEX_SUFFIX);
+    unlink(index_name);
+    unlink(name);
+    return 0;
+}
+
+/**
+ * @brief Looks for command boundaries in synthetic terminal output, as the relay does.
+ * @details With a non-empty @c arg_, the prompt regular expression is used as well.
+ */
+static int run_cmd_scan(const bench_case_t *bc, bench_run_t *run) {
+    char name[4096], cmd_name[sizeof(name) + sizeof(PS_CMD_SUFFIX)];
+    uint8_t *input = nt_pool_alloc(STRIP_BENCH_BYTES);
+    yanzc_chain_t *chain = io_chain_new(STRIP_BENCH_CHUNK * 2, 0);
+    yanzc_chain_reader_t reader;
+    ps_cmd_t cmd;
+    uint64_t start;
+    size_t off;
+    snprintf(name, sizeof(name), "%s/cmd_bench", s_dir);
+    cmd = ps_cmd_open(name, '\0' != bc->arg_[0] ? bc->arg_ : NULL, 0);
+    if (NULL == input || NULL == chain || NULL == cmd) {
+        ps_cmd_close(cmd, 0);
+        io_chain_free(chain);
+        nt_pool_free(input);
+        return -1;
+    }
+    fill_terminal_output(input, STRIP_BENCH_BYTES, 1);
+    io_chain_reader_attach(chain, &reader);
+    start = now_ns();
+    for (off = 0; off < STRIP_BENCH_BYTES; off += STRIP_BENCH_CHUNK) {
+        io_chain_append(chain, input + off, STRIP_BENCH_CHUNK);
+        ps_cmd_scan(cmd, &reader);
+        ++run->ops_;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = STRIP_BENCH_BYTES;
+    ps_cmd_close(cmd, STRIP_BENCH_BYTES);
+    io_chain_reader_detach(&reader);
+    io_chain_free(chain);
+    nt_pool_free(input);
+    snprintf(cmd_name, sizeof(cmd_name), "%s%s", name, PS_CMD_SUFFIX);
+    unlink(cmd_name);
+    return 0;
+}
+
+/**
+ * @brief Encodes synthetic terminal output as JSON strings, a recording event at a time.
+ */
+static int run_cast_encode(const bench_case_t *bc, bench_run_t *run) {
+    uint8_t *input = nt_pool_alloc(STRIP_BENCH_BYTES);
+    char *output = nt_pool_alloc(NT_VIS_JSON_SIZE(PS_CAST_CHUNK));
+    uint64_t start;
+    size_t off, consumed;
+    (void)(bc);
+    if (NULL == input || NULL == output) {
+        nt_pool_free(output);
+        nt_pool_free(input);
+        return -1;
+    }
+    fill_terminal_output(input, STRIP_BENCH_BYTES, 1);
+    start = now_ns();
+    for (off = 0; off < STRIP_BENCH_BYTES; off += PS_CAST_CHUNK) {
+        nt_vis_json(input + off, PS_CAST_CHUNK, 0, output, &consumed);
+        run->bytes_ += consumed;
+        ++run->ops_;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    nt_pool_free(output);
+    nt_pool_free(input);
+    return STRIP_BENCH_BYTES == run->bytes_ ? 0 : -1;
+}
+
+/**
+ * @brief Writes a log of synthetic terminal output and metadata with an output record every
+ * @ref CAST_BENCH_RECORD bytes, 100 microseconds apart.
+ * @param name name of the log.
+ * @param bytes its length, a multiple of @ref CAST_BENCH_RECORD.
+ * @return 0 on success, -1 on error.
+ */
+static int cast_bench_log(const char *name, size_t bytes) {
+    char meta_name[4096 + sizeof(PS_META_SUFFIX)];
+    size_t size = sizeof(ps_meta_record_t) * (bytes / CAST_BENCH_RECORD + 2);
+    ps_meta_record_t *records = nt_pool_zalloc(size);
+    uint8_t *data = nt_pool_alloc(bytes);
+    size_t idx;
+    int log_fd, meta_fd, result = -1;
+    snprintf(meta_name, sizeof(meta_name), "%s%s", name, PS_META_SUFFIX);
+    log_fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    meta_fd = open(meta_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (NULL != records && NULL != data && log_fd >= 0 && meta_fd >= 0) {
+        records[0].type_ = PS_META_HEADER;
+        records[0].arg_ = PS_META_MAGIC;
+        records[0].time_ns_ = 1000000000ULL;
+        records[1].type_ = PS_META_RESIZE;
+        records[1].arg1_ = 50;
+        records[1].arg2_ = 132;
+        for (idx = 0; idx < bytes / CAST_BENCH_RECORD; ++idx) {
+            records[idx + 2].type_ = PS_META_OUTPUT;
+            records[idx + 2].time_ns_ = records[0].time_ns_ + idx * 100000ULL;
+            records[idx + 2].offset_ = idx * CAST_BENCH_RECORD;
+        }
+        fill_terminal_output(data, bytes, 1);
+        if ((ssize_t)bytes == write(log_fd, data, bytes) &&
+            (ssize_t)size == write(meta_fd, records, size)) {
+            result = 0;
+        }
+    }
+    if (meta_fd >= 0) {
+        close(meta_fd);
+    }
+    if (log_fd >= 0) {
+        close(log_fd);
+    }
+    nt_pool_free(data);
+    nt_pool_free(records);
+    return result;
+}
+
+/**
+ * @brief Converts a log into an asciicast recording on @c arg_ threads, 0 for one per
+ * processor online.
+ * @details The log is written beforehand, and the recording goes to @c /dev/null.
+ */
+static int run_cast_convert(const bench_case_t *bc, bench_run_t *run) {
+    char name[4096];
+    unsigned int jobs = (unsigned int)strtoul(bc->arg_, NULL, 10);
+    uint64_t start;
+    int fd, result;
+    snprintf(name, sizeof(name), "%s/cast_bench", s_dir);
+    fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (fd < 0 || 0 != cast_bench_log(name, CAST_BENCH_BYTES)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        remove_log(name);
+        return -1;
+    }
+    if (0 == jobs) {
+        jobs = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    start = now_ns();
+    result = ps_cast_convert(name, fd, jobs);
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = CAST_BENCH_BYTES;
+    run->ops_ = 1;
+    close(fd);
+    remove_log(name);
+    return result;
+}
+
+/**
+ * @brief Tells whether two files have the same contents.
+ * @return 1 if they do, 0 if not or if one cannot be read.
+ */
+static int same_files(const char *name_a, const char *name_b) {
+    int fd_a = open(name_a, O_RDONLY | O_CLOEXEC), fd_b = open(name_b, O_RDONLY | O_CLOEXEC);
+    char buf_a[4096], buf_b[4096];
+    ssize_t len_a = -1, len_b = -1;
+    while (fd_a >= 0 && fd_b >= 0) {
+        len_a = read(fd_a, buf_a, sizeof(buf_a));
+        len_b = read(fd_b, buf_b, sizeof(buf_b));
+        if (len_a <= 0 || len_a != len_b || 0 != memcmp(buf_a, buf_b, (size_t)len_a)) {
+            break;
+        }
+    }
+    if (fd_a >= 0) {
+        close(fd_a);
+    }
+    if (fd_b >= 0) {
+        close(fd_b);
+    }
+    return 0 == len_a && 0 == len_b;
+}
+
+/**
+ * @brief Imports the recording of a log, which has to convert back to the same recording.
+ * @details The log is written and converted beforehand, only the import is timed. The log
+ * imported has to be the same as the original, byte for byte.
+ */
+static int run_cast_import(const bench_case_t *bc, bench_run_t *run) {
+    char name[4096], cast[4096 + 16], copy[4096 + 16], copy_cast[4096 + 32];
+    uint64_t start;
+    int fd, result = -1;
+    (void)bc;
+    snprintf(name, sizeof(name), "%s/cast_bench", s_dir);
+    snprintf(cast, sizeof(cast), "%s%s", name, PS_CAST_SUFFIX);
+    snprintf(copy, sizeof(copy), "%s.copy", name);
+    snprintf(copy_cast, sizeof(copy_cast), "%s%s", copy, PS_CAST_SUFFIX);
+    fd = open(cast, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd >= 0 && 0 == cast_bench_log(name, CAST_BENCH_BYTES) &&
+        0 == ps_cast_convert(name, fd, 1)) {
+        start = now_ns();
+        result = ps_cast_import(fd, copy);
+        run->elapsed_ns_ = now_ns() - start;
+        run->bytes_ = CAST_BENCH_BYTES;
+        run->ops_ = 1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (0 == result) {
+        fd = open(copy_cast, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        result = fd >= 0 && 0 == ps_cast_convert(copy, fd, 1) && same_files(cast, copy_cast) &&
+                         same_files(name, copy)
+                     ? 0
+                     : -1;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    remove_log(name);
+    remove_log(copy);
+    unlink(cast);
+    unlink(copy_cast);
+    return result;
+}
+
+/**
+ * @brief Analyses an archive of logs of different lengths on @c arg_ threads, 0 for one per
+ * processor online.
+ * @details The logs are written beforehand.
+ */
+static int run_analyze(const bench_case_t *bc, bench_run_t *run) {
+    ps_analyze_config_t config = {.idle_ns_ = PS_ANALYZE_DEFAULT_IDLE_NS,
+                                  .jobs_ = (unsigned int)strtoul(bc->arg_, NULL, 10)};
+    char names[ANALYZE_BENCH_LOGS][4096];
+    const char *logs[ANALYZE_BENCH_LOGS];
+    ps_analyze_command_t top[1];
+    ps_analyze_stats_t stats;
+    size_t idx, n_top = ARRAY_SIZE(top);
+    uint64_t start;
+    int result = 0;
+    run->bytes_ = 0;
+    for (idx = 0; idx < ANALYZE_BENCH_LOGS; ++idx) {
+        size_t bytes = (idx % 8 + 1) * ANALYZE_BENCH_UNIT;
+        snprintf(names[idx], sizeof(names[idx]), "%s/analyze_bench_%zu", s_dir, idx);
+        logs[idx] = names[idx];
+        if (0 == result && 0 != cast_bench_log(names[idx], bytes)) {
+            result = -1;
+        }
+        run->bytes_ += bytes;
+    }
+    if (0 == config.jobs_) {
+        config.jobs_ = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (0 == result) {
+        start = now_ns();
+        result = 0 == ps_analyze(logs, ANALYZE_BENCH_LOGS, &config, &stats, top, &n_top) ? 0 : -1;
+        run->elapsed_ns_ = now_ns() - start;
+        run->ops_ = ANALYZE_BENCH_LOGS;
+    }
+    for (idx = 0; idx < ANALYZE_BENCH_LOGS; ++idx) {
+        remove_log(names[idx]);
+    }
+    return result;
+}
+
+/**
+ * @brief Verifies a log against its block checksums on @c arg_ threads, 0 for one per
+ * processor online.
+ * @details The log is written through a session log beforehand and is in the page cache.
+ */
+static int run_sum_verify(const bench_case_t *bc, bench_run_t *run) {
+    static uint8_t chunk[LOG_BENCH_CHUNK];
+    ps_log_config_t config = {.durability_ = PS_LOG_SYNC_NONE, .dir_ = s_dir};
+    unsigned int jobs = (unsigned int)strtoul(bc->arg_, NULL, 10);
+    yanzc_chain_t *chain = io_chain_new(LOG_BENCH_CHUNK * 2, 0);
+    yanzc_chain_reader_t reader;
+    ps_sum_result_t result;
+    const char *names[1];
+    char name[4096];
+    uint64_t start, written;
+    ps_log_t log = NULL != chain ? ps_log_open(&config) : NULL;
+    int error;
+    if (NULL == log) {
+        io_chain_free(chain);
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%s", ps_log_name(log));
+    io_chain_reader_attach(chain, &reader);
+    fill_terminal_output(chunk, sizeof(chunk), 1);
+    for (written = 0; written < LOG_BENCH_BYTES; written += sizeof(chunk)) {
+        io_chain_append(chain, chunk, sizeof(chunk));
+        while (io_chain_reader_pending(&reader) > 0 && 0 == ps_log_write(log, &reader)) {
+        }
+    }
+    ps_log_close(log);
+    io_chain_reader_detach(&reader);
+    io_chain_free(chain);
+    if (0 == jobs) {
+        jobs = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    names[0] = name;
+    start = now_ns();
+    error = ps_sum_verify(names, 1, jobs, &result);
+    run->elapsed_ns_ = now_ns() - start;
+    run->bytes_ = LOG_BENCH_BYTES;
+    run->ops_ = LOG_BENCH_BYTES / PS_SUM_BLOCK;
+    if (0 == error && (0 != result.error_ || 0 != result.n_bad_ ||
+                       LOG_BENCH_BYTES != result.covered_)) {
+        error = -1;
+    }
+    ps_sum_result_free(&result, 1);
+    remove_log(name);
+    return 0 == error ? 0 : -1;
+}
+
+/**
+ * @brief Publishes output to live viewers, none of which is attached.
+ * @details This is what a session pays for having viewers enabled.
+ */
+static int run_view_publish(const bench_case_t *bc, bench_run_t *run) {
+    static uint8_t chunk[LOG_BENCH_CHUNK];
+    char name[4096];
+    yanzc_chain_t *chain = io_chain_new(LOG_BENCH_CHUNK * 2, 0);
+    yanzc_chain_reader_t reader;
+    ps_view_t view;
+    uint64_t start;
+    (void)(bc);
+    snprintf(name, sizeof(name), "%s/view_bench", s_dir);
+    view = ps_view_open(name, 1UL << 20);
+    if (NULL == chain || NULL == view) {
+        ps_view_close(view);
+        io_chain_free(chain);
+        return -1;
+    }
+    io_chain_reader_attach(chain, &reader);
+    fill_terminal_output(chunk, sizeof(chunk), 1);
+    start = now_ns();
+    for (run->bytes_ = 0; run->bytes_ < LOG_BENCH_BYTES; run->bytes_ += sizeof(chunk)) {
+        io_chain_append(chain, chunk, sizeof(chunk));
+        ps_view_publish(view, &reader);
+        ++run->ops_;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    ps_view_close(view);
+    io_chain_reader_detach(&reader);
+    io_chain_free(chain);
+    return 0;
+}
+
+/** @brief Length of the log the replay server serves. */
+#define REPLAY_BENCH_BYTES (4UL << 20)
+
+/**
+ * @brief A replay client of the benchmark.
+ */
+typedef struct replay_bench_client_t {
+    const char *socket_name_; /**< Socket of the server */
+    int fd_;                  /**< Where the output goes */
+    int result_;              /**< Outcome of the request */
+} replay_bench_client_t;
+
+static void *replay_bench_client(void *context) {
+    replay_bench_client_t *client = context;
+    client->result_ = ps_replay_request(client->socket_name_, "replay_bench", 0, 0, client->fd_);
+    return NULL;
+}
+
+/** @brief Set to stop the replay server of the benchmark. */
+static volatile sig_atomic_t s_replay_stop;
+
+static void *replay_bench_server(void *context) {
+    return (void *)(intptr_t)ps_replay_serve(context, &s_replay_stop, NULL);
+}
+
+/**
+ * @brief Has as many clients as @c arg_ get the same log from a replay server at once.
+ * @details The clients write the output to @c /dev/null. The log stays in the page cache
+ * throughout, the server sends it to every client from there.
+ */
+static int run_replay(const bench_case_t *bc, bench_run_t *run) {
+    static uint8_t chunk[LOG_BENCH_CHUNK];
+    unsigned int n_clients = (unsigned int)strtoul(bc->arg_, NULL, 10), idx;
+    char log_name[4096], socket_name[108];
+    ps_replay_config_t config = {.socket_name_ = socket_name, .root_ = s_dir,
+                                 .max_clients_ = n_clients};
+    replay_bench_client_t *clients = calloc(n_clients, sizeof(replay_bench_client_t));
+    pthread_t *threads = calloc(n_clients, sizeof(pthread_t));
+    pthread_t server;
+    uint64_t start, written;
+    int fd, null_fd, result = 0;
+    snprintf(log_name, sizeof(log_name), "%s/replay_bench", s_dir);
+    snprintf(socket_name, sizeof(socket_name), "/tmp/ps-bench-replay.%d", (int)getpid());
+    fd = open(log_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    fill_terminal_output(chunk, sizeof(chunk), 1);
+    for (written = 0; fd >= 0 && written < REPLAY_BENCH_BYTES; written += sizeof(chunk)) {
+        if (sizeof(chunk) != write(fd, chunk, sizeof(chunk))) {
+            result = -1;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    s_replay_stop = 0;
+    if (NULL == clients || NULL == threads || fd < 0 || null_fd < 0 || 0 != result ||
+        0 != pthread_create(&server, NULL, replay_bench_server, &config)) {
+        free(clients);
+        free(threads);
+        if (null_fd >= 0) {
+            close(null_fd);
+        }
+        unlink(log_name);
+        return -1;
+    }
+    /* The server has its socket up once a request gets an answer, refused or not */
+    for (idx = 0; idx < 1000; ++idx) {
+        int error = ps_replay_request(socket_name, "", 0, 0, null_fd);
+        if (ECONNREFUSED != error && ENOENT != error) {
+            break;
+        }
+        usleep(1000);
+    }
+    start = now_ns();
+    for (idx = 0; idx < n_clients; ++idx) {
+        clients[idx] = (replay_bench_client_t){.socket_name_ = socket_name, .fd_ = null_fd};
+        if (0 != pthread_create(&threads[idx], NULL, replay_bench_client, &clients[idx])) {
+            break;
+        }
+    }
+    n_clients = idx;
+    for (idx = 0; idx < n_clients; ++idx) {
+        pthread_join(threads[idx], NULL);
+        result |= 0 != clients[idx].result_ ? -1 : 0;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    run->ops_ = n_clients;
+    run->bytes_ = (uint64_t)n_clients * REPLAY_BENCH_BYTES;
+    /* Stopped after waiting, which a last request ends */
+    s_replay_stop = 1;
+    ps_replay_request(socket_name, "", 0, 0, null_fd);
+    pthread_join(server, NULL);
+    close(null_fd);
+    unlink(log_name);
+    free(threads);
+    free(clients);
+    return result;
+}
+
+static int compare_u64(const void *left, const void *right) {
+    uint64_t a = *(const uint64_t *)left, b = *(const uint64_t *)right;
+    return a < b ? -1 : a > b;
+}
+
+/**
+ * @brief Finds the pseudoshell executable, which is built next to this one.
+ * @return 0 on success, -1 on error.
+ */
+static int startup_program(char *path, size_t len) {
+    ssize_t fill = readlink("/proc/self/exe", path, len - sizeof("pseudoshell"));
+    char *slash;
+    if (fill < 0) {
+        return -1;
+    }
+    path[fill] = '\0';
+    slash = strrchr(path, '/');
+    if (NULL == slash) {
+        return -1;
+    }
+    strcpy(slash + 1, "pseudoshell");
+    return access(path, X_OK);
+}
+
+/**
+ * @brief Waits for a session to show its prompt on a terminal.
+ * @return 0 once the prompt is there, -1 on error or timeout.
+ */
+static int startup_wait_prompt(int master) {
+    struct pollfd pfd = {.fd = master, .events = POLLIN};
+    char buf[256];
+    while (poll(&pfd, 1, STARTUP_BENCH_TIMEOUT_MS) > 0) {
+        ssize_t len = read(master, buf, sizeof(buf));
+        if (len <= 0) {
+            return -1;
+        }
+        if (NULL != memchr(buf, '$', (size_t)len)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Waits for a session to exit.
+ * @return Its exit status, -1 if it did not exit cleanly in time; it is killed then.
+ */
+static int startup_wait_exit(pid_t pid) {
+    int status, waited;
+    for (waited = 0; waited < STARTUP_BENCH_TIMEOUT_MS; ++waited) {
+        if (pid == waitpid(pid, &status, WNOHANG)) {
+            return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        }
+        if (waited > 10) {
+            usleep(1000);
+        }
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    return -1;
+}
+
+/**
+ * @brief Starts sessions one after the other and times them.
+ * @details With @c arg_ set to @c prompt, a session runs on a terminal of its own and is
+ * timed until the prompt its command prints comes out of that terminal, through the whole
+ * relay: that is the time to the first prompt. With @c batch, a headless session running
+ * @c true is timed until it exits. With @c script, a headless shell is timed until it runs
+ * out of an input file whose last line has no newline, which it must notice.
+ */
+static int run_startup(const bench_case_t *bc, bench_run_t *run) {
+    extern char **environ;
+    static const char script[] = "echo one\necho two";
+    char program[4096], name[4096], input[4096];
+    uint64_t latency[STARTUP_BENCH_SESSIONS];
+    int prompt = 0 == strcmp(bc->arg_, "prompt");
+    char *prompt_args[] = {program, "-I", "0", "-o", name, "/bin/sh", "-c", "printf '$ '", NULL};
+    char *batch_args[] = {program, "-B", "-I", "0", "-o", name, "true", NULL};
+    char *script_args[] = {program, "-B", "-I", "0", "-i", input, "-o", name, "/bin/sh", NULL};
+    char *const *args = prompt ? prompt_args : batch_args;
+    struct winsize win_size = {.ws_row = 24, .ws_col = 80};
+    size_t idx;
+    int result = 0;
+    snprintf(name, sizeof(name), "%s/startup_bench", s_dir);
+    snprintf(input, sizeof(input), "%s/startup_bench.in", s_dir);
+    if (0 != startup_program(program, sizeof(program))) {
+        return -1;
+    }
+    if (0 == strcmp(bc->arg_, "script")) {
+        int fd = open(input, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        ssize_t written = fd >= 0 ? write(fd, script, sizeof(script) - 1) : -1;
+        if (fd >= 0) {
+            close(fd);
+        }
+        if ((ssize_t)sizeof(script) - 1 != written) {
+            unlink(input);
+            return -1;
+        }
+        args = script_args;
+    }
+    run->elapsed_ns_ = 0;
+    for (idx = 0; 0 == result && idx < STARTUP_BENCH_SESSIONS; ++idx) {
+        posix_spawn_file_actions_t actions;
+        int master = -1, slave = -1, status;
+        uint64_t start;
+        pid_t pid;
+        posix_spawn_file_actions_init(&actions);
+        if (prompt) {
+            if (0 != openpty(&master, &slave, NULL, NULL, &win_size)) {
+                posix_spawn_file_actions_destroy(&actions);
+                return -1;
+            }
+            fcntl(master, F_SETFD, FD_CLOEXEC);
+            posix_spawn_file_actions_adddup2(&actions, slave, STDIN_FILENO);
+            posix_spawn_file_actions_adddup2(&actions, slave, STDOUT_FILENO);
+            posix_spawn_file_actions_addclose(&actions, slave);
+        }
+        start = now_ns();
+        if (0 != posix_spawn(&pid, program, &actions, NULL, args, environ)) {
+            result = -1;
+        } else {
+            if (prompt) {
+                close(slave);
+                slave = -1;
+                result = startup_wait_prompt(master);
+            } else if (0 != startup_wait_exit(pid)) {
+                result = -1;
+            }
+            latency[idx] = now_ns() - start;
+            run->elapsed_ns_ += latency[idx];
+            if (prompt) {
+                waitpid(pid, &status, 0);
+            }
+        }
+        if (slave >= 0) {
+            close(slave);
+        }
+        if (master >= 0) {
+            close(master);
+        }
+        posix_spawn_file_actions_destroy(&actions);
+    }
+    remove_log(name);
+    unlink(input);
+    snprintf(name + strlen(name), sizeof(name) - strlen(name), "%s", PS_CMD_SUFFIX);
+    unlink(name);
+    if (0 != result) {
+        return -1;
+    }
+    qsort(latency, STARTUP_BENCH_SESSIONS, sizeof(latency[0]), compare_u64);
+    run->ops_ = STARTUP_BENCH_SESSIONS;
+    run->p50_ns_ = latency[STARTUP_BENCH_SESSIONS / 2];
+    run->p99_ns_ = latency[STARTUP_BENCH_SESSIONS * 99 / 100];
+    return 0;
+}
+
+/**
+ * @brief Checks a segment of a log against its metadata.
+ * @details Every record has to fall within the segment, and the footer give its length.
+ * @param name name of the segment.
+ * @param[out] data where the segment goes, @p room bytes at most.
+ * @param room room there is at @p data.
+ * @param[out] output offset of the last output record, unchanged without one.
+ * @return Length of the segment, -1 if it cannot be read or its metadata is wrong.
+ */
+static ssize_t rotate_bench_segment(const char *name, char *data, size_t room,
+                                    uint64_t *output) {
+    ps_meta_record_t record;
+    char meta[4096];
+    ssize_t len;
+    int fd, footer = 0;
+    fd = open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    len = read(fd, data, room);
+    close(fd);
+    snprintf(meta, sizeof(meta), "%s%s", name, PS_META_SUFFIX);
+    fd = open(meta, O_RDONLY | O_CLOEXEC);
+    if (len < 0 || fd < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    /* The header is rewritten on each commit, its offset is the length committed */
+    while (sizeof(record) == read(fd, &record, sizeof(record))) {
+        if (record.offset_ > (uint64_t)len) {
+            len = -1;
+        } else if (PS_META_OUTPUT == record.type_) {
+            *output = record.offset_;
+        } else if (PS_META_FOOTER == record.type_) {
+            footer = (uint64_t)len == record.offset_;
+        }
+    }
+    close(fd);
+    return footer ? len : -1;
+}
+
+/**
+ * @brief Has a headless session rotate its log while the redactor holds back the start of a
+ * secret, and checks the segments.
+ * @details The command prints the start of the secret, waits for the segment to age and
+ * prints the rest. The segments together have to be the output with the secret masked, each
+ * with the records of its metadata within it, the last output record pointing at the rest
+ * of the secret.
+ */
+static int run_rotate_redact(const bench_case_t *bc, bench_run_t *run) {
+    extern char **environ;
+    static const char patterns[] = "literal hunter2xyz\n";
+    static const char after[] = "er2xyz-AFTER";
+    char program[4096], name[4096], pattern[4096], segment[4096 + 32];
+    char *args[] = {program, "-B", "-I", "0", "-R", pattern, "-S", ROTATE_BENCH_AGE, "-o", name,
+                    "/bin/sh", "-c", "printf 'abc hunt'; sleep 2; printf 'er2xyz-AFTER'", NULL};
+    char data[64], expected[64];
+    size_t len = 0, idx;
+    uint64_t start, output = 0;
+    ssize_t written, last = 0;
+    unsigned int segments = 0;
+    int fd, result = 0;
+    pid_t pid;
+    (void)bc;
+    snprintf(name, sizeof(name), "%s/rotate_bench", s_dir);
+    snprintf(pattern, sizeof(pattern), "%s/rotate_bench.patterns", s_dir);
+    if (0 != startup_program(program, sizeof(program))) {
+        return -1;
+    }
+    fd = open(pattern, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    written = fd >= 0 ? write(fd, patterns, sizeof(patterns) - 1) : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    start = now_ns();
+    if ((ssize_t)sizeof(patterns) - 1 != written ||
+        0 != posix_spawn(&pid, program, NULL, NULL, args, environ) ||
+        0 != startup_wait_exit(pid)) {
+        result = -1;
+    }
+    run->elapsed_ns_ = now_ns() - start;
+    for (idx = 0; idx < ROTATE_BENCH_SEGMENTS; ++idx) {
+        if (0 == idx) {
+            snprintf(segment, sizeof(segment), "%s", name);
+        } else {
+            snprintf(segment, sizeof(segment), "%s.%zu", name, idx);
+        }
+        if (0 != access(segment, F_OK)) {
+            break;
+        }
+        if (0 == result) {
+            written = rotate_bench_segment(segment, data + len, sizeof(data) - len, &output);
+            if (written < 0) {
+                result = -1;
+            } else if (written > 0) {
+                len += (size_t)written;
+                last = written;
+            }
+        }
+        ++segments;
+        remove_log(segment);
+        snprintf(segment + strlen(segment), sizeof(segment) - strlen(segment), "%s",
+                 PS_CMD_SUFFIX);
+        unlink(segment);
+    }
+    unlink(pattern);
+    memcpy(expected, "abc ", 4);
+    memset(expected + 4, NT_REDACT_MASK, 10);
+    memcpy(expected + 14, "-AFTER", 6);
+    if (0 != result || segments < 2 || 20 != len || 0 != memcmp(data, expected, len) ||
+        output + sizeof(after) - 1 != (uint64_t)last) {
+        return -1;
+    }
+    run->ops_ = segments;
+    run->bytes_ = len;
+    return 0;
+}
+
+/**
+ * @brief Starts pseudoshell on a terminal of its own, running a command through the shell.
+ * @details Waits for the prompt the command prints first.
+ * @param program the pseudoshell executable.
+ * @param name name of the log.
+ * @param command the command.
+ * @param latency low-latency relay specification, see @c -l, @c NULL for a normal relay.
+ * @param[out] master master part of the terminal, non-blocking.
+ * @param[out] pid process of pseudoshell.
+ * @return 0 on success, -1 on error.
+ */
+static int session_start(char *program, char *name, char *command, char *latency, int *master,
+                         pid_t *pid) {
+    extern char **environ;
+    char *args[] = {program, "-I", "0", "-o", name, "/bin/sh", "-c", command, NULL, NULL, NULL};
+    struct winsize win_size = {.ws_row = 24, .ws_col = 80};
+    posix_spawn_file_actions_t actions;
+    int slave, result;
+    if (NULL != latency) {
+        /* The options go before the command */
+        memmove(&args[3], &args[1], 8 * sizeof(args[0]));
+        args[1] = "-l";
+        args[2] = latency;
+    }
+    if (0 != openpty(master, &slave, NULL, NULL, &win_size)) {
+        return -1;
+    }
+    fcntl(*master, F_SETFD, FD_CLOEXEC);
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, slave, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, slave, STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, slave);
+    result = posix_spawn(pid, program, &actions, NULL, args, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(slave);
+    if (0 == result && 0 == startup_wait_prompt(*master)) {
+        fcntl(*master, F_SETFL, fcntl(*master, F_GETFL) | O_NONBLOCK);
+        return 0;
+    }
+    if (0 == result) {
+        kill(*pid, SIGKILL);
+        waitpid(*pid, NULL, 0);
+    }
+    close(*master);
+    return -1;
+}
+
+/**
+ * @brief Ends a session started with session_start() and removes its logs.
+ */
+static void session_end(char *name, int master, pid_t pid) {
+    int status;
+    /* Hanging the terminal up ends the session */
+    close(master);
+    waitpid(pid, &status, 0);
+    remove_log(name);
+    snprintf(name + strlen(name), 4096 - strlen(name), "%s", PS_CMD_SUFFIX);
+    unlink(name);
+    name[strlen(name) - strlen(PS_CMD_SUFFIX)] = '\0';
+}
+
+/**
+ * @brief Types bytes into a session whose command echoes them, until they all come back.
+ * @return 0 on success, -1 on error or timeout.
+ */
+static int session_roundtrip(int master, const uint8_t *buf, size_t len) {
+    uint8_t sink[4096];
+    size_t written = 0, echoed = 0;
+    while (echoed < len) {
+        struct pollfd pfd = {.fd = master, .events = POLLIN | (written < len ? POLLOUT : 0)};
+        ssize_t result;
+        if (poll(&pfd, 1, STARTUP_BENCH_TIMEOUT_MS) <= 0) {
+            return -1;
+        }
+        if (0 != (pfd.revents & POLLOUT)) {
+            result = write(master, buf + written, len - written);
+            if (result < 0 && EAGAIN != errno) {
+                return -1;
+            }
+            written += result > 0 ? (size_t)result : 0;
+        }
+        if (0 != (pfd.revents & POLLIN)) {
+            result = read(master, sink, sizeof(sink));
+            if (result <= 0) {
+                return -1;
+            }
+            echoed += (size_t)result;
+        } else if (0 != (pfd.revents & (POLLERR | POLLHUP))) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Relays through a whole session of pseudoshell, on a terminal of its own.
+ * @details The command sets its terminal raw, so that what comes out is exactly what it
+ * wrote. With @c arg_ set to @c bulk, it writes @ref SESSION_BENCH_BULK_BYTES of coloured
+ * output, timed until the session ends. With @c keys, it echoes @ref SESSION_BENCH_KEYS
+ * keystrokes typed one at a time, each timed until it comes back. With @c paste, it echoes
+ * @ref SESSION_BENCH_PASTES pastes of @ref SESSION_BENCH_PASTE_SIZE bytes, timed alike.
+ * What follows a slash in @c arg_ runs the relay in low-latency mode, see @c -l.
+ * These are also the workloads the profile guided build is trained on.
+ */
+static int run_session(const bench_case_t *bc, bench_run_t *run) {
+    char program[4096], name[4096], input[4096], command[8192 + 64], mode[16];
+    char *relay = strchr(bc->arg_, '/');
+    uint64_t latency[SESSION_BENCH_KEYS];
+    size_t count = 0, size = 1, idx;
+    uint8_t *buf = NULL;
+    int master, started = 0, result = 0;
+    pid_t pid;
+    snprintf(name, sizeof(name), "%s/session_bench", s_dir);
+    if (0 != startup_program(program, sizeof(program))) {
+        return -1;
+    }
+    snprintf(mode, sizeof(mode), "%.*s", NULL != relay ? (int)(relay - bc->arg_) : 15, bc->arg_);
+    relay = NULL != relay ? relay + 1 : NULL;
+    if (0 == strcmp(mode, "bulk")) {
+        FILE *file;
+        snprintf(input, sizeof(input), "%s/session_bench.in", s_dir);
+        buf = malloc(SESSION_BENCH_BULK_BYTES);
+        file = fopen(input, "w");
+        if (NULL == buf || NULL == file) {
+            free(buf);
+            if (NULL != file) {
+                fclose(file);
+            }
+            return -1;
+        }
+        fill_terminal_output(buf, SESSION_BENCH_BULK_BYTES, 1);
+        result = SESSION_BENCH_BULK_BYTES == fwrite(buf, 1, SESSION_BENCH_BULK_BYTES, file)
+                     ? 0 : -1;
+        fclose(file);
+        snprintf(command, sizeof(command),
+                 "stty raw -echo; printf '$ '; head -c 1 >/dev/null; exec cat '%s'", input);
+    } else {
+        count = 0 == strcmp(mode, "keys") ? SESSION_BENCH_KEYS : SESSION_BENCH_PASTES;
+        size = 0 == strcmp(mode, "keys") ? 1 : SESSION_BENCH_PASTE_SIZE;
+        buf = malloc(size);
+        if (NULL == buf) {
+            return -1;
+        }
+        fill_terminal_output(buf, size, 0);
+        snprintf(command, sizeof(command), "stty raw -echo; printf '$ '; exec cat");
+    }
+    if (0 == result) {
+        result = session_start(program, name, command, relay, &master, &pid);
+        started = 0 == result;
+    }
+    if (0 == result && 0 == count) {
+        uint64_t start = now_ns();
+        struct pollfd pfd = {.fd = master, .events = POLLIN};
+        ssize_t len = write(master, "\r", 1);
+        /* The master reports an error once the session is over */
+        while (1 == len && poll(&pfd, 1, STARTUP_BENCH_TIMEOUT_MS) > 0 &&
+               (len = read(master, buf, SESSION_BENCH_BULK_BYTES)) > 0) {
+            run->bytes_ += (uint64_t)len;
+            ++run->ops_;
+            len = 1;
+        }
+        run->elapsed_ns_ = now_ns() - start;
+    }
+    for (idx = 0; 0 == result && idx < count; ++idx) {
+        uint64_t start = now_ns();
+        result = session_roundtrip(master, buf, size);
+        latency[idx] = now_ns() - start;
+        run->elapsed_ns_ += latency[idx];
+        run->bytes_ += size;
+    }
+    if (started) {
+        session_end(name, master, pid);
+    }
+    if (0 == count) {
+        unlink(input);
+    }
+    free(buf);
+    if (0 != result) {
+        return -1;
+    }
+    if (0 != count) {
+        qsort(latency, count, sizeof(latency[0]), compare_u64);
+        run->ops_ = count;
+        run->p50_ns_ = latency[count / 2];
+        run->p99_ns_ = latency[count * 99 / 100];
+    }
+    return 0;
+}
+
+/**
+ * @brief Gets sessions a terminal with a shell on it, one after the other, and times them.
+ * @details Each is timed from opening the terminal and starting the shell on it until its
+ * prompt can be read from the master part.
+ */
+static int run_pty(const bench_case_t *bc, bench_run_t *run) {
+    extern char **environ;
+    char *args[] = {"/bin/sh", "-c", "printf '$ '; exec cat", NULL};
+    uint64_t latency[STARTUP_BENCH_SESSIONS];
+    struct winsize win_size = {.ws_row = 24, .ws_col = 80};
+    sigset_t sigmask;
+    size_t idx;
+    int result = 0;
+    (void)bc;
+    sigemptyset(&sigmask);
+    run->elapsed_ns_ = 0;
+    for (idx = 0; 0 == result && idx < STARTUP_BENCH_SESSIONS; ++idx) {
+        ps_pty_t pty;
+        uint64_t start = now_ns();
+        result = ps_pty_open(&pty, &win_size);
+        if (0 == result) {
+            result = ps_pty_spawn(&pty, args, environ, &sigmask);
+        }
+        if (0 == result) {
+            result = startup_wait_prompt(pty.master_);
+            latency[idx] = now_ns() - start;
+            run->elapsed_ns_ += latency[idx];
+        }
+        ps_pty_close(&pty);
+    }
+    if (0 != result) {
+        return -1;
+    }
+    qsort(latency, STARTUP_BENCH_SESSIONS, sizeof(latency[0]), compare_u64);
+    run->ops_ = STARTUP_BENCH_SESSIONS;
+    run->p50_ns_ = latency[STARTUP_BENCH_SESSIONS / 2];
+    run->p99_ns_ = latency[STARTUP_BENCH_SESSIONS * 99 / 100];
+    return 0;
+}
+
+/**
+ * @brief All the benchmark cases.
+ */
+static const bench_case_t s_cases[] = {
+    {"buffer/new", run_buffer, "new"},
+    {"buffer/realign", run_buffer, "realign"},
+    {"buffer/pipe/64", run_buffer_pipe, "64"},
+    {"buffer/pipe/4k", run_buffer_pipe, "4096"},
+    {"buffer/pipe/64k", run_buffer_pipe, "65536"},
+    {"bitmap/64/0", run_bitmap, "64/0"},
+    {"bitmap/64/90", run_bitmap, "64/90"},
+    {"bitmap/4096/50", run_bitmap, "4096/50"},
+    {"bitmap/4096/99", run_bitmap, "4096/99"},
+    {"bitmap/65535/99", run_bitmap, "65535/99"},
+    {"timers/16", run_timers, "16"},
+    {"timers/1k", run_timers, "1024"},
+    {"timers/64k", run_timers, "65536"},
+    {"vis/hex/printable", run_vis, "hex/printable"},
+    {"vis/hex/binary", run_vis, "hex/binary"},
+    {"vis/hex/mixed", run_vis, "hex/mixed"},
+    {"vis/c/printable", run_vis, "c/printable"},
+    {"vis/c/binary", run_vis, "c/binary"},
+    {"vis/c/mixed", run_vis, "c/mixed"},
+    {"debuglog/append", run_debug_log, ""},
+    {"log/durability/none", run_log_write, "none"},
+    {"log/durability/interval:1000", run_log_write, "interval:1000"},
+    {"log/durability/interval:10", run_log_write, "interval:10"},
+    {"log/durability/bytes:1m", run_log_write, "bytes:1m"},
+    {"log/durability/bytes:64k", run_log_write, "bytes:64k"},
+    {"log/create/noprealloc", run_log_write, "none,noprealloc"},
+    {"log/create/direct", run_log_write, "none,direct"},
+    {"log/create/direct,noprealloc", run_log_write, "none,direct,noprealloc"},
+    {"journal/append", run_journal, ""},
+    {"crc32c/table", run_crc32c, "table"},
+    {"crc32c/best", run_crc32c, ""},
+    {"replay/1", run_replay, "1"},
+    {"replay/100", run_replay, "100"},
+    {"strip/plain", run_strip, ""},
+    {"strip/escapes", run_strip, "escapes"},
+    {"relay/pty", run_relay_pty, ""},
+    {"relay/pty/budget", run_relay_pty, "budget"},
+    {"redact/10", run_redact, "10"},
+    {"redact/100", run_redact, "100"},
+    {"redact/500", run_redact, "500"},
+    {"index/64k", run_index, "64"},
+    {"index/256k", run_index, "256"},
+    {"commands/marks", run_cmd_scan, ""},
+    {"commands/prompt", run_cmd_scan, "[#$] $"},
+    {"cast/encode", run_cast_encode, ""},
+    {"cast/convert/1", run_cast_convert, "1"},
+    {"cast/convert/all", run_cast_convert, "0"},
+    {"cast/import", run_cast_import, ""},
+    {"view/publish", run_view_publish, ""},
+    {"startup/prompt", run_startup, "prompt"},
+    {"startup/batch", run_startup, "batch"},
+    {"startup/script", run_startup, "script"},
+    {"rotate/redact", run_rotate_redact, ""},
+    {"session/bulk", run_session, "bulk"},
+    {"session/keys", run_session, "keys"},
+    {"session/keys/pinned", run_session, "keys/0"},
+    {"session/keys/spin", run_session, "keys/0,spin:100"},
+    {"session/paste", run_session, "paste"},
+    {"pty/spawn", run_pty, ""},
+    {"analyze/1", run_analyze, "1"},
+    {"analyze/all", run_analyze, "0"},
+    {"verify/1", run_sum_verify, "1"},
+    {"verify/all", run_sum_verify, "0"},
+};
+
+/**
+ * @brief Result of a case, as saved in a baseline.
+ */
+typedef struct bench_result_t {
+    char name_[64];    /**< Name of the case */
+    double ns_per_op_; /**< Mean time per operation */
+    double mb_per_s_;  /**< Mean throughput */
+    double stddev_;    /**< Standard deviation of the time per operation, in percent of it */
+    double p50_us_;    /**< Mean median latency, 0 if not timed one by one */
+    double p99_us_;    /**< Mean 99th percentile latency, 0 if not timed one by one */
+} bench_result_t;
+
+/**
+ * @brief Reads a baseline saved with the @c -s option.
+ * @param file_name name of the baseline.
+ * @param[out] results results read.
+ * @param room room in @p results.
+ * @return Number of results read, -1 if the baseline cannot be read.
+ */
+static ssize_t load_baseline(const char *file_name, bench_result_t *results, size_t room) {
+    FILE *file = fopen(file_name, "r");
+    size_t count = 0;
+    if (NULL == file) {
+        return -1;
+    }
+    while (count < room &&
+           6 == fscanf(file, "%63s %lf %lf %lf %lf %lf", results[count].name_,
+                       &results[count].ns_per_op_, &results[count].mb_per_s_,
+                       &results[count].stddev_, &results[count].p50_us_,
+                       &results[count].p99_us_)) {
+        ++count;
+    }
+    fclose(file);
+    return (ssize_t)count;
+}
+
+/**
+ * @brief Prints how a result compares with the baseline of its case, if there is one.
+ */
+static void compare_result(const bench_result_t *result, const bench_result_t *baseline,
+                           size_t count) {
+    size_t idx;
+    for (idx = 0; idx < count; ++idx) {
+        if (0 == strcmp(result->name_, baseline[idx].name_) && baseline[idx].ns_per_op_ > 0) {
+            double change = 100.0 * (result->ns_per_op_ - baseline[idx].ns_per_op_) /
+                            baseline[idx].ns_per_op_;
+            double noise = 2 * fmax(result->stddev_, baseline[idx].stddev_);
+            printf("  %+.1f%% %s", change,
+                   fabs(change) <= noise ? "(noise)" : change < 0 ? "faster" : "slower");
+            return;
+        }
+    }
+    printf("  (no baseline)");
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [-r runs] [-D dir] [-s baseline] [-c baseline] [filter]\n"
+                    "  -r  number of runs of each case, %d by default\n"
+                    "  -D  directory for files created by the cases\n"
+                    "  -s  save the results as a baseline\n"
+                    "  -c  compare the results with a baseline\n",
+            argv0, DEFAULT_RUNS);
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    int runs = DEFAULT_RUNS;
+    const char *filter = NULL;
+    const char *save_name = NULL, *compare_name = NULL;
+    bench_result_t baseline[ARRAY_SIZE(s_cases)];
+    ssize_t baseline_count = 0;
+    FILE *save = NULL;
+    size_t idx;
+    while (-1 != (opt = getopt(argc, argv, "r:D:s:c:"))) {
+        switch (opt) {
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'D':
+            s_dir = optarg;
+            break;
+        case 's':
+            save_name = optarg;
+            break;
+        case 'c':
+            compare_name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (runs < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (optind < argc) {
+        filter = argv[optind];
+    }
+    if (NULL != compare_name) {
+        baseline_count = load_baseline(compare_name, baseline, ARRAY_SIZE(baseline));
+        if (baseline_count < 0) {
+            perror(compare_name);
+            return EXIT_FAILURE;
+        }
+    }
+    if (NULL != save_name) {
+        save = fopen(save_name, "w");
+        if (NULL == save) {
+            perror(save_name);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("%-40s %14s %12s %8s\n", "case", "ns/op", "MB/s", "stddev");
+    for (idx = 0; idx < ARRAY_SIZE(s_cases); ++idx) {
+        const bench_case_t *bc = &s_cases[idx];
+        double sum = 0, sum_sq = 0, mean, stddev, mb_per_s = 0, p50 = 0, p99 = 0;
+        bench_result_t result;
+        int run_idx;
+        if (NULL != filter && NULL == strstr(bc->name_, filter)) {
+            continue;
+        }
+        for (run_idx = 0; run_idx < runs; ++run_idx) {
+            bench_run_t run = {0, 0, 0, 0, 0};
+            double ns_per_op;
+            if (0 != bc->run_(bc, &run) || 0 == run.ops_) {
+                perror(bc->name_);
+                return EXIT_FAILURE;
+            }
+            ns_per_op = (double)run.elapsed_ns_ / run.ops_;
+            sum += ns_per_op;
+            sum_sq += ns_per_op * ns_per_op;
+            mb_per_s += (double)run.bytes_ * 1000.0 / run.elapsed_ns_;
+            p50 += (double)run.p50_ns_;
+            p99 += (double)run.p99_ns_;
+        }
+        mean = sum / runs;
+        stddev = sqrt(fabs(sum_sq / runs - mean * mean));
+        snprintf(result.name_, sizeof(result.name_), "%s", bc->name_);
+        result.ns_per_op_ = mean;
+        result.mb_per_s_ = mb_per_s / runs;
+        result.stddev_ = 100.0 * stddev / mean;
+        result.p50_us_ = p50 / runs / 1000.0;
+        result.p99_us_ = p99 / runs / 1000.0;
+        printf("%-40s %14.1f %12.1f %7.1f%%", result.name_, result.ns_per_op_,
+               result.mb_per_s_, result.stddev_);
+        if (p50 > 0) {
+            printf("  p50 %.1f us, p99 %.1f us", result.p50_us_, result.p99_us_);
+        }
+        if (NULL != compare_name) {
+            compare_result(&result, baseline, (size_t)baseline_count);
+        }
+        printf("\n");
+        if (NULL != save) {
+            fprintf(save, "%s %.1f %.1f %.2f %.1f %.1f\n", result.name_, result.ns_per_op_,
+                    result.mb_per_s_, result.stddev_, result.p50_us_, result.p99_us_);
+        }
+    }
+    if (NULL != save && 0 != fclose(save)) {
+        perror(save_name);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1031 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-cast.c
+ * @brief asciicast recording implementation file
+ * @details Live, pending output is copied into a staging buffer behind the few bytes of an
+ * unfinished UTF-8 sequence held back from the previous call, and encoded from there, at
+ * most @ref PS_CAST_CHUNK bytes per event. @n
+ * The conversion maps the log and its metadata. The calling thread cuts the log into parts
+ * of about @ref CAST_PART_BYTES, none of which splits a UTF-8 sequence, and hands them out
+ * to the worker threads through a ring of @ref CAST_SLOTS_PER_JOB slots per thread. Workers
+ * encode a part into a buffer of its own; the calling thread writes the buffers out in part
+ * order and reuses the slots, so memory stays bounded whatever the length of the log. @n
+ * The import maps the recording and parses it a line at a time, decoding the output of an
+ * event straight into a buffer of @ref PS_CAST_CHUNK bytes written to the log whenever it
+ * fills up; the records are batched alike, @ref CAST_IMPORT_RECORDS at a time.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "nt-pool.h"
+#include "ps-cast.h"
+#include "ps-meta.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Longest UTF-8 sequence. */
+#define CAST_UTF8_MAX (4)
+
+/** @brief Length of the log a conversion part aims at. */
+#define CAST_PART_BYTES (1UL << 20)
+
+/** @brief Most metadata records in a conversion part, which bounds its number of events. */
+#define CAST_PART_RECORDS (16384)
+
+/** @brief Number of conversion slots per worker thread. */
+#define CAST_SLOTS_PER_JOB (2)
+
+/** @brief Size the terminal is assumed to have when its size is not known. */
+#define CAST_DEFAULT_ROWS (24)
+
+/** @brief See @ref CAST_DEFAULT_ROWS. */
+#define CAST_DEFAULT_COLS (80)
+
+/** @brief Metadata records the import gathers before writing them out. */
+#define CAST_IMPORT_RECORDS (256)
+
+/**
+ * @brief Recording written live.
+ */
+struct ps_cast {
+    int fd_;            /**< File descriptor */
+    uint64_t start_ns_; /**< When the recording started */
+    size_t held_;       /**< Bytes of an unfinished UTF-8 sequence at the start of @c in_ */
+    uint8_t *in_;       /**< Output being encoded, @ref PS_CAST_CHUNK bytes */
+    char *line_;        /**< Event line, @ref PS_CAST_LINE_SIZE(PS_CAST_CHUNK) bytes */
+};
+
+/**
+ * @brief A part of a log being converted.
+ */
+struct cast_part_t {
+    uint64_t start_;    /**< Log offset of the part */
+    uint64_t end_;      /**< Log offset past the part */
+    size_t record_;     /**< First metadata record of the part */
+    size_t record_end_; /**< Metadata record past the part */
+    uint64_t time_ns_;  /**< Time of the output at @c start_ */
+};
+
+/**
+ * @brief A slot of the conversion ring.
+ */
+struct cast_slot_t {
+    struct cast_part_t part_; /**< The part */
+    char *out_;               /**< Its recording, allocated by the dispatcher */
+    size_t len_;              /**< Length of @c out_, valid once @c done_ is set */
+    int done_;                /**< Non-zero once a worker has encoded the part */
+};
+
+/**
+ * @brief State of a conversion.
+ */
+struct cast_convert_t {
+    const uint8_t *log_;              /**< The log, mapped */
+    uint64_t size_;                   /**< Its length */
+    const ps_meta_record_t *records_; /**< The metadata records, mapped */
+    size_t count_;                    /**< Their number */
+    size_t first_resize_;             /**< Resize record the header stands for */
+    uint64_t start_ns_;               /**< When the session started */
+    uint64_t pos_;                    /**< Where the next part starts */
+    size_t record_;                   /**< First record of the next part */
+    uint64_t time_ns_;                /**< Time of the output at @c pos_ */
+    int dispatched_;                  /**< Non-zero once the last part is made */
+    int stop_;                        /**< Non-zero to make the workers quit */
+    struct cast_slot_t *slots_;       /**< Ring of slots */
+    unsigned int n_slots_;            /**< Its size */
+    uint64_t created_;                /**< Parts made so far */
+    uint64_t claimed_;                /**< Parts taken by the workers so far */
+    pthread_mutex_t lock_;            /**< Guards the ring and the counters */
+    pthread_cond_t work_;             /**< Signalled when a part is made or on stop */
+    pthread_cond_t done_;             /**< Signalled when a part is encoded */
+};
+
+/**
+ * @brief State of an import.
+ */
+struct cast_import_t {
+    const char *pos_;           /**< Next character of the recording */
+    const char *end_;           /**< End of the recording */
+    int log_fd_;                /**< The log */
+    int meta_fd_;               /**< Its metadata */
+    uint64_t start_ns_;         /**< When the session started */
+    uint64_t size_;             /**< Length of the log, with the output not written yet */
+    uint8_t *out_;              /**< Output not written yet, @ref PS_CAST_CHUNK bytes */
+    size_t fill_;               /**< Its length */
+    ps_meta_record_t *records_; /**< Records not written yet, @ref CAST_IMPORT_RECORDS */
+    size_t n_records_;          /**< Their number */
+};
+
+/**
+ * @brief Writes a whole buffer to a file.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t result = write(fd, buf, len);
+        if (result < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return errno;
+        }
+        buf += result;
+        len -= (size_t)result;
+    }
+    return 0;
+}
+
+/**
+ * @brief Formats a time as seconds with a fraction, without going through floating point.
+ * @return Length of the text.
+ */
+static int cast_time(char *text, uint64_t time_ns) {
+    return sprintf(text, "%llu.%06llu", (unsigned long long)(time_ns / 1000000000ULL),
+                   (unsigned long long)(time_ns % 1000000000ULL / 1000ULL));
+}
+
+size_t ps_cast_header_line(char *line, unsigned int rows, unsigned int cols, uint64_t start_ns) {
+    /* A pseudo terminal nobody has sized reports zeros, which players do not take */
+    if (0 == rows || 0 == cols) {
+        rows = CAST_DEFAULT_ROWS;
+        cols = CAST_DEFAULT_COLS;
+    }
+    return (size_t)sprintf(line, "{\"version\": 2, \"width\": %u, \"height\": %u, "
+                                 "\"timestamp\": %llu}\n",
+                           cols, rows, (unsigned long long)(start_ns / 1000000000ULL));
+}
+
+size_t ps_cast_output_line(char *line, uint64_t time_ns, const uint8_t *data, size_t len,
+                           int last, size_t *consumed) {
+    size_t fill = 1;
+    line[0] = '[';
+    fill += (size_t)cast_time(line + fill, time_ns);
+    memcpy(line + fill, ", \"o\", \"", 8);
+    fill += 8;
+    fill += nt_vis_json(data, len, last, line + fill, consumed);
+    if (0 == *consumed) {
+        return 0;
+    }
+    memcpy(line + fill, "\"]\n", 3);
+    return fill + 3;
+}
+
+size_t ps_cast_resize_line(char *line, uint64_t time_ns, unsigned int rows, unsigned int cols) {
+    size_t fill = 1;
+    line[0] = '[';
+    fill += (size_t)cast_time(line + fill, time_ns);
+    return fill + (size_t)sprintf(line + fill, ", \"r\", \"%ux%u\"]\n", cols, rows);
+}
+
+ps_cast_t ps_cast_open(const char *log_file_name, unsigned int rows, unsigned int cols) {
+    size_t len = strlen(log_file_name) + sizeof(PS_CAST_SUFFIX);
+    char *name = nt_pool_alloc(len);
+    struct ps_cast *cast = nt_pool_zalloc(sizeof(struct ps_cast));
+    uint8_t *in = nt_pool_alloc(PS_CAST_CHUNK);
+    char *line = nt_pool_alloc(PS_CAST_LINE_SIZE(PS_CAST_CHUNK));
+    if (NULL == name || NULL == cast || NULL == in || NULL == line) {
+        goto fail;
+    }
+    snprintf(name, len, "%s%s", log_file_name, PS_CAST_SUFFIX);
+    cast->fd_ = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (cast->fd_ < 0) {
+        goto fail;
+    }
+    cast->start_ns_ = ps_meta_now();
+    cast->in_ = in;
+    cast->line_ = line;
+    if (0 != (errno = write_all(cast->fd_, line,
+                                ps_cast_header_line(line, rows, cols, cast->start_ns_)))) {
+        close(cast->fd_);
+        goto fail;
+    }
+    nt_pool_free(name);
+    return cast;
+fail:
+    nt_pool_free(line);
+    nt_pool_free(in);
+    nt_pool_free(cast);
+    nt_pool_free(name);
+    return NULL;
+}
+
+int ps_cast_write(ps_cast_t cast, yanzc_chain_reader_t *reader) {
+    struct iovec iov[16];
+    int n_iov = io_chain_reader_get_iov(reader, iov, sizeof(iov) / sizeof(iov[0]));
+    uint64_t time_ns = ps_meta_now() - cast->start_ns_;
+    int idx;
+    for (idx = 0; idx < n_iov; ++idx) {
+        const uint8_t *data = iov[idx].iov_base;
+        size_t left = iov[idx].iov_len;
+        while (left > 0) {
+            size_t chunk = PS_CAST_CHUNK - cast->held_;
+            size_t consumed, len;
+            int result;
+            if (chunk > left) {
+                chunk = left;
+            }
+            memcpy(cast->in_ + cast->held_, data, chunk);
+            len = ps_cast_output_line(cast->line_, time_ns, cast->in_, cast->held_ + chunk, 0,
+                                      &consumed);
+            /* What is held back is the start of a sequence, a few bytes at most */
+            cast->held_ += chunk - consumed;
+            memmove(cast->in_, cast->in_ + consumed, cast->held_);
+            io_chain_reader_advance(reader, chunk);
+            result = write_all(cast->fd_, cast->line_, len);
+            if (0 != result) {
+                return result;
+            }
+            data += chunk;
+            left -= chunk;
+        }
+    }
+    return 0;
+}
+
+int ps_cast_resize(ps_cast_t cast, unsigned int rows, unsigned int cols) {
+    return write_all(cast->fd_, cast->line_,
+                     ps_cast_resize_line(cast->line_, ps_meta_now() - cast->start_ns_, rows,
+                                         cols));
+}
+
+void ps_cast_close(ps_cast_t cast) {
+    size_t consumed;
+    if (NULL == cast) {
+        return;
+    }
+    if (cast->held_ > 0) {
+        write_all(cast->fd_, cast->line_,
+                  ps_cast_output_line(cast->line_, ps_meta_now() - cast->start_ns_, cast->in_,
+                                      cast->held_, 1, &consumed));
+    }
+    close(cast->fd_);
+    nt_pool_free(cast->line_);
+    nt_pool_free(cast->in_);
+    nt_pool_free(cast);
+}
+
+/**
+ * @brief Moves a log offset back to the start of the UTF-8 sequence it falls into.
+ * @details Cutting the log there keeps sequences whole, so parts and events are encoded
+ * on their own exactly as they would be together. Offsets past the log are cut to its end.
+ * @param conv the conversion.
+ * @param low offset not to move back beyond.
+ * @param offset the offset.
+ * @return The offset, moved back by up to three bytes.
+ */
+static uint64_t cast_cut(const struct cast_convert_t *conv, uint64_t low, uint64_t offset) {
+    uint64_t back;
+    if (offset >= conv->size_) {
+        return conv->size_;
+    }
+    for (back = 1; back < CAST_UTF8_MAX && offset >= low + back; ++back) {
+        uint8_t byte = conv->log_[offset - back];
+        if (byte < 0x80) {
+            break;
+        }
+        if (byte >= 0xc0) {
+            uint64_t length = byte >= 0xf0 ? 4 : byte >= 0xe0 ? 3 : 2;
+            return length > back ? offset - back : offset;
+        }
+    }
+    return offset;
+}
+
+/**
+ * @brief Returns a time relative to the start of the session.
+ */
+static uint64_t cast_relative(const struct cast_convert_t *conv, uint64_t time_ns) {
+    return time_ns > conv->start_ns_ ? time_ns - conv->start_ns_ : 0;
+}
+
+/**
+ * @brief Makes the next part of the log.
+ * @details A part ends after about @ref CAST_PART_BYTES of the log or @ref CAST_PART_RECORDS
+ * records, whichever comes first. Records belong to the part their cut offset falls into,
+ * the last part takes those at the end of the log as well.
+ * @param conv the conversion.
+ * @param[out] part the part.
+ * @return Upper bound of the length of the recording of the part.
+ */
+static size_t cast_next_part(struct cast_convert_t *conv, struct cast_part_t *part) {
+    uint64_t end = conv->pos_ + CAST_PART_BYTES;
+    size_t record;
+    part->start_ = conv->pos_;
+    part->record_ = conv->record_;
+    part->time_ns_ = conv->time_ns_;
+    end = end >= conv->size_ ? conv->size_ : cast_cut(conv, part->start_, end);
+    for (record = conv->record_; record < conv->count_; ++record) {
+        uint64_t at = cast_cut(conv, part->start_, conv->records_[record].offset_);
+        if (at >= end && end < conv->size_) {
+            break;
+        }
+        if (record - part->record_ == CAST_PART_RECORDS && at > part->start_) {
+            end = at;
+            break;
+        }
+        if (PS_META_OUTPUT == conv->records_[record].type_) {
+            conv->time_ns_ = conv->records_[record].time_ns_;
+        }
+    }
+    part->end_ = end;
+    part->record_end_ = record;
+    conv->pos_ = end;
+    conv->record_ = record;
+    conv->dispatched_ = conv->pos_ == conv->size_ && conv->record_ == conv->count_;
+    /* Every record may end an event and start another, and so does every full chunk */
+    return NT_VIS_JSON_SIZE(end - part->start_) +
+           (2 * (record - part->record_) + (end - part->start_) / (PS_CAST_CHUNK - 3) + 2) *
+               PS_CAST_LINE_SIZE(0);
+}
+
+/**
+ * @brief Encodes a part of the log.
+ * @param conv the conversion.
+ * @param part the part.
+ * @param[out] out the recording of the part.
+ * @return Its length.
+ */
+static size_t cast_encode(const struct cast_convert_t *conv, const struct cast_part_t *part,
+                          char *out) {
+    uint64_t pos = part->start_;
+    uint64_t time_ns = part->time_ns_;
+    size_t record = part->record_;
+    size_t len = 0;
+    for (;;) {
+        uint64_t next = part->end_;
+        for (; record < part->record_end_; ++record) {
+            const ps_meta_record_t *meta = &conv->records_[record];
+            uint64_t at = cast_cut(conv, part->start_, meta->offset_);
+            if (at > pos) {
+                next = at < part->end_ ? at : part->end_;
+                break;
+            }
+            if (PS_META_OUTPUT == meta->type_) {
+                time_ns = meta->time_ns_;
+            } else if (PS_META_RESIZE == meta->type_ && record != conv->first_resize_) {
+                len += ps_cast_resize_line(out + len, cast_relative(conv, meta->time_ns_),
+                                           meta->arg1_, meta->arg2_);
+            }
+        }
+        if (pos >= part->end_) {
+            break;
+        }
+        while (pos < next) {
+            uint64_t piece = next - pos > PS_CAST_CHUNK ? cast_cut(conv, pos, pos + PS_CAST_CHUNK)
+                                                         : next;
+            size_t consumed;
+            len += ps_cast_output_line(out + len, cast_relative(conv, time_ns), conv->log_ + pos,
+                                       (size_t)(piece - pos), 1, &consumed);
+            pos = piece;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Worker thread of a conversion: encodes parts in the order they are made.
+ * @param arg the conversion.
+ * @return @c NULL.
+ */
+static void *cast_worker(void *arg) {
+    struct cast_convert_t *conv = arg;
+    pthread_mutex_lock(&conv->lock_);
+    for (;;) {
+        struct cast_slot_t *slot;
+        while (!conv->stop_ && conv->claimed_ == conv->created_) {
+            pthread_cond_wait(&conv->work_, &conv->lock_);
+        }
+        if (conv->stop_) {
+            break;
+        }
+        slot = &conv->slots_[conv->claimed_++ % conv->n_slots_];
+        pthread_mutex_unlock(&conv->lock_);
+        slot->len_ = cast_encode(conv, &slot->part_, slot->out_);
+        pthread_mutex_lock(&conv->lock_);
+        slot->done_ = 1;
+        pthread_cond_broadcast(&conv->done_);
+    }
+    pthread_mutex_unlock(&conv->lock_);
+    return NULL;
+}
+
+/**
+ * @brief Makes parts, and writes the recordings of encoded ones out, until the end.
+ * @details Runs on the calling thread with the lock held, which it drops while writing.
+ * @param conv the conversion.
+ * @param fd descriptor the recording is written to.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int cast_dispatch(struct cast_convert_t *conv, int fd) {
+    uint64_t written = 0;
+    int result = 0;
+    for (;;) {
+        struct cast_slot_t *slot;
+        while (!conv->dispatched_ && conv->created_ - written < conv->n_slots_) {
+            slot = &conv->slots_[conv->created_ % conv->n_slots_];
+            slot->out_ = nt_pool_alloc(cast_next_part(conv, &slot->part_));
+            if (NULL == slot->out_) {
+                return ENOMEM;
+            }
+            slot->done_ = 0;
+            ++conv->created_;
+            pthread_cond_broadcast(&conv->work_);
+        }
+        if (written == conv->created_) {
+            return 0;
+        }
+        slot = &conv->slots_[written % conv->n_slots_];
+        while (!slot->done_) {
+            pthread_cond_wait(&conv->done_, &conv->lock_);
+        }
+        pthread_mutex_unlock(&conv->lock_);
+        result = write_all(fd, slot->out_, slot->len_);
+        pthread_mutex_lock(&conv->lock_);
+        nt_pool_free(slot->out_);
+        slot->out_ = NULL;
+        ++written;
+        if (0 != result) {
+            return result;
+        }
+    }
+}
+
+/**
+ * @brief Maps a file read only.
+ * @param fd descriptor of the file.
+ * @param[out] size its length.
+ * @return The mapping, @c NULL for an empty file, @c MAP_FAILED on error.
+ */
+static void *cast_map(int fd, uint64_t *size) {
+    struct stat file_stat;
+    if (0 != fstat(fd, &file_stat)) {
+        return MAP_FAILED;
+    }
+    *size = (uint64_t)file_stat.st_size;
+    return 0 == *size ? NULL : mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+}
+
+/**
+ * @brief Finds the terminal size the recording starts with, from the metadata.
+ * @param conv the conversion.
+ * @param[out] rows number of rows.
+ * @param[out] cols number of columns.
+ */
+static void cast_initial_size(struct cast_convert_t *conv, unsigned int *rows,
+                              unsigned int *cols) {
+    size_t record;
+    *rows = CAST_DEFAULT_ROWS;
+    *cols = CAST_DEFAULT_COLS;
+    conv->first_resize_ = conv->count_;
+    for (record = 1; record < conv->count_ && 0 == conv->records_[record].offset_; ++record) {
+        if (PS_META_RESIZE == conv->records_[record].type_) {
+            *rows = conv->records_[record].arg1_;
+            *cols = conv->records_[record].arg2_;
+            conv->first_resize_ = record;
+            break;
+        }
+    }
+}
+
+int ps_cast_convert(const char *log_file_name, int fd, unsigned int jobs) {
+    struct cast_convert_t conv = {.log_ = NULL};
+    size_t len = strlen(log_file_name) + sizeof(PS_META_SUFFIX);
+    char *meta_name = nt_pool_alloc(len);
+    char header[PS_CAST_LINE_SIZE(0)];
+    pthread_t *workers = nt_pool_alloc(sizeof(pthread_t) * jobs);
+    void *log_map = MAP_FAILED, *meta_map = MAP_FAILED;
+    uint64_t meta_size = 0;
+    unsigned int rows, cols, started = 0;
+    int log_fd = -1, meta_fd = -1;
+    int result = ENOMEM;
+    conv.slots_ = nt_pool_zalloc(sizeof(struct cast_slot_t) * jobs * CAST_SLOTS_PER_JOB);
+    if (NULL == meta_name || NULL == workers || NULL == conv.slots_) {
+        goto done;
+    }
+    snprintf(meta_name, len, "%s%s", log_file_name, PS_META_SUFFIX);
+    log_fd = open(log_file_name, O_RDONLY | O_CLOEXEC);
+    meta_fd = open(meta_name, O_RDONLY | O_CLOEXEC);
+    if (log_fd < 0 || meta_fd < 0 || MAP_FAILED == (log_map = cast_map(log_fd, &conv.size_)) ||
+        MAP_FAILED == (meta_map = cast_map(meta_fd, &meta_size))) {
+        result = errno;
+        goto done;
+    }
+    conv.log_ = log_map;
+    conv.records_ = meta_map;
+    conv.count_ = meta_size / sizeof(ps_meta_record_t);
+    if (0 == conv.count_ || PS_META_HEADER != conv.records_[0].type_ ||
+        PS_META_MAGIC != conv.records_[0].arg_) {
+        result = EINVAL;
+        goto done;
+    }
+    /* The header record holds the committed length rather than an offset, parts start past it */
+    conv.record_ = 1;
+    conv.start_ns_ = conv.time_ns_ = conv.records_[0].time_ns_;
+    conv.n_slots_ = jobs * CAST_SLOTS_PER_JOB;
+    cast_initial_size(&conv, &rows, &cols);
+    result = write_all(fd, header, ps_cast_header_line(header, rows, cols, conv.start_ns_));
+    if (0 != result) {
+        goto done;
+    }
+    pthread_mutex_init(&conv.lock_, NULL);
+    pthread_cond_init(&conv.work_, NULL);
+    pthread_cond_init(&conv.done_, NULL);
+    for (; started < jobs; ++started) {
+        if (0 != (result = pthread_create(&workers[started], NULL, cast_worker, &conv))) {
+            break;
+        }
+    }
+    pthread_mutex_lock(&conv.lock_);
+    if (0 != started) {
+        result = cast_dispatch(&conv, fd);
+    }
+    conv.stop_ = 1;
+    pthread_cond_broadcast(&conv.work_);
+    pthread_mutex_unlock(&conv.lock_);
+    while (started > 0) {
+        pthread_join(workers[--started], NULL);
+    }
+    for (started = 0; started < conv.n_slots_; ++started) {
+        nt_pool_free(conv.slots_[started].out_);
+    }
+    pthread_cond_destroy(&conv.done_);
+    pthread_cond_destroy(&conv.work_);
+    pthread_mutex_destroy(&conv.lock_);
+done:
+    if (MAP_FAILED != meta_map && NULL != meta_map) {
+        munmap(meta_map, meta_size);
+    }
+    if (MAP_FAILED != log_map && NULL != log_map) {
+        munmap(log_map, conv.size_);
+    }
+    if (meta_fd >= 0) {
+        close(meta_fd);
+    }
+    if (log_fd >= 0) {
+        close(log_fd);
+    }
+    nt_pool_free(conv.slots_);
+    nt_pool_free(workers);
+    nt_pool_free(meta_name);
+    errno = result;
+    return 0 == result ? 0 : -1;
+}
+
+/**
+ * @brief Skips blanks, not line feeds.
+ * @param imp the import.
+ */
+static void cast_skip(struct cast_import_t *imp) {
+    while (imp->pos_ < imp->end_ && (' ' == *imp->pos_ || '\t' == *imp->pos_ ||
+                                     '\r' == *imp->pos_)) {
+        ++imp->pos_;
+    }
+}
+
+/**
+ * @brief Takes a character, after blanks.
+ * @param imp the import.
+ * @param c the character.
+ * @return 0 if it was there, @c EINVAL otherwise.
+ */
+static int cast_expect(struct cast_import_t *imp, char c) {
+    cast_skip(imp);
+    if (imp->pos_ == imp->end_ || c != *imp->pos_) {
+        return EINVAL;
+    }
+    ++imp->pos_;
+    return 0;
+}
+
+/**
+ * @brief Parses a non-negative integer.
+ * @param p first character.
+ * @param end end of the text.
+ * @param[out] value the integer.
+ * @return Character past the integer, @c NULL if there is none.
+ */
+static const char *cast_parse_number(const char *p, const char *end, uint64_t *value) {
+    const char *start = p;
+    *value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        *value = *value * 10 + (uint64_t)(*p - '0');
+    }
+    return p != start ? p : NULL;
+}
+
+/**
+ * @brief Parses a non-negative number of seconds, with a fraction of up to nanoseconds.
+ * @param p first character.
+ * @param end end of the text.
+ * @param[out] time_ns the time, in nanoseconds.
+ * @return Character past the number, @c NULL if there is none.
+ */
+static const char *cast_parse_time(const char *p, const char *end, uint64_t *time_ns) {
+    uint64_t seconds, fraction = 0, scale = 1000000000ULL;
+    p = cast_parse_number(p, end, &seconds);
+    if (NULL == p) {
+        return NULL;
+    }
+    if (p < end && '.' == *p) {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (uint64_t)(*p - '0') * scale;
+            }
+        }
+    }
+    *time_ns = seconds * 1000000000ULL + fraction;
+    return p;
+}
+
+/**
+ * @brief Finds a number in the header line of a recording.
+ * @param line the header line.
+ * @param end its end.
+ * @param key the key, quotes included.
+ * @param[out] value the number.
+ * @return 0 on success, -1 if the key or its number is missing.
+ */
+static int cast_header_number(const char *line, const char *end, const char *key,
+                              uint64_t *value) {
+    size_t len = strlen(key);
+    const char *p = memmem(line, (size_t)(end - line), key, len);
+    if (NULL == p) {
+        return -1;
+    }
+    for (p += len; p < end && (' ' == *p || ':' == *p); ++p) {
+    }
+    return NULL != cast_parse_number(p, end, value) ? 0 : -1;
+}
+
+/**
+ * @brief Writes out the output and records gathered so far.
+ * @param imp the import.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int cast_import_flush(struct cast_import_t *imp) {
+    int result = write_all(imp->log_fd_, (const char *)imp->out_, imp->fill_);
+    if (0 == result) {
+        result = write_all(imp->meta_fd_, (const char *)imp->records_,
+                           imp->n_records_ * sizeof(ps_meta_record_t));
+    }
+    imp->fill_ = 0;
+    imp->n_records_ = 0;
+    return result;
+}
+
+/**
+ * @brief Adds a record at the current end of the log.
+ * @param imp the import.
+ * @param type type of the record.
+ * @param time_ns its time.
+ * @param arg1 type dependent.
+ * @param arg2 type dependent.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int cast_import_record(struct cast_import_t *imp, ps_meta_type_t type, uint64_t time_ns,
+                              uint32_t arg1, uint32_t arg2) {
+    ps_meta_record_t *record;
+    if (CAST_IMPORT_RECORDS == imp->n_records_) {
+        int result = cast_import_flush(imp);
+        if (0 != result) {
+            return result;
+        }
+    }
+    record = &imp->records_[imp->n_records_++];
+    memset(record, 0, sizeof(*record));
+    record->type_ = type;
+    record->time_ns_ = time_ns;
+    record->offset_ = imp->size_;
+    record->arg1_ = arg1;
+    record->arg2_ = arg2;
+    return 0;
+}
+
+/**
+ * @brief Appends a code point to the output, as UTF-8.
+ * @param imp the import.
+ * @param code the code point, U+FFFD for a lone surrogate.
+ */
+static void cast_put_code(struct cast_import_t *imp, uint32_t code) {
+    uint8_t *out = imp->out_ + imp->fill_;
+    size_t len;
+    if (code >= 0xd800 && code < 0xe000) {
+        code = 0xfffd;
+    }
+    if (code < 0x80) {
+        out[0] = (uint8_t)code;
+        len = 1;
+    } else if (code < 0x800) {
+        out[0] = (uint8_t)(0xc0 | code >> 6);
+        out[1] = (uint8_t)(0x80 | (code & 0x3f));
+        len = 2;
+    } else if (code < 0x10000) {
+        out[0] = (uint8_t)(0xe0 | code >> 12);
+        out[1] = (uint8_t)(0x80 | (code >> 6 & 0x3f));
+        out[2] = (uint8_t)(0x80 | (code & 0x3f));
+        len = 3;
+    } else {
+        out[0] = (uint8_t)(0xf0 | code >> 18);
+        out[1] = (uint8_t)(0x80 | (code >> 12 & 0x3f));
+        out[2] = (uint8_t)(0x80 | (code >> 6 & 0x3f));
+        out[3] = (uint8_t)(0x80 | (code & 0x3f));
+        len = 4;
+    }
+    imp->fill_ += len;
+    imp->size_ += len;
+}
+
+/**
+ * @brief Parses the four hexadecimal digits of a @c \\u escape.
+ * @param imp the import, at the first digit.
+ * @param[out] code the value.
+ * @return 0 on success, @c EINVAL otherwise.
+ */
+static int cast_parse_hex(struct cast_import_t *imp, uint32_t *code) {
+    int idx;
+    if (imp->end_ - imp->pos_ < 4) {
+        return EINVAL;
+    }
+    *code = 0;
+    for (idx = 0; idx < 4; ++idx) {
+        char c = *imp->pos_++;
+        *code <<= 4;
+        if (c >= '0' && c <= '9') {
+            *code |= (uint32_t)(c - '0');
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            *code |= (uint32_t)((c | 0x20) - 'a' + 10);
+        } else {
+            return EINVAL;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes a JSON string into the output.
+ * @details The output is written to the log whenever it fills up.
+ * @param imp the import, at the opening quote.
+ * @return 0 on success, @c errno value otherwise; @c EINVAL if the string is not valid.
+ */
+static int cast_import_string(struct cast_import_t *imp) {
+    int result;
+    if (0 != (result = cast_expect(imp, '"'))) {
+        return result;
+    }
+    while (imp->pos_ < imp->end_ && '"' != *imp->pos_) {
+        uint32_t code;
+        if (imp->fill_ > PS_CAST_CHUNK - CAST_UTF8_MAX &&
+            0 != (result = cast_import_flush(imp))) {
+            return result;
+        }
+        if ('\\' != *imp->pos_) {
+            imp->out_[imp->fill_++] = (uint8_t)*imp->pos_++;
+            ++imp->size_;
+            continue;
+        }
+        if (++imp->pos_ == imp->end_) {
+            return EINVAL;
+        }
+        switch (*imp->pos_++) {
+        case '"':
+        case '\\':
+        case '/':
+            code = (uint8_t)imp->pos_[-1];
+            break;
+        case 'b':
+            code = '\b';
+            break;
+        case 'f':
+            code = '\f';
+            break;
+        case 'n':
+            code = '\n';
+            break;
+        case 'r':
+            code = '\r';
+            break;
+        case 't':
+            code = '\t';
+            break;
+        case 'u':
+            code = UINT32_MAX;
+            break;
+        default:
+            return EINVAL;
+        }
+        if (UINT32_MAX != code) {
+            cast_put_code(imp, code);
+            continue;
+        }
+        if (0 != cast_parse_hex(imp, &code)) {
+            return EINVAL;
+        }
+        if (code >= 0xd800 && code < 0xdc00 && imp->end_ - imp->pos_ >= 6 &&
+            '\\' == imp->pos_[0] && 'u' == imp->pos_[1]) {
+            const char *pair = imp->pos_;
+            uint32_t low;
+            imp->pos_ += 2;
+            if (0 == cast_parse_hex(imp, &low) && low >= 0xdc00 && low < 0xe000) {
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            } else {
+                imp->pos_ = pair;
+            }
+        }
+        cast_put_code(imp, code);
+    }
+    return cast_expect(imp, '"');
+}
+
+/**
+ * @brief Skips a JSON string.
+ * @param imp the import, at the opening quote.
+ * @return 0 on success, @c EINVAL if the string is not terminated.
+ */
+static int cast_skip_string(struct cast_import_t *imp) {
+    if (0 != cast_expect(imp, '"')) {
+        return EINVAL;
+    }
+    while (imp->pos_ < imp->end_ && '"' != *imp->pos_) {
+        imp->pos_ += '\\' == *imp->pos_ && imp->end_ - imp->pos_ > 1 ? 2 : 1;
+    }
+    return cast_expect(imp, '"');
+}
+
+/**
+ * @brief Imports an event line.
+ * @param imp the import, at the opening bracket.
+ * @return 0 on success, @c errno value otherwise; @c EINVAL if the event is not valid.
+ */
+static int cast_import_event(struct cast_import_t *imp) {
+    uint64_t time_ns;
+    char type;
+    int result;
+    if (0 != cast_expect(imp, '[')) {
+        return EINVAL;
+    }
+    cast_skip(imp);
+    if (NULL == (imp->pos_ = cast_parse_time(imp->pos_, imp->end_, &time_ns)) ||
+        0 != cast_expect(imp, ',') || 0 != cast_expect(imp, '"') ||
+        imp->end_ - imp->pos_ < 2 || '"' != imp->pos_[1]) {
+        return EINVAL;
+    }
+    type = imp->pos_[0];
+    imp->pos_ += 2;
+    if (0 != cast_expect(imp, ',')) {
+        return EINVAL;
+    }
+    time_ns += imp->start_ns_;
+    cast_skip(imp);
+    if ('o' == type) {
+        /* An empty event has nothing to time */
+        result = imp->end_ - imp->pos_ >= 2 && '"' == imp->pos_[1]
+                     ? 0
+                     : cast_import_record(imp, PS_META_OUTPUT, time_ns, 0, 0);
+        if (0 == result) {
+            result = cast_import_string(imp);
+        }
+    } else if ('r' == type) {
+        uint64_t cols, rows;
+        const char *p = imp->pos_ + 1;
+        if (0 != cast_expect(imp, '"') || NULL == (p = cast_parse_number(p, imp->end_, &cols)) ||
+            p == imp->end_ || 'x' != *p ||
+            NULL == (p = cast_parse_number(p + 1, imp->end_, &rows))) {
+            return EINVAL;
+        }
+        imp->pos_ = p;
+        result = cast_expect(imp, '"');
+        if (0 == result) {
+            result = cast_import_record(imp, PS_META_RESIZE, time_ns, (uint32_t)rows,
+                                        (uint32_t)cols);
+        }
+    } else {
+        /* Input and markers have no place in the log */
+        result = cast_skip_string(imp);
+    }
+    if (0 != result) {
+        return result;
+    }
+    return cast_expect(imp, ']');
+}
+
+int ps_cast_import(int fd, const char *log_file_name) {
+    struct cast_import_t imp = {.log_fd_ = -1, .meta_fd_ = -1};
+    size_t len = strlen(log_file_name) + sizeof(PS_META_SUFFIX);
+    char *meta_name = nt_pool_alloc(len);
+    ps_meta_record_t header = {.type_ = PS_META_HEADER, .arg_ = PS_META_MAGIC};
+    void *map;
+    const char *eol;
+    uint64_t size = 0, version, rows, cols, last_ns;
+    int result = ENOMEM;
+    imp.out_ = nt_pool_alloc(PS_CAST_CHUNK);
+    imp.records_ = nt_pool_alloc(sizeof(ps_meta_record_t) * CAST_IMPORT_RECORDS);
+    map = cast_map(fd, &size);
+    if (MAP_FAILED == map) {
+        result = errno;
+        goto done;
+    }
+    if (NULL == meta_name || NULL == imp.out_ || NULL == imp.records_) {
+        goto done;
+    }
+    if (NULL == map) {
+        result = EINVAL;
+        goto done;
+    }
+    imp.pos_ = map;
+    imp.end_ = imp.pos_ + size;
+    eol = memchr(imp.pos_, '\n', size);
+    if (NULL == eol) {
+        eol = imp.end_;
+    }
+    if (0 != cast_header_number(imp.pos_, eol, "\"version\"", &version) || 2 != version ||
+        0 != cast_header_number(imp.pos_, eol, "\"width\"", &cols) ||
+        0 != cast_header_number(imp.pos_, eol, "\"height\"", &rows)) {
+        result = EINVAL;
+        goto done;
+    }
+    if (0 != cast_header_number(imp.pos_, eol, "\"timestamp\"", &imp.start_ns_)) {
+        imp.start_ns_ = 0;
+    }
+    imp.start_ns_ *= 1000000000ULL;
+    imp.pos_ = eol;
+    snprintf(meta_name, len, "%s%s", log_file_name, PS_META_SUFFIX);
+    imp.log_fd_ = open(log_file_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    imp.meta_fd_ = open(meta_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (imp.log_fd_ < 0 || imp.meta_fd_ < 0) {
+        result = errno;
+        goto done;
+    }
+    header.time_ns_ = last_ns = imp.start_ns_;
+    header.arg1_ = PS_META_VERSION;
+    result = write_all(imp.meta_fd_, (const char *)&header, sizeof(header));
+    if (0 == result) {
+        result = cast_import_record(&imp, PS_META_RESIZE, imp.start_ns_, (uint32_t)rows,
+                                    (uint32_t)cols);
+    }
+    while (0 == result && imp.pos_ < imp.end_) {
+        if ('\n' == *imp.pos_) {
+            ++imp.pos_;
+            cast_skip(&imp);
+            continue;
+        }
+        result = cast_import_event(&imp);
+        if (0 == result && imp.n_records_ > 0) {
+            last_ns = imp.records_[imp.n_records_ - 1].time_ns_;
+        }
+        cast_skip(&imp);
+        if (0 == result && imp.pos_ < imp.end_ && '\n' != *imp.pos_) {
+            result = EINVAL;
+        }
+    }
+    if (0 == result) {
+        result = cast_import_record(&imp, PS_META_FOOTER, last_ns, 0, 0);
+    }
+    if (0 == result) {
+        result = cast_import_flush(&imp);
+    }
+    /* The header holds the length of the log, all of it written */
+    header.offset_ = imp.size_;
+    if (0 == result &&
+        (ssize_t)sizeof(header) != pwrite(imp.meta_fd_, &header, sizeof(header), 0)) {
+        result = errno;
+    }
+done:
+    if (MAP_FAILED != map && NULL != map) {
+        munmap(map, size);
+    }
+    if (imp.meta_fd_ >= 0) {
+        close(imp.meta_fd_);
+    }
+    if (imp.log_fd_ >= 0) {
+        close(imp.log_fd_);
+    }
+    nt_pool_free(imp.records_);
+    nt_pool_free(imp.out_);
+    nt_pool_free(meta_name);
+    errno = result;
+    return 0 == result ? 0 : -1;
+}
+
+/** @} */
@@ -0,0 +1,151 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-cast.h
+ * @brief asciicast recording header file
+ * @details An asciicast v2 recording is a companion of the session log, named after it with
+ * a @c .cast suffix, for players and tools that speak that format. It is a JSON header line
+ * followed by a JSON array per line for each event: @c o for output, with the time it was
+ * read, and @c r for a change of the terminal size. @n
+ * A recording can be written live, next to the log, or converted afterwards from a log and
+ * the output records of its metadata. The conversion cuts the log into parts, encodes them
+ * on as many threads as asked for and writes them out in log order. @n
+ * A recording made elsewhere can be imported back into a log and its metadata, which the
+ * other tools then read like any session log.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_CAST_H
+#define PS_CAST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nt-vis.h"
+#include "yanzc_chain.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Suffix appended to the log file name to get the recording name. */
+#define PS_CAST_SUFFIX ".cast"
+
+/** @brief Largest piece of output put in a single event. */
+#define PS_CAST_CHUNK (16UL << 10)
+
+/**
+ * @brief Size of a buffer large enough for an event line with a given length of output.
+ * @details Next to the encoded output there is room for the time, the event type and the
+ * punctuation.
+ */
+#define PS_CAST_LINE_SIZE(len) (NT_VIS_JSON_SIZE(len) + 128)
+
+/**
+ * @brief Formats the header line of a recording.
+ * @param[out] line buffer of at least @ref PS_CAST_LINE_SIZE(0) bytes.
+ * @param rows initial number of rows of the terminal.
+ * @param cols initial number of columns.
+ * @param start_ns when the session started, in nanoseconds since the epoch.
+ * @return Length of the line.
+ */
+size_t ps_cast_header_line(char *line, unsigned int rows, unsigned int cols, uint64_t start_ns);
+
+/**
+ * @brief Formats an output event line.
+ * @details See @ref nt_vis_json() for how the output is encoded and what @p last means.
+ * @param[out] line buffer of at least @ref PS_CAST_LINE_SIZE(len) bytes.
+ * @param time_ns time of the event, in nanoseconds since the session started.
+ * @param data the output.
+ * @param len its length.
+ * @param last non-zero if no output follows this one.
+ * @param[out] consumed number of bytes of output the event holds.
+ * @return Length of the line, 0 if no output could be put in it.
+ */
+size_t ps_cast_output_line(char *line, uint64_t time_ns, const uint8_t *data, size_t len,
+                           int last, size_t *consumed);
+
+/**
+ * @brief Formats a resize event line.
+ * @param[out] line buffer of at least @ref PS_CAST_LINE_SIZE(0) bytes.
+ * @param time_ns time of the event, in nanoseconds since the session started.
+ * @param rows new number of rows.
+ * @param cols new number of columns.
+ * @return Length of the line.
+ */
+size_t ps_cast_resize_line(char *line, uint64_t time_ns, unsigned int rows, unsigned int cols);
+
+/**
+ * @brief A handle of a recording being written live.
+ */
+typedef struct ps_cast *ps_cast_t;
+
+/**
+ * @brief Creates the recording of a session log and writes its header.
+ * @param log_file_name name of the session log.
+ * @param rows initial number of rows of the terminal.
+ * @param cols initial number of columns.
+ * @return The recording or @c NULL, with @c errno set.
+ * @sa ps_cast_close()
+ */
+ps_cast_t ps_cast_open(const char *log_file_name, unsigned int rows, unsigned int cols);
+
+/**
+ * @brief Writes the output pending for a reader as events timed now.
+ * @param cast the recording.
+ * @param reader the reader.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_cast_write(ps_cast_t cast, yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Writes a resize event timed now.
+ * @param cast the recording.
+ * @param rows new number of rows.
+ * @param cols new number of columns.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_cast_resize(ps_cast_t cast, unsigned int rows, unsigned int cols);
+
+/**
+ * @brief Writes the output held back, if any, and closes the recording.
+ * @param cast the recording, may be @c NULL.
+ */
+void ps_cast_close(ps_cast_t cast);
+
+/**
+ * @brief Converts a log and its metadata into a recording.
+ * @details Output is timed by the output records of the metadata; a log without them comes
+ * out as a single burst at its start.
+ * @param log_file_name name of the log.
+ * @param fd descriptor the recording is written to.
+ * @param jobs number of threads encoding the log, at least 1.
+ * @return 0 on success, -1 with @c errno set otherwise; @c EINVAL if the metadata is not
+ * valid.
+ */
+int ps_cast_convert(const char *log_file_name, int fd, unsigned int jobs);
+
+/**
+ * @brief Turns a recording into a log and its metadata.
+ * @details Each output event becomes an output record at the log offset its output starts at,
+ * each resize event a resize record; the header gives the size at the start and the time of
+ * the header record. Other events are left out. The log is closed cleanly. @n
+ * Converting the log back gives the recording again, as long as it was made by
+ * @ref ps_cast_convert() or the live writer.
+ * @param fd descriptor the recording is read from, a regular file.
+ * @param log_file_name name of the log, overwritten if it exists.
+ * @return 0 on success, -1 with @c errno set otherwise; @c EINVAL if the recording is not
+ * valid asciicast v2.
+ */
+int ps_cast_import(int fd, const char *log_file_name);
+
+/** @} */
+
+#endif /* PS_CAST_H */
@@ -0,0 +1,377 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-cmd.c
+ * @brief Command table implementation file
+ * @details The output is searched for ESC with @c memchr(), only what follows one is looked
+ * at byte by byte, so plain output costs next to nothing. Marks may be split across reads,
+ * the part of a mark seen so far is kept. @n
+ * Prompt recognition keeps a copy of the last line of output, up to @ref PROMPT_MAX bytes.
+ * After each scan that leaves the line unfinished, the line is stripped and matched against
+ * the regular expression, unless a prompt was already found at its start.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "compiler-defs.h"
+#include "nt-pool.h"
+#include "nt-strip.h"
+#include "ps-cmd.h"
+#include "ps-meta.h"
+#include "yandu_log.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Longest line taken for a prompt. */
+#define PROMPT_MAX (256)
+
+/** @brief Longest mark, parameters included. */
+#define MARK_MAX (64)
+
+/** @brief What follows ESC in a mark. */
+#define MARK_PREFIX "]133;"
+
+/** @brief Escape. */
+#define C_ESC (0x1b)
+
+/** @brief Bell, ends a control string in xterm. */
+#define C_BEL (0x07)
+
+/**
+ * @brief Where the current command is at.
+ */
+enum cmd_state_t {
+    CMD_IDLE = 0,    /**< No command */
+    CMD_PROMPT = 1,  /**< Showing the prompt */
+    CMD_INPUT = 2,   /**< Reading the command line */
+    CMD_RUNNING = 3, /**< Running */
+};
+
+/**
+ * @brief Command table being written.
+ */
+struct ps_cmd {
+    int fd_;                       /**< Command table file descriptor */
+    int has_prompt_;               /**< Non-zero if @c prompt_ was compiled */
+    int marks_seen_;               /**< Non-zero once a mark has been found */
+    int state_;                    /**< One of @ref cmd_state_t */
+    ps_cmd_record_t record_;       /**< Current command */
+    regex_t prompt_;               /**< Regular expression matching a prompt */
+    int in_mark_;                  /**< Non-zero while in what may be a mark */
+    int mark_esc_;                 /**< Non-zero after ESC inside a mark, maybe the start of ST */
+    uint64_t mark_start_;          /**< Offset of the ESC starting the mark */
+    unsigned int mark_len_;        /**< Bytes of the mark after ESC */
+    char mark_[MARK_MAX + 1];      /**< The mark after ESC, null terminated */
+    uint64_t line_start_;          /**< Offset of the last line of output */
+    uint64_t prompt_line_;         /**< Offset of the line where a prompt was last found */
+    size_t line_len_;              /**< Length of @c line_, valid unless @c line_long_ */
+    int line_long_;                /**< Non-zero if the last line is too long for a prompt */
+    uint8_t line_[PROMPT_MAX];     /**< The last line of output */
+    char text_[NT_STRIP_OUTPUT_SIZE(PROMPT_MAX) + 1]; /**< The last line, stripped */
+    nt_strip_t strip_;             /**< Strips the last line */
+    uint64_t base_;                /**< Reader offset the log starts at */
+};
+
+/**
+ * @brief Writes the current command out.
+ * @param cmd the command table.
+ * @param end end of its output.
+ * @param status its exit status.
+ */
+static void cmd_end(struct ps_cmd *cmd, uint64_t end, int32_t status) {
+    cmd->record_.end_ = end;
+    cmd->record_.end_ns_ = ps_meta_now();
+    cmd->record_.status_ = status;
+    if (sizeof(cmd->record_) != write(cmd->fd_, &cmd->record_, sizeof(cmd->record_))) {
+        LOG_DEBUG("%d %s", errno, strerror(errno));
+    }
+    cmd->state_ = CMD_IDLE;
+}
+
+/**
+ * @brief Starts a new command at a prompt, ending the one running if any.
+ * @param cmd the command table.
+ * @param offset start of the prompt.
+ * @param source where the prompt comes from.
+ */
+static void cmd_prompt(struct ps_cmd *cmd, uint64_t offset, ps_cmd_source_t source) {
+    if (CMD_RUNNING == cmd->state_) {
+        cmd_end(cmd, offset, PS_CMD_STATUS_UNKNOWN);
+    }
+    memset(&cmd->record_, 0, sizeof(cmd->record_));
+    cmd->record_.prompt_ = cmd->record_.input_ = cmd->record_.output_ = offset;
+    cmd->record_.source_ = source;
+    cmd->state_ = CMD_PROMPT;
+}
+
+/**
+ * @brief Marks the start of the output of the current command.
+ * @param cmd the command table.
+ * @param offset start of the output.
+ */
+static void cmd_run(struct ps_cmd *cmd, uint64_t offset) {
+    if (CMD_PROMPT == cmd->state_) {
+        cmd->record_.input_ = offset;
+    }
+    cmd->record_.output_ = offset;
+    cmd->record_.start_ns_ = ps_meta_now();
+    cmd->state_ = CMD_RUNNING;
+}
+
+/**
+ * @brief Acts on a complete mark.
+ * @param cmd the command table, with the mark in @c mark_.
+ * @param end offset past the mark.
+ */
+static void cmd_mark(struct ps_cmd *cmd, uint64_t end) {
+    const char *param = cmd->mark_ + sizeof(MARK_PREFIX) - 1;
+    cmd->marks_seen_ = 1;
+    switch (param[0]) {
+    case 'A':
+        cmd_prompt(cmd, cmd->mark_start_, PS_CMD_OSC133);
+        break;
+    case 'B':
+        if (CMD_PROMPT == cmd->state_) {
+            cmd->record_.input_ = end;
+            cmd->state_ = CMD_INPUT;
+        }
+        break;
+    case 'C':
+        if (CMD_IDLE == cmd->state_) {
+            cmd_prompt(cmd, cmd->mark_start_, PS_CMD_OSC133);
+        }
+        if (CMD_RUNNING != cmd->state_) {
+            cmd_run(cmd, end);
+        }
+        break;
+    case 'D':
+        /* Shells send D before each prompt, also when no command was run */
+        if (CMD_RUNNING == cmd->state_) {
+            char *status_end;
+            long status = ';' == param[1] ? strtol(param + 2, &status_end, 10) : 0;
+            if (';' != param[1] || status_end == param + 2) {
+                status = PS_CMD_STATUS_UNKNOWN;
+            }
+            cmd_end(cmd, cmd->mark_start_, (int32_t)status);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Feeds bytes to the mark being read.
+ * @param cmd the command table.
+ * @param p the bytes following the ESC or the bytes read so far.
+ * @param end their end.
+ * @param offset offset of @p p.
+ * @return Address of the first byte not consumed.
+ */
+static const uint8_t *cmd_read_mark(struct ps_cmd *cmd, const uint8_t *p, const uint8_t *end,
+                                    uint64_t offset) {
+    const uint8_t *start = p;
+    for (; p < end; ++p) {
+        uint8_t byte = *p;
+        if (cmd->mark_len_ < sizeof(MARK_PREFIX) - 1) {
+            if (byte != (uint8_t)MARK_PREFIX[cmd->mark_len_]) {
+                /* Not a mark; this byte may be the ESC of the next one */
+                cmd->in_mark_ = 0;
+                return p;
+            }
+        } else if (C_BEL == byte || (cmd->mark_esc_ && '\\' == byte)) {
+            cmd->mark_[cmd->mark_len_] = '\0';
+            cmd->in_mark_ = 0;
+            cmd_mark(cmd, offset + (uint64_t)(p - start) + 1);
+            return p + 1;
+        } else if (cmd->mark_esc_ || cmd->mark_len_ == MARK_MAX) {
+            cmd->in_mark_ = 0;
+            return p;
+        } else if (C_ESC == byte) {
+            cmd->mark_esc_ = 1;
+            continue;
+        }
+        cmd->mark_[cmd->mark_len_++] = (char)byte;
+    }
+    return p;
+}
+
+/**
+ * @brief Looks for marks in a piece of output.
+ * @param cmd the command table.
+ * @param data the output.
+ * @param len its length.
+ * @param offset its offset.
+ */
+static void cmd_scan_marks(struct ps_cmd *cmd, const uint8_t *data, size_t len, uint64_t offset) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    while (p < end) {
+        if (!cmd->in_mark_) {
+            p = memchr(p, C_ESC, (size_t)(end - p));
+            if (NULL == p) {
+                break;
+            }
+            cmd->in_mark_ = 1;
+            cmd->mark_esc_ = 0;
+            cmd->mark_len_ = 0;
+            cmd->mark_start_ = offset + (uint64_t)(p - data);
+            ++p;
+        }
+        p = cmd_read_mark(cmd, p, end, offset + (uint64_t)(p - data));
+    }
+}
+
+/**
+ * @brief Follows the lines of a piece of output, for prompt recognition.
+ * @details Ends the command line of the current command at the first line feed after it and
+ * keeps the last line.
+ * @param cmd the command table.
+ * @param data the output.
+ * @param len its length.
+ * @param offset its offset.
+ */
+static void cmd_scan_lines(struct ps_cmd *cmd, const uint8_t *data, size_t len, uint64_t offset) {
+    const uint8_t *last = memrchr(data, '\n', len);
+    if (CMD_INPUT == cmd->state_) {
+        uint64_t from = cmd->record_.input_ > offset ? cmd->record_.input_ - offset : 0;
+        const uint8_t *line_feed = from < len ? memchr(data + from, '\n', len - from) : NULL;
+        if (NULL != line_feed) {
+            cmd_run(cmd, offset + (uint64_t)(line_feed - data) + 1);
+        }
+    }
+    if (NULL != last) {
+        cmd->line_start_ = offset + (uint64_t)(last - data) + 1;
+        cmd->line_len_ = 0;
+        cmd->line_long_ = 0;
+        len -= (size_t)(last + 1 - data);
+        data = last + 1;
+    }
+    if (cmd->line_long_ || len > PROMPT_MAX - cmd->line_len_) {
+        cmd->line_long_ = 1;
+        return;
+    }
+    memcpy(cmd->line_ + cmd->line_len_, data, len);
+    cmd->line_len_ += len;
+}
+
+/**
+ * @brief Checks whether the last line of output is a prompt.
+ * @param cmd the command table.
+ * @param offset offset of the end of the output.
+ */
+static void cmd_check_prompt(struct ps_cmd *cmd, uint64_t offset) {
+    size_t len;
+    if (cmd->line_long_ || 0 == cmd->line_len_ || cmd->prompt_line_ == cmd->line_start_) {
+        return;
+    }
+    nt_strip_init(&cmd->strip_);
+    len = nt_strip_feed(&cmd->strip_, cmd->line_, cmd->line_len_, cmd->text_);
+    len += nt_strip_finish(&cmd->strip_, cmd->text_ + len);
+    cmd->text_[len] = '\0';
+    if (0 == regexec(&cmd->prompt_, cmd->text_, 0, NULL, 0)) {
+        cmd_prompt(cmd, cmd->line_start_, PS_CMD_PROMPT);
+        /* The command line is typed after the prompt */
+        cmd->record_.input_ = cmd->record_.output_ = offset;
+        cmd->state_ = CMD_INPUT;
+        cmd->prompt_line_ = cmd->line_start_;
+    }
+}
+
+ps_cmd_t ps_cmd_open(const char *log_file_name, const char *prompt, uint64_t base) {
+    size_t len = strlen(log_file_name) + sizeof(PS_CMD_SUFFIX);
+    char *name = nt_pool_alloc(len);
+    struct ps_cmd *cmd = nt_pool_zalloc(sizeof(struct ps_cmd));
+    ps_cmd_header_t header = {.magic_ = PS_CMD_MAGIC,
+                              .version_ = PS_CMD_VERSION,
+                              .record_size_ = sizeof(ps_cmd_record_t)};
+    if (NULL == name || NULL == cmd) {
+        nt_pool_free(cmd);
+        nt_pool_free(name);
+        return NULL;
+    }
+    cmd->fd_ = -1;
+    cmd->base_ = base;
+    cmd->prompt_line_ = UINT64_MAX;
+    if (NULL != prompt) {
+        if (0 != regcomp(&cmd->prompt_, prompt, REG_EXTENDED | REG_NOSUB)) {
+            nt_pool_free(cmd);
+            nt_pool_free(name);
+            errno = EINVAL;
+            return NULL;
+        }
+        cmd->has_prompt_ = 1;
+    }
+    snprintf(name, len, "%s%s", log_file_name, PS_CMD_SUFFIX);
+    cmd->fd_ = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    nt_pool_free(name);
+    if (cmd->fd_ < 0 || sizeof(header) != write(cmd->fd_, &header, sizeof(header))) {
+        ps_cmd_close(cmd, 0);
+        return NULL;
+    }
+    return cmd;
+}
+
+void ps_cmd_scan(ps_cmd_t cmd, yanzc_chain_reader_t *reader) {
+    struct iovec iov[16];
+    int n_iov = io_chain_reader_get_iov(reader, iov, ARRAY_SIZE(iov));
+    uint64_t offset = reader->offset_read_ - cmd->base_;
+    unsigned long scanned = 0;
+    int idx;
+    for (idx = 0; idx < n_iov; ++idx) {
+        if (cmd->has_prompt_ && !cmd->marks_seen_) {
+            cmd_scan_lines(cmd, iov[idx].iov_base, iov[idx].iov_len, offset + scanned);
+        }
+        cmd_scan_marks(cmd, iov[idx].iov_base, iov[idx].iov_len, offset + scanned);
+        scanned += iov[idx].iov_len;
+    }
+    io_chain_reader_advance(reader, scanned);
+    if (cmd->has_prompt_ && !cmd->marks_seen_) {
+        cmd_check_prompt(cmd, offset + scanned);
+    }
+}
+
+void ps_cmd_close(ps_cmd_t cmd, uint64_t end) {
+    if (NULL == cmd) {
+        return;
+    }
+    if (cmd->fd_ >= 0) {
+        if (CMD_RUNNING == cmd->state_) {
+            cmd_end(cmd, end, PS_CMD_STATUS_UNKNOWN);
+        }
+        close(cmd->fd_);
+    }
+    if (cmd->has_prompt_) {
+        regfree(&cmd->prompt_);
+    }
+    nt_pool_free(cmd);
+}
+
+int ps_cmd_read(int fd, uint64_t n, ps_cmd_record_t *record) {
+    off_t offset = (off_t)(sizeof(ps_cmd_header_t) + n * sizeof(ps_cmd_record_t));
+    if (sizeof(*record) != pread(fd, record, sizeof(*record), offset)) {
+        return -1;
+    }
+    return 0;
+}
+
+/** @} */
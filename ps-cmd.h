@@ -0,0 +1,127 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-cmd.h
+ * @brief Command table header file
+ * @details The command table is a companion of the session log, named after it with a
+ * @c .cmd suffix. It holds a fixed-size record per command run in the session: where its
+ * prompt, its command line and its output are in the log, when it ran and how it exited. The
+ * n-th command is found without parsing the records before it. @n
+ * Command boundaries come from shell integration marks, OSC 133 sequences that shells print
+ * around the prompt and each command: @c A where the prompt starts, @c B where the command
+ * line starts, @c C where the output starts and <tt>D[;status]</tt> where the command ends.
+ * For shells that do not print them, a prompt can be recognised by a regular expression
+ * instead: an unfinished last line of output that matches it is taken for a prompt, and the
+ * command runs from the end of the line typed after it to the next prompt. Once a mark shows
+ * up, the regular expression is no longer used.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_CMD_H
+#define PS_CMD_H
+
+#include <stdint.h>
+
+#include "yanzc_chain.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Suffix appended to the log file name to get the command table name. */
+#define PS_CMD_SUFFIX ".cmd"
+
+/** @brief Value of @c magic_ in the command table header, "PSC1" in little endian. */
+#define PS_CMD_MAGIC (0x31435350U)
+
+/** @brief Version of the record layout. */
+#define PS_CMD_VERSION (1)
+
+/** @brief Value of @c status_ when the shell did not report the exit status. */
+#define PS_CMD_STATUS_UNKNOWN (INT32_MIN)
+
+/**
+ * @brief Where the boundaries of a command come from.
+ */
+typedef enum ps_cmd_source_t {
+    PS_CMD_OSC133 = 1, /**< Shell integration marks */
+    PS_CMD_PROMPT = 2, /**< Prompt recognised by the regular expression */
+} ps_cmd_source_t;
+
+/**
+ * @brief Header of the command table.
+ */
+typedef struct ps_cmd_header_t {
+    uint32_t magic_;       /**< @ref PS_CMD_MAGIC */
+    uint32_t version_;     /**< @ref PS_CMD_VERSION */
+    uint32_t record_size_; /**< Size of a record, for readers of later versions */
+    uint32_t reserved_;    /**< Zero */
+} ps_cmd_header_t;
+
+/**
+ * @brief A command.
+ * @details Offsets are log offsets. The command line is <tt>[input_, output_)</tt> and the
+ * output <tt>[output_, end_)</tt>. Records are stored in host byte order.
+ */
+typedef struct ps_cmd_record_t {
+    uint64_t prompt_;   /**< Start of the prompt */
+    uint64_t input_;    /**< Start of the command line */
+    uint64_t output_;   /**< Start of the output */
+    uint64_t end_;      /**< End of the output */
+    uint64_t start_ns_; /**< When the command started, in nanoseconds since the epoch */
+    uint64_t end_ns_;   /**< When the command ended */
+    int32_t status_;    /**< Exit status, @ref PS_CMD_STATUS_UNKNOWN if not reported */
+    uint32_t source_;   /**< One of @ref ps_cmd_source_t */
+} ps_cmd_record_t;
+
+/**
+ * @brief A handle of a command table being written.
+ */
+typedef struct ps_cmd *ps_cmd_t;
+
+/**
+ * @brief Creates the command table of a log.
+ * @param log_file_name name of the log.
+ * @param prompt extended regular expression matching a prompt, @c NULL to rely on marks only.
+ * @param base offset of the readers given to @ref ps_cmd_scan() the log starts at.
+ * @return The command table or @c NULL, with @c errno set; @c EINVAL for a malformed
+ * regular expression.
+ * @sa ps_cmd_close()
+ */
+ps_cmd_t ps_cmd_open(const char *log_file_name, const char *prompt, uint64_t base);
+
+/**
+ * @brief Looks for command boundaries in the output pending for a reader, and consumes it.
+ * @details Meant to be called as soon as the output is read, the time it is called at is
+ * the time recorded for the boundaries it finds.
+ * @param cmd the command table.
+ * @param reader the reader, reading the output the log gets.
+ */
+void ps_cmd_scan(ps_cmd_t cmd, yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Ends the command still running, if any, and closes the command table.
+ * @param cmd the command table, may be @c NULL.
+ * @param end length of the output, where the last command ends.
+ */
+void ps_cmd_close(ps_cmd_t cmd, uint64_t end);
+
+/**
+ * @brief Reads the n-th command from a command table.
+ * @param fd descriptor of the command table.
+ * @param n number of the command, from 0.
+ * @param[out] record the command.
+ * @return 0 on success, -1 if there is no such command or on error.
+ */
+int ps_cmd_read(int fd, uint64_t n, ps_cmd_record_t *record);
+
+/** @} */
+
+#endif /* PS_CMD_H */
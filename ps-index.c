@@ -0,0 +1,524 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-index.c
+ * @brief Session log full-text index implementation file
+ * @details The index thread reads the log back in chunks of @ref INDEX_CHUNK bytes, strips
+ * them and sets the bucket of each trigram in the bitmap of the current segment. When the
+ * segment ends, the bitmap is written out, as a list if it is sparse, and cleared. The log
+ * is read through the page cache, where the relay has just put it. @n
+ * A search reads the segments in order and keeps the last @ref SEARCH_WINDOW of them, so that
+ * a string spanning segments is still found in the union of their trigrams.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "compiler-defs.h"
+#include "nt-pool.h"
+#include "nt-strip.h"
+#include "ps-index.h"
+#include "ps-meta.h"
+#include "yandu_log.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/**
+ * @brief Size of the stripped text buffer.
+ * @details A power of two, the slab pool has no waste on it.
+ */
+#define INDEX_TEXT_SIZE (64UL << 10)
+
+/** @brief Largest piece of the log read and stripped at once. */
+#define INDEX_CHUNK (INDEX_TEXT_SIZE - NT_STRIP_LINE_MAX)
+
+/** @brief Amount of new log data that wakes the index thread up. */
+#define INDEX_WAKE_BYTES (64UL << 10)
+
+/** @brief Niceness of the index thread, so it yields to the relay. */
+#define INDEX_NICE (10)
+
+/**
+ * @brief Most trigrams of a query looked up in the index.
+ * @details Longer strings are looked up by their first trigrams only, which can only add
+ * false positives.
+ */
+#define SEARCH_TRIGRAMS (64)
+
+/** @brief Most segments a hit may span. */
+#define SEARCH_WINDOW (64)
+
+/**
+ * @brief Index being built.
+ */
+struct ps_index {
+    int fd_;                     /**< Index file descriptor */
+    int log_fd_;                 /**< Log file descriptor, read only */
+    unsigned long segment_size_; /**< Largest segment */
+    uint64_t published_;         /**< Length of the log file, published by the relay */
+    uint64_t signalled_;         /**< Value of @c published_ when the thread was last woken */
+    uint64_t indexed_;           /**< Length of the log indexed so far */
+    uint32_t gram_;              /**< Last bytes of text, the start of the next trigram */
+    unsigned int gram_len_;      /**< Number of bytes in @c gram_, up to 2 */
+    ps_index_segment_t segment_; /**< Current segment */
+    uint8_t *read_;              /**< Log data, @ref INDEX_CHUNK bytes */
+    uint8_t *text_;              /**< Stripped text, @ref INDEX_TEXT_SIZE bytes */
+    uint64_t *bitmap_;           /**< Buckets of the current segment */
+    uint16_t *list_;             /**< Buckets of a sparse segment, being written out */
+    pthread_t thread_;           /**< Index thread */
+    int thread_running_;         /**< Non-zero if @c thread_ was started */
+    pthread_mutex_t lock_;       /**< Guards @c stop_, @c kick_, @c idle_ and the condition */
+    pthread_cond_t wake_;        /**< Wakes the index thread up */
+    int kick_;                   /**< Asks the index thread to catch up */
+    int idle_;                   /**< Asks the index thread to end the segment as well */
+    int stop_;                   /**< Asks the index thread to finish */
+    nt_strip_t strip_;           /**< Stripper state */
+};
+
+/**
+ * @brief Folds ASCII upper case letters to lower case.
+ */
+static inline uint8_t fold(uint8_t byte) {
+    return (byte >= 'A' && byte <= 'Z') ? (uint8_t)(byte | 0x20) : byte;
+}
+
+/**
+ * @brief Hashes a trigram into a bucket.
+ * @param gram three folded bytes, the first one in bits 16..23.
+ * @return The bucket.
+ */
+static inline uint32_t trigram_bucket(uint32_t gram) {
+    /* Multiplicative hashing, the top bits of the product mix all the input bits */
+    return (gram * 2654435761U) >> 16;
+}
+
+/**
+ * @brief Sets the buckets of all the trigrams of a piece of text.
+ * @details The last two bytes are carried over, so trigrams spanning pieces and segments are
+ * not lost; such a trigram belongs to the segment it ends in.
+ */
+static void index_text(struct ps_index *index, const uint8_t *text, size_t len) {
+    uint64_t *bitmap = index->bitmap_;
+    uint32_t gram = index->gram_;
+    size_t idx = 0;
+    for (; idx < len && index->gram_len_ < 2; ++idx, ++index->gram_len_) {
+        gram = (gram << 8) | fold(text[idx]);
+    }
+    for (; idx < len; ++idx) {
+        uint32_t bucket;
+        gram = ((gram << 8) | fold(text[idx])) & 0xffffffU;
+        bucket = trigram_bucket(gram);
+        bitmap[bucket >> 6] |= 1ULL << (bucket & 63);
+    }
+    index->gram_ = gram;
+    index->segment_.text_len_ += len;
+}
+
+/**
+ * @brief Writes the current segment out and starts the next one.
+ * @details The unfinished line goes to the segment that ends, escape sequences are still
+ * tracked across the boundary.
+ */
+static void index_flush(struct ps_index *index) {
+    ps_index_segment_t *segment = &index->segment_;
+    uint8_t state = index->strip_.state_;
+    uint32_t param = index->strip_.param_;
+    struct iovec iov[2];
+    size_t words = PS_INDEX_BUCKETS / 64;
+    size_t idx;
+    if (segment->end_ == segment->start_) {
+        return;
+    }
+    index_text(index, index->text_, nt_strip_finish(&index->strip_, index->text_));
+    index->strip_.state_ = state;
+    index->strip_.param_ = param;
+    segment->count_ = 0;
+    for (idx = 0; idx < words; ++idx) {
+        segment->count_ += (uint32_t)__builtin_popcountll(index->bitmap_[idx]);
+    }
+    iov[0].iov_base = segment;
+    iov[0].iov_len = sizeof(*segment);
+    if (segment->count_ >= PS_INDEX_DENSE) {
+        iov[1].iov_base = index->bitmap_;
+        iov[1].iov_len = PS_INDEX_BUCKETS / 8;
+    } else {
+        uint32_t fill = 0;
+        for (idx = 0; idx < words; ++idx) {
+            uint64_t word = index->bitmap_[idx];
+            while (0 != word) {
+                index->list_[fill++] = (uint16_t)(idx * 64 + (size_t)__builtin_ctzll(word));
+                word &= word - 1;
+            }
+        }
+        iov[1].iov_base = index->list_;
+        iov[1].iov_len = fill * sizeof(uint16_t);
+    }
+    if ((ssize_t)(iov[0].iov_len + iov[1].iov_len) != writev(index->fd_, iov, ARRAY_SIZE(iov))) {
+        LOG_DEBUG("%d %s", errno, strerror(errno));
+    }
+    memset(index->bitmap_, 0, PS_INDEX_BUCKETS / 8);
+    segment->start_ = segment->end_;
+    segment->text_len_ = 0;
+}
+
+/**
+ * @brief Indexes the log up to a given length.
+ * @param index the index.
+ * @param length length of the log file.
+ */
+static void index_catch_up(struct ps_index *index, uint64_t length) {
+    ps_index_segment_t *segment = &index->segment_;
+    while (index->indexed_ < length) {
+        uint64_t left = length - index->indexed_;
+        uint64_t segment_left = segment->start_ + index->segment_size_ - index->indexed_;
+        size_t chunk = INDEX_CHUNK;
+        uint64_t now;
+        ssize_t result;
+        if (chunk > left) {
+            chunk = (size_t)left;
+        }
+        if (chunk > segment_left) {
+            chunk = (size_t)segment_left;
+        }
+        result = pread(index->log_fd_, index->read_, chunk, (off_t)index->indexed_);
+        if (result < 0 && EINTR == errno) {
+            continue;
+        }
+        if (result <= 0) {
+            LOG_DEBUG("%d %s", errno, strerror(errno));
+            return;
+        }
+        now = ps_meta_now();
+        if (segment->end_ == segment->start_) {
+            segment->start_ns_ = now;
+        }
+        index_text(index, index->text_,
+                   nt_strip_feed(&index->strip_, index->read_, (size_t)result, index->text_));
+        index->indexed_ += (uint64_t)result;
+        segment->end_ns_ = now;
+        segment->end_ = index->indexed_;
+        if (segment->end_ - segment->start_ >= index->segment_size_) {
+            index_flush(index);
+        }
+    }
+}
+
+/**
+ * @brief Index thread.
+ * @details Runs at a lower priority than the relay. Wakes up when the relay reports enough
+ * new data or asks it to, indexes whatever the log holds by then, and ends the segment if the
+ * relay says the output has paused.
+ */
+static void *index_thread(void *arg) {
+    struct ps_index *index = arg;
+    if (0 != setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), INDEX_NICE)) {
+        LOG_DEBUG("%d %s", errno, strerror(errno));
+    }
+    pthread_mutex_lock(&index->lock_);
+    while (!index->stop_) {
+        uint64_t published;
+        int idle;
+        while (!index->stop_ && !index->kick_) {
+            pthread_cond_wait(&index->wake_, &index->lock_);
+        }
+        if (index->stop_) {
+            break;
+        }
+        idle = index->idle_;
+        index->kick_ = index->idle_ = 0;
+        published = __atomic_load_n(&index->published_, __ATOMIC_ACQUIRE);
+        pthread_mutex_unlock(&index->lock_);
+        index_catch_up(index, published);
+        if (idle && index->segment_.end_ != index->segment_.start_) {
+            index_flush(index);
+        }
+        pthread_mutex_lock(&index->lock_);
+    }
+    pthread_mutex_unlock(&index->lock_);
+    return NULL;
+}
+
+ps_index_t ps_index_open(const char *log_file_name, unsigned long segment_size) {
+    size_t len = strlen(log_file_name) + sizeof(PS_INDEX_SUFFIX);
+    char *name = nt_pool_alloc(len);
+    struct ps_index *index = nt_pool_zalloc(sizeof(struct ps_index));
+    ps_index_header_t header = {.magic_ = PS_INDEX_MAGIC, .version_ = PS_INDEX_VERSION};
+    if (NULL == name || NULL == index) {
+        nt_pool_free(index);
+        nt_pool_free(name);
+        return NULL;
+    }
+    index->fd_ = index->log_fd_ = -1;
+    index->segment_size_ = segment_size;
+    index->segment_.magic_ = PS_INDEX_SEGMENT_MAGIC;
+    nt_strip_init(&index->strip_);
+    index->read_ = nt_pool_alloc(INDEX_CHUNK);
+    index->text_ = nt_pool_alloc(INDEX_TEXT_SIZE);
+    index->bitmap_ = nt_pool_zalloc(PS_INDEX_BUCKETS / 8);
+    index->list_ = nt_pool_alloc(PS_INDEX_DENSE * sizeof(uint16_t));
+    snprintf(name, len, "%s%s", log_file_name, PS_INDEX_SUFFIX);
+    index->log_fd_ = open(log_file_name, O_RDONLY | O_CLOEXEC);
+    index->fd_ = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    nt_pool_free(name);
+    if (NULL == index->read_ || NULL == index->text_ || NULL == index->bitmap_ ||
+        NULL == index->list_ || index->log_fd_ < 0 || index->fd_ < 0) {
+        ps_index_close(index);
+        return NULL;
+    }
+    header.start_ns_ = ps_meta_now();
+    header.segment_size_ = (uint32_t)segment_size;
+    gethostname(header.host_, sizeof(header.host_) - 1);
+    if (sizeof(header) != write(index->fd_, &header, sizeof(header))) {
+        ps_index_close(index);
+        return NULL;
+    }
+    pthread_mutex_init(&index->lock_, NULL);
+    pthread_cond_init(&index->wake_, NULL);
+    if (0 != pthread_create(&index->thread_, NULL, index_thread, index)) {
+        pthread_mutex_destroy(&index->lock_);
+        pthread_cond_destroy(&index->wake_);
+        ps_index_close(index);
+        return NULL;
+    }
+    index->thread_running_ = 1;
+    return index;
+}
+
+void ps_index_advance(ps_index_t index, uint64_t length) {
+    __atomic_store_n(&index->published_, length, __ATOMIC_RELEASE);
+    if (length - index->signalled_ >= INDEX_WAKE_BYTES) {
+        ps_index_wake(index, 0);
+    }
+}
+
+void ps_index_wake(ps_index_t index, int idle) {
+    index->signalled_ = index->published_;
+    pthread_mutex_lock(&index->lock_);
+    index->kick_ = 1;
+    index->idle_ |= idle;
+    pthread_cond_signal(&index->wake_);
+    pthread_mutex_unlock(&index->lock_);
+}
+
+void ps_index_close(ps_index_t index) {
+    struct stat log_stat;
+    if (NULL == index) {
+        return;
+    }
+    if (index->thread_running_) {
+        pthread_mutex_lock(&index->lock_);
+        index->stop_ = 1;
+        pthread_cond_signal(&index->wake_);
+        pthread_mutex_unlock(&index->lock_);
+        pthread_join(index->thread_, NULL);
+        pthread_mutex_destroy(&index->lock_);
+        pthread_cond_destroy(&index->wake_);
+        /* The log is complete by now, whatever was published last */
+        if (0 == fstat(index->log_fd_, &log_stat)) {
+            index_catch_up(index, (uint64_t)log_stat.st_size);
+        }
+        index_flush(index);
+    }
+    if (index->fd_ >= 0) {
+        close(index->fd_);
+    }
+    if (index->log_fd_ >= 0) {
+        close(index->log_fd_);
+    }
+    nt_pool_free(index->list_);
+    nt_pool_free(index->bitmap_);
+    nt_pool_free(index->text_);
+    nt_pool_free(index->read_);
+    nt_pool_free(index);
+}
+
+/**
+ * @brief A segment of a log being searched.
+ */
+struct search_entry_t {
+    ps_index_segment_t segment_; /**< The segment */
+    uint64_t found_;             /**< Trigrams of the query found in the segment, one bit each */
+};
+
+/**
+ * @brief Reads a whole record.
+ * @return 0 on success, -1 at the end of the file, on error or on a torn record.
+ */
+static int read_all(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t result = read(fd, p, len);
+        if (result < 0 && EINTR == errno) {
+            continue;
+        }
+        if (result <= 0) {
+            return -1;
+        }
+        p += result;
+        len -= (size_t)result;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds which of the buckets of a query a segment has.
+ * @param segment the segment header.
+ * @param payload list or bitmap following the header.
+ * @param buckets buckets of the query.
+ * @param n_buckets their number.
+ * @return One bit per bucket present.
+ */
+static uint64_t search_segment(const ps_index_segment_t *segment, const void *payload,
+                               const uint32_t *buckets, size_t n_buckets) {
+    uint64_t found = 0;
+    size_t idx;
+    if (segment->count_ >= PS_INDEX_DENSE) {
+        const uint64_t *bitmap = payload;
+        for (idx = 0; idx < n_buckets; ++idx) {
+            if (0 != (bitmap[buckets[idx] >> 6] & (1ULL << (buckets[idx] & 63)))) {
+                found |= 1ULL << idx;
+            }
+        }
+    } else {
+        const uint16_t *list = payload;
+        for (idx = 0; idx < n_buckets; ++idx) {
+            size_t low = 0, high = segment->count_;
+            while (low < high) {
+                size_t mid = (low + high) / 2;
+                if (list[mid] < buckets[idx]) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            if (low < segment->count_ && list[low] == buckets[idx]) {
+                found |= 1ULL << idx;
+            }
+        }
+    }
+    return found;
+}
+
+int ps_index_search(const char *index_file_name, const void *text, size_t len,
+                    ps_index_hit_t hit, void *context) {
+    const uint8_t *bytes = text;
+    uint32_t buckets[SEARCH_TRIGRAMS];
+    size_t n_buckets = 0;
+    uint64_t all;
+    ps_index_header_t header;
+    struct search_entry_t *window = nt_pool_alloc(sizeof(struct search_entry_t) * SEARCH_WINDOW);
+    uint64_t *payload = nt_pool_alloc(PS_INDEX_BUCKETS / 8);
+    ps_index_segment_t pending;
+    uint64_t count = 0, pending_last = 0;
+    int has_pending = 0, stop = 0, result = -1;
+    size_t idx;
+    int fd = open(index_file_name, O_RDONLY | O_CLOEXEC);
+    for (idx = 2; idx < len && n_buckets < SEARCH_TRIGRAMS; ++idx) {
+        uint32_t gram = (uint32_t)fold(bytes[idx - 2]) << 16 |
+                        (uint32_t)fold(bytes[idx - 1]) << 8 | fold(bytes[idx]);
+        uint32_t bucket = trigram_bucket(gram);
+        size_t seen = 0;
+        while (seen < n_buckets && buckets[seen] != bucket) {
+            ++seen;
+        }
+        if (seen == n_buckets) {
+            buckets[n_buckets++] = bucket;
+        }
+    }
+    all = SEARCH_TRIGRAMS == n_buckets ? ~0ULL : (1ULL << n_buckets) - 1;
+    if (fd < 0 || NULL == window || NULL == payload) {
+        goto out;
+    }
+    if (0 != read_all(fd, &header, sizeof(header)) || PS_INDEX_MAGIC != header.magic_ ||
+        PS_INDEX_VERSION != header.version_) {
+        errno = EINVAL;
+        goto out;
+    }
+    header.host_[sizeof(header.host_) - 1] = '\0';
+    result = 0;
+    while (!stop) {
+        struct search_entry_t *entry = &window[count % SEARCH_WINDOW];
+        ps_index_segment_t *segment = &entry->segment_;
+        uint64_t found = 0, earlier = 0, inner = 0;
+        size_t back, payload_len;
+        /* A torn record at the end is what a session still running or one that crashed has */
+        if (0 != read_all(fd, segment, sizeof(*segment)) ||
+            PS_INDEX_SEGMENT_MAGIC != segment->magic_) {
+            break;
+        }
+        payload_len = segment->count_ >= PS_INDEX_DENSE ? PS_INDEX_BUCKETS / 8
+                                                        : segment->count_ * sizeof(uint16_t);
+        if (0 != read_all(fd, payload, payload_len)) {
+            break;
+        }
+        entry->found_ = search_segment(segment, payload, buckets, n_buckets);
+        /* Look for the shortest run of segments ending with this one that has it all */
+        for (back = 0; back < SEARCH_WINDOW && back <= count; ++back) {
+            const struct search_entry_t *first = &window[(count - back) % SEARCH_WINDOW];
+            found |= first->found_;
+            earlier |= back > 0 ? first->found_ : 0;
+            if (all == found) {
+                break;
+            }
+            if (back > 0) {
+                inner += first->segment_.text_len_;
+            }
+            /* A match has at least a byte in the first and the last segment of the run */
+            if (inner + 2 > len) {
+                break;
+            }
+        }
+        /* Runs that have it all without this segment have been reported already */
+        if (all == found && (0 == n_buckets || all != earlier)) {
+            uint64_t first_idx = count - back;
+            const ps_index_segment_t *first = &window[first_idx % SEARCH_WINDOW].segment_;
+            if (has_pending && first_idx <= pending_last) {
+                pending.end_ = segment->end_;
+                pending.end_ns_ = segment->end_ns_;
+            } else {
+                if (has_pending) {
+                    stop = hit(context, &header, &pending);
+                }
+                pending = *first;
+                pending.end_ = segment->end_;
+                pending.end_ns_ = segment->end_ns_;
+                has_pending = 1;
+            }
+            pending_last = count;
+        }
+        ++count;
+    }
+    if (has_pending && !stop) {
+        hit(context, &header, &pending);
+    }
+out:
+    if (fd >= 0) {
+        close(fd);
+    }
+    nt_pool_free(payload);
+    nt_pool_free(window);
+    return result;
+}
+
+/** @} */
@@ -0,0 +1,166 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-index.h
+ * @brief Session log full-text index header file
+ * @details The index is a companion of the session log, named after it with a @c .idx suffix.
+ * It lets a query find the sessions, and the parts of them, that may contain a string
+ * without reading the logs. @n
+ * The log is cut into segments of at most a given size; a segment also ends when the output
+ * pauses for a while, so it tends to hold the output of a single command. For each segment,
+ * the index records its log offsets, its time span and the set of trigrams of its text, with
+ * escape sequences stripped and ASCII letters folded to lower case. Trigrams are hashed into
+ * @ref PS_INDEX_BUCKETS buckets; the set is stored as a sorted list of bucket numbers or,
+ * once that would be the larger of the two, as a bitmap of all buckets. @n
+ * The index is built by a thread of its own, which reads back what the relay has written to
+ * the log file. The relay only publishes how far the log goes, and the memory the thread
+ * uses does not depend on the length of the session.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_INDEX_H
+#define PS_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Suffix appended to the log file name to get the index file name. */
+#define PS_INDEX_SUFFIX ".idx"
+
+/** @brief Value of @c magic_ in the index header, "PSI1" in little endian. */
+#define PS_INDEX_MAGIC (0x31495350U)
+
+/** @brief Value of @c magic_ in a segment record, "PSIS" in little endian. */
+#define PS_INDEX_SEGMENT_MAGIC (0x53495350U)
+
+/** @brief Version of the index layout. */
+#define PS_INDEX_VERSION (1)
+
+/** @brief Number of trigram hash buckets. */
+#define PS_INDEX_BUCKETS (1U << 16)
+
+/**
+ * @brief Number of buckets from which a segment stores a bitmap rather than a list.
+ * @details That is where a list of 16-bit bucket numbers gets as large as the bitmap.
+ */
+#define PS_INDEX_DENSE (PS_INDEX_BUCKETS / 16)
+
+/** @brief Default size of a segment. */
+#define PS_INDEX_DEFAULT_SEGMENT (256UL << 10)
+
+/** @brief Longest new log data below the wake-up threshold waits to be indexed, in ns. */
+#define PS_INDEX_POLL_NS (1000000000ULL)
+
+/** @brief Pause in the output that ends a segment, in nanoseconds. */
+#define PS_INDEX_IDLE_NS (5000000000ULL)
+
+/**
+ * @brief Header of the index file.
+ */
+typedef struct ps_index_header_t {
+    uint32_t magic_;        /**< @ref PS_INDEX_MAGIC */
+    uint32_t version_;      /**< @ref PS_INDEX_VERSION */
+    uint64_t start_ns_;     /**< When the session started, in nanoseconds since the epoch */
+    uint32_t segment_size_; /**< Largest segment, in log bytes */
+    uint32_t reserved_;     /**< Zero */
+    char host_[64];         /**< Host the session was recorded on, null terminated */
+} ps_index_header_t;
+
+/**
+ * @brief Header of a segment record.
+ * @details It is followed by @c count_ bucket numbers as @c uint16_t in ascending order or,
+ * if @c count_ is at least @ref PS_INDEX_DENSE, by a bitmap of @ref PS_INDEX_BUCKETS bits.
+ * Records are stored in host byte order.
+ */
+typedef struct ps_index_segment_t {
+    uint32_t magic_;    /**< @ref PS_INDEX_SEGMENT_MAGIC */
+    uint32_t count_;    /**< Number of buckets holding a trigram of the segment */
+    uint64_t start_;    /**< Log offset of the segment */
+    uint64_t end_;      /**< Log offset past the segment */
+    uint64_t start_ns_; /**< When the first output of the segment was indexed */
+    uint64_t end_ns_;   /**< When the last output of the segment was indexed */
+    uint64_t text_len_; /**< Length of the text of the segment, escape sequences stripped */
+} ps_index_segment_t;
+
+/**
+ * @brief A handle of an index being built.
+ */
+typedef struct ps_index *ps_index_t;
+
+/**
+ * @brief Creates the index of a log and starts the thread that builds it.
+ * @param log_file_name name of the log, which must exist already.
+ * @param segment_size largest segment, in log bytes.
+ * @return The index or @c NULL, with @c errno set.
+ * @sa ps_index_close()
+ */
+ps_index_t ps_index_open(const char *log_file_name, unsigned long segment_size);
+
+/**
+ * @brief Tells the index thread how far the log file goes.
+ * @details Never blocks for long: it only wakes the thread up once enough data has piled up.
+ * The rest waits for @ref ps_index_wake(), which the owner of the index calls within
+ * @ref PS_INDEX_POLL_NS.
+ * @param index the index.
+ * @param length length of the log file.
+ */
+void ps_index_advance(ps_index_t index, uint64_t length);
+
+/**
+ * @brief Has the index thread index what the log holds so far.
+ * @details The owner calls it @ref PS_INDEX_POLL_NS after it advanced the index, and with
+ * @p idle set once the log has not grown for @ref PS_INDEX_IDLE_NS; the relay does it from its
+ * timer wheel, so that the thread sleeps while the session is idle.
+ * @param index the index.
+ * @param idle non-zero to end the current segment as well, the output having paused.
+ */
+void ps_index_wake(ps_index_t index, int idle);
+
+/**
+ * @brief Stops the index thread, indexes the rest of the log and closes the index.
+ * @details To be called once the log is complete, after it is closed.
+ * @param index the index, may be @c NULL.
+ */
+void ps_index_close(ps_index_t index);
+
+/**
+ * @brief Callback reporting a part of a log that may contain the string searched for.
+ * @param context context given to @ref ps_index_search().
+ * @param header header of the index.
+ * @param hit offsets and time span of the part of the log; @c count_ and @c text_len_ are
+ * undefined.
+ * @return 0 to go on searching, anything else to stop.
+ */
+typedef int (*ps_index_hit_t)(void *context, const ps_index_header_t *header,
+                              const ps_index_segment_t *hit);
+
+/**
+ * @brief Finds the parts of a log that may contain a string, using its index only.
+ * @details A part is made of one or more consecutive segments: those whose trigrams, taken
+ * together, include all of the trigrams of the string. There are no false negatives, but
+ * there are false positives, the caller confirms hits by reading the log if need be.
+ * Strings shorter than a trigram match every segment. Letter case is ignored.
+ * @param index_file_name name of the index file.
+ * @param text the string.
+ * @param len its length.
+ * @param hit callback called for each part found, in log order.
+ * @param context passed to @p hit.
+ * @return 0 on success, -1 if the index cannot be read or is not valid, with @c errno set.
+ */
+int ps_index_search(const char *index_file_name, const void *text, size_t len,
+                    ps_index_hit_t hit, void *context);
+
+/** @} */
+
+#endif /* PS_INDEX_H */
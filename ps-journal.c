@@ -0,0 +1,203 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-journal.c
+ * @brief Shared session journal implementation file
+ * @details Output records are gathered straight from the segments of the chain, the header
+ * in front of them, so the output is copied once, by the kernel. A reader looking for the
+ * next record after a damaged one searches for the magic number and takes the first header
+ * whose checksum matches; a match by chance within output is as unlikely as a CRC-32C
+ * collision.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "nt-crc32c.h"
+#include "nt-pool.h"
+#include "ps-journal.h"
+#include "ps-meta.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Largest number of pieces of output in a record. */
+#define JOURNAL_IOV_MAX (16)
+
+/**
+ * @brief Writing side of a session.
+ */
+struct ps_journal {
+    int fd_;           /**< The journal, opened with @c O_APPEND */
+    uint64_t session_; /**< Identifier of the session */
+    uint64_t seq_;     /**< Number of the next record */
+};
+
+/**
+ * @brief Computes the checksum of a record.
+ * @param header the header, its checksum ignored.
+ * @param iov the payload.
+ * @param n_iov number of pieces of the payload.
+ * @return The checksum.
+ */
+static uint32_t journal_crc(const ps_journal_record_t *header, const struct iovec *iov,
+                            int n_iov) {
+    ps_journal_record_t copy = *header;
+    uint32_t crc;
+    int idx;
+    copy.crc_ = 0;
+    crc = nt_crc32c(0, &copy, sizeof(copy));
+    for (idx = 0; idx < n_iov; ++idx) {
+        crc = nt_crc32c(crc, iov[idx].iov_base, iov[idx].iov_len);
+    }
+    return crc;
+}
+
+/**
+ * @brief Appends a record in a single call.
+ * @param journal the writing side.
+ * @param type type of the record.
+ * @param payload the payload, @c JOURNAL_IOV_MAX pieces at most.
+ * @param n_iov number of pieces.
+ * @param length length of the payload, @ref PS_JOURNAL_PAYLOAD_MAX at most.
+ * @return 0 on success, @c errno value otherwise, @c EIO if the record was cut short.
+ */
+static int journal_append(struct ps_journal *journal, ps_journal_type_t type,
+                          const struct iovec *payload, int n_iov, size_t length) {
+    ps_journal_record_t header = {.magic_ = PS_JOURNAL_MAGIC,
+                                  .length_ = (uint32_t)length,
+                                  .session_ = journal->session_,
+                                  .seq_ = journal->seq_,
+                                  .time_ns_ = ps_meta_now(),
+                                  .type_ = (uint16_t)type};
+    struct iovec iov[JOURNAL_IOV_MAX + 1];
+    ssize_t result;
+    header.crc_ = journal_crc(&header, payload, n_iov);
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    memcpy(&iov[1], payload, sizeof(struct iovec) * (size_t)n_iov);
+    do {
+        result = writev(journal->fd_, iov, n_iov + 1);
+    } while (-1 == result && EINTR == errno);
+    if (-1 == result) {
+        return errno;
+    }
+    /* Even a torn record takes its number, readers see the gap */
+    ++journal->seq_;
+    return (size_t)result == sizeof(header) + length ? 0 : EIO;
+}
+
+ps_journal_t ps_journal_open(const char *file_name, const char *label) {
+    struct ps_journal *journal = nt_pool_zalloc(sizeof(struct ps_journal));
+    struct iovec iov = {.iov_base = (void *)label, .iov_len = strlen(label)};
+    int result;
+    if (NULL == journal) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    journal->fd_ = open(file_name, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (journal->fd_ < 0) {
+        nt_pool_free(journal);
+        return NULL;
+    }
+    if (sizeof(journal->session_) !=
+        getrandom(&journal->session_, sizeof(journal->session_), GRND_NONBLOCK)) {
+        journal->session_ = ps_meta_now() ^ ((uint64_t)getpid() << 32);
+    }
+    if (iov.iov_len > PS_JOURNAL_PAYLOAD_MAX) {
+        iov.iov_len = PS_JOURNAL_PAYLOAD_MAX;
+    }
+    result = journal_append(journal, PS_JOURNAL_START, &iov, 1, iov.iov_len);
+    if (0 != result) {
+        close(journal->fd_);
+        nt_pool_free(journal);
+        errno = result;
+        return NULL;
+    }
+    return journal;
+}
+
+int ps_journal_fd(ps_journal_t journal) { return journal->fd_; }
+
+uint64_t ps_journal_session(ps_journal_t journal) { return journal->session_; }
+
+int ps_journal_write(ps_journal_t journal, yanzc_chain_reader_t *reader) {
+    while (io_chain_reader_pending(reader) > 0) {
+        struct iovec iov[JOURNAL_IOV_MAX];
+        int n_iov = io_chain_reader_get_iov(reader, iov, JOURNAL_IOV_MAX), idx;
+        size_t length = 0;
+        int result;
+        /* Cut the output at the largest payload */
+        for (idx = 0; idx < n_iov && length < PS_JOURNAL_PAYLOAD_MAX; ++idx) {
+            if (iov[idx].iov_len > PS_JOURNAL_PAYLOAD_MAX - length) {
+                iov[idx].iov_len = PS_JOURNAL_PAYLOAD_MAX - length;
+            }
+            length += iov[idx].iov_len;
+        }
+        result = journal_append(journal, PS_JOURNAL_OUTPUT, iov, idx, length);
+        if (0 != result) {
+            return result;
+        }
+        io_chain_reader_advance(reader, length);
+    }
+    return 0;
+}
+
+int ps_journal_resize(ps_journal_t journal, unsigned int rows, unsigned int cols) {
+    ps_journal_resize_t size = {.rows_ = (uint16_t)rows, .cols_ = (uint16_t)cols};
+    struct iovec iov = {.iov_base = &size, .iov_len = sizeof(size)};
+    return journal_append(journal, PS_JOURNAL_RESIZE, &iov, 1, sizeof(size));
+}
+
+void ps_journal_close(ps_journal_t journal) {
+    if (NULL != journal) {
+        journal_append(journal, PS_JOURNAL_END, NULL, 0, 0);
+        close(journal->fd_);
+        nt_pool_free(journal);
+    }
+}
+
+int ps_journal_next(ps_journal_cursor_t *cursor, ps_journal_record_t *record,
+                    const uint8_t **payload) {
+    static const uint32_t magic = PS_JOURNAL_MAGIC;
+    while (cursor->size_ - cursor->offset_ >= sizeof(*record)) {
+        const uint8_t *at = cursor->data_ + cursor->offset_;
+        size_t left = cursor->size_ - cursor->offset_ - sizeof(*record);
+        const uint8_t *next;
+        memcpy(record, at, sizeof(*record));
+        if (PS_JOURNAL_MAGIC == record->magic_ && record->length_ <= PS_JOURNAL_PAYLOAD_MAX &&
+            record->length_ <= left) {
+            struct iovec iov = {.iov_base = (void *)(at + sizeof(*record)),
+                                .iov_len = record->length_};
+            if (journal_crc(record, &iov, 1) == record->crc_) {
+                *payload = iov.iov_base;
+                cursor->offset_ += sizeof(*record) + record->length_;
+                return 1;
+            }
+        }
+        next = memmem(at + 1, cursor->size_ - cursor->offset_ - 1, &magic, sizeof(magic));
+        left = NULL != next ? (size_t)(next - at) : cursor->size_ - cursor->offset_;
+        cursor->skipped_ += left;
+        cursor->offset_ += left;
+    }
+    cursor->skipped_ += cursor->size_ - cursor->offset_;
+    cursor->offset_ = cursor->size_;
+    return 0;
+}
+
+/** @} */
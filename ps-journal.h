@@ -0,0 +1,152 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-journal.h
+ * @brief Shared session journal header file
+ * @details Any number of sessions, in as many processes, may append to a single journal file
+ * rather than each keeping files of its own. The journal is a sequence of self-describing
+ * records: a header naming the session, the number of the record within the session, the
+ * time, the length of the payload and a CRC-32C of the record, then the payload. @n
+ * Each session opens the journal with @c O_APPEND and writes each record with a single
+ * @c writev() call, which the kernel appends at the end of the file as a whole, so that
+ * records of different sessions interleave but never mix. Records are at most
+ * @ref PS_JOURNAL_PAYLOAD_MAX long, for a record to always go out in one call. Should one
+ * still be cut short, by a full disk or a crash, readers notice by its checksum, skip to the
+ * next record header and see the gap in the record numbers of the session.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_JOURNAL_H
+#define PS_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "yanzc_chain.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Value of @c magic_ of every record header, "PSJ1" in little endian. */
+#define PS_JOURNAL_MAGIC (0x314a5350U)
+
+/** @brief Largest payload of a record. */
+#define PS_JOURNAL_PAYLOAD_MAX (64U << 10)
+
+/**
+ * @brief Kinds of journal records.
+ */
+typedef enum ps_journal_type_t {
+    PS_JOURNAL_START = 1,  /**< First record of a session, the payload is its label */
+    PS_JOURNAL_OUTPUT = 2, /**< Output of the session */
+    PS_JOURNAL_RESIZE = 3, /**< Terminal size change, the payload is rows and columns */
+    PS_JOURNAL_END = 4,    /**< Last record of a session that ended cleanly */
+} ps_journal_type_t;
+
+/**
+ * @brief Header of a journal record, followed by @c length_ bytes of payload.
+ * @details Stored in host byte order. The checksum covers the header, with @c crc_ taken as
+ * zero, and the payload.
+ */
+typedef struct ps_journal_record_t {
+    uint32_t magic_;    /**< @ref PS_JOURNAL_MAGIC */
+    uint32_t length_;   /**< Length of the payload */
+    uint64_t session_;  /**< Identifier of the session, random */
+    uint64_t seq_;      /**< Number of the record within the session, from 0 */
+    uint64_t time_ns_;  /**< Wall clock time, in nanoseconds since the epoch */
+    uint16_t type_;     /**< One of @ref ps_journal_type_t */
+    uint16_t reserved_; /**< Zero */
+    uint32_t crc_;      /**< CRC-32C of the record */
+} ps_journal_record_t;
+
+/**
+ * @brief Payload of a @ref PS_JOURNAL_RESIZE record.
+ */
+typedef struct ps_journal_resize_t {
+    uint16_t rows_; /**< Number of rows */
+    uint16_t cols_; /**< Number of columns */
+} ps_journal_resize_t;
+
+/** @brief Writing side of a session, opaque. */
+typedef struct ps_journal *ps_journal_t;
+
+/**
+ * @brief Opens a journal for a new session and appends its start record.
+ * @details The journal is created if it does not exist yet.
+ * @param file_name name of the journal.
+ * @param label label of the session, for the readers to tell the sessions apart.
+ * @return The writing side or @c NULL, with @c errno set.
+ */
+ps_journal_t ps_journal_open(const char *file_name, const char *label);
+
+/**
+ * @brief Returns the descriptor of the journal, for the caller to wait for writability.
+ * @param journal the writing side.
+ * @return The descriptor.
+ */
+int ps_journal_fd(ps_journal_t journal);
+
+/**
+ * @brief Returns the identifier of the session.
+ * @param journal the writing side.
+ * @return The identifier.
+ */
+uint64_t ps_journal_session(ps_journal_t journal);
+
+/**
+ * @brief Appends the output a reader has pending, in as many records as it takes.
+ * @param journal the writing side.
+ * @param reader reader of the output.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_journal_write(ps_journal_t journal, yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Appends a terminal size change.
+ * @param journal the writing side.
+ * @param rows number of rows.
+ * @param cols number of columns.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_journal_resize(ps_journal_t journal, unsigned int rows, unsigned int cols);
+
+/**
+ * @brief Appends the end record of the session and closes the journal.
+ * @param journal the writing side, may be @c NULL.
+ */
+void ps_journal_close(ps_journal_t journal);
+
+/**
+ * @brief Position of a reader in a journal mapped into memory.
+ */
+typedef struct ps_journal_cursor_t {
+    const uint8_t *data_; /**< The journal */
+    size_t size_;         /**< Its length */
+    size_t offset_;       /**< Offset of the next record */
+    uint64_t skipped_;    /**< Bytes skipped so far for not being a valid record */
+} ps_journal_cursor_t;
+
+/**
+ * @brief Returns the next valid record of a journal.
+ * @details Bytes that do not start a record with a matching checksum are skipped up to the
+ * next one that does, and counted in @c skipped_. Records start at any offset, the header is
+ * copied out rather than pointed at.
+ * @param cursor the cursor, moved past the record.
+ * @param[out] record header of the record.
+ * @param[out] payload payload of the record, pointing into the journal.
+ * @return 1 if a record was found, 0 at the end of the journal.
+ */
+int ps_journal_next(ps_journal_cursor_t *cursor, ps_journal_record_t *record,
+                    const uint8_t **payload);
+
+/** @} */
+
+#endif /* PS_JOURNAL_H */
@@ -0,0 +1,216 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-latency.c
+ * @brief Low-latency relay implementation file
+ * @details The relay bumps @c waits_ once before it waits for events and once after, whether
+ * it blocks or only polls, so the count is odd while it waits. Each wait is a point where the
+ * relay is back in the kernel; a relay polling under sustained output keeps the count moving.
+ * The watchdog demotes the relay if the count is even and has not moved for a whole period:
+ * the relay is running, and has been all along, without coming back to its loop. A relay
+ * that waits for keystrokes for hours is left alone.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nt-pool.h"
+#include "ps-latency.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/**
+ * @brief State of the low-latency relay.
+ */
+struct ps_latency {
+    uint64_t waits_;             /**< Bumped by the relay before and after it waits */
+    pthread_t relay_;            /**< The relay */
+    pthread_t watchdog_;         /**< The watchdog, if the relay runs under @c SCHED_FIFO */
+    pthread_mutex_t lock_;       /**< Guards @c stop_ and @c demoted_ */
+    pthread_cond_t wake_;        /**< Wakes the watchdog up to stop */
+    int stop_;                   /**< Non-zero once the watchdog should stop */
+    int demoted_;                /**< Non-zero once the watchdog has demoted the relay */
+    ps_latency_config_t config_; /**< The configuration */
+};
+
+int ps_latency_parse(const char *spec, ps_latency_config_t *config) {
+    char *end;
+    long cpu = strtol(spec, &end, 10);
+    if (end == spec || cpu < 0 || cpu >= CPU_SETSIZE) {
+        return -1;
+    }
+    config->cpu_ = (int)cpu;
+    config->priority_ = 0;
+    config->spin_us_ = 0;
+    while (',' == *end) {
+        const char *word = end + 1;
+        if (0 == strncmp(word, "fifo", 4)) {
+            end = (char *)word + 4;
+            config->priority_ = PS_LATENCY_DEFAULT_PRIORITY;
+            if (':' == *end) {
+                long priority = strtol(end + 1, &end, 10);
+                if (priority < sched_get_priority_min(SCHED_FIFO) ||
+                    priority > sched_get_priority_max(SCHED_FIFO)) {
+                    return -1;
+                }
+                config->priority_ = (int)priority;
+            }
+        } else if (0 == strncmp(word, "spin", 4)) {
+            end = (char *)word + 4;
+            config->spin_us_ = PS_LATENCY_DEFAULT_SPIN_US;
+            if (':' == *end) {
+                const char *value = end + 1;
+                config->spin_us_ = strtoul(value, &end, 10);
+                if (end == value) {
+                    return -1;
+                }
+            }
+        } else {
+            return -1;
+        }
+    }
+    return '\0' == *end ? 0 : -1;
+}
+
+int ps_latency_isolate(const ps_latency_config_t *config) {
+    cpu_set_t allowed;
+    if (0 != sched_getaffinity(0, sizeof(allowed), &allowed)) {
+        return errno;
+    }
+    if (!CPU_ISSET(config->cpu_, &allowed)) {
+        return EINVAL;
+    }
+    CPU_CLR(config->cpu_, &allowed);
+    if (0 == CPU_COUNT(&allowed)) {
+        /* Nowhere else to go */
+        return 0;
+    }
+    return 0 == sched_setaffinity(0, sizeof(allowed), &allowed) ? 0 : errno;
+}
+
+/**
+ * @brief Entry point of the watchdog.
+ * @param arg the state of the relay.
+ * @return @c NULL.
+ */
+static void *latency_watchdog(void *arg) {
+    struct ps_latency *latency = arg;
+    uint64_t seen = __atomic_load_n(&latency->waits_, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&latency->lock_);
+    while (!latency->stop_) {
+        struct timespec deadline;
+        uint64_t waits;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += PS_LATENCY_WATCHDOG_MS / 1000;
+        deadline.tv_nsec += (PS_LATENCY_WATCHDOG_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+        if (ETIMEDOUT != pthread_cond_timedwait(&latency->wake_, &latency->lock_, &deadline)) {
+            continue;
+        }
+        waits = __atomic_load_n(&latency->waits_, __ATOMIC_RELAXED);
+        if (waits == seen && 0 == (waits & 1)) {
+            struct sched_param param = {.sched_priority = 0};
+            pthread_setschedparam(latency->relay_, SCHED_OTHER, &param);
+            latency->demoted_ = 1;
+            break;
+        }
+        seen = waits;
+    }
+    pthread_mutex_unlock(&latency->lock_);
+    return NULL;
+}
+
+ps_latency_t ps_latency_start(const ps_latency_config_t *config) {
+    struct ps_latency *latency = nt_pool_zalloc(sizeof(struct ps_latency));
+    pthread_condattr_t attr;
+    cpu_set_t relay_cpu;
+    int result;
+    if (NULL == latency) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    latency->config_ = *config;
+    latency->relay_ = pthread_self();
+    pthread_mutex_init(&latency->lock_, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&latency->wake_, &attr);
+    pthread_condattr_destroy(&attr);
+    CPU_ZERO(&relay_cpu);
+    CPU_SET(config->cpu_, &relay_cpu);
+    /* The watchdog is started before the relay is pinned, so it inherits the mask
+     * ps_latency_isolate() left, without the processor of the relay, not the pinned one */
+    result = 0 == config->priority_
+                 ? 0 : pthread_create(&latency->watchdog_, NULL, latency_watchdog, latency);
+    if (0 != result) {
+        /* No watchdog to stop */
+        latency->config_.priority_ = 0;
+    } else {
+        result = pthread_setaffinity_np(latency->relay_, sizeof(relay_cpu), &relay_cpu);
+    }
+    if (0 == result && 0 != config->priority_) {
+        struct sched_param param = {.sched_priority = config->priority_};
+        result = pthread_setschedparam(latency->relay_, SCHED_FIFO, &param);
+    }
+    if (0 != result) {
+        ps_latency_stop(latency);
+        errno = result;
+        return NULL;
+    }
+    return latency;
+}
+
+void ps_latency_wait_begin(ps_latency_t latency) {
+    if (NULL != latency) {
+        __atomic_store_n(&latency->waits_, latency->waits_ + 1, __ATOMIC_RELAXED);
+    }
+}
+
+void ps_latency_wait_end(ps_latency_t latency) {
+    if (NULL != latency) {
+        __atomic_store_n(&latency->waits_, latency->waits_ + 1, __ATOMIC_RELAXED);
+    }
+}
+
+int ps_latency_stop(ps_latency_t latency) {
+    int demoted;
+    if (NULL == latency) {
+        return 0;
+    }
+    if (0 != latency->config_.priority_) {
+        struct sched_param param = {.sched_priority = 0};
+        pthread_mutex_lock(&latency->lock_);
+        latency->stop_ = 1;
+        pthread_cond_signal(&latency->wake_);
+        pthread_mutex_unlock(&latency->lock_);
+        pthread_join(latency->watchdog_, NULL);
+        pthread_setschedparam(latency->relay_, SCHED_OTHER, &param);
+    }
+    demoted = latency->demoted_;
+    pthread_cond_destroy(&latency->wake_);
+    pthread_mutex_destroy(&latency->lock_);
+    nt_pool_free(latency);
+    return demoted;
+}
+
+/** @} */
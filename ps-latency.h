@@ -0,0 +1,100 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-latency.h
+ * @brief Low-latency relay header file
+ * @details Keeps the relay loop, which carries every keystroke to the child and every echo
+ * back, from competing for a processor with anything else in the session. The relay is
+ * pinned to a processor of its own, the child and the other threads of the session run on
+ * the remaining ones. Optionally, the relay runs under @c SCHED_FIFO, so that nothing time
+ * shared preempts it; a watchdog thread demotes it back to time sharing should it ever run
+ * for @ref PS_LATENCY_WATCHDOG_MS without going back to its wait. Optionally as well, once
+ * it has relayed something, the relay polls for a short while before it blocks again, which
+ * saves the wake-up of the next keystroke of a burst.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_LATENCY_H
+#define PS_LATENCY_H
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief @c SCHED_FIFO priority of the relay unless given. */
+#define PS_LATENCY_DEFAULT_PRIORITY (10)
+
+/** @brief How long the relay polls before it blocks unless given, in microseconds. */
+#define PS_LATENCY_DEFAULT_SPIN_US (50)
+
+/** @brief Longest the relay may run under @c SCHED_FIFO without waiting, in milliseconds. */
+#define PS_LATENCY_WATCHDOG_MS (500)
+
+/**
+ * @brief Configuration of the low-latency relay.
+ */
+typedef struct ps_latency_config_t {
+    int cpu_;                /**< Processor the relay is pinned to, -1 for a normal relay */
+    int priority_;           /**< @c SCHED_FIFO priority of the relay, 0 for time sharing */
+    unsigned long spin_us_;  /**< How long the relay polls before it blocks, 0 not to */
+} ps_latency_config_t;
+
+/** @brief State of the low-latency relay, opaque. */
+typedef struct ps_latency *ps_latency_t;
+
+/**
+ * @brief Parses a low-latency relay specification.
+ * @details The specification reads <tt>cpu[,fifo[:priority]][,spin[:us]]</tt>.
+ * @param spec the specification.
+ * @param[out] config the configuration.
+ * @return 0 on success, -1 if the specification is malformed.
+ */
+int ps_latency_parse(const char *spec, ps_latency_config_t *config);
+
+/**
+ * @brief Moves the calling thread off the processor of the relay.
+ * @details Called before the child and the threads of the session are started, which
+ * inherit it. On a machine with that processor alone, nothing is moved.
+ * @param config the configuration.
+ * @return 0 on success, @c errno value otherwise; @c EINVAL if the processor of the relay is
+ * not one the process may run on.
+ */
+int ps_latency_isolate(const ps_latency_config_t *config);
+
+/**
+ * @brief Turns the calling thread into the low-latency relay.
+ * @details Pins it, and raises it to @c SCHED_FIFO under a watchdog if so configured.
+ * @param config the configuration.
+ * @return The state of the relay or @c NULL, with @c errno set.
+ */
+ps_latency_t ps_latency_start(const ps_latency_config_t *config);
+
+/**
+ * @brief Tells the watchdog that the relay is about to wait for events, or to poll them.
+ * @param latency the state of the relay, may be @c NULL.
+ */
+void ps_latency_wait_begin(ps_latency_t latency);
+
+/**
+ * @brief Tells the watchdog that the relay is running again.
+ * @param latency the state of the relay, may be @c NULL.
+ */
+void ps_latency_wait_end(ps_latency_t latency);
+
+/**
+ * @brief Returns the relay to time sharing and stops the watchdog.
+ * @param latency the state of the relay, may be @c NULL.
+ * @return Non-zero if the watchdog had to demote the relay.
+ */
+int ps_latency_stop(ps_latency_t latency);
+
+/** @} */
+
+#endif /* PS_LATENCY_H */
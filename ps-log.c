@@ -0,0 +1,450 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-log.c
+ * @brief Session log implementation file
+ * @details Commits are grouped: the relay only publishes how far it has written, and the
+ * commit thread syncs everything written so far with a single @c fdatasync(), then records
+ * the committed length in the metadata header. @n
+ * Writes with @c O_DIRECT are synchronous, the relay does wait for those; they are meant for
+ * hosts where the page cache is the scarcer resource. @n
+ * Block checksums are extended over the data as it goes to the file: by the bytes a buffered
+ * write took, or as the data is copied into the staging buffer.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "compiler-defs.h"
+#include "nt-pool.h"
+#include "ps-log.h"
+#include "ps-sum.h"
+#include "yandu_log.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Default commit period of @ref PS_LOG_SYNC_INTERVAL. */
+#define DEFAULT_SYNC_INTERVAL_MS (1000)
+
+/** @brief Default commit threshold of @ref PS_LOG_SYNC_BYTES. */
+#define DEFAULT_SYNC_BYTES (1UL << 20)
+
+/** @brief Size of the first preallocated extent, the next ones double up to the configured one. */
+#define FIRST_EXTENT (64UL << 10)
+
+/** @brief Largest number of pieces of data written at once. */
+#define LOG_IOV_MAX (64)
+
+/** @brief @c mkstemp() template of generated log names. */
+#define DEFAULT_FILE_NAME "log_XXXXXX"
+
+/**
+ * @brief Alignment of @c O_DIRECT buffers, offsets and lengths.
+ * @details The page size, which satisfies devices with both 512 and 4096 byte sectors.
+ */
+#define DIRECT_ALIGN (4096UL)
+
+/**
+ * @brief Size of the @c O_DIRECT staging buffer.
+ * @details A power of two, so the slab pool hands it out aligned to its size.
+ */
+#define DIRECT_STAGE_SIZE (1UL << 20)
+
+/**
+ * @brief Session log.
+ */
+struct ps_log {
+    ps_log_config_t config_;  /**< Configuration */
+    int fd_;                  /**< Log file descriptor */
+    char *name_;              /**< Log file name */
+    ps_meta_t meta_;          /**< Metadata stream */
+    ps_sum_t sum_;            /**< Block checksums */
+    uint64_t written_;        /**< Bytes in the file, published to the commit thread */
+    uint64_t allocated_;      /**< End of the space preallocated for the file */
+    uint8_t *stage_;          /**< @c O_DIRECT staging buffer, @c NULL for buffered writes */
+    size_t stage_fill_;       /**< Bytes in @c stage_, they go to the file at @c written_ */
+    uint64_t signalled_;      /**< Value of @c written_ when the commit thread was last woken */
+    pthread_t thread_;        /**< Commit thread */
+    int thread_running_;      /**< Non-zero if @c thread_ was started */
+    pthread_mutex_t lock_;    /**< Guards @c stop_, @c commit_ and the condition variable */
+    pthread_cond_t wake_;     /**< Wakes the commit thread up */
+    int stop_;                /**< Asks the commit thread to finish */
+    int commit_;              /**< Asks the commit thread to commit */
+};
+
+int ps_log_parse_size(const char *spec, unsigned long *size) {
+    char *end;
+    unsigned long value = strtoul(spec, &end, 10);
+    if (end == spec) {
+        return -1;
+    }
+    if ('k' == *end || 'K' == *end) {
+        value <<= 10;
+        ++end;
+    } else if ('m' == *end || 'M' == *end) {
+        value <<= 20;
+        ++end;
+    }
+    if ('\0' != *end || 0 == value) {
+        return -1;
+    }
+    *size = value;
+    return 0;
+}
+
+int ps_log_parse_durability(const char *spec, ps_log_config_t *config) {
+    const char *arg = strchr(spec, ':');
+    size_t len = NULL != arg ? (size_t)(arg - spec) : strlen(spec);
+    unsigned long value = 0;
+    if (NULL != arg && 0 != ps_log_parse_size(arg + 1, &value)) {
+        return -1;
+    }
+    if (4 == len && 0 == strncmp(spec, "none", len) && NULL == arg) {
+        config->durability_ = PS_LOG_SYNC_NONE;
+    } else if (8 == len && 0 == strncmp(spec, "interval", len)) {
+        config->durability_ = PS_LOG_SYNC_INTERVAL;
+        config->sync_interval_ms_ = NULL != arg ? value : DEFAULT_SYNC_INTERVAL_MS;
+    } else if (5 == len && 0 == strncmp(spec, "bytes", len)) {
+        config->durability_ = PS_LOG_SYNC_BYTES;
+        config->sync_bytes_ = NULL != arg ? value : DEFAULT_SYNC_BYTES;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Commit thread.
+ * @details Sleeps until asked to commit, by the relay once enough new data piled up or by the
+ * owner of the log once the commit period is over, then syncs whatever has been written by
+ * then. A final commit is made by @ref ps_log_close() once the thread is gone.
+ */
+static void *commit_thread(void *arg) {
+    struct ps_log *log = arg;
+    uint64_t committed = 0;
+    pthread_mutex_lock(&log->lock_);
+    while (!log->stop_) {
+        /* Asked while busy syncing, it goes again right away */
+        while (!log->stop_ && !log->commit_) {
+            pthread_cond_wait(&log->wake_, &log->lock_);
+        }
+        log->commit_ = 0;
+        uint64_t written = __atomic_load_n(&log->written_, __ATOMIC_ACQUIRE);
+        if (log->stop_ || written == committed) {
+            continue;
+        }
+        pthread_mutex_unlock(&log->lock_);
+        if (0 == fdatasync(log->fd_) && 0 == ps_sum_sync(log->sum_) &&
+            0 == ps_meta_commit(log->meta_, written)) {
+            committed = written;
+        } else {
+            LOG_DEBUG("%d %s", errno, strerror(errno));
+        }
+        pthread_mutex_lock(&log->lock_);
+    }
+    pthread_mutex_unlock(&log->lock_);
+    return NULL;
+}
+
+/**
+ * @brief Creates the log file.
+ * @param log the log, with the name buffer allocated.
+ * @param flags extra flags to open the file with.
+ * @return The descriptor or -1.
+ */
+static int log_create(struct ps_log *log, int flags) {
+    if (NULL != log->config_.file_name_) {
+        strcpy(log->name_, log->config_.file_name_);
+        return open(log->name_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | flags, 0600);
+    }
+    if (NULL != log->config_.dir_) {
+        sprintf(log->name_, "%s/%s", log->config_.dir_, DEFAULT_FILE_NAME);
+    } else {
+        strcpy(log->name_, DEFAULT_FILE_NAME);
+    }
+    return mkostemp(log->name_, O_CLOEXEC | flags);
+}
+
+/**
+ * @brief Makes sure the file has space preallocated up to a given offset.
+ * @details Space is reserved with @c FALLOC_FL_KEEP_SIZE, so the file size keeps telling how
+ * much of the log has been written. Filesystems without @c fallocate() just go without.
+ * @param log the log.
+ * @param end the offset.
+ */
+static void log_reserve(struct ps_log *log, uint64_t end) {
+    while (0 != log->config_.prealloc_ && end > log->allocated_) {
+        uint64_t extent = log->allocated_ > FIRST_EXTENT ? log->allocated_ : FIRST_EXTENT;
+        if (extent > log->config_.prealloc_) {
+            extent = log->config_.prealloc_;
+        }
+        if (0 != fallocate(log->fd_, FALLOC_FL_KEEP_SIZE, (off_t)log->allocated_,
+                           (off_t)extent)) {
+            LOG_DEBUG("%d %s", errno, strerror(errno));
+            log->config_.prealloc_ = 0;
+            return;
+        }
+        log->allocated_ += extent;
+    }
+}
+
+/**
+ * @brief Publishes new data in the file to the commit thread.
+ * @param log the log.
+ * @param written new length of the file.
+ */
+static void log_advance(struct ps_log *log, uint64_t written) {
+    __atomic_store_n(&log->written_, written, __ATOMIC_RELEASE);
+    if (PS_LOG_SYNC_BYTES == log->config_.durability_ &&
+        written - log->signalled_ >= log->config_.sync_bytes_) {
+        log->signalled_ = written;
+        ps_log_commit(log);
+    }
+}
+
+/**
+ * @brief Writes to the log file at an offset, again if interrupted.
+ * @param log the log.
+ * @param data the data.
+ * @param len its length.
+ * @param offset offset in the file.
+ * @return Number of bytes written, -1 with @c errno set on error.
+ */
+static ssize_t log_pwrite(struct ps_log *log, const void *data, size_t len, uint64_t offset) {
+    ssize_t result;
+    do {
+        result = pwrite(log->fd_, data, len, (off_t)offset);
+    } while (-1 == result && EINTR == errno);
+    return result;
+}
+
+/**
+ * @brief Switches the log file descriptor to buffered writes.
+ * @param log the log.
+ */
+static void log_clear_direct(struct ps_log *log) {
+    int flags = fcntl(log->fd_, F_GETFL);
+    if (flags >= 0) {
+        fcntl(log->fd_, F_SETFL, flags & ~O_DIRECT);
+    }
+}
+
+ps_log_t ps_log_open(const ps_log_config_t *config) {
+    size_t len = NULL != config->file_name_
+                     ? strlen(config->file_name_) + 1
+                     : (NULL != config->dir_ ? strlen(config->dir_) + 1 : 0) +
+                           sizeof(DEFAULT_FILE_NAME);
+    struct ps_log *log = nt_pool_zalloc(sizeof(struct ps_log));
+    if (NULL == log) {
+        return NULL;
+    }
+    log->config_ = *config;
+    log->fd_ = -1;
+    log->name_ = nt_pool_alloc(len);
+    if (NULL == log->name_) {
+        ps_log_close(log);
+        return NULL;
+    }
+    log->fd_ = log_create(log, config->direct_ ? O_DIRECT : 0);
+    if (log->fd_ < 0 && config->direct_ && EINVAL == errno) {
+        LOG_DEBUG("%s: O_DIRECT not supported", log->name_);
+        log->config_.direct_ = 0;
+        log->fd_ = log_create(log, 0);
+    }
+    if (log->fd_ < 0) {
+        ps_log_close(log);
+        return NULL;
+    }
+    if (log->config_.direct_) {
+        log->stage_ = nt_budget_alloc(config->budget_, DIRECT_STAGE_SIZE);
+        if (NULL == log->stage_ || 0 != ((uintptr_t)log->stage_ & (DIRECT_ALIGN - 1))) {
+            LOG_DEBUG("%p: staging buffer not aligned", log->stage_);
+            log_clear_direct(log);
+            nt_budget_free(config->budget_, log->stage_);
+            log->stage_ = NULL;
+        }
+    }
+    log_reserve(log, 1);
+    log->sum_ = ps_sum_open(log->name_);
+    if (NULL == log->sum_) {
+        ps_log_close(log);
+        return NULL;
+    }
+    log->meta_ = ps_meta_open(log->name_, config->durability_, config->budget_);
+    if (NULL == log->meta_) {
+        ps_log_close(log);
+        return NULL;
+    }
+    pthread_mutex_init(&log->lock_, NULL);
+    pthread_cond_init(&log->wake_, NULL);
+    if (PS_LOG_SYNC_NONE != config->durability_) {
+        if (0 != pthread_create(&log->thread_, NULL, commit_thread, log)) {
+            ps_log_close(log);
+            return NULL;
+        }
+        log->thread_running_ = 1;
+    }
+    return log;
+}
+
+int ps_log_fd(ps_log_t log) { return log->fd_; }
+
+const char *ps_log_name(ps_log_t log) { return log->name_; }
+
+ps_meta_t ps_log_meta(ps_log_t log) { return log->meta_; }
+
+uint64_t ps_log_written(ps_log_t log) { return log->written_; }
+
+/**
+ * @brief @c O_DIRECT flavour of @ref ps_log_write().
+ * @details Moves as much pending data as fits into the staging buffer, then writes out
+ * the whole blocks it holds and keeps the partial one for later.
+ */
+static int log_write_direct(struct ps_log *log, yanzc_chain_reader_t *reader) {
+    struct iovec iov[16];
+    int n_iov = io_chain_reader_get_iov(reader, iov, ARRAY_SIZE(iov));
+    unsigned long copied = 0;
+    size_t aligned;
+    ssize_t result;
+    int idx;
+    for (idx = 0; idx < n_iov && log->stage_fill_ < DIRECT_STAGE_SIZE; ++idx) {
+        size_t len = iov[idx].iov_len;
+        if (len > DIRECT_STAGE_SIZE - log->stage_fill_) {
+            len = DIRECT_STAGE_SIZE - log->stage_fill_;
+        }
+        memcpy(log->stage_ + log->stage_fill_, iov[idx].iov_base, len);
+        ps_sum_update(log->sum_, iov[idx].iov_base, len);
+        log->stage_fill_ += len;
+        copied += len;
+    }
+    io_chain_reader_advance(reader, copied);
+    aligned = log->stage_fill_ & ~(DIRECT_ALIGN - 1);
+    if (0 == aligned) {
+        return 0;
+    }
+    log_reserve(log, log->written_ + aligned);
+    result = log_pwrite(log, log->stage_, aligned, log->written_);
+    if (result < 0) {
+        return errno;
+    }
+    aligned = (size_t)result & ~(DIRECT_ALIGN - 1);
+    memmove(log->stage_, log->stage_ + aligned, log->stage_fill_ - aligned);
+    log->stage_fill_ -= aligned;
+    log_advance(log, log->written_ + aligned);
+    return 0;
+}
+
+int ps_log_write(ps_log_t log, yanzc_chain_reader_t *reader) {
+    struct iovec iov[LOG_IOV_MAX];
+    int n_iov, idx;
+    ssize_t result;
+    size_t left;
+    if (NULL != log->stage_) {
+        return log_write_direct(log, reader);
+    }
+    log_reserve(log, log->written_ + io_chain_reader_pending(reader));
+    n_iov = io_chain_reader_get_iov(reader, iov, LOG_IOV_MAX);
+    if (n_iov <= 0) {
+        return 0;
+    }
+    do {
+        result = writev(log->fd_, iov, n_iov);
+    } while (-1 == result && EINTR == errno);
+    if (-1 == result) {
+        return EAGAIN == errno ? 0 : errno;
+    }
+    /* Only the bytes the file took are checksummed */
+    for (idx = 0, left = (size_t)result; left > 0; ++idx) {
+        size_t len = iov[idx].iov_len < left ? iov[idx].iov_len : left;
+        ps_sum_update(log->sum_, iov[idx].iov_base, len);
+        left -= len;
+    }
+    io_chain_reader_advance(reader, (unsigned long)result);
+    log_advance(log, log->written_ + (uint64_t)result);
+    return 0;
+}
+
+void ps_log_commit(ps_log_t log) {
+    if (log->thread_running_) {
+        pthread_mutex_lock(&log->lock_);
+        log->commit_ = 1;
+        pthread_cond_signal(&log->wake_);
+        pthread_mutex_unlock(&log->lock_);
+    }
+}
+
+int ps_log_close(ps_log_t log) {
+    int result = 0;
+    if (NULL == log) {
+        return 0;
+    }
+    if (log->thread_running_) {
+        pthread_mutex_lock(&log->lock_);
+        log->stop_ = 1;
+        pthread_cond_signal(&log->wake_);
+        pthread_mutex_unlock(&log->lock_);
+        pthread_join(log->thread_, NULL);
+    }
+    if (log->fd_ >= 0) {
+        if (NULL != log->stage_) {
+            size_t done = 0;
+            /* The partial block at the end cannot be written with O_DIRECT */
+            log_clear_direct(log);
+            while (0 == result && done < log->stage_fill_) {
+                ssize_t written = log_pwrite(log, log->stage_ + done, log->stage_fill_ - done,
+                                             log->written_ + done);
+                if (written <= 0) {
+                    result = written < 0 ? errno : EIO;
+                } else {
+                    done += (size_t)written;
+                }
+            }
+            if (0 == result) {
+                log->written_ += log->stage_fill_;
+            }
+        }
+        if (log->allocated_ > log->written_) {
+            if (0 != ftruncate(log->fd_, (off_t)log->written_)) {
+                LOG_DEBUG("%d %s", errno, strerror(errno));
+            }
+        }
+        if (0 != fsync(log->fd_) && 0 == result) {
+            result = errno;
+        }
+        if (0 != result) {
+            LOG_DEBUG("%s: %d %s", log->name_, result, strerror(result));
+        }
+        ps_sum_close(log->sum_);
+        /* A log whose end did not make it to the disk is not closed cleanly */
+        ps_meta_close(log->meta_, log->written_, 0 == result);
+        close(log->fd_);
+    }
+    if (NULL != log->meta_) {
+        pthread_mutex_destroy(&log->lock_);
+        pthread_cond_destroy(&log->wake_);
+    }
+    nt_budget_free(log->config_.budget_, log->stage_);
+    nt_pool_free(log->name_);
+    nt_pool_free(log);
+    return result;
+}
+
+/** @} */
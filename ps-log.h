@@ -0,0 +1,159 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-log.h
+ * @brief Session log header file
+ * @details The session log owns the log file and its metadata stream. It writes the child's
+ * output to the log and, depending on the configured durability, commits it to stable
+ * storage from a background thread, so the relay never waits for the disk. @n
+ * The file grows in preallocated extents, which keeps it in few fragments and saves the
+ * filesystem a metadata update on most writes. Extents start small and double up to the
+ * configured size, so that a short session does not pay for a large one when it starts. @n
+ * With @c direct_ set, the log bypasses the page cache: output is staged in an aligned buffer
+ * from the slab pool and written with @c O_DIRECT in whole blocks, so a host recording many
+ * sessions does not evict everything else from memory. @n
+ * Every block of the log gets a checksum in a companion file, see ps-sum.h.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_LOG_H
+#define PS_LOG_H
+
+#include <stdint.h>
+
+#include "ps-meta.h"
+#include "yanzc_chain.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/**
+ * @brief How hard the log tries to survive a crash.
+ */
+typedef enum ps_log_durability_t {
+    PS_LOG_SYNC_NONE = 0,     /**< Synced only when the session ends */
+    PS_LOG_SYNC_INTERVAL = 1, /**< Synced every @c sync_interval_ms_, see ps_log_commit() */
+    PS_LOG_SYNC_BYTES = 2,    /**< Synced whenever @c sync_bytes_ new bytes have piled up */
+} ps_log_durability_t;
+
+/** @brief Default size of a preallocated extent of the log file. */
+#define PS_LOG_DEFAULT_PREALLOC (8UL << 20)
+
+/**
+ * @brief Session log configuration.
+ */
+typedef struct ps_log_config_t {
+    ps_log_durability_t durability_; /**< Durability mode */
+    unsigned long sync_interval_ms_; /**< Commit period for @ref PS_LOG_SYNC_INTERVAL */
+    unsigned long sync_bytes_;       /**< Commit threshold for @ref PS_LOG_SYNC_BYTES */
+    const char *dir_;                /**< Directory of generated log names, @c NULL for cwd */
+    const char *file_name_;          /**< Log file name, @c NULL to generate a unique one */
+    unsigned long prealloc_;         /**< Size of the largest preallocated extent, 0 to disable */
+    int direct_;                     /**< Non-zero to write with @c O_DIRECT */
+    nt_budget_t *budget_;            /**< Memory budget the buffers are charged to, or @c NULL */
+} ps_log_config_t;
+
+/**
+ * @brief A handle of an open session log.
+ */
+typedef struct ps_log *ps_log_t;
+
+/**
+ * @brief Parses a durability specification.
+ * @details Accepted forms are @c none, @c interval[:milliseconds] and @c bytes[:count], where
+ * count may have a @c k or @c m suffix.
+ * @param spec the specification.
+ * @param[in,out] config configuration to update.
+ * @return 0 on success, -1 if the specification is malformed.
+ */
+int ps_log_parse_durability(const char *spec, ps_log_config_t *config);
+
+/**
+ * @brief Parses a size with an optional @c k or @c m suffix.
+ * @param spec the size.
+ * @param[out] size the parsed value.
+ * @return 0 on success, -1 if the size is malformed or zero.
+ */
+int ps_log_parse_size(const char *spec, unsigned long *size);
+
+/**
+ * @brief Creates a log file, its metadata stream, and starts the commit thread if needed.
+ * @details Without @c file_name_ the log is given a unique @c log_XXXXXX name in @c dir_.
+ * An explicitly named log is truncated if it exists, like @c script(1) does. If the
+ * filesystem refuses @c O_DIRECT, the log falls back to buffered writes.
+ * @param config the configuration.
+ * @return The log or @c NULL, with @c errno set.
+ * @sa ps_log_close()
+ */
+ps_log_t ps_log_open(const ps_log_config_t *config);
+
+/**
+ * @brief Returns the descriptor of the log file.
+ * @param log the log.
+ * @return The descriptor.
+ */
+int ps_log_fd(ps_log_t log);
+
+/**
+ * @brief Returns the name of the log file.
+ * @param log the log.
+ * @return The name.
+ */
+const char *ps_log_name(ps_log_t log);
+
+/**
+ * @brief Returns the metadata stream of the log.
+ * @param log the log.
+ * @return The metadata stream.
+ */
+ps_meta_t ps_log_meta(ps_log_t log);
+
+/**
+ * @brief Writes data pending for a reader to the log.
+ * @details Never waits for a commit; in @ref PS_LOG_SYNC_BYTES mode it only wakes the commit
+ * thread up once enough data has been written. @n
+ * With @c O_DIRECT, data is consumed from the reader into the staging buffer and only whole
+ * blocks reach the file; the partial block at the end is written by @ref ps_log_close().
+ * @param log the log.
+ * @param reader the reader.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_log_write(ps_log_t log, yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Has the commit thread commit whatever has been written so far.
+ * @details Never waits for the commit. In @ref PS_LOG_SYNC_INTERVAL mode, the owner of the
+ * log keeps the period and calls this once it is over, so that an idle log wakes nothing up;
+ * the relay does it from its timer wheel. Does nothing without a commit thread.
+ * @param log the log.
+ */
+void ps_log_commit(ps_log_t log);
+
+/**
+ * @brief Returns the number of bytes written to the log file so far.
+ * @param log the log.
+ * @return Number of bytes.
+ */
+uint64_t ps_log_written(ps_log_t log);
+
+/**
+ * @brief Stops the commit thread, syncs the log, marks it as cleanly closed and closes it.
+ * @details Preallocated space past the end of the log is given back to the filesystem. A log
+ * whose end fails to be written or synced is closed all the same, but not marked as cleanly
+ * closed: recovery cuts it to the length committed last.
+ * @param log the log, may be @c NULL.
+ * @return 0 on success, @c errno value if the end of the log may be missing.
+ */
+int ps_log_close(ps_log_t log);
+
+/** @} */
+
+#endif /* PS_LOG_H */
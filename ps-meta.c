@@ -0,0 +1,210 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-meta.c
+ * @brief Session metadata stream implementation file
+ * @details Records are queued in a chain and written out by the relay loop whenever the
+ * metadata file is writable, so recording an event never stalls the relay.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ps-meta.h"
+#include "nt-pool.h"
+#include "yanzc_chain.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Size of a single segment of the record queue. */
+#define META_SEGMENT_SIZE (4096)
+
+/** @brief Maximal number of segments of the record queue. */
+#define META_SEGMENTS (16)
+
+/**
+ * @brief Metadata stream.
+ */
+struct ps_meta {
+    int fd_;                       /**< Metadata file descriptor */
+    yanzc_chain_t *queue_;         /**< Records not written yet */
+    yanzc_chain_reader_t reader_;  /**< Writes the queue to @c fd_ */
+    ps_meta_record_t header_;      /**< Header record, rewritten on every commit */
+};
+
+/**
+ * @brief Builds the metadata file name of a log.
+ * @param log_file_name name of the log file.
+ * @return The name, allocated from the pool, or @c NULL.
+ */
+static char *meta_name(const char *log_file_name) {
+    size_t len = strlen(log_file_name);
+    char *name = nt_pool_alloc(len + sizeof(PS_META_SUFFIX));
+    if (NULL != name) {
+        memcpy(name, log_file_name, len);
+        memcpy(name + len, PS_META_SUFFIX, sizeof(PS_META_SUFFIX));
+    }
+    return name;
+}
+
+uint64_t ps_meta_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static int meta_queue(ps_meta_t meta, const ps_meta_record_t *record) {
+    /* Partial records would corrupt the file, so a record either fits entirely or is dropped */
+    if (io_chain_get_size_for_writes(meta->queue_) < sizeof(*record)) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    io_chain_append(meta->queue_, record, sizeof(*record));
+    return 0;
+}
+
+ps_meta_t ps_meta_open(const char *log_file_name, uint32_t durability, nt_budget_t *budget) {
+    char *name = meta_name(log_file_name);
+    struct ps_meta *meta = nt_pool_zalloc(sizeof(struct ps_meta));
+    ps_meta_record_t header = {0};
+    if (NULL == name || NULL == meta) {
+        goto fail;
+    }
+    meta->fd_ = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (meta->fd_ < 0) {
+        goto fail;
+    }
+    header.type_ = PS_META_HEADER;
+    header.arg_ = PS_META_MAGIC;
+    header.time_ns_ = ps_meta_now();
+    header.arg1_ = PS_META_VERSION;
+    header.arg2_ = durability;
+    meta->header_ = header;
+    /* The header is written right away, as the commit thread may rewrite it in place
+     * before the queue is flushed for the first time. It is written from a copy on the stack:
+     * with LTO, GCC takes &meta->header_ for its first member and warns of an overread */
+    meta->queue_ = io_chain_new_charged(META_SEGMENT_SIZE, META_SEGMENTS, budget);
+    if (NULL == meta->queue_ || sizeof(header) != write(meta->fd_, &header, sizeof(header))) {
+        io_chain_free(meta->queue_);
+        close(meta->fd_);
+        goto fail;
+    }
+    io_chain_reader_attach(meta->queue_, &meta->reader_);
+    nt_pool_free(name);
+    return meta;
+fail:
+    nt_pool_free(name);
+    nt_pool_free(meta);
+    return NULL;
+}
+
+int ps_meta_append(ps_meta_t meta, ps_meta_type_t type, uint64_t offset, uint32_t arg1,
+                   uint32_t arg2) {
+    ps_meta_record_t record = {.type_ = type,
+                               .arg_ = 0,
+                               .time_ns_ = ps_meta_now(),
+                               .offset_ = offset,
+                               .arg1_ = arg1,
+                               .arg2_ = arg2};
+    return meta_queue(meta, &record);
+}
+
+int ps_meta_fd(ps_meta_t meta) { return meta->fd_; }
+
+unsigned long ps_meta_pending(ps_meta_t meta) { return io_chain_reader_pending(&meta->reader_); }
+
+int ps_meta_flush(ps_meta_t meta) { return from_chain_to_fd(&meta->reader_, meta->fd_); }
+
+int ps_meta_commit(ps_meta_t meta, uint64_t committed) {
+    meta->header_.offset_ = committed;
+    if (sizeof(meta->header_) != pwrite(meta->fd_, &meta->header_, sizeof(meta->header_), 0)) {
+        return -1;
+    }
+    return fdatasync(meta->fd_);
+}
+
+void ps_meta_close(ps_meta_t meta, uint64_t log_length, int clean) {
+    if (NULL != meta) {
+        if (clean) {
+            ps_meta_append(meta, PS_META_FOOTER, log_length, 0, 0);
+        }
+        while (ps_meta_pending(meta) > 0 && 0 == ps_meta_flush(meta)) {
+        }
+        if (clean) {
+            ps_meta_commit(meta, log_length);
+        }
+        close(meta->fd_);
+        io_chain_reader_detach(&meta->reader_);
+        io_chain_free(meta->queue_);
+        nt_pool_free(meta);
+    }
+}
+
+int ps_meta_check(const char *log_file_name, ps_meta_check_t *check) {
+    ps_meta_record_t header, last;
+    struct stat log_stat, meta_stat;
+    char *name = meta_name(log_file_name);
+    int fd = NULL != name ? open(name, O_RDONLY | O_CLOEXEC) : -1;
+    int result = -1;
+    nt_pool_free(name);
+    if (fd < 0) {
+        return -1;
+    }
+    if (0 == stat(log_file_name, &log_stat) && 0 == fstat(fd, &meta_stat) &&
+        sizeof(header) == pread(fd, &header, sizeof(header), 0) &&
+        PS_META_HEADER == header.type_ && PS_META_MAGIC == header.arg_) {
+        off_t last_offset = (meta_stat.st_size / sizeof(last) - 1) * sizeof(last);
+        check->durability_ = header.arg2_;
+        check->committed_ = header.offset_;
+        check->log_size_ = log_stat.st_size;
+        check->meta_size_ = meta_stat.st_size;
+        check->clean_ = sizeof(last) == pread(fd, &last, sizeof(last), last_offset) &&
+                        PS_META_FOOTER == last.type_ && 0 == meta_stat.st_size % sizeof(last) &&
+                        last.offset_ == (uint64_t)log_stat.st_size;
+        result = 0;
+    } else {
+        errno = EINVAL;
+    }
+    close(fd);
+    return result;
+}
+
+int ps_meta_truncate_tail(const char *log_file_name, const ps_meta_check_t *check) {
+    int truncated = 0;
+    uint64_t meta_size = check->meta_size_ - check->meta_size_ % sizeof(ps_meta_record_t);
+    if (check->clean_ || 0 == check->durability_) {
+        return 0;
+    }
+    if (check->log_size_ > check->committed_) {
+        if (0 != truncate(log_file_name, (off_t)check->committed_)) {
+            return -1;
+        }
+        truncated = 1;
+    }
+    if (meta_size != check->meta_size_) {
+        char *name = meta_name(log_file_name);
+        int result = NULL != name ? truncate(name, (off_t)meta_size) : -1;
+        nt_pool_free(name);
+        if (0 != result) {
+            return -1;
+        }
+        truncated = 1;
+    }
+    return truncated;
+}
+
+/** @} */
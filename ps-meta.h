@@ -0,0 +1,190 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-meta.h
+ * @brief Session metadata stream header file
+ * @details The log file of a session holds the raw output of the child, byte for byte, so
+ * it can still be read with @c cat or @c grep. Everything else known about the session
+ * (when it started, when the terminal was resized, ...) goes to a companion file, named
+ * after the log with a @c .meta suffix, as a sequence of fixed-size records.
+ * Each record carries the log offset it applies to, so a player can act on it at the
+ * right byte.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_META_H
+#define PS_META_H
+
+#include <stdint.h>
+
+#include "nt-budget.h"
+
+/**
+ * @defgroup SessionLogModule Session log
+ * @brief Everything that ends up on disk about a recorded session.
+ */
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Suffix appended to the log file name to get the metadata file name. */
+#define PS_META_SUFFIX ".meta"
+
+/** @brief Value of @c arg_ in the header record, "PSM1" in little endian. */
+#define PS_META_MAGIC (0x314d5350U)
+
+/** @brief Version of the record layout. */
+#define PS_META_VERSION (1)
+
+/**
+ * @brief Kinds of metadata records.
+ */
+typedef enum ps_meta_type_t {
+    PS_META_HEADER = 1, /**< First record of the file, @c arg_ is @ref PS_META_MAGIC */
+    PS_META_RESIZE = 2, /**< Terminal size change, @c arg1_ rows, @c arg2_ columns */
+    PS_META_FOOTER = 3, /**< Last record of a cleanly closed log, @c offset_ is its length */
+    PS_META_OUTPUT = 4, /**< Output read from the child, @c offset_ is where it starts */
+    PS_META_MEMORY = 5, /**< Memory held by the session, @c arg1_ now and @c arg2_ at most, KiB */
+} ps_meta_type_t;
+
+/**
+ * @brief Least time between two output records, in nanoseconds.
+ * @details Output read sooner than that after an output record shares its time, so that
+ * a burst of output does not produce a record per read.
+ */
+#define PS_META_OUTPUT_NS (1000000ULL)
+
+/**
+ * @brief A single metadata record.
+ * @details Records are 32 bytes long and stored in host byte order, so the n-th record
+ * is found without parsing the ones before it. @n
+ * The header record is rewritten in place each time the log is committed to stable storage:
+ * its @c offset_ holds the length of the log known to be on disk and its @c arg2_ holds the
+ * durability mode. A log whose metadata does not end with a footer record was not closed
+ * cleanly, anything past the committed length may be torn.
+ */
+typedef struct ps_meta_record_t {
+    uint32_t type_;    /**< One of @ref ps_meta_type_t */
+    uint32_t arg_;     /**< Type dependent */
+    uint64_t time_ns_; /**< Wall clock time, in nanoseconds since the epoch */
+    uint64_t offset_;  /**< Log offset the record applies to */
+    uint32_t arg1_;    /**< Type dependent */
+    uint32_t arg2_;    /**< Type dependent */
+} ps_meta_record_t;
+
+/**
+ * @brief A handle of an open metadata stream.
+ */
+typedef struct ps_meta *ps_meta_t;
+
+/**
+ * @brief Returns the current wall clock time in nanoseconds.
+ * @return Nanoseconds since the epoch.
+ */
+uint64_t ps_meta_now(void);
+
+/**
+ * @brief Result of checking a log against its metadata.
+ */
+typedef struct ps_meta_check_t {
+    int clean_;           /**< Non-zero if the metadata ends with a footer record */
+    uint32_t durability_; /**< Durability mode the log was written with */
+    uint64_t committed_;  /**< Length of the log known to be on stable storage */
+    uint64_t log_size_;   /**< Actual length of the log */
+    uint64_t meta_size_;  /**< Actual length of the metadata file */
+} ps_meta_check_t;
+
+/**
+ * @brief Creates the metadata file for a log and writes its header record.
+ * @param log_file_name name of the log file the metadata describes.
+ * @param durability durability mode of the log, stored in the header.
+ * @param budget memory budget the queue of records is charged to, may be @c NULL.
+ * @return The stream or @c NULL, with @c errno set.
+ * @sa ps_meta_close()
+ */
+ps_meta_t ps_meta_open(const char *log_file_name, uint32_t durability, nt_budget_t *budget);
+
+/**
+ * @brief Queues a record.
+ * @details The record is only copied into memory, the caller flushes it with
+ * @ref ps_meta_flush() when the descriptor is writable. This never blocks.
+ * @param meta the stream.
+ * @param type record type.
+ * @param offset log offset the record applies to.
+ * @param arg1 type dependent.
+ * @param arg2 type dependent.
+ * @return 0 on success, -1 if the record was dropped because the queue is full.
+ */
+int ps_meta_append(ps_meta_t meta, ps_meta_type_t type, uint64_t offset, uint32_t arg1,
+                   uint32_t arg2);
+
+/**
+ * @brief Returns the descriptor of the metadata file.
+ * @param meta the stream.
+ * @return The descriptor.
+ */
+int ps_meta_fd(ps_meta_t meta);
+
+/**
+ * @brief Returns the number of queued bytes.
+ * @param meta the stream.
+ * @return Number of bytes waiting for @ref ps_meta_flush().
+ */
+unsigned long ps_meta_pending(ps_meta_t meta);
+
+/**
+ * @brief Writes queued records out.
+ * @param meta the stream.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_meta_flush(ps_meta_t meta);
+
+/**
+ * @brief Records that the log is on stable storage up to a given length.
+ * @details Rewrites the header record in place and syncs the metadata file. Only touches
+ * the header, so it may be called from a thread other than the one queueing records.
+ * @param meta the stream.
+ * @param committed length of the log already synced.
+ * @return 0 on success, -1 otherwise.
+ */
+int ps_meta_commit(ps_meta_t meta, uint64_t committed);
+
+/**
+ * @brief Appends the footer record, commits, and closes the metadata file.
+ * @details A log that did not make it to stable storage whole gets neither, the records
+ * queued are written and the header keeps the length committed last.
+ * @param meta the stream, may be @c NULL.
+ * @param log_length final length of the log, already synced by the caller.
+ * @param clean non-zero if the log is whole on stable storage.
+ */
+void ps_meta_close(ps_meta_t meta, uint64_t log_length, int clean);
+
+/**
+ * @brief Checks whether a log was closed cleanly.
+ * @param log_file_name name of the log file.
+ * @param[out] check the result.
+ * @return 0 on success, -1 if the log or its metadata cannot be read or is not valid.
+ */
+int ps_meta_check(const char *log_file_name, ps_meta_check_t *check);
+
+/**
+ * @brief Truncates the torn tail of a log that was not closed cleanly.
+ * @details The log is cut to its committed length and the metadata to a whole number of
+ * records. Logs that were closed cleanly, or written without durability, are left alone.
+ * @param log_file_name name of the log file.
+ * @param check result of @ref ps_meta_check() for that log.
+ * @return 1 if something was truncated, 0 if not, -1 on error.
+ */
+int ps_meta_truncate_tail(const char *log_file_name, const ps_meta_check_t *check);
+
+/** @} */
+
+#endif /* PS_META_H */
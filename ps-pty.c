@@ -0,0 +1,117 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-pty.c
+ * @brief Pseudo terminals implementation file
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined __linux__
+#include <pty.h>
+#include <utmp.h>
+#elif defined __FreeBSD__
+#include <libutil.h>
+#endif
+
+#include "ps-pty.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+int ps_pty_open(ps_pty_t *pty, const struct winsize *win_size) {
+    int result = 0;
+    pty->pid_ = 0;
+    if (0 != openpty(&pty->master_, &pty->slave_, NULL, NULL, (struct winsize *)win_size)) {
+        pty->master_ = pty->slave_ = -1;
+        return errno;
+    }
+    if (-1 == fcntl(pty->master_, F_SETFD, FD_CLOEXEC) ||
+        -1 == fcntl(pty->slave_, F_SETFD, FD_CLOEXEC)) {
+        result = errno;
+    } else {
+        result = ptsname_r(pty->master_, pty->name_, sizeof(pty->name_));
+    }
+    if (0 != result) {
+        ps_pty_close(pty);
+    }
+    return result;
+}
+
+int ps_pty_spawn(ps_pty_t *pty, char *const argv[], char *const envp[], const sigset_t *sigmask) {
+#if defined POSIX_SPAWN_SETSID
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    int result;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setsigmask(&attributes, sigmask);
+    /* Opened by name by the leader of the new session, it becomes its controlling terminal */
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, pty->name_, O_RDWR, 0);
+    posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDERR_FILENO);
+    result = posix_spawnp(&pty->pid_, argv[0], &actions, &attributes, argv, envp);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    if (0 != result) {
+        pty->pid_ = 0;
+        return result;
+    }
+#else
+    pid_t cpid = fork();
+    if (-1 == cpid) {
+        return errno;
+    }
+    if (0 == cpid) {
+        /* In the child process */
+        close(pty->master_);
+        if (0 != login_tty(pty->slave_)) {
+            _exit(EXIT_FAILURE);
+        }
+        sigprocmask(SIG_SETMASK, sigmask, NULL);
+        environ = (char **)envp;
+        execvp(argv[0], argv);
+        _exit(EXIT_FAILURE);
+    }
+    pty->pid_ = cpid;
+#endif
+    close(pty->slave_);
+    pty->slave_ = -1;
+    return 0;
+}
+
+void ps_pty_close(ps_pty_t *pty) {
+    if (-1 != pty->slave_) {
+        close(pty->slave_);
+        pty->slave_ = -1;
+    }
+    if (-1 != pty->master_) {
+        close(pty->master_);
+        pty->master_ = -1;
+    }
+    if (0 != pty->pid_) {
+        kill(pty->pid_, SIGKILL);
+        while (-1 == waitpid(pty->pid_, NULL, 0) && EINTR == errno) {
+        }
+        pty->pid_ = 0;
+    }
+}
+
+/** @} */
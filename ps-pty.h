@@ -0,0 +1,74 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-pty.h
+ * @brief Pseudo terminals header file
+ * @details Opens pseudo terminals and starts children on them, as leaders of new sessions
+ * whose controlling terminal the pseudo terminal is.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_PTY_H
+#define PS_PTY_H
+
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Longest name of the slave part, null terminator included. */
+#define PS_PTY_NAME_MAX (64)
+
+/**
+ * @brief A pseudo terminal and the child started on it.
+ */
+typedef struct ps_pty_t {
+    int master_;                 /**< Master part, -1 if not opened */
+    int slave_;                  /**< Slave part, kept open until a child is started on it */
+    pid_t pid_;                  /**< Child started on it, 0 if none */
+    char name_[PS_PTY_NAME_MAX]; /**< Name of the slave part */
+} ps_pty_t;
+
+/**
+ * @brief Opens a pseudo terminal.
+ * @details Both parts are closed on exec.
+ * @param[out] pty the pseudo terminal, no child started on it.
+ * @param win_size its size.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_pty_open(ps_pty_t *pty, const struct winsize *win_size);
+
+/**
+ * @brief Starts a child on a pseudo terminal.
+ * @details The child leads a new session, has the slave part as its controlling terminal,
+ * standard input, output and error. Where @c posix_spawn() can start a new session, the
+ * child comes from it, which glibc implements with <tt>clone(CLONE_VM | CLONE_VFORK)</tt>:
+ * unlike @c fork() it does not copy the page tables of the caller. Elsewhere, it comes from
+ * @c fork() and @c login_tty(). The slave part is closed in the caller once the child runs.
+ * @param[in,out] pty the pseudo terminal, opened with no child on it.
+ * @param argv the command and its arguments, looked for in @c PATH.
+ * @param envp environment of the child.
+ * @param sigmask signal mask of the child.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_pty_spawn(ps_pty_t *pty, char *const argv[], char *const envp[], const sigset_t *sigmask);
+
+/**
+ * @brief Closes a pseudo terminal and kills the child on it, if any, and waits for it.
+ * @param pty the pseudo terminal.
+ */
+void ps_pty_close(ps_pty_t *pty);
+
+/** @} */
+
+#endif /* PS_PTY_H */
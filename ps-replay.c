@@ -0,0 +1,599 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-replay.c
+ * @brief Replay server implementation file
+ * @details Clients live in an array, the poll set mirrors it one slot off, the listening
+ * socket taking the first slot. A client leaving is replaced by the last one, so clients are
+ * gone through from the last to the first. @n
+ * A client has output released up to the start of the first output record not due yet; its
+ * timer fires when that one is due. Logs are found again by device and inode, the clients of
+ * a log still being written see it grow whenever a new client asks for it.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nt-pool.h"
+#include "nt-timerwheel.h"
+#include "ps-meta.h"
+#include "ps-replay.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Length of a tick of the timer wheel of the server, in nanoseconds. */
+#define REPLAY_TICK_NS (1000000ULL)
+
+/** @brief Most bytes sent to a client in one go, for the other clients not to wait. */
+#define REPLAY_SEND_MAX (256UL << 10)
+
+/** @brief Longest request line. */
+#define REPLAY_REQUEST_MAX (PATH_MAX + 64)
+
+/** @brief Longest status line. */
+#define REPLAY_STATUS_MAX (32)
+
+/** @brief Most bytes moved at once by the client. */
+#define REPLAY_COPY_MAX (1UL << 20)
+
+/**
+ * @brief A log served, shared by all its clients.
+ */
+struct replay_recording_t {
+    struct replay_recording_t *next_; /**< Next log served */
+    dev_t dev_;                       /**< Device of the log */
+    ino_t ino_;                       /**< Inode of the log */
+    int fd_;                          /**< The log */
+    int meta_fd_;                     /**< Its metadata, -1 without */
+    uint64_t size_;                   /**< Length of the log when last looked at */
+    const ps_meta_record_t *records_; /**< The metadata, mapped, @c NULL without */
+    size_t map_size_;                 /**< Length of the mapping */
+    size_t count_;                    /**< Number of records */
+    unsigned int refs_;               /**< Number of clients */
+};
+
+/**
+ * @brief A client.
+ */
+struct replay_client_t {
+    int fd_;                                /**< Connection of the client */
+    struct replay_server_t *server_;        /**< The server */
+    struct replay_recording_t *recording_;  /**< Log served, @c NULL until requested */
+    off_t offset_;                          /**< Next byte of the log to send */
+    uint64_t limit_;                        /**< End of the output released so far */
+    uint64_t bulk_;                         /**< End of the output sent at once */
+    size_t record_;                         /**< Next output record to release */
+    uint64_t base_ns_;                      /**< Session time the pacing starts at */
+    uint64_t start_ns_;                     /**< Server time it started at */
+    unsigned int speed_milli_;              /**< Speed, in thousandths of the recorded pace */
+    nt_timer_t timer_;                      /**< Fires once the next record is due */
+    size_t request_len_;                    /**< Length of the request read so far */
+    char request_[REPLAY_REQUEST_MAX];      /**< The request */
+};
+
+/**
+ * @brief State of a server.
+ */
+struct replay_server_t {
+    const ps_replay_config_t *config_;        /**< Its configuration */
+    int root_fd_;                             /**< Directory served */
+    int listen_fd_;                           /**< Socket clients connect to */
+    struct sockaddr_un address_;              /**< Its address */
+    struct replay_recording_t *recordings_;   /**< Logs served */
+    struct replay_client_t **clients_;        /**< Clients, @c n_clients_ of them */
+    struct pollfd *poll_;                     /**< Poll set, the listening socket first */
+    unsigned int n_clients_;                  /**< Number of clients */
+    nt_timerwheel_t timers_;                  /**< Pacing of the clients */
+    ps_replay_stats_t stats_;                 /**< What the server did */
+};
+
+/**
+ * @brief Returns the time on the clock of the timer wheel.
+ * @return Nanoseconds of @c CLOCK_MONOTONIC.
+ */
+static uint64_t replay_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Looks at a log again: its length and its metadata, mapped anew if it grew.
+ * @details Clients hold record numbers, not pointers, a new mapping does not bother them.
+ * Metadata without a valid header is ignored, the log is then sent at once.
+ * @param recording the log.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int replay_refresh(struct replay_recording_t *recording) {
+    struct stat file_stat;
+    void *map;
+    if (0 != fstat(recording->fd_, &file_stat)) {
+        return errno;
+    }
+    recording->size_ = (uint64_t)file_stat.st_size;
+    if (recording->meta_fd_ < 0 || 0 != fstat(recording->meta_fd_, &file_stat) ||
+        (size_t)file_stat.st_size / sizeof(ps_meta_record_t) * sizeof(ps_meta_record_t) <=
+            recording->map_size_) {
+        return 0;
+    }
+    map = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, recording->meta_fd_, 0);
+    if (MAP_FAILED == map) {
+        return 0;
+    }
+    if (PS_META_HEADER != ((const ps_meta_record_t *)map)->type_ ||
+        PS_META_MAGIC != ((const ps_meta_record_t *)map)->arg_) {
+        munmap(map, (size_t)file_stat.st_size);
+        return 0;
+    }
+    if (NULL != recording->records_) {
+        munmap((void *)recording->records_, recording->map_size_);
+    }
+    recording->records_ = map;
+    recording->map_size_ = (size_t)file_stat.st_size;
+    recording->count_ = recording->map_size_ / sizeof(ps_meta_record_t);
+    return 0;
+}
+
+/**
+ * @brief Closes a log once it has no clients left.
+ */
+static void replay_release(struct replay_server_t *server, struct replay_recording_t *recording) {
+    struct replay_recording_t **link = &server->recordings_;
+    if (NULL == recording || 0 != --recording->refs_) {
+        return;
+    }
+    while (*link != recording) {
+        link = &(*link)->next_;
+    }
+    *link = recording->next_;
+    if (NULL != recording->records_) {
+        munmap((void *)recording->records_, recording->map_size_);
+    }
+    if (recording->meta_fd_ >= 0) {
+        close(recording->meta_fd_);
+    }
+    close(recording->fd_);
+    nt_pool_free(recording);
+}
+
+/**
+ * @brief Opens a log for a client, or finds it open already.
+ * @param server the server.
+ * @param name name of the log, relative to the directory served.
+ * @param[out] error @c errno value on error.
+ * @return The log, @c NULL on error.
+ */
+static struct replay_recording_t *replay_open(struct replay_server_t *server, const char *name,
+                                              int *error) {
+    char meta_name[REPLAY_REQUEST_MAX + sizeof(PS_META_SUFFIX)];
+    struct replay_recording_t *recording;
+    struct stat file_stat;
+    int fd;
+    if ('\0' == name[0] || '/' == name[0] || NULL != strstr(name, "..")) {
+        *error = EACCES;
+        return NULL;
+    }
+    fd = openat(server->root_fd_, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || 0 != fstat(fd, &file_stat) || !S_ISREG(file_stat.st_mode)) {
+        *error = fd < 0 ? errno : EINVAL;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    for (recording = server->recordings_; NULL != recording; recording = recording->next_) {
+        if (file_stat.st_dev == recording->dev_ && file_stat.st_ino == recording->ino_) {
+            close(fd);
+            ++recording->refs_;
+            replay_refresh(recording);
+            return recording;
+        }
+    }
+    recording = nt_pool_zalloc(sizeof(struct replay_recording_t));
+    if (NULL == recording) {
+        close(fd);
+        *error = ENOMEM;
+        return NULL;
+    }
+    snprintf(meta_name, sizeof(meta_name), "%s%s", name, PS_META_SUFFIX);
+    recording->fd_ = fd;
+    recording->meta_fd_ = openat(server->root_fd_, meta_name, O_RDONLY | O_CLOEXEC);
+    recording->dev_ = file_stat.st_dev;
+    recording->ino_ = file_stat.st_ino;
+    recording->refs_ = 1;
+    *error = replay_refresh(recording);
+    recording->next_ = server->recordings_;
+    server->recordings_ = recording;
+    if (0 != *error) {
+        replay_release(server, recording);
+        return NULL;
+    }
+    /* Logs are read front to back, whoever reads them */
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    ++server->stats_.recordings_;
+    return recording;
+}
+
+/**
+ * @brief Releases the output of a client up to the start of its next record.
+ */
+static void replay_limit(struct replay_client_t *client) {
+    const struct replay_recording_t *recording = client->recording_;
+    client->limit_ = client->record_ < recording->count_
+                         ? recording->records_[client->record_].offset_
+                         : recording->size_;
+    if (client->limit_ > recording->size_) {
+        client->limit_ = recording->size_;
+    }
+}
+
+/**
+ * @brief Releases the output of a client that is due and arms its timer for the next.
+ * @param context the client.
+ */
+static void replay_due(void *context) {
+    struct replay_client_t *client = context;
+    const struct replay_recording_t *recording = client->recording_;
+    uint64_t session_ns =
+        client->base_ns_ + (replay_now() - client->start_ns_) * client->speed_milli_ / 1000;
+    while (client->record_ < recording->count_ &&
+           (PS_META_OUTPUT != recording->records_[client->record_].type_ ||
+            recording->records_[client->record_].time_ns_ <= session_ns)) {
+        ++client->record_;
+    }
+    replay_limit(client);
+    if (client->record_ < recording->count_) {
+        uint64_t ahead = recording->records_[client->record_].time_ns_ - client->base_ns_;
+        nt_timer_arm(&client->server_->timers_, &client->timer_,
+                     client->start_ns_ + ahead * 1000 / client->speed_milli_);
+    }
+}
+
+/**
+ * @brief Tells whether a client has got all of its log.
+ */
+static int replay_over(const struct replay_client_t *client) {
+    return NULL != client->recording_ && (uint64_t)client->offset_ >= client->recording_->size_ &&
+           client->record_ >= client->recording_->count_;
+}
+
+/**
+ * @brief Sends the status line of an answer.
+ * @details The socket buffer of a new connection is empty, the line fits.
+ * @return 0 on success, -1 otherwise.
+ */
+static int replay_status(struct replay_client_t *client, int error) {
+    char line[REPLAY_STATUS_MAX];
+    int len = snprintf(line, sizeof(line), "%s %d\n", PS_REPLAY_MAGIC, error);
+    return len == send(client->fd_, line, (size_t)len, MSG_DONTWAIT | MSG_NOSIGNAL) ? 0 : -1;
+}
+
+/**
+ * @brief Starts serving a client once its request is in.
+ * @details The output before the time asked for is released right away, then the client is
+ * paced from the first output record after it on.
+ * @return 0 on success, -1 if the client is to be closed.
+ */
+static int replay_start(struct replay_client_t *client) {
+    struct replay_server_t *server = client->server_;
+    const struct replay_recording_t *recording;
+    unsigned long long from_ms;
+    int name_at = 0, error = EINVAL;
+    client->request_[client->request_len_] = '\0';
+    if (2 != sscanf(client->request_, "%llu %u %n", &from_ms, &client->speed_milli_, &name_at) ||
+        0 == name_at || NULL == (client->recording_ = replay_open(server, client->request_ +
+                                                                              name_at, &error))) {
+        ++server->stats_.refused_;
+        replay_status(client, error);
+        return -1;
+    }
+    ++server->stats_.clients_;
+    recording = client->recording_;
+    if (0 != replay_status(client, 0)) {
+        return -1;
+    }
+    if (0 == client->speed_milli_ || 0 == recording->count_) {
+        client->record_ = recording->count_;
+    } else {
+        client->base_ns_ = recording->records_[0].time_ns_ + from_ms * 1000000ULL;
+        client->start_ns_ = replay_now();
+        client->record_ = 1;
+    }
+    client->timer_ = (nt_timer_t){.fire_ = replay_due, .context_ = client};
+    if (client->record_ < recording->count_) {
+        replay_due(client);
+    } else {
+        replay_limit(client);
+    }
+    client->bulk_ = client->limit_;
+    return 0;
+}
+
+/**
+ * @brief Reads the request of a client.
+ * @return 0 on success, -1 if the client is to be closed.
+ */
+static int replay_read(struct replay_client_t *client) {
+    ssize_t result = recv(client->fd_, client->request_ + client->request_len_,
+                          sizeof(client->request_) - 1 - client->request_len_, MSG_DONTWAIT);
+    char *line_end;
+    if (result <= 0) {
+        return result < 0 && (EAGAIN == errno || EINTR == errno) ? 0 : -1;
+    }
+    line_end = memchr(client->request_ + client->request_len_, '\n', (size_t)result);
+    client->request_len_ += (size_t)result;
+    if (NULL != line_end) {
+        client->request_len_ = (size_t)(line_end - client->request_);
+        return replay_start(client);
+    }
+    if (client->request_len_ == sizeof(client->request_) - 1) {
+        ++client->server_->stats_.refused_;
+        replay_status(client, ENAMETOOLONG);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sends a client the output released to it, from the page cache.
+ * @return 0 on success, -1 if the client is to be closed.
+ */
+static int replay_send(struct replay_client_t *client) {
+    ps_replay_stats_t *stats = &client->server_->stats_;
+    uint64_t start = (uint64_t)client->offset_;
+    size_t len = client->limit_ - start < REPLAY_SEND_MAX ? (size_t)(client->limit_ - start)
+                                                          : REPLAY_SEND_MAX;
+    ssize_t result = sendfile(client->fd_, client->recording_->fd_, &client->offset_, len);
+    if (result <= 0) {
+        return result < 0 && (EAGAIN == errno || EINTR == errno) ? 0 : -1;
+    }
+    if (start < client->bulk_) {
+        uint64_t bulk = client->bulk_ - start < (uint64_t)result ? client->bulk_ - start
+                                                                 : (uint64_t)result;
+        stats->bulk_ += bulk;
+        stats->paced_ += (uint64_t)result - bulk;
+    } else {
+        stats->paced_ += (uint64_t)result;
+    }
+    return 0;
+}
+
+/**
+ * @brief Closes a client, the last one taking its place.
+ */
+static void replay_close(struct replay_server_t *server, unsigned int idx) {
+    struct replay_client_t *client = server->clients_[idx];
+    nt_timer_cancel(&server->timers_, &client->timer_);
+    replay_release(server, client->recording_);
+    close(client->fd_);
+    nt_pool_free(client);
+    server->clients_[idx] = server->clients_[--server->n_clients_];
+}
+
+/**
+ * @brief Accepts the clients waiting, as many as there is room for.
+ */
+static void replay_accept(struct replay_server_t *server) {
+    while (server->n_clients_ < server->config_->max_clients_) {
+        struct replay_client_t *client;
+        int fd = accept4(server->listen_fd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        client = nt_pool_zalloc(sizeof(struct replay_client_t));
+        if (NULL == client) {
+            close(fd);
+            return;
+        }
+        client->fd_ = fd;
+        client->server_ = server;
+        server->clients_[server->n_clients_++] = client;
+    }
+}
+
+/**
+ * @brief Waits for the clients and serves them until told to stop.
+ * @return 0 once stopped, @c errno value on error.
+ */
+static int replay_loop(struct replay_server_t *server, volatile sig_atomic_t *stop) {
+    while (0 == *stop) {
+        uint64_t now = replay_now(), next = nt_timerwheel_next(&server->timers_);
+        struct timespec timeout = {0, 0};
+        unsigned int idx;
+        int result;
+        server->poll_[0] = (struct pollfd){
+            .fd = server->listen_fd_,
+            .events = server->n_clients_ < server->config_->max_clients_ ? POLLIN : 0};
+        for (idx = 0; idx < server->n_clients_; ++idx) {
+            const struct replay_client_t *client = server->clients_[idx];
+            short events = NULL == client->recording_ ? POLLIN
+                           : (uint64_t)client->offset_ < client->limit_ ? POLLOUT
+                                                                        : 0;
+            server->poll_[idx + 1] = (struct pollfd){.fd = client->fd_, .events = events};
+        }
+        if (NT_TIMERWHEEL_NEVER != next && next > now) {
+            timeout.tv_sec = (time_t)((next - now) / 1000000000ULL);
+            timeout.tv_nsec = (long)((next - now) % 1000000000ULL);
+        }
+        result = ppoll(server->poll_, server->n_clients_ + 1,
+                       NT_TIMERWHEEL_NEVER != next ? &timeout : NULL, server->config_->sigmask_);
+        if (result < 0 && EINTR != errno) {
+            return errno;
+        }
+        nt_timerwheel_run(&server->timers_, replay_now());
+        for (idx = server->n_clients_; result > 0 && idx-- > 0;) {
+            struct replay_client_t *client = server->clients_[idx];
+            short revents = server->poll_[idx + 1].revents;
+            int keep = 0;
+            if (0 == revents) {
+                keep = 1;
+            } else if (NULL == client->recording_) {
+                keep = 0 == replay_read(client);
+            } else if (0 != (revents & POLLOUT)) {
+                keep = 0 == replay_send(client);
+            }
+            if (!keep || replay_over(client)) {
+                replay_close(server, idx);
+            }
+        }
+        /* Clients done while not waiting for anything, their last record released late */
+        for (idx = server->n_clients_; idx-- > 0;) {
+            if (replay_over(server->clients_[idx])) {
+                replay_close(server, idx);
+            }
+        }
+        if (result > 0 && 0 != (server->poll_[0].revents & POLLIN)) {
+            replay_accept(server);
+        }
+    }
+    return 0;
+}
+
+int ps_replay_serve(const ps_replay_config_t *config, volatile sig_atomic_t *stop,
+                    ps_replay_stats_t *stats) {
+    struct replay_server_t server = {.config_ = config, .root_fd_ = -1, .listen_fd_ = -1};
+    int len, result = 0;
+    nt_timerwheel_init(&server.timers_, REPLAY_TICK_NS, replay_now());
+    server.clients_ = nt_pool_zalloc(sizeof(struct replay_client_t *) * config->max_clients_);
+    server.poll_ = nt_pool_zalloc(sizeof(struct pollfd) * (config->max_clients_ + 1));
+    server.address_.sun_family = AF_UNIX;
+    len = snprintf(server.address_.sun_path, sizeof(server.address_.sun_path), "%s",
+                   config->socket_name_);
+    if (NULL == server.clients_ || NULL == server.poll_ || 0 == config->max_clients_) {
+        result = NULL == server.clients_ || NULL == server.poll_ ? ENOMEM : EINVAL;
+        goto done;
+    }
+    if (len < 0 || (size_t)len >= sizeof(server.address_.sun_path)) {
+        result = ENAMETOOLONG;
+        goto done;
+    }
+    server.root_fd_ = open(config->root_, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    server.listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server.root_fd_ < 0 || server.listen_fd_ < 0) {
+        result = errno;
+        goto done;
+    }
+    /* A socket left behind by an earlier server is stale */
+    unlink(server.address_.sun_path);
+    if (0 != bind(server.listen_fd_, (const struct sockaddr *)&server.address_,
+                  sizeof(server.address_)) ||
+        0 != chmod(server.address_.sun_path, 0600) || 0 != listen(server.listen_fd_, 64)) {
+        result = errno;
+        goto done;
+    }
+    result = replay_loop(&server, stop);
+    unlink(server.address_.sun_path);
+done:
+    while (server.n_clients_ > 0) {
+        replay_close(&server, server.n_clients_ - 1);
+    }
+    if (server.listen_fd_ >= 0) {
+        close(server.listen_fd_);
+    }
+    if (server.root_fd_ >= 0) {
+        close(server.root_fd_);
+    }
+    nt_pool_free(server.poll_);
+    nt_pool_free(server.clients_);
+    if (NULL != stats) {
+        *stats = server.stats_;
+    }
+    return result;
+}
+
+/**
+ * @brief Moves everything a socket receives to a descriptor.
+ * @details Spliced without a copy when the descriptor is a pipe, read and written otherwise.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int replay_copy(int socket_fd, int fd) {
+    static char buf[64 << 10];
+    ssize_t result;
+    while ((result = splice(socket_fd, NULL, fd, NULL, REPLAY_COPY_MAX, SPLICE_F_MOVE)) > 0) {
+    }
+    if (0 == result) {
+        return 0;
+    }
+    if (EINVAL != errno) {
+        return errno;
+    }
+    while ((result = read(socket_fd, buf, sizeof(buf))) > 0) {
+        const char *data = buf;
+        while (result > 0) {
+            ssize_t written = write(fd, data, (size_t)result);
+            if (written < 0) {
+                if (EINTR == errno) {
+                    continue;
+                }
+                return errno;
+            }
+            data += written;
+            result -= written;
+        }
+    }
+    return result < 0 ? errno : 0;
+}
+
+int ps_replay_request(const char *socket_name, const char *log_name, uint64_t from_ms,
+                      unsigned int speed_milli, int fd) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    char request[REPLAY_REQUEST_MAX], status[REPLAY_STATUS_MAX];
+    int len, socket_fd, error = EPROTO;
+    size_t status_len = 0;
+    len = snprintf(request, sizeof(request), "%llu %u %s\n", (unsigned long long)from_ms,
+                   speed_milli, log_name);
+    if (len < 0 || (size_t)len >= sizeof(request) ||
+        (size_t)snprintf(address.sun_path, sizeof(address.sun_path), "%s", socket_name) >=
+            sizeof(address.sun_path)) {
+        return ENAMETOOLONG;
+    }
+    socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_fd < 0) {
+        return errno;
+    }
+    if (0 != connect(socket_fd, (const struct sockaddr *)&address, sizeof(address)) ||
+        len != send(socket_fd, request, (size_t)len, MSG_NOSIGNAL)) {
+        error = errno;
+        close(socket_fd);
+        return error;
+    }
+    /* The status line is read byte by byte, not to read any output along with it */
+    while (status_len < sizeof(status) - 1 && 1 == read(socket_fd, &status[status_len], 1) &&
+           '\n' != status[status_len]) {
+        ++status_len;
+    }
+    status[status_len] = '\0';
+    if (0 != strncmp(status, PS_REPLAY_MAGIC " ", sizeof(PS_REPLAY_MAGIC)) ||
+        1 != sscanf(status + sizeof(PS_REPLAY_MAGIC), "%d", &error)) {
+        error = EPROTO;
+    } else if (0 == error) {
+        error = replay_copy(socket_fd, fd);
+    }
+    close(socket_fd);
+    return error;
+}
+
+/** @} */
@@ -0,0 +1,98 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-replay.h
+ * @brief Replay server header file
+ * @details A replay server streams recorded sessions to local clients connecting to a Unix
+ * socket, paced by the output records of the metadata, as fast as the client takes them or
+ * at any multiple of the pace they were recorded at, optionally from some time into the
+ * session on. @n
+ * A client sends a single request line, <tt>from speed name</tt>: the time into the session
+ * to start from, in milliseconds, the speed, in thousandths of the recorded pace, and the name
+ * of the log relative to the directory the server serves. The server answers with a status
+ * line, <tt>PSR1 0</tt> or <tt>PSR1 errno</tt>, followed on success by the output of the
+ * session. Output up to @c from is sent at once, so that the terminal of the client is in the
+ * right state, the rest as it was recorded, all of it at once with a speed of zero. The server
+ * closes the connection once the output is over. @n
+ * The server is a single thread. Clients of the same log share its descriptor and a single
+ * mapping of its metadata, and the output is sent with @c sendfile() straight from the page
+ * cache, so that any number of clients of a session cost about one copy of its log in memory.
+ * Each client is paced by a timer of its own on a timer wheel, which only wakes the server
+ * when some client has output due.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_REPLAY_H
+#define PS_REPLAY_H
+
+#include <signal.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Start of the status line of an answer. */
+#define PS_REPLAY_MAGIC "PSR1"
+
+/** @brief Default number of clients served at once. */
+#define PS_REPLAY_DEFAULT_CLIENTS (256)
+
+/**
+ * @brief Configuration of a replay server.
+ */
+typedef struct ps_replay_config_t {
+    const char *socket_name_;  /**< Socket clients connect to, replaced if it exists */
+    const char *root_;         /**< Directory the logs are looked up in */
+    unsigned int max_clients_; /**< Number of clients served at once, more wait */
+    const sigset_t *sigmask_;  /**< Signal mask while waiting, @c NULL not to change it */
+} ps_replay_config_t;
+
+/**
+ * @brief What a replay server did.
+ */
+typedef struct ps_replay_stats_t {
+    uint64_t clients_;    /**< Clients served */
+    uint64_t refused_;    /**< Requests refused */
+    uint64_t recordings_; /**< Logs opened, each shared by the clients of a session */
+    uint64_t bulk_;       /**< Bytes sent at once */
+    uint64_t paced_;      /**< Bytes sent as they were recorded */
+} ps_replay_stats_t;
+
+/**
+ * @brief Runs a replay server until told to stop.
+ * @details Names going out of the directory served, absolute ones and those holding @c ..,
+ * are refused. Clients going away while being sent output raise @c SIGPIPE, which the caller
+ * ignores.
+ * @param config configuration of the server.
+ * @param stop set to non-zero, from a signal handler say, to stop the server; the server
+ * only looks at it after waiting, signals meant to stop it should be unblocked by
+ * @c sigmask_ alone.
+ * @param[out] stats what the server did, may be @c NULL.
+ * @return 0 once stopped, @c errno value if the server could not run.
+ */
+int ps_replay_serve(const ps_replay_config_t *config, volatile sig_atomic_t *stop,
+                    ps_replay_stats_t *stats);
+
+/**
+ * @brief Requests a session from a replay server and writes its output out.
+ * @param socket_name socket of the server.
+ * @param log_name name of the log, relative to the directory served.
+ * @param from_ms time into the session to start from, in milliseconds.
+ * @param speed_milli speed, in thousandths of the recorded pace, 0 for no pacing.
+ * @param fd where to write the output.
+ * @return 0 on success, @c errno value otherwise, that of the server if it refused.
+ */
+int ps_replay_request(const char *socket_name, const char *log_name, uint64_t from_ms,
+                      unsigned int speed_milli, int fd);
+
+/** @} */
+
+#endif /* PS_REPLAY_H */
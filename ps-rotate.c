@@ -0,0 +1,203 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-rotate.c
+ * @brief Log rotation and background sealing implementation file
+ * @details The sealer thread takes segments from a queue guarded by a mutex, oldest first.
+ * A segment is sealed in the order the session closes its parts at the end: the log first,
+ * so that the index reads a complete log back.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "nt-pool.h"
+#include "ps-rotate.h"
+#include "yandu_log.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Niceness of the sealer thread, so it yields to the relay. */
+#define SEAL_NICE (10)
+
+/** @brief Longest item of a rotation specification. */
+#define SPEC_ITEM_MAX (32)
+
+/**
+ * @brief A segment waiting in the queue of the sealer.
+ */
+struct seal_entry {
+    struct seal_entry *next_; /**< Next segment, submitted later */
+    ps_seal_job_t job_;       /**< The segment */
+};
+
+/**
+ * @brief Sealer thread and its queue.
+ */
+struct ps_sealer {
+    pthread_t thread_;         /**< Sealer thread */
+    pthread_mutex_t lock_;     /**< Guards the queue and @c stop_ */
+    pthread_cond_t wake_;      /**< Wakes the sealer thread up */
+    struct seal_entry *head_;  /**< Oldest segment in the queue */
+    struct seal_entry **tail_; /**< Link the next segment goes to */
+    int stop_;                 /**< Asks the sealer thread to finish once the queue is empty */
+};
+
+int ps_rotate_parse(const char *spec, ps_rotate_config_t *config) {
+    config->size_ = 0;
+    config->age_ns_ = 0;
+    while ('\0' != *spec) {
+        const char *comma = strchr(spec, ',');
+        size_t len = NULL != comma ? (size_t)(comma - spec) : strlen(spec);
+        char item[SPEC_ITEM_MAX];
+        if (len >= sizeof(item)) {
+            return -1;
+        }
+        memcpy(item, spec, len);
+        item[len] = '\0';
+        if (0 == strncmp(item, "size:", 5)) {
+            if (0 != ps_log_parse_size(item + 5, &config->size_)) {
+                return -1;
+            }
+        } else if (0 == strncmp(item, "age:", 4)) {
+            char *end;
+            uint64_t seconds = strtoull(item + 4, &end, 10);
+            if ('m' == *end) {
+                seconds *= 60;
+                ++end;
+            } else if ('h' == *end) {
+                seconds *= 3600;
+                ++end;
+            } else if ('s' == *end) {
+                ++end;
+            }
+            if (end == item + 4 || '\0' != *end || 0 == seconds) {
+                return -1;
+            }
+            config->age_ns_ = seconds * 1000000000ULL;
+        } else {
+            return -1;
+        }
+        spec += len + (NULL != comma);
+    }
+    return 0 != config->size_ || 0 != config->age_ns_ ? 0 : -1;
+}
+
+char *ps_rotate_name(const char *first_name, unsigned int segment) {
+    size_t len = strlen(first_name) + 12;
+    char *name = nt_pool_alloc(len);
+    if (NULL != name) {
+        snprintf(name, len, "%s.%u", first_name, segment);
+    }
+    return name;
+}
+
+void ps_seal(const ps_seal_job_t *job) {
+    ps_text_close(job->text_);
+    ps_cast_close(job->cast_);
+    ps_log_close(job->log_);
+    ps_index_close(job->index_);
+    ps_cmd_close(job->cmd_, job->end_);
+}
+
+/**
+ * @brief Sealer thread.
+ * @details Seals segments until asked to stop and none is left.
+ */
+static void *seal_thread(void *arg) {
+    struct ps_sealer *sealer = arg;
+    if (0 != setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), SEAL_NICE)) {
+        LOG_DEBUG("%d %s", errno, strerror(errno));
+    }
+    pthread_mutex_lock(&sealer->lock_);
+    for (;;) {
+        struct seal_entry *entry = sealer->head_;
+        if (NULL == entry) {
+            if (sealer->stop_) {
+                break;
+            }
+            pthread_cond_wait(&sealer->wake_, &sealer->lock_);
+            continue;
+        }
+        sealer->head_ = entry->next_;
+        if (NULL == sealer->head_) {
+            sealer->tail_ = &sealer->head_;
+        }
+        pthread_mutex_unlock(&sealer->lock_);
+        ps_seal(&entry->job_);
+        nt_pool_free(entry);
+        pthread_mutex_lock(&sealer->lock_);
+    }
+    pthread_mutex_unlock(&sealer->lock_);
+    return NULL;
+}
+
+ps_sealer_t ps_sealer_start(void) {
+    struct ps_sealer *sealer = nt_pool_zalloc(sizeof(struct ps_sealer));
+    int result;
+    if (NULL == sealer) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    sealer->tail_ = &sealer->head_;
+    pthread_mutex_init(&sealer->lock_, NULL);
+    pthread_cond_init(&sealer->wake_, NULL);
+    result = pthread_create(&sealer->thread_, NULL, seal_thread, sealer);
+    if (0 != result) {
+        pthread_cond_destroy(&sealer->wake_);
+        pthread_mutex_destroy(&sealer->lock_);
+        nt_pool_free(sealer);
+        errno = result;
+        return NULL;
+    }
+    return sealer;
+}
+
+void ps_sealer_submit(ps_sealer_t sealer, const ps_seal_job_t *job) {
+    struct seal_entry *entry = NULL != sealer ? nt_pool_alloc(sizeof(struct seal_entry)) : NULL;
+    if (NULL == entry) {
+        ps_seal(job);
+        return;
+    }
+    entry->next_ = NULL;
+    entry->job_ = *job;
+    pthread_mutex_lock(&sealer->lock_);
+    *sealer->tail_ = entry;
+    sealer->tail_ = &entry->next_;
+    pthread_cond_signal(&sealer->wake_);
+    pthread_mutex_unlock(&sealer->lock_);
+}
+
+void ps_sealer_stop(ps_sealer_t sealer) {
+    if (NULL == sealer) {
+        return;
+    }
+    pthread_mutex_lock(&sealer->lock_);
+    sealer->stop_ = 1;
+    pthread_cond_signal(&sealer->wake_);
+    pthread_mutex_unlock(&sealer->lock_);
+    pthread_join(sealer->thread_, NULL);
+    pthread_cond_destroy(&sealer->wake_);
+    pthread_mutex_destroy(&sealer->lock_);
+    nt_pool_free(sealer);
+}
+
+/** @} */
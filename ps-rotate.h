@@ -0,0 +1,111 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-rotate.h
+ * @brief Log rotation and background sealing header file
+ * @details A long session may have its log split into segments once a segment reaches a size
+ * or an age. Each segment is a recording of its own: the log, its metadata, command table,
+ * index, plain text copy and asciicast recording, with offsets starting from 0 and names made
+ * from the name of the first segment and the number of the segment, @c log_XXXXXX.1 after
+ * @c log_XXXXXX. The relay switches segments between two writes, once everything read from
+ * the child so far is in the old segment, so that every byte lands in exactly one. @n
+ * What finishing a segment takes, syncing it, writing out what is left of its index and the
+ * footer of its metadata, is done by a sealer thread, so that the relay goes on with the new
+ * segment right away.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_ROTATE_H
+#define PS_ROTATE_H
+
+#include <stdint.h>
+
+#include "ps-cast.h"
+#include "ps-cmd.h"
+#include "ps-index.h"
+#include "ps-log.h"
+#include "ps-text.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/**
+ * @brief When a segment of the log ends.
+ */
+typedef struct ps_rotate_config_t {
+    unsigned long size_; /**< Size of the log a segment ends at, 0 for any */
+    uint64_t age_ns_;    /**< Age a segment ends at, 0 for any */
+} ps_rotate_config_t;
+
+/**
+ * @brief Parses a rotation specification.
+ * @details The specification is a comma separated list of <tt>size:count[k|m]</tt> and
+ * <tt>age:count[s|m|h]</tt>, seconds unless given.
+ * @param spec the specification.
+ * @param[out] config the configuration.
+ * @return 0 on success, -1 if the specification is malformed.
+ */
+int ps_rotate_parse(const char *spec, ps_rotate_config_t *config);
+
+/**
+ * @brief Makes the name of a segment.
+ * @param first_name name of the first segment.
+ * @param segment number of the segment, from 1 for the second one.
+ * @return The name, to be released with @c nt_pool_free(), or @c NULL.
+ */
+char *ps_rotate_name(const char *first_name, unsigned int segment);
+
+/**
+ * @brief A segment to seal, any part of it may be @c NULL.
+ */
+typedef struct ps_seal_job_t {
+    ps_log_t log_;     /**< The log */
+    ps_index_t index_; /**< Its index */
+    ps_text_t text_;   /**< Its plain text copy */
+    ps_cast_t cast_;   /**< Its asciicast recording */
+    ps_cmd_t cmd_;     /**< Its command table */
+    uint64_t end_;     /**< Length of the output in the segment, where the last command ends */
+} ps_seal_job_t;
+
+/** @brief Sealer thread and its queue, opaque. */
+typedef struct ps_sealer *ps_sealer_t;
+
+/**
+ * @brief Seals a segment right away.
+ * @param job the segment.
+ */
+void ps_seal(const ps_seal_job_t *job);
+
+/**
+ * @brief Starts a sealer thread.
+ * @details It runs at a lower priority than the relay.
+ * @return The sealer or @c NULL, with @c errno set.
+ */
+ps_sealer_t ps_sealer_start(void);
+
+/**
+ * @brief Has a segment sealed in the background.
+ * @details Segments are sealed in the order they are submitted. Without a sealer, or memory to
+ * queue the segment, it is sealed right away.
+ * @param sealer the sealer, may be @c NULL.
+ * @param job the segment, copied.
+ */
+void ps_sealer_submit(ps_sealer_t sealer, const ps_seal_job_t *job);
+
+/**
+ * @brief Seals the segments still queued and stops the sealer thread.
+ * @param sealer the sealer, may be @c NULL.
+ */
+void ps_sealer_stop(ps_sealer_t sealer);
+
+/** @} */
+
+#endif /* PS_ROTATE_H */
@@ -0,0 +1,452 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-sum.c
+ * @brief Log block checksums implementation file
+ * @details The verifier reads the logs with @c pread() rather than mapping them, so that a
+ * block the disk cannot read is reported as bad instead of killing the process. A task reads
+ * its blocks a few at a time; should such a read fail, it falls back to a block at a time to
+ * tell the unreadable blocks from the others. Each block has a flag of its own, set by the
+ * task checking it, and the flags are turned into ranges once all tasks are done.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nt-crc32c.h"
+#include "nt-pool.h"
+#include "nt-tasks.h"
+#include "ps-sum.h"
+#include "yandu_log.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Number of blocks checked by a single verification task. */
+#define VERIFY_TASK_BLOCKS (256)
+
+/** @brief Number of blocks a verification task reads at once. */
+#define VERIFY_READ_BLOCKS (16)
+
+/**
+ * @brief Checksums of a log being written.
+ */
+struct ps_sum {
+    int fd_;          /**< Checksum file descriptor */
+    uint32_t crc_;    /**< Checksum of the block so far */
+    uint32_t fill_;   /**< Bytes of the block so far */
+    uint64_t blocks_; /**< Whole blocks checksummed */
+};
+
+/**
+ * @brief A log being verified.
+ */
+struct verify_log_t {
+    int fd_;              /**< The log */
+    uint32_t *sums_;      /**< Its checksums */
+    uint8_t *bad_;        /**< Non-zero for each block that failed */
+    uint64_t n_blocks_;   /**< Number of checksums */
+    uint64_t n_checked_;  /**< Number of leading blocks the log has whole, to be read */
+    uint64_t covered_;    /**< Bytes covered by checksums */
+    uint32_t first_task_; /**< Number of its first task */
+};
+
+/**
+ * @brief State of a verification shared by its tasks.
+ */
+struct verify_t {
+    struct verify_log_t *logs_; /**< The logs */
+    uint32_t *task_log_;        /**< Log of each task */
+    uint8_t **buffers_;         /**< Read buffer of each thread */
+};
+
+/**
+ * @brief Builds the checksum file name of a log.
+ * @param log_file_name name of the log file.
+ * @return The name, allocated from the pool, or @c NULL.
+ */
+static char *sum_name(const char *log_file_name) {
+    size_t len = strlen(log_file_name);
+    char *name = nt_pool_alloc(len + sizeof(PS_SUM_SUFFIX));
+    if (NULL != name) {
+        memcpy(name, log_file_name, len);
+        memcpy(name + len, PS_SUM_SUFFIX, sizeof(PS_SUM_SUFFIX));
+    }
+    return name;
+}
+
+/**
+ * @brief Returns the offset of the checksum of a block in the checksum file.
+ */
+static inline off_t sum_offset(uint64_t block) {
+    return (off_t)(sizeof(ps_sum_header_t) + block * sizeof(uint32_t));
+}
+
+/**
+ * @brief Writes the checksum of a block.
+ * @return 0 on success, -1 otherwise.
+ */
+static int sum_store(int fd, uint64_t block, uint32_t crc) {
+    if (sizeof(crc) != pwrite(fd, &crc, sizeof(crc), sum_offset(block))) {
+        LOG_DEBUG("%d %s", errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+ps_sum_t ps_sum_open(const char *log_file_name) {
+    char *name = sum_name(log_file_name);
+    struct ps_sum *sum = nt_pool_zalloc(sizeof(struct ps_sum));
+    ps_sum_header_t header = {
+        .magic_ = PS_SUM_MAGIC, .block_ = PS_SUM_BLOCK, .length_ = PS_SUM_OPEN};
+    if (NULL == name || NULL == sum) {
+        goto fail;
+    }
+    sum->fd_ = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (sum->fd_ < 0) {
+        goto fail;
+    }
+    if (sizeof(header) != write(sum->fd_, &header, sizeof(header))) {
+        close(sum->fd_);
+        goto fail;
+    }
+    nt_pool_free(name);
+    return sum;
+fail:
+    nt_pool_free(name);
+    nt_pool_free(sum);
+    return NULL;
+}
+
+void ps_sum_update(ps_sum_t sum, const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    while (len > 0) {
+        size_t take = PS_SUM_BLOCK - sum->fill_;
+        if (take > len) {
+            take = len;
+        }
+        sum->crc_ = nt_crc32c(sum->crc_, bytes, take);
+        sum->fill_ += (uint32_t)take;
+        bytes += take;
+        len -= take;
+        if (PS_SUM_BLOCK == sum->fill_) {
+            sum_store(sum->fd_, sum->blocks_++, sum->crc_);
+            sum->crc_ = 0;
+            sum->fill_ = 0;
+        }
+    }
+}
+
+int ps_sum_sync(ps_sum_t sum) { return fdatasync(sum->fd_); }
+
+void ps_sum_close(ps_sum_t sum) {
+    if (NULL != sum) {
+        ps_sum_header_t header = {.magic_ = PS_SUM_MAGIC,
+                                  .block_ = PS_SUM_BLOCK,
+                                  .length_ = sum->blocks_ * PS_SUM_BLOCK + sum->fill_};
+        /* The length is only written once every checksum is there */
+        if ((0 == sum->fill_ || 0 == sum_store(sum->fd_, sum->blocks_, sum->crc_)) &&
+            sizeof(header) != pwrite(sum->fd_, &header, sizeof(header), 0)) {
+            LOG_DEBUG("%d %s", errno, strerror(errno));
+        }
+        fsync(sum->fd_);
+        close(sum->fd_);
+        nt_pool_free(sum);
+    }
+}
+
+/**
+ * @brief Computes the checksum of a piece of a file.
+ * @param fd the file.
+ * @param offset where the piece starts.
+ * @param len its length, a block at most.
+ * @param[out] crc the checksum.
+ * @return 0 on success, -1 if the piece cannot be read whole.
+ */
+static int sum_file(int fd, uint64_t offset, size_t len, uint32_t *crc) {
+    uint8_t *block = nt_pool_alloc(PS_SUM_BLOCK);
+    int result = -1;
+    if (NULL != block && (ssize_t)len == pread(fd, block, len, (off_t)offset)) {
+        *crc = nt_crc32c(0, block, len);
+        result = 0;
+    }
+    nt_pool_free(block);
+    return result;
+}
+
+int ps_sum_truncate(const char *log_file_name, uint64_t length) {
+    char *name = sum_name(log_file_name);
+    int fd = NULL != name ? open(name, O_RDWR | O_CLOEXEC) : -1;
+    ps_sum_header_t header;
+    uint64_t n_blocks, whole = length / PS_SUM_BLOCK, rest = length % PS_SUM_BLOCK;
+    struct stat sum_stat;
+    int log_fd, result = -1;
+    uint32_t crc;
+    nt_pool_free(name);
+    if (fd < 0) {
+        return ENOENT == errno ? 0 : -1;
+    }
+    if (0 != fstat(fd, &sum_stat) || sizeof(header) != pread(fd, &header, sizeof(header), 0) ||
+        PS_SUM_MAGIC != header.magic_ || PS_SUM_BLOCK != header.block_) {
+        errno = EINVAL;
+        goto done;
+    }
+    n_blocks = ((uint64_t)sum_stat.st_size - sizeof(header)) / sizeof(uint32_t);
+    if (n_blocks < whole) {
+        /* Checksums of the last blocks were lost along with the tail, the rest stays open */
+        result = ftruncate(fd, sum_offset(n_blocks));
+        goto done;
+    }
+    if (0 != ftruncate(fd, sum_offset(whole))) {
+        goto done;
+    }
+    if (0 != rest) {
+        log_fd = open(log_file_name, O_RDONLY | O_CLOEXEC);
+        if (log_fd < 0) {
+            goto done;
+        }
+        result = sum_file(log_fd, whole * PS_SUM_BLOCK, rest, &crc);
+        close(log_fd);
+        if (0 != result || 0 != sum_store(fd, whole, crc)) {
+            result = -1;
+            goto done;
+        }
+    }
+    header.length_ = length;
+    result = sizeof(header) == pwrite(fd, &header, sizeof(header), 0) ? fsync(fd) : -1;
+done:
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief Opens a log and reads its checksums for verification.
+ * @param log_name name of the log.
+ * @param[out] log the log being verified.
+ * @param[out] result its result, but for the ranges.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int verify_open(const char *log_name, struct verify_log_t *log, ps_sum_result_t *result) {
+    char *name = sum_name(log_name);
+    int fd = NULL != name ? open(name, O_RDONLY | O_CLOEXEC) : -1;
+    ps_sum_header_t header;
+    struct stat log_stat, sum_stat;
+    uint64_t block;
+    int error = 0;
+    nt_pool_free(name);
+    log->fd_ = open(log_name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || log->fd_ < 0 || 0 != fstat(fd, &sum_stat) || 0 != fstat(log->fd_, &log_stat)) {
+        error = NULL == name ? ENOMEM : errno;
+        goto done;
+    }
+    if (sizeof(header) != pread(fd, &header, sizeof(header), 0) ||
+        PS_SUM_MAGIC != header.magic_ || PS_SUM_BLOCK != header.block_) {
+        error = EINVAL;
+        goto done;
+    }
+    result->size_ = (uint64_t)log_stat.st_size;
+    log->n_blocks_ = ((uint64_t)sum_stat.st_size - sizeof(header)) / sizeof(uint32_t);
+    log->covered_ = log->n_blocks_ * PS_SUM_BLOCK;
+    result->closed_ = PS_SUM_OPEN != header.length_ && header.length_ <= log->covered_ &&
+                      header.length_ + PS_SUM_BLOCK > log->covered_;
+    if (result->closed_) {
+        log->covered_ = header.length_;
+    }
+    result->covered_ = log->covered_;
+    log->sums_ = nt_pool_alloc(log->n_blocks_ * sizeof(uint32_t) + 1);
+    log->bad_ = nt_pool_zalloc(log->n_blocks_ + 1);
+    if (NULL == log->sums_ || NULL == log->bad_) {
+        error = ENOMEM;
+        goto done;
+    }
+    if ((ssize_t)(log->n_blocks_ * sizeof(uint32_t)) !=
+        pread(fd, log->sums_, log->n_blocks_ * sizeof(uint32_t), sizeof(header))) {
+        error = EIO;
+        goto done;
+    }
+    /* Blocks the log no longer has whole fail without being read */
+    for (block = 0; block < log->n_blocks_; ++block) {
+        uint64_t end = (block + 1) * PS_SUM_BLOCK;
+        if ((end < log->covered_ ? end : log->covered_) > result->size_) {
+            log->bad_[block] = 1;
+        } else {
+            log->n_checked_ = block + 1;
+        }
+    }
+    posix_fadvise(log->fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+done:
+    if (fd >= 0) {
+        close(fd);
+    }
+    return error;
+}
+
+/**
+ * @brief Checks blocks of a log against their checksums.
+ * @param log the log.
+ * @param buffer read buffer, @ref VERIFY_READ_BLOCKS blocks long.
+ * @param first first block.
+ * @param count number of blocks, all of them whole in the log but maybe the last one of it.
+ */
+static void verify_blocks(struct verify_log_t *log, uint8_t *buffer, uint64_t first,
+                          uint64_t count) {
+    uint64_t start = first * PS_SUM_BLOCK, end = (first + count) * PS_SUM_BLOCK;
+    uint64_t block;
+    ssize_t result;
+    if (end > log->covered_) {
+        end = log->covered_;
+    }
+    result = pread(log->fd_, buffer, end - start, (off_t)start);
+    for (block = 0; block < count; ++block) {
+        size_t len = end - start - block * PS_SUM_BLOCK;
+        uint8_t *data = buffer + block * PS_SUM_BLOCK;
+        if (len > PS_SUM_BLOCK) {
+            len = PS_SUM_BLOCK;
+        }
+        /* A read that came up short is retried block by block, to find the unreadable ones */
+        if ((uint64_t)result != end - start &&
+            (ssize_t)len != pread(log->fd_, data, len, (off_t)(start + block * PS_SUM_BLOCK))) {
+            log->bad_[first + block] = 1;
+        } else if (nt_crc32c(0, data, len) != log->sums_[first + block]) {
+            log->bad_[first + block] = 1;
+        }
+    }
+}
+
+/**
+ * @brief Verification task, checks up to @ref VERIFY_TASK_BLOCKS blocks of a log.
+ */
+static void verify_task(void *context, unsigned int worker, uint32_t task) {
+    struct verify_t *verify = context;
+    struct verify_log_t *log = &verify->logs_[verify->task_log_[task]];
+    uint64_t block = (uint64_t)(task - log->first_task_) * VERIFY_TASK_BLOCKS;
+    uint64_t end = block + VERIFY_TASK_BLOCKS;
+    if (end > log->n_checked_) {
+        end = log->n_checked_;
+    }
+    for (; block < end; block += VERIFY_READ_BLOCKS) {
+        verify_blocks(log, verify->buffers_[worker], block,
+                      end - block < VERIFY_READ_BLOCKS ? end - block : VERIFY_READ_BLOCKS);
+    }
+}
+
+/**
+ * @brief Turns the failed blocks of a log into ranges.
+ * @return 0 on success, @c ENOMEM otherwise.
+ */
+static int verify_ranges(const struct verify_log_t *log, ps_sum_result_t *result) {
+    uint64_t block;
+    size_t count = 0;
+    for (block = 0; block < log->n_blocks_; ++block) {
+        count += log->bad_[block] && (0 == block || !log->bad_[block - 1]);
+    }
+    if (0 == count) {
+        return 0;
+    }
+    result->bad_ = nt_pool_alloc(count * sizeof(ps_sum_range_t));
+    if (NULL == result->bad_) {
+        return ENOMEM;
+    }
+    for (block = 0; block < log->n_blocks_; ++block) {
+        ps_sum_range_t *range;
+        if (!log->bad_[block]) {
+            continue;
+        }
+        if (0 == block || !log->bad_[block - 1]) {
+            result->bad_[result->n_bad_++].start_ = block * PS_SUM_BLOCK;
+        }
+        range = &result->bad_[result->n_bad_ - 1];
+        range->end_ = (block + 1) * PS_SUM_BLOCK;
+        if (range->end_ > log->covered_) {
+            range->end_ = log->covered_;
+        }
+    }
+    return 0;
+}
+
+int ps_sum_verify(const char *const *logs, size_t count, unsigned int jobs,
+                  ps_sum_result_t *results) {
+    struct verify_t verify = {NULL, NULL, NULL};
+    size_t idx, n_tasks = 0, task;
+    unsigned int worker;
+    int result = ENOMEM;
+    memset(results, 0, sizeof(ps_sum_result_t) * count);
+    if (0 == count) {
+        return 0;
+    }
+    verify.logs_ = nt_pool_zalloc(sizeof(struct verify_log_t) * count);
+    if (NULL == verify.logs_) {
+        return ENOMEM;
+    }
+    for (idx = 0; idx < count; ++idx) {
+        struct verify_log_t *log = &verify.logs_[idx];
+        results[idx].error_ = verify_open(logs[idx], log, &results[idx]);
+        if (0 != results[idx].error_) {
+            log->n_checked_ = 0;
+        }
+        log->first_task_ = (uint32_t)n_tasks;
+        n_tasks += (log->n_checked_ + VERIFY_TASK_BLOCKS - 1) / VERIFY_TASK_BLOCKS;
+    }
+    verify.task_log_ = nt_pool_alloc(sizeof(uint32_t) * (n_tasks + 1));
+    verify.buffers_ = nt_pool_zalloc(sizeof(uint8_t *) * jobs);
+    if (NULL == verify.task_log_ || NULL == verify.buffers_ || n_tasks > NT_TASKS_MAX) {
+        goto done;
+    }
+    for (idx = count, task = n_tasks; idx-- > 0;) {
+        while (task > verify.logs_[idx].first_task_) {
+            verify.task_log_[--task] = (uint32_t)idx;
+        }
+    }
+    for (worker = 0; worker < jobs; ++worker) {
+        verify.buffers_[worker] = nt_pool_alloc(VERIFY_READ_BLOCKS * PS_SUM_BLOCK);
+        if (NULL == verify.buffers_[worker]) {
+            goto done;
+        }
+    }
+    result = nt_tasks_run(n_tasks, jobs, verify_task, &verify);
+    for (idx = 0; 0 == result && idx < count; ++idx) {
+        if (0 == results[idx].error_) {
+            results[idx].error_ = verify_ranges(&verify.logs_[idx], &results[idx]);
+        }
+    }
+done:
+    for (idx = 0; idx < count; ++idx) {
+        if (verify.logs_[idx].fd_ >= 0) {
+            close(verify.logs_[idx].fd_);
+        }
+        nt_pool_free(verify.logs_[idx].sums_);
+        nt_pool_free(verify.logs_[idx].bad_);
+    }
+    for (worker = 0; NULL != verify.buffers_ && worker < jobs; ++worker) {
+        nt_pool_free(verify.buffers_[worker]);
+    }
+    nt_pool_free(verify.buffers_);
+    nt_pool_free(verify.task_log_);
+    nt_pool_free(verify.logs_);
+    return result;
+}
+
+void ps_sum_result_free(ps_sum_result_t *results, size_t count) {
+    size_t idx;
+    for (idx = 0; idx < count; ++idx) {
+        nt_pool_free(results[idx].bad_);
+        results[idx].bad_ = NULL;
+        results[idx].n_bad_ = 0;
+    }
+}
+
+/** @} */
@@ -0,0 +1,152 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-sum.h
+ * @brief Log block checksums header file
+ * @details Every block of @ref PS_SUM_BLOCK bytes of a log carries a CRC-32C, kept in a
+ * companion file named after the log with a @c .sum suffix: a header, then the checksums of
+ * the blocks in order, the last block possibly shorter. @n
+ * The checksums are computed as the log is written, over exactly the bytes handed to the
+ * file, and a block's checksum is written once the block is complete; the checksum of the
+ * partial block at the end and the length of the log only when the log is closed. A log
+ * that was not closed cleanly has its whole blocks covered, the rest is not. @n
+ * The verifier checks any number of logs at once, their blocks cut into tasks spread over
+ * all threads by a work-stealing loop, so a single large log keeps every core busy as much as
+ * an archive of small ones. It reports the exact ranges of bytes that fail their checksum,
+ * those that cannot be read, and checksummed bytes the log no longer has.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_SUM_H
+#define PS_SUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Suffix appended to the log file name to get the checksum file name. */
+#define PS_SUM_SUFFIX ".sum"
+
+/** @brief Value of @c magic_ of the header, "PSS1" in little endian. */
+#define PS_SUM_MAGIC (0x31535350U)
+
+/** @brief Length of a block of the log with a checksum of its own. */
+#define PS_SUM_BLOCK (64U << 10)
+
+/** @brief Value of @c length_ of the header while the log is being written. */
+#define PS_SUM_OPEN (UINT64_MAX)
+
+/**
+ * @brief Header of a checksum file, followed by a @c uint32_t checksum per block.
+ * @details Stored in host byte order.
+ */
+typedef struct ps_sum_header_t {
+    uint32_t magic_;  /**< @ref PS_SUM_MAGIC */
+    uint32_t block_;  /**< Length of a block */
+    uint64_t length_; /**< Length of the log covered, @ref PS_SUM_OPEN until it is closed */
+} ps_sum_header_t;
+
+/**
+ * @brief A handle of the checksums of a log being written.
+ */
+typedef struct ps_sum *ps_sum_t;
+
+/**
+ * @brief Creates the checksum file of a log.
+ * @param log_file_name name of the log file.
+ * @return The handle or @c NULL, with @c errno set.
+ * @sa ps_sum_close()
+ */
+ps_sum_t ps_sum_open(const char *log_file_name);
+
+/**
+ * @brief Extends the checksums over data appended to the log.
+ * @details The checksum of each block completed goes to the file right away. A checksum that
+ * cannot be written leaves its block uncovered, the log goes on.
+ * @param sum the handle.
+ * @param data the data, as written to the log.
+ * @param len its length.
+ */
+void ps_sum_update(ps_sum_t sum, const void *data, size_t len);
+
+/**
+ * @brief Syncs the checksums written so far.
+ * @details Only touches the descriptor, so it may be called from a thread other than the
+ * one extending the checksums.
+ * @param sum the handle.
+ * @return 0 on success, -1 otherwise.
+ */
+int ps_sum_sync(ps_sum_t sum);
+
+/**
+ * @brief Writes the checksum of the partial block and the length of the log, syncs and
+ * closes the checksum file.
+ * @param sum the handle, may be @c NULL.
+ */
+void ps_sum_close(ps_sum_t sum);
+
+/**
+ * @brief Cuts the checksums of a log whose torn tail was truncated.
+ * @details The checksums of the blocks the log still has whole are kept. If they are all
+ * there, the partial block at the end gets its checksum computed from the log as it is and
+ * the log counts as closed; otherwise the checksums end where they do. Logs without a
+ * checksum file are left alone.
+ * @param log_file_name name of the log file.
+ * @param length length the log was truncated to.
+ * @return 0 on success, -1 otherwise.
+ */
+int ps_sum_truncate(const char *log_file_name, uint64_t length);
+
+/**
+ * @brief A range of bytes of a log.
+ */
+typedef struct ps_sum_range_t {
+    uint64_t start_; /**< Offset of the first byte */
+    uint64_t end_;   /**< Offset past the last byte */
+} ps_sum_range_t;
+
+/**
+ * @brief Result of verifying a log.
+ * @details Ranges start at block boundaries and are merged when adjacent. Bytes of a range
+ * at or past @c size_ were checksummed but are no longer in the log.
+ */
+typedef struct ps_sum_result_t {
+    int error_;           /**< @c errno value if the log could not be verified, 0 otherwise */
+    int closed_;          /**< Non-zero if the log was closed, all of it covered */
+    uint64_t size_;       /**< Length of the log */
+    uint64_t covered_;    /**< Length of the log covered by checksums */
+    ps_sum_range_t *bad_; /**< Ranges failing their checksum, allocated from the pool */
+    size_t n_bad_;        /**< Number of ranges */
+} ps_sum_result_t;
+
+/**
+ * @brief Verifies logs against their checksums.
+ * @param logs names of the logs.
+ * @param count number of logs.
+ * @param jobs number of threads, at least 1.
+ * @param[out] results a result per log, released with @ref ps_sum_result_free().
+ * @return 0 on success, even if some logs could not be verified, @c errno value otherwise.
+ */
+int ps_sum_verify(const char *const *logs, size_t count, unsigned int jobs,
+                  ps_sum_result_t *results);
+
+/**
+ * @brief Releases the ranges of results.
+ * @param results the results.
+ * @param count their number.
+ */
+void ps_sum_result_free(ps_sum_result_t *results, size_t count);
+
+/** @} */
+
+#endif /* PS_SUM_H */
@@ -0,0 +1,121 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-text.c
+ * @brief Plain text log implementation file
+ * @details Pending output is stripped in chunks of at most @ref TEXT_CHUNK bytes into
+ * a staging buffer from the slab pool, which is then written out in one go.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "nt-pool.h"
+#include "nt-strip.h"
+#include "ps-text.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Largest piece of output stripped at once. */
+#define TEXT_CHUNK (64UL << 10)
+
+/**
+ * @brief Plain text log.
+ */
+struct ps_text {
+    int fd_;             /**< File descriptor */
+    nt_strip_t strip_;   /**< Stripper state */
+    uint8_t *stage_;     /**< Stripped output, @ref NT_STRIP_OUTPUT_SIZE(TEXT_CHUNK) bytes */
+};
+
+/**
+ * @brief Writes a whole buffer to a regular file.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int write_all(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t result = write(fd, buf, len);
+        if (result < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return errno;
+        }
+        buf += result;
+        len -= (size_t)result;
+    }
+    return 0;
+}
+
+ps_text_t ps_text_open(const char *log_file_name) {
+    size_t len = strlen(log_file_name) + sizeof(PS_TEXT_SUFFIX);
+    char *name = nt_pool_alloc(len);
+    struct ps_text *text = nt_pool_alloc(sizeof(struct ps_text));
+    uint8_t *stage = nt_pool_alloc(NT_STRIP_OUTPUT_SIZE(TEXT_CHUNK));
+    if (NULL == name || NULL == text || NULL == stage) {
+        goto fail;
+    }
+    snprintf(name, len, "%s%s", log_file_name, PS_TEXT_SUFFIX);
+    text->fd_ = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (text->fd_ < 0) {
+        goto fail;
+    }
+    nt_strip_init(&text->strip_);
+    text->stage_ = stage;
+    nt_pool_free(name);
+    return text;
+fail:
+    nt_pool_free(stage);
+    nt_pool_free(text);
+    nt_pool_free(name);
+    return NULL;
+}
+
+int ps_text_write(ps_text_t text, yanzc_chain_reader_t *reader) {
+    struct iovec iov[16];
+    int n_iov = io_chain_reader_get_iov(reader, iov, sizeof(iov) / sizeof(iov[0]));
+    int idx;
+    for (idx = 0; idx < n_iov; ++idx) {
+        const uint8_t *data = iov[idx].iov_base;
+        size_t left = iov[idx].iov_len;
+        while (left > 0) {
+            size_t chunk = left < TEXT_CHUNK ? left : TEXT_CHUNK;
+            size_t stripped = nt_strip_feed(&text->strip_, data, chunk, text->stage_);
+            int result = write_all(text->fd_, text->stage_, stripped);
+            /* The stripper has taken the chunk in, it is consumed even if writing failed */
+            io_chain_reader_advance(reader, chunk);
+            if (0 != result) {
+                return result;
+            }
+            data += chunk;
+            left -= chunk;
+        }
+    }
+    return 0;
+}
+
+void ps_text_close(ps_text_t text) {
+    if (NULL == text) {
+        return;
+    }
+    write_all(text->fd_, text->stage_, nt_strip_finish(&text->strip_, text->stage_));
+    close(text->fd_);
+    nt_pool_free(text->stage_);
+    nt_pool_free(text);
+}
+
+/** @} */
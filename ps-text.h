@@ -0,0 +1,60 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-text.h
+ * @brief Plain text log header file
+ * @details The plain text log is a companion of the session log, named after it with a
+ * @c .txt suffix. It holds the same output with escape sequences removed and line redraws
+ * applied, ready for @c grep and for indexing.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_TEXT_H
+#define PS_TEXT_H
+
+#include "yanzc_chain.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Suffix appended to the log file name to get the plain text log name. */
+#define PS_TEXT_SUFFIX ".txt"
+
+/**
+ * @brief A handle of an open plain text log.
+ */
+typedef struct ps_text *ps_text_t;
+
+/**
+ * @brief Creates the plain text log of a session log.
+ * @param log_file_name name of the session log.
+ * @return The plain text log or @c NULL, with @c errno set.
+ * @sa ps_text_close()
+ */
+ps_text_t ps_text_open(const char *log_file_name);
+
+/**
+ * @brief Strips data pending for a reader and writes it to the plain text log.
+ * @param text the plain text log.
+ * @param reader the reader.
+ * @return 0 on success, @c errno value otherwise.
+ */
+int ps_text_write(ps_text_t text, yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Writes the unfinished last line out and closes the plain text log.
+ * @param text the plain text log, may be @c NULL.
+ */
+void ps_text_close(ps_text_t text);
+
+/** @} */
+
+#endif /* PS_TEXT_H */
@@ -0,0 +1,467 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-view.c
+ * @brief Live session viewers implementation file
+ * @details The memory file starts with a page of shared state, the ring follows it. Positions
+ * are byte counts since the session started, the ring holds the last @c size_ bytes of them.
+ * The session publishes a piece of output like a sequence lock: it first moves @c head_ to
+ * where the piece ends, then copies it and then moves @c written_ there. A viewer reads what
+ * lies below @c written_, and checks @c head_ once the bytes are out: if the session has
+ * come within a ring of them meanwhile, they may have been overwritten while being read. @n
+ * @c seq_ is the futex word, bumped on every publication. Viewers count themselves in
+ * @c waiters_ before they go to sleep, so that the session makes no system call while no
+ * one sleeps. The shared state only informs viewers: the session keeps its own positions and
+ * the geometry of the ring, and never reads them back, so a viewer that scribbles over the
+ * shared page or the ring harms just the viewers.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#if defined __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "nt-pool.h"
+#include "ps-view.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Magic number of the shared state, "PSV1" read as little-endian. */
+#define VIEW_MAGIC (0x31565350U)
+
+/** @brief Version of the layout of the shared state. */
+#define VIEW_VERSION (1U)
+
+/** @brief Offset of the ring in the memory file. */
+#define VIEW_RING_OFFSET (4096UL)
+
+/** @brief Size of a cache line. */
+#define VIEW_CACHE_LINE (64)
+
+/** @brief How long a viewer sleeps before it checks that the session is still there. */
+#define VIEW_WAIT_NS (1000000000L)
+
+/**
+ * @brief State shared by the session and its viewers.
+ * @details What the session updates on every publication and what viewers update before they
+ * sleep sit on cache lines of their own.
+ */
+struct view_shared_t {
+    uint32_t magic_;   /**< @ref VIEW_MAGIC */
+    uint32_t version_; /**< @ref VIEW_VERSION */
+    uint64_t size_;    /**< Size of the ring, a power of 2 */
+    int32_t pid_;      /**< Process of the session */
+    char pad_1_[VIEW_CACHE_LINE - 2 * sizeof(uint32_t) - sizeof(uint64_t) - sizeof(int32_t)];
+    uint64_t head_;    /**< End of the output being copied into the ring */
+    uint64_t written_; /**< End of the output in the ring */
+    uint32_t seq_;     /**< Futex word, bumped on every publication */
+    uint32_t closed_;  /**< Non-zero once the session is over */
+    char pad_2_[VIEW_CACHE_LINE - 2 * sizeof(uint64_t) - 2 * sizeof(uint32_t)];
+    uint32_t waiters_; /**< Number of viewers sleeping on @c seq_ */
+};
+
+/**
+ * @brief Publishing side of a session.
+ */
+struct ps_view {
+    struct view_shared_t *shared_; /**< The shared state */
+    uint8_t *ring_;                /**< The ring */
+    size_t ring_size_;             /**< Size of the ring, a power of 2, never read back */
+    size_t mask_;                  /**< @c ring_size_ - 1 */
+    size_t map_size_;              /**< Size of the memory file */
+    uint64_t written_;             /**< End of the output in the ring */
+    int memfd_;                    /**< The memory file */
+    int listen_fd_;                /**< Socket viewers connect to */
+    struct sockaddr_un address_;   /**< Its address */
+};
+
+/**
+ * @brief Wakes all the viewers sleeping on the futex word.
+ */
+static void view_wake(struct view_shared_t *shared) {
+#if defined __linux__
+    syscall(SYS_futex, &shared->seq_, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)(shared);
+#endif
+}
+
+/**
+ * @brief Sleeps until the futex word is no longer @p seq or for @ref VIEW_WAIT_NS at most.
+ * @details Without futexes at hand, it just sleeps for a millisecond.
+ */
+static void view_wait(struct view_shared_t *shared, uint32_t seq) {
+#if defined __linux__
+    struct timespec timeout = {.tv_sec = VIEW_WAIT_NS / 1000000000L,
+                               .tv_nsec = VIEW_WAIT_NS % 1000000000L};
+    syscall(SYS_futex, &shared->seq_, FUTEX_WAIT, seq, &timeout, NULL, 0);
+#else
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = 1000000L};
+    (void)(shared);
+    (void)(seq);
+    nanosleep(&timeout, NULL);
+#endif
+}
+
+/**
+ * @brief Fills in the address of the socket of a log.
+ * @return 0 on success, -1 with @c errno set if the name does not fit.
+ */
+static int view_address(const char *log_file_name, struct sockaddr_un *address) {
+    int len;
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    len = snprintf(address->sun_path, sizeof(address->sun_path), "%s%s", log_file_name,
+                   PS_VIEW_SUFFIX);
+    if (len < 0 || (size_t)len >= sizeof(address->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+ps_view_t ps_view_open(const char *log_file_name, size_t size) {
+    struct ps_view *view = nt_pool_zalloc(sizeof(struct ps_view));
+    size_t ring_size = PS_VIEW_MIN_SIZE;
+    void *map;
+    int saved_errno;
+    if (NULL == view) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    view->memfd_ = view->listen_fd_ = -1;
+    while (ring_size < size && ring_size < PS_VIEW_MAX_SIZE) {
+        ring_size *= 2;
+    }
+    view->map_size_ = VIEW_RING_OFFSET + ring_size;
+    if (0 != view_address(log_file_name, &view->address_)) {
+        goto fail;
+    }
+    /* Sealed, so that no viewer can shrink the file from under the session */
+    view->memfd_ = memfd_create("pseudoshell-view", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (view->memfd_ < 0 || 0 != ftruncate(view->memfd_, (off_t)view->map_size_) ||
+        0 != fcntl(view->memfd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+        goto fail;
+    }
+    map = mmap(NULL, view->map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, view->memfd_, 0);
+    if (MAP_FAILED == map) {
+        goto fail;
+    }
+    view->shared_ = map;
+    view->ring_ = (uint8_t *)map + VIEW_RING_OFFSET;
+    view->ring_size_ = ring_size;
+    view->mask_ = ring_size - 1;
+    view->shared_->size_ = ring_size;
+    view->shared_->pid_ = (int32_t)getpid();
+    view->shared_->version_ = VIEW_VERSION;
+    view->shared_->magic_ = VIEW_MAGIC;
+    view->listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (view->listen_fd_ < 0) {
+        goto fail;
+    }
+    /* A socket left behind by an earlier session of the same log is stale */
+    unlink(view->address_.sun_path);
+    if (0 != bind(view->listen_fd_, (const struct sockaddr *)&view->address_,
+                  sizeof(view->address_)) ||
+        0 != chmod(view->address_.sun_path, 0600) || 0 != listen(view->listen_fd_, 16)) {
+        goto fail;
+    }
+    return view;
+fail:
+    saved_errno = errno;
+    if (NULL != view->shared_) {
+        munmap(view->shared_, view->map_size_);
+    }
+    if (view->listen_fd_ >= 0) {
+        close(view->listen_fd_);
+        unlink(view->address_.sun_path);
+    }
+    if (view->memfd_ >= 0) {
+        close(view->memfd_);
+    }
+    nt_pool_free(view);
+    errno = saved_errno;
+    return NULL;
+}
+
+int ps_view_fd(ps_view_t view) {
+    return view->listen_fd_;
+}
+
+size_t ps_view_size(ps_view_t view) {
+    return view->map_size_;
+}
+
+void ps_view_accept(ps_view_t view) {
+    union {
+        struct cmsghdr header_;
+        char buf_[CMSG_SPACE(sizeof(int))];
+    } control;
+    char byte = 'V';
+    struct iovec iov = {.iov_base = &byte, .iov_len = sizeof(byte)};
+    struct msghdr msg = {.msg_iov = &iov,
+                         .msg_iovlen = 1,
+                         .msg_control = control.buf_,
+                         .msg_controllen = sizeof(control.buf_)};
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    int fd;
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &view->memfd_, sizeof(int));
+    /* The message fits in any socket buffer, a viewer that is not there any more is skipped */
+    while ((fd = accept4(view->listen_fd_, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+        sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        close(fd);
+    }
+}
+
+void ps_view_publish(ps_view_t view, yanzc_chain_reader_t *reader) {
+    struct view_shared_t *shared = view->shared_;
+    /* Viewers may write anything to the shared page, the session trusts none of it */
+    size_t size = view->ring_size_, mask = view->mask_;
+    struct iovec iov[16];
+    int n_iov = io_chain_reader_get_iov(reader, iov, sizeof(iov) / sizeof(iov[0]));
+    int idx;
+    if (0 == n_iov) {
+        return;
+    }
+    for (idx = 0; idx < n_iov; ++idx) {
+        const uint8_t *data = iov[idx].iov_base;
+        size_t len = iov[idx].iov_len, offset, first;
+        io_chain_reader_advance(reader, len);
+        /* Only the last ring's worth of a piece survives anyway */
+        if (len > size) {
+            data += len - size;
+            view->written_ += len - size;
+            len = size;
+        }
+        __atomic_store_n(&shared->head_, view->written_ + len, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        offset = (size_t)view->written_ & mask;
+        first = len < size - offset ? len : size - offset;
+        memcpy(view->ring_ + offset, data, first);
+        memcpy(view->ring_, data + first, len - first);
+        view->written_ += len;
+        __atomic_store_n(&shared->written_, view->written_, __ATOMIC_RELEASE);
+    }
+    __atomic_add_fetch(&shared->seq_, 1, __ATOMIC_SEQ_CST);
+    if (0 != __atomic_load_n(&shared->waiters_, __ATOMIC_SEQ_CST)) {
+        view_wake(shared);
+    }
+}
+
+void ps_view_close(ps_view_t view) {
+    if (NULL == view) {
+        return;
+    }
+    close(view->listen_fd_);
+    unlink(view->address_.sun_path);
+    __atomic_store_n(&view->shared_->closed_, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&view->shared_->seq_, 1, __ATOMIC_SEQ_CST);
+    view_wake(view->shared_);
+    munmap(view->shared_, view->map_size_);
+    close(view->memfd_);
+    nt_pool_free(view);
+}
+
+/**
+ * @brief Viewing side of a session.
+ */
+struct view_follow_t {
+    struct view_shared_t *shared_; /**< The shared state */
+    const uint8_t *ring_;          /**< The ring */
+    uint64_t size_;                /**< Its size */
+    uint64_t read_;                /**< Position of the viewer */
+};
+
+/**
+ * @brief Connects to the socket of a log and receives the memory file.
+ * @return The memory file, -1 with @c errno set on error.
+ */
+static int view_connect(const char *log_file_name) {
+    union {
+        struct cmsghdr header_;
+        char buf_[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct sockaddr_un address;
+    char byte;
+    struct iovec iov = {.iov_base = &byte, .iov_len = sizeof(byte)};
+    struct msghdr msg = {.msg_iov = &iov,
+                         .msg_iovlen = 1,
+                         .msg_control = control.buf_,
+                         .msg_controllen = sizeof(control.buf_)};
+    struct cmsghdr *cmsg;
+    int fd, memfd = -1;
+    if (0 != view_address(log_file_name, &address)) {
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (0 == connect(fd, (const struct sockaddr *)&address, sizeof(address)) &&
+        recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) > 0) {
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (NULL != cmsg && SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type &&
+            CMSG_LEN(sizeof(int)) == cmsg->cmsg_len) {
+            memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+        } else {
+            errno = EPROTO;
+        }
+    }
+    close(fd);
+    return memfd;
+}
+
+/**
+ * @brief Returns the position right after the first new line in <tt>[from, to)</tt>.
+ * @return The position, @p from if there is no new line.
+ */
+static uint64_t view_line_start(const struct view_follow_t *follow, uint64_t from, uint64_t to) {
+    uint64_t mask = follow->size_ - 1;
+    while (from < to) {
+        size_t offset = (size_t)(from & mask);
+        size_t len = (size_t)(to - from < follow->size_ - offset ? to - from
+                                                                  : follow->size_ - offset);
+        const uint8_t *line_end = memchr(follow->ring_ + offset, '\n', len);
+        if (NULL != line_end) {
+            return from + (uint64_t)(line_end + 1 - (follow->ring_ + offset));
+        }
+        from += len;
+    }
+    return from;
+}
+
+/**
+ * @brief Writes a notice about output the viewer did not show as it was.
+ */
+static int view_notice(int fd, const char *what, uint64_t bytes) {
+    char notice[128];
+    int len = snprintf(notice, sizeof(notice), "\033[0m\r\n[pstool: %llu bytes of output %s]\r\n",
+                       (unsigned long long)bytes, what);
+    return write(fd, notice, (size_t)len) < 0 && EINTR != errno ? errno : 0;
+}
+
+/**
+ * @brief Writes what the viewer has not shown yet out of the ring.
+ * @param follow the viewer.
+ * @param fd where to write.
+ * @param written end of the output in the ring.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int view_show(struct view_follow_t *follow, int fd, uint64_t written) {
+    uint64_t mask = follow->size_ - 1, start = follow->read_, head;
+    size_t offset = (size_t)(start & mask), len = (size_t)(written - start);
+    struct iovec iov[2] = {{.iov_base = (void *)(follow->ring_ + offset), .iov_len = len}};
+    int n_iov = 1;
+    ssize_t result;
+    if (offset + len > follow->size_) {
+        iov[0].iov_len = (size_t)follow->size_ - offset;
+        iov[1].iov_base = (void *)follow->ring_;
+        iov[1].iov_len = len - iov[0].iov_len;
+        n_iov = 2;
+    }
+    result = writev(fd, iov, n_iov);
+    if (result < 0) {
+        return EINTR == errno ? 0 : errno;
+    }
+    follow->read_ += (uint64_t)result;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&follow->shared_->head_, __ATOMIC_RELAXED);
+    if (head - start > follow->size_) {
+        return view_notice(fd, "overwritten while shown, the log has them",
+                           head - start - follow->size_);
+    }
+    return 0;
+}
+
+int ps_view_follow(const char *log_file_name, int fd) {
+    struct view_follow_t follow = {NULL, NULL, 0, 0};
+    struct view_shared_t *shared;
+    struct stat memfd_stat;
+    uint64_t written, keep;
+    int memfd = view_connect(log_file_name), result = 0;
+    void *map;
+    if (memfd < 0) {
+        return errno;
+    }
+    if (0 != fstat(memfd, &memfd_stat) || (uint64_t)memfd_stat.st_size <= VIEW_RING_OFFSET) {
+        result = 0 != errno ? errno : EPROTO;
+        close(memfd);
+        return result;
+    }
+    map = mmap(NULL, (size_t)memfd_stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    close(memfd);
+    if (MAP_FAILED == map) {
+        return errno;
+    }
+    shared = follow.shared_ = map;
+    follow.ring_ = (const uint8_t *)map + VIEW_RING_OFFSET;
+    follow.size_ = shared->size_;
+    if (VIEW_MAGIC != shared->magic_ || VIEW_VERSION != shared->version_ ||
+        VIEW_RING_OFFSET + follow.size_ != (uint64_t)memfd_stat.st_size ||
+        0 != (follow.size_ & (follow.size_ - 1))) {
+        munmap(map, (size_t)memfd_stat.st_size);
+        return EPROTO;
+    }
+    /* A screenful or so of what came last, from a line start */
+    keep = follow.size_ / 4 < 8192 ? follow.size_ / 4 : 8192;
+    written = __atomic_load_n(&shared->written_, __ATOMIC_ACQUIRE);
+    if (written > keep) {
+        follow.read_ = view_line_start(&follow, written - keep, written);
+    }
+    while (0 == result) {
+        uint32_t seq = __atomic_load_n(&shared->seq_, __ATOMIC_ACQUIRE);
+        written = __atomic_load_n(&shared->written_, __ATOMIC_ACQUIRE);
+        if (written - follow.read_ > follow.size_ / 2) {
+            uint64_t skip_to = view_line_start(&follow, written - follow.size_ / 4, written);
+            result = view_notice(fd, "skipped, the log has them", skip_to - follow.read_);
+            follow.read_ = skip_to;
+        } else if (written != follow.read_) {
+            result = view_show(&follow, fd, written);
+        } else if (0 != __atomic_load_n(&shared->closed_, __ATOMIC_ACQUIRE)) {
+            break;
+        } else {
+            __atomic_add_fetch(&shared->waiters_, 1, __ATOMIC_SEQ_CST);
+            if (seq == __atomic_load_n(&shared->seq_, __ATOMIC_SEQ_CST)) {
+                view_wait(shared, seq);
+            }
+            __atomic_sub_fetch(&shared->waiters_, 1, __ATOMIC_SEQ_CST);
+            if (seq == __atomic_load_n(&shared->seq_, __ATOMIC_ACQUIRE) &&
+                0 != kill((pid_t)shared->pid_, 0) && ESRCH == errno) {
+                result = ESRCH;
+            }
+        }
+    }
+    munmap(map, (size_t)memfd_stat.st_size);
+    return result;
+}
+
+/** @} */
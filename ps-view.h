@@ -0,0 +1,105 @@
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ * @file ps-view.h
+ * @brief Live session viewers header file
+ * @details A session may publish its output to any number of local viewers while it runs.
+ * The output goes into a ring in shared memory, a memory file descriptor that the session
+ * hands over to each viewer connecting to a Unix socket named after the log with a
+ * @ref PS_VIEW_SUFFIX suffix. Viewers map the ring and write the output straight out of it,
+ * no copy made on the way. @n
+ * The session only ever copies the output into the ring and moves its write position on, it
+ * never waits for a viewer. Viewers sleep on a futex in the ring, which the session wakes
+ * only when somebody sleeps on it. A viewer that falls more than half the ring behind skips
+ * ahead to a line start near the latest output and says how much it skipped; should its
+ * output be overwritten while it writes it out anyway, it says so as well.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ * @sa SessionLogModule
+ * @}
+ */
+
+#ifndef PS_VIEW_H
+#define PS_VIEW_H
+
+#include <stddef.h>
+
+#include "yanzc_chain.h"
+
+/**
+ * @addtogroup SessionLogModule
+ * @{
+ */
+
+/** @brief Suffix appended to the log file name to get the name of the viewer socket. */
+#define PS_VIEW_SUFFIX ".view"
+
+/** @brief Smallest ring, smaller sizes are rounded up to it. */
+#define PS_VIEW_MIN_SIZE (64UL << 10)
+
+/** @brief Largest ring. */
+#define PS_VIEW_MAX_SIZE (1UL << 30)
+
+/** @brief Publishing side of a session, opaque. */
+typedef struct ps_view *ps_view_t;
+
+/**
+ * @brief Creates the ring and the socket viewers connect to.
+ * @param log_file_name name of the log the socket is named after.
+ * @param size size of the ring, rounded up to a power of 2 between @ref PS_VIEW_MIN_SIZE
+ * and @ref PS_VIEW_MAX_SIZE.
+ * @return The publishing side or @c NULL, with @c errno set.
+ */
+ps_view_t ps_view_open(const char *log_file_name, size_t size);
+
+/**
+ * @brief Returns the socket viewers connect to, for the caller to watch for readability.
+ * @param view the publishing side.
+ * @return The descriptor.
+ */
+int ps_view_fd(ps_view_t view);
+
+/**
+ * @brief Returns the size of the shared memory the ring takes, its header included.
+ * @param view the publishing side.
+ * @return Number of bytes.
+ */
+size_t ps_view_size(ps_view_t view);
+
+/**
+ * @brief Hands the ring over to the viewers waiting on the socket.
+ * @param view the publishing side.
+ */
+void ps_view_accept(ps_view_t view);
+
+/**
+ * @brief Copies everything the reader has pending into the ring and wakes the viewers.
+ * @details Never blocks, the reader is always left with nothing pending.
+ * @param view the publishing side.
+ * @param reader reader of the output.
+ */
+void ps_view_publish(ps_view_t view, yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Tells the viewers that the session is over, removes the socket and frees the ring.
+ * @param view the publishing side, may be @c NULL.
+ */
+void ps_view_close(ps_view_t view);
+
+/**
+ * @brief Watches a session live.
+ * @details Connects to the socket of the log, starts a screenful or so before the latest
+ * output and writes everything that follows to @p fd until the session is over.
+ * @param log_file_name name of the log of the session.
+ * @param fd where to write the output.
+ * @return 0 once the session is over, @c errno value otherwise; @c ESRCH if the session
+ * went away without closing the ring.
+ */
+int ps_view_follow(const char *log_file_name, int fd);
+
+/** @} */
+
+#endif /* PS_VIEW_H */
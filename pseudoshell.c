@@ -95,17 +95,15 @@
  * -# <tt><a href="http://man7.org/linux/man-pages/man1/script.1.html">pty(7)</a></tt>
  */
 
+#define _GNU_SOURCE
+
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <termios.h>
-#if defined __linux__
-#include <pty.h>
-#elif defined __FreeBSD__
-#include <libutil.h>
-#endif
+#include <regex.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -122,7 +120,22 @@
 
 #include "event2/event.h"
 #include "yanzc_buffer.h"
+#include "yanzc_chain.h"
 #include "yandu_log.h"
+#include "nt-budget.h"
+#include "nt-pool.h"
+#include "nt-redact.h"
+#include "nt-timerwheel.h"
+#include "ps-cast.h"
+#include "ps-cmd.h"
+#include "ps-index.h"
+#include "ps-journal.h"
+#include "ps-latency.h"
+#include "ps-log.h"
+#include "ps-pty.h"
+#include "ps-rotate.h"
+#include "ps-text.h"
+#include "ps-view.h"
 
 /**
  * @brief Size of the data buffer that stores
@@ -131,13 +144,110 @@
 #define IO_TO_CHILD_BUFSIZE (32)
 
 /**
- * @brief Size of the data buffer that stores
+ * @brief Size of a single segment of the chain that stores
  * data received from the child process.
  */
 #define IO_FROM_CHILD_BUFSIZE (4096)
 
+/**
+ * @brief Maximal number of segments of the chain that stores
+ * data received from the child process.
+ * @details This is how much output a burst from the child may pile up
+ * before reading from the pseudo terminal is suspended.
+ */
+#define IO_FROM_CHILD_SEGMENTS (256)
+
+/**
+ * @brief Size of the data buffer that stores data to be sent to the child process in
+ * headless mode, where it comes from a file rather than from the keyboard.
+ */
+#define HEADLESS_TO_CHILD_BUFSIZE (4096)
+
+/**
+ * @brief Size of a single segment of the chain that stores data received from the child
+ * process in headless mode, where throughput matters more than latency.
+ */
+#define HEADLESS_FROM_CHILD_BUFSIZE (65536)
+
+/**
+ * @brief Maximal number of segments of the chain that stores data received from the child
+ * process in headless mode.
+ */
+#define HEADLESS_FROM_CHILD_SEGMENTS (64)
+
+/** @brief Number of rows of the pseudo terminal in headless mode. */
+#define HEADLESS_ROWS (24)
+
+/** @brief Number of columns of the pseudo terminal in headless mode. */
+#define HEADLESS_COLS (80)
+
+/**
+ * @brief Most bytes sent once the input of headless mode is over: a line feed ending the last
+ * line, if it has none, and the end of file character.
+ */
+#define INPUT_END_MAX (2)
+
+/**
+ * @brief Largest piece of output redacted at once.
+ */
+#define REDACT_CHUNK (IO_FROM_CHILD_BUFSIZE * 4)
+
+/**
+ * @brief Least amount of output kept for the display when it skips ahead.
+ */
+#define DISPLAY_KEEP_MIN (4096UL)
+
+/**
+ * @brief Tick of the timer wheel of the relay, in nanoseconds.
+ * @details Deadlines due within the same millisecond share a wake-up.
+ */
+#define RELAY_TICK_NS (1000000ULL)
+
+/**
+ * @brief Number of reads the memory budget must have room for once the session is set up.
+ * @details The chains keep a spare segment each once they have been written, the metadata
+ * queue grows now and then; this keeps those from using up the room a read needs for good.
+ */
+#define MEMORY_MIN_READS (4)
+
+/**
+ * @brief Growth of the most memory held that makes the session note it in the metadata.
+ */
+#define MEMORY_NOTE_STEP (256UL << 10)
+
+/**
+ * @brief How often the relay looks at the memory budget again while it has no room for a read,
+ * in nanoseconds.
+ * @details Memory held by the segments being sealed comes back from the sealer thread, which
+ * does not wake the relay up.
+ */
+#define MEMORY_RETRY_NS (10000000ULL)
+
+/**
+ * @brief Command line configuration of a session.
+ */
+struct ps_config_t {
+    ps_log_config_t log_;       /**< Configuration of the log */
+    unsigned long display_lag_; /**< Display lag that makes it skip ahead, 0 never skips */
+    int text_;                  /**< Non-zero to write a plain text log as well */
+    int cast_;                  /**< Non-zero to write an asciicast recording as well */
+    unsigned long index_;       /**< Index segment size, 0 not to index the log */
+    unsigned long view_;        /**< Size of the ring for live viewers, 0 without viewers */
+    const char *prompt_;        /**< Regular expression matching a prompt, may be @c NULL */
+    nt_redact_set_t redact_;    /**< Patterns to keep out of the logs, may be @c NULL */
+    int headless_;              /**< Non-zero to run without a terminal, see @c -B */
+    ps_latency_config_t latency_; /**< Low-latency relay, @c cpu_ -1 for a normal one */
+    ps_rotate_config_t rotate_; /**< When the log starts a new segment, all zero never */
+    unsigned long memory_;      /**< Memory budget of the session, 0 for none */
+    const char *journal_;       /**< Shared journal to log to instead, may be @c NULL */
+};
+
 static volatile sig_atomic_t quit = 0;
-static const char file_name[] = "log_XXXXXX";
+
+/**
+ * @brief Write end of the self-pipe that turns @c SIGWINCH into a readable descriptor.
+ */
+static int s_winch_fd = -1;
 
 /**
  * @brief
@@ -155,33 +265,915 @@ static void handle_child(int signal, siginfo_t *info, void *context) {
     quit = 1;
 }
 
+/**
+ * @brief Reports a change of the terminal size to the relay loop.
+ * @details Only async-signal-safe calls are made here: a single byte goes to the self-pipe,
+ * the relay loop does the rest. If the pipe is full, a wake-up is already pending anyway.
+ * @param signal
+ */
+static void handle_winch(int signal) {
+    int saved_errno = errno;
+    char byte = 'W';
+    ssize_t ignored = write(s_winch_fd, &byte, sizeof(byte));
+    (void)(ignored);
+    (void)(signal);
+    errno = saved_errno;
+}
+
+/**
+ * @brief State of a single recorded session.
+ * @details The session object, its buffers and its bookkeeping are all allocated from the
+ * slab pool, so that the memory of a finished session is recycled by the next one.
+ */
+struct ps_session_t {
+    int fd_master_;                              /**< Master part of the pseudo terminal */
+    int headless_;                               /**< Non-zero if the output is not shown */
+    uint8_t last_input_;                         /**< Last byte of input read, headless */
+    ps_log_t log_;                               /**< Log of the child's output */
+    ps_meta_t meta_;                             /**< Metadata stream of the log */
+    ps_journal_t journal_;                       /**< Shared journal, @c NULL with a log */
+    ps_text_t text_;                             /**< Plain text log, may be @c NULL */
+    ps_cast_t cast_;                             /**< asciicast recording, may be @c NULL */
+    ps_index_t index_;                           /**< Index of the log, may be @c NULL */
+    ps_view_t view_;                             /**< Ring for live viewers, may be @c NULL */
+    ps_cmd_t cmd_;                               /**< Command table of the log */
+    int winch_pipe_[2];                          /**< Self-pipe signalling @c SIGWINCH */
+    struct winsize win_size_;                    /**< Last size set on the master */
+    struct yanzc_buffer_t *io_buf_1_;            /**< Data from the standard input */
+    struct yanzc_chain_t *io_buf_2_;             /**< Data from the child process */
+    struct yanzc_chain_t *io_buf_3_;             /**< Redacted data, @c NULL without patterns */
+    struct yanzc_chain_t *log_stream_;           /**< What the logs get, chain 2 or chain 3 */
+    struct yanz_read_slice_t io_buf_1_read_slice_; /**< Reader writing to the master */
+    /** @brief Readers of the child's output: the standard output, then the log, the plain
+     * text log, the asciicast recording and the live viewers, which read from the log
+     * stream. */
+    struct yanzc_chain_reader_t io_buf_2_readers_[5];
+    struct yanzc_chain_reader_t redact_reader_;  /**< Feeds the redactor from chain 2 */
+    struct yanzc_chain_reader_t cmd_reader_;     /**< Looks for commands in chain 2 */
+    nt_redact_t *redact_;                        /**< Redactor, @c NULL without patterns */
+    uint8_t *redact_stage_;                      /**< Output of the redactor */
+    uint64_t output_ns_;                         /**< When the last output record was queued */
+    unsigned long display_lag_;                  /**< Display lag that makes it skip ahead */
+    uint64_t display_skipped_;                   /**< Bytes the display skipped in total */
+    uint64_t notice_skipped_;                    /**< Bytes the skip notice reports */
+    char notice_[96];                            /**< Skip notice, shown before the output */
+    unsigned int notice_len_;                    /**< Length of @c notice_ */
+    unsigned int notice_sent_;                   /**< Part of @c notice_ already shown */
+    nt_timerwheel_t timers_;                     /**< Deadlines of the relay */
+    uint64_t sync_interval_ns_;                  /**< Commit period of the log, 0 for none */
+    uint64_t scheduled_;                         /**< Log length the deadlines were set for */
+    nt_timer_t sync_timer_;                      /**< Commits the log once the period is over */
+    nt_timer_t index_poll_timer_;                /**< Has the index pick up the latest data */
+    nt_timer_t index_idle_timer_;                /**< Ends the index segment on a pause */
+    const struct ps_config_t *config_;           /**< Configuration of the session */
+    ps_sealer_t sealer_;                         /**< Seals finished segments, may be @c NULL */
+    char *first_name_;                           /**< Name of the first segment of the log */
+    unsigned int segment_;                       /**< Number of the current segment, from 0 */
+    uint64_t log_base_;                          /**< Log stream offset the segment starts at */
+    int rotate_due_;                             /**< Non-zero once the segment should end */
+    nt_timer_t rotate_timer_;                    /**< Ends the segment once it is old enough */
+    nt_budget_t budget_;                         /**< Memory held by the session */
+    nt_timer_t memory_timer_;                    /**< Wakes the relay up to look at it again */
+    size_t read_charge_;                         /**< Memory a read from the child may take */
+    size_t segment_charge_;                      /**< Memory a segment of the log takes */
+    size_t memory_noted_;                        /**< Most memory held last noted */
+};
+
+/**
+ * @brief Returns the time on the clock of the timer wheel of the relay.
+ * @return Nanoseconds of @c CLOCK_MONOTONIC.
+ */
+static uint64_t relay_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Commits the log once the commit period is over.
+ * @param context the session.
+ */
+static void session_sync_due(void *context) {
+    struct ps_session_t *session = context;
+    ps_log_commit(session->log_);
+}
+
+/**
+ * @brief Has the index thread pick up log data that did not wake it up.
+ * @param context the session.
+ */
+static void session_index_poll_due(void *context) {
+    struct ps_session_t *session = context;
+    if (NULL != session->index_) {
+        ps_index_wake(session->index_, 0);
+    }
+}
+
+/**
+ * @brief Has the index thread end its segment once the output has paused.
+ * @param context the session.
+ */
+static void session_index_idle_due(void *context) {
+    struct ps_session_t *session = context;
+    if (NULL != session->index_) {
+        ps_index_wake(session->index_, 1);
+    }
+}
+
+/**
+ * @brief Only wakes the relay up, for it to look at the memory budget again.
+ * @param context the session.
+ */
+static void session_memory_due(void *context) { (void)(context); }
+
+/**
+ * @brief Has the segment end once it is old enough.
+ * @param context the session.
+ */
+static void session_rotate_due(void *context) {
+    struct ps_session_t *session = context;
+    session->rotate_due_ = 1;
+}
+
+/**
+ * @brief Notes the memory held by the session in the metadata.
+ * @details A note is queued whenever the most memory held has grown by
+ * @ref MEMORY_NOTE_STEP since the last one, and once more as the segment ends.
+ * @param session the session.
+ * @param force non-zero to queue a note whatever the growth.
+ */
+static void session_note_memory(struct ps_session_t *session, int force) {
+    size_t peak = nt_budget_peak(&session->budget_);
+    uint64_t offset;
+    if (NULL == session->meta_) {
+        return;
+    }
+    if (!force && peak < session->memory_noted_ + MEMORY_NOTE_STEP) {
+        return;
+    }
+    offset = NULL != session->log_stream_
+                 ? session->log_stream_->offset_write_ - session->log_base_
+                 : 0;
+    if (0 == ps_meta_append(session->meta_, PS_META_MEMORY, offset,
+                            (uint32_t)(nt_budget_used(&session->budget_) >> 10),
+                            (uint32_t)(peak >> 10))) {
+        session->memory_noted_ = peak;
+    }
+}
+
+/**
+ * @brief Releases a session and everything it owns.
+ * @param session the session, may be partially constructed.
+ */
+static void session_free(struct ps_session_t *session) {
+    int error;
+    session_note_memory(session, 1);
+    LOG_DEBUG("memory %zu bytes at most", nt_budget_peak(&session->budget_));
+    ps_text_close(session->text_);
+    ps_cast_close(session->cast_);
+    ps_view_close(session->view_);
+    error = ps_log_close(session->log_);
+    if (0 != error) {
+        fprintf(stderr, "pseudoshell: the end of the log may be missing, %s\r\n", strerror(error));
+    }
+    ps_journal_close(session->journal_);
+    ps_index_close(session->index_);
+    ps_cmd_close(session->cmd_, NULL != session->log_stream_
+                                    ? session->log_stream_->offset_write_ - session->log_base_
+                                    : 0);
+    ps_sealer_stop(session->sealer_);
+    nt_pool_free(session->first_name_);
+    if (session->winch_pipe_[0] >= 0) {
+        s_winch_fd = -1;
+        close(session->winch_pipe_[0]);
+        close(session->winch_pipe_[1]);
+    }
+    io_buffer_free(session->io_buf_1_);
+    io_chain_reader_detach(&session->io_buf_2_readers_[0]);
+    io_chain_reader_detach(&session->io_buf_2_readers_[1]);
+    io_chain_reader_detach(&session->io_buf_2_readers_[2]);
+    io_chain_reader_detach(&session->io_buf_2_readers_[3]);
+    io_chain_reader_detach(&session->io_buf_2_readers_[4]);
+    io_chain_reader_detach(&session->redact_reader_);
+    io_chain_reader_detach(&session->cmd_reader_);
+    io_chain_free(session->io_buf_3_);
+    io_chain_free(session->io_buf_2_);
+    if (NULL != session->redact_) {
+        LOG_DEBUG("%llu secrets redacted", (unsigned long long)session->redact_->matches_);
+    }
+    nt_budget_free(&session->budget_, session->redact_stage_);
+    nt_budget_free(&session->budget_, session->redact_);
+    nt_pool_free(session);
+}
+
+/**
+ * @brief Opens the log of a session and the files that go with it.
+ * @param session the session.
+ * @param config configuration of the session.
+ * @return 0 on success, -1 otherwise, the error reported.
+ */
+static int session_open_log(struct ps_session_t *session, const struct ps_config_t *config) {
+    ps_log_config_t log_config = config->log_;
+    log_config.budget_ = &session->budget_;
+    session->log_ = ps_log_open(&log_config);
+    session->segment_charge_ = nt_budget_used(&session->budget_);
+    if (NULL == session->log_) {
+        perror("ps_log_open");
+        return -1;
+    }
+    session->meta_ = ps_log_meta(session->log_);
+    if (config->text_ && NULL == (session->text_ = ps_text_open(ps_log_name(session->log_)))) {
+        perror("ps_text_open");
+        return -1;
+    }
+    if (0 != config->index_ &&
+        NULL == (session->index_ = ps_index_open(ps_log_name(session->log_), config->index_))) {
+        perror("ps_index_open");
+        return -1;
+    }
+    if (0 != config->view_ &&
+        NULL == (session->view_ = ps_view_open(ps_log_name(session->log_), config->view_))) {
+        perror("ps_view_open");
+        return -1;
+    }
+    if (NULL != session->view_) {
+        nt_budget_charge(&session->budget_, ps_view_size(session->view_));
+    }
+    session->cmd_ = ps_cmd_open(ps_log_name(session->log_), config->prompt_, 0);
+    if (NULL == session->cmd_) {
+        perror("ps_cmd_open");
+        return -1;
+    }
+    if (0 != config->rotate_.size_ || 0 != config->rotate_.age_ns_) {
+        const char *name = ps_log_name(session->log_);
+        session->first_name_ = nt_pool_alloc(strlen(name) + 1);
+        if (NULL == session->first_name_) {
+            perror("nt_pool_alloc");
+            return -1;
+        }
+        strcpy(session->first_name_, name);
+        /* Without the thread, segments are sealed by the relay */
+        session->sealer_ = ps_sealer_start();
+        if (NULL == session->sealer_) {
+            LOG_DEBUG("%d %s", errno, strerror(errno));
+        }
+        if (0 != config->rotate_.age_ns_) {
+            nt_timer_arm(&session->timers_, &session->rotate_timer_,
+                         relay_now() + config->rotate_.age_ns_);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Opens the shared journal for a session, which goes without any other file.
+ * @details The session is labelled with the host and the process, for the readers of the
+ * journal to tell the sessions apart.
+ * @param session the session.
+ * @param config configuration of the session.
+ * @return 0 on success, -1 otherwise, the error reported.
+ */
+static int session_open_journal(struct ps_session_t *session, const struct ps_config_t *config) {
+    char label[96], host[64];
+    if (0 != gethostname(host, sizeof(host))) {
+        strcpy(host, "localhost");
+    }
+    host[sizeof(host) - 1] = '\0';
+    snprintf(label, sizeof(label), "%s:%ld", host, (long)getpid());
+    session->journal_ = ps_journal_open(config->journal_, label);
+    if (NULL == session->journal_) {
+        perror(config->journal_);
+        return -1;
+    }
+    LOG_DEBUG("%s %016llx", label, (unsigned long long)ps_journal_session(session->journal_));
+    return 0;
+}
+
+/**
+ * @brief Creates a session: opens the log file and allocates relay buffers.
+ * @param fd_master master part of the pseudo terminal.
+ * @param config configuration of the session.
+ * @return The session or @c NULL.
+ */
+static struct ps_session_t *session_new(int fd_master, const struct ps_config_t *config) {
+    struct ps_session_t *session = nt_pool_zalloc(sizeof(struct ps_session_t));
+    unsigned int to_child_size = IO_TO_CHILD_BUFSIZE;
+    unsigned int segment_size = IO_FROM_CHILD_BUFSIZE, segments = IO_FROM_CHILD_SEGMENTS;
+    size_t needed;
+    if (NULL == session) {
+        return NULL;
+    }
+    nt_budget_init(&session->budget_, config->memory_);
+    session->fd_master_ = fd_master;
+    session->config_ = config;
+    session->headless_ = config->headless_;
+    session->last_input_ = '\n';
+    if (session->headless_) {
+        to_child_size = HEADLESS_TO_CHILD_BUFSIZE;
+        segment_size = HEADLESS_FROM_CHILD_BUFSIZE;
+        segments = HEADLESS_FROM_CHILD_SEGMENTS;
+    }
+    session->winch_pipe_[0] = session->winch_pipe_[1] = -1;
+    nt_timerwheel_init(&session->timers_, RELAY_TICK_NS, relay_now());
+    session->sync_timer_ = (nt_timer_t){.fire_ = session_sync_due, .context_ = session};
+    session->index_poll_timer_ = (nt_timer_t){.fire_ = session_index_poll_due, .context_ = session};
+    session->index_idle_timer_ = (nt_timer_t){.fire_ = session_index_idle_due, .context_ = session};
+    session->rotate_timer_ = (nt_timer_t){.fire_ = session_rotate_due, .context_ = session};
+    session->memory_timer_ = (nt_timer_t){.fire_ = session_memory_due, .context_ = session};
+    if (PS_LOG_SYNC_INTERVAL == config->log_.durability_) {
+        session->sync_interval_ns_ = config->log_.sync_interval_ms_ * 1000000ULL;
+    }
+    /* The display has to skip before its lag fills the chain up and stalls the child */
+    session->display_lag_ = config->display_lag_;
+    if (session->display_lag_ > IO_FROM_CHILD_BUFSIZE * IO_FROM_CHILD_SEGMENTS / 2) {
+        session->display_lag_ = IO_FROM_CHILD_BUFSIZE * IO_FROM_CHILD_SEGMENTS / 2;
+    }
+    if (0 != (NULL != config->journal_ ? session_open_journal(session, config)
+                                       : session_open_log(session, config))) {
+        session_free(session);
+        return NULL;
+    }
+    if (0 != pipe(session->winch_pipe_)) {
+        session->winch_pipe_[0] = session->winch_pipe_[1] = -1;
+        perror("pipe");
+        session_free(session);
+        return NULL;
+    }
+    evutil_make_socket_nonblocking(session->winch_pipe_[0]);
+    evutil_make_socket_nonblocking(session->winch_pipe_[1]);
+    evutil_make_socket_closeonexec(session->winch_pipe_[0]);
+    evutil_make_socket_closeonexec(session->winch_pipe_[1]);
+    s_winch_fd = session->winch_pipe_[1];
+    /* Record the initial size, so a player starts with the right layout */
+    if (0 == ioctl(fd_master, TIOCGWINSZ, &session->win_size_)) {
+        if (NULL != session->journal_) {
+            ps_journal_resize(session->journal_, session->win_size_.ws_row,
+                              session->win_size_.ws_col);
+        } else {
+            ps_meta_append(session->meta_, PS_META_RESIZE, 0, session->win_size_.ws_row,
+                           session->win_size_.ws_col);
+        }
+    }
+    if (config->cast_ &&
+        NULL == (session->cast_ = ps_cast_open(ps_log_name(session->log_),
+                                               session->win_size_.ws_row,
+                                               session->win_size_.ws_col))) {
+        perror("ps_cast_open");
+        session_free(session);
+        return NULL;
+    }
+    session->io_buf_1_ = io_buffer_new_charged(to_child_size, &session->budget_);
+    session->io_buf_2_ = io_chain_new_charged(segment_size, segments, &session->budget_);
+    session->read_charge_ = segment_size;
+    if (NULL == session->io_buf_1_ || NULL == session->io_buf_2_) {
+        session_free(session);
+        return NULL;
+    }
+    session->log_stream_ = session->io_buf_2_;
+    if (NULL != config->redact_) {
+        /* Logs get the output only after it has been through the redactor */
+        session->io_buf_3_ = io_chain_new_charged(segment_size, segments, &session->budget_);
+        session->redact_ = nt_budget_alloc(&session->budget_, sizeof(nt_redact_t));
+        session->redact_stage_ =
+            nt_budget_alloc(&session->budget_, NT_REDACT_OUTPUT_SIZE(REDACT_CHUNK));
+        /* What is read is copied once redacted */
+        session->read_charge_ += segment_size;
+        if (NULL == session->io_buf_3_ || NULL == session->redact_ ||
+            NULL == session->redact_stage_) {
+            session_free(session);
+            return NULL;
+        }
+        nt_redact_init(session->redact_, config->redact_);
+        io_chain_reader_attach(session->io_buf_2_, &session->redact_reader_);
+        session->log_stream_ = session->io_buf_3_;
+    }
+    session->io_buf_1_read_slice_ = io_buffer_get_read_slice(session->io_buf_1_, 0);
+    /* Without a display, nothing should wait for one */
+    if (!session->headless_) {
+        io_chain_reader_attach(session->io_buf_2_, &session->io_buf_2_readers_[0]);
+    }
+    if (NULL != session->cmd_) {
+        io_chain_reader_attach(session->io_buf_2_, &session->cmd_reader_);
+    }
+    io_chain_reader_attach(session->log_stream_, &session->io_buf_2_readers_[1]);
+    if (NULL != session->text_) {
+        io_chain_reader_attach(session->log_stream_, &session->io_buf_2_readers_[2]);
+    }
+    if (NULL != session->cast_) {
+        io_chain_reader_attach(session->log_stream_, &session->io_buf_2_readers_[3]);
+    }
+    if (NULL != session->view_) {
+        io_chain_reader_attach(session->log_stream_, &session->io_buf_2_readers_[4]);
+    }
+    /* The next segment of the log is opened while the last one is still being sealed */
+    needed = MEMORY_MIN_READS * session->read_charge_ +
+             (NULL != session->first_name_ ? session->segment_charge_ : 0);
+    if (nt_budget_room(&session->budget_) < needed) {
+        fprintf(stderr, "pseudoshell: a memory budget of at least %zuk is needed\r\n",
+                (nt_budget_used(&session->budget_) + needed + 1023) >> 10);
+        session_free(session);
+        return NULL;
+    }
+    return session;
+}
+
+/**
+ * @brief Lets the display skip ahead if it has fallen too far behind.
+ * @details The standard output reader jumps forward, keeping about a screenful of the latest
+ * output, and resumes at the start of a line so that the terminal is not fed half of an escape
+ * sequence. Skipped output is replaced by a notice. The log reader is not touched: the log
+ * keeps every byte, and a slow terminal no longer holds the child back.
+ * @param session the session.
+ */
+static void session_skip_display(struct ps_session_t *session) {
+    struct yanzc_chain_reader_t *to_stdout = &session->io_buf_2_readers_[0];
+    unsigned long keep = (unsigned long)session->win_size_.ws_row * session->win_size_.ws_col;
+    unsigned long pending, skipped, scanned = 0;
+    struct iovec iov[16];
+    int n_iov, idx;
+    if (0 == session->display_lag_ || session->headless_) {
+        return;
+    }
+    pending = io_chain_reader_pending(to_stdout);
+    if (pending <= session->display_lag_) {
+        return;
+    }
+    if (keep < DISPLAY_KEEP_MIN) {
+        keep = DISPLAY_KEEP_MIN;
+    }
+    if (keep > session->display_lag_ / 2) {
+        keep = session->display_lag_ / 2;
+    }
+    skipped = pending - keep;
+    io_chain_reader_advance(to_stdout, skipped);
+    n_iov = io_chain_reader_get_iov(to_stdout, iov, sizeof(iov) / sizeof(iov[0]));
+    for (idx = 0; idx < n_iov; ++idx) {
+        const char *line_end = memchr(iov[idx].iov_base, '\n', iov[idx].iov_len);
+        if (NULL != line_end) {
+            scanned += (unsigned long)(line_end + 1 - (const char *)iov[idx].iov_base);
+            io_chain_reader_advance(to_stdout, scanned);
+            skipped += scanned;
+            break;
+        }
+        scanned += iov[idx].iov_len;
+    }
+    session->display_skipped_ += skipped;
+    /* A notice that is being shown is left alone, one not shown yet is updated */
+    if (0 == session->notice_sent_ || session->notice_sent_ == session->notice_len_) {
+        if (0 != session->notice_sent_) {
+            session->notice_skipped_ = 0;
+        }
+        session->notice_skipped_ += skipped;
+        session->notice_len_ = (unsigned int)snprintf(
+            session->notice_, sizeof(session->notice_),
+            "\033[0m\r\n[pseudoshell: %llu bytes of output not shown, the log has them]\r\n",
+            (unsigned long long)session->notice_skipped_);
+        if (session->notice_len_ >= sizeof(session->notice_)) {
+            session->notice_len_ = sizeof(session->notice_) - 1;
+        }
+        session->notice_sent_ = 0;
+    }
+}
+
+/**
+ * @brief Takes note of output just read from the child.
+ * @details Queues an output record with the log offset the output starts at, unless one was
+ * queued less than @ref PS_META_OUTPUT_NS ago, looks for command boundaries and lets the
+ * display skip ahead if need be. All of that is timed as the output shows up.
+ * @param session the session.
+ * @param start chain 2 offset the output starts at. Redacting keeps the length, so the same
+ * offset into the log stream has the same byte, whether or not the redactor still holds it.
+ */
+static void session_output(struct ps_session_t *session, unsigned long start) {
+    if (NULL != session->meta_ && session->io_buf_2_->offset_write_ != start) {
+        uint64_t now = ps_meta_now();
+        if (now - session->output_ns_ >= PS_META_OUTPUT_NS &&
+            0 == ps_meta_append(session->meta_, PS_META_OUTPUT, start - session->log_base_, 0,
+                                0)) {
+            session->output_ns_ = now;
+        }
+    }
+    if (NULL != session->cmd_) {
+        ps_cmd_scan(session->cmd_, &session->cmd_reader_);
+    }
+    session_skip_display(session);
+    session_note_memory(session, 0);
+}
+
+/**
+ * @brief Returns the number of bytes waiting to be shown on the standard output.
+ * @param session the session.
+ * @return Number of bytes.
+ */
+static unsigned long session_display_pending(const struct ps_session_t *session) {
+    if (session->headless_) {
+        return 0;
+    }
+    return io_chain_reader_pending(&session->io_buf_2_readers_[0]) +
+           (session->notice_len_ - session->notice_sent_);
+}
+
+/**
+ * @brief Writes the child's output, preceded by the skip notice if any, to the standard output.
+ * @param session the session.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int session_write_display(struct ps_session_t *session) {
+    if (session->notice_sent_ < session->notice_len_) {
+        ssize_t sent = write(STDOUT_FILENO, session->notice_ + session->notice_sent_,
+                             session->notice_len_ - session->notice_sent_);
+        if (sent < 0) {
+            return EAGAIN == errno || EINTR == errno ? 0 : errno;
+        }
+        session->notice_sent_ += (unsigned int)sent;
+        if (session->notice_sent_ < session->notice_len_) {
+            return 0;
+        }
+    }
+    return from_chain_to_fd(&session->io_buf_2_readers_[0], STDOUT_FILENO);
+}
+
+/**
+ * @brief Tells the child that the input is over, as a terminal does on Ctrl+D.
+ * @details Used in headless mode once the input file is exhausted. A last line without a line
+ * feed gets one, then a single end of file character follows, at the start of a line, where
+ * a reader in canonical mode gets it as an empty read: exactly one end of file, whatever the
+ * reader. Both are queued like any input; there is room for them, input is only read while
+ * there is room for @ref INPUT_END_MAX bytes. Nothing else is sent to the child afterwards. @n
+ * As on a terminal, a command reading again after its end of file waits for more input,
+ * which never comes. A command that reads its terminal in raw mode, such as a shell with line
+ * editing, takes both bytes as ordinary input; one that does not read its input ignores them.
+ * @param session the session.
+ */
+static void session_end_input(struct ps_session_t *session) {
+    struct termios attributes;
+    uint8_t *end = io_buffer_get_buf_for_writes(session->io_buf_1_);
+    unsigned long count = 0;
+    if ('\n' != session->last_input_) {
+        end[count++] = '\n';
+    }
+    end[count] = 'D' & 0x1f;
+    if (0 == tcgetattr(session->fd_master_, &attributes)) {
+        end[count] = attributes.c_cc[VEOF];
+    }
+    io_buffer_move_write_offset(session->io_buf_1_, count + 1);
+}
+
+/**
+ * @brief Moves the child's output through the redactor into the log stream.
+ * @details Takes only as much as the log stream has room for: a full log stream holds the
+ * child back, like any slow reader of chain 2 does.
+ * @param session the session.
+ */
+static void session_redact(struct ps_session_t *session) {
+    struct iovec iov[16];
+    int n_iov, idx;
+    if (NULL == session->redact_) {
+        return;
+    }
+    n_iov = io_chain_reader_get_iov(&session->redact_reader_, iov, sizeof(iov) / sizeof(iov[0]));
+    for (idx = 0; idx < n_iov; ++idx) {
+        const uint8_t *data = iov[idx].iov_base;
+        size_t left = iov[idx].iov_len;
+        while (left > 0) {
+            unsigned long room = io_chain_get_size_for_writes(session->io_buf_3_);
+            size_t chunk = left < REDACT_CHUNK ? left : REDACT_CHUNK;
+            if (room < NT_REDACT_OUTPUT_SIZE(chunk)) {
+                if (room <= NT_REDACT_MAX_PATTERN) {
+                    return;
+                }
+                chunk = room - NT_REDACT_MAX_PATTERN;
+            }
+            io_chain_append(session->io_buf_3_, session->redact_stage_,
+                            nt_redact_feed(session->redact_, data, chunk, session->redact_stage_));
+            io_chain_reader_advance(&session->redact_reader_, chunk);
+            data += chunk;
+            left -= chunk;
+        }
+    }
+}
+
+/**
+ * @brief Returns the number of bytes waiting to be written to the logs.
+ * @details Bytes the redactor holds back are not counted, they wait for more output.
+ * @param session the session.
+ * @return Number of bytes.
+ */
+static unsigned long session_log_pending(const struct ps_session_t *session) {
+    unsigned long pending = io_chain_reader_pending(&session->io_buf_2_readers_[1]);
+    if (NULL != session->text_) {
+        pending += io_chain_reader_pending(&session->io_buf_2_readers_[2]);
+    }
+    if (NULL != session->cast_) {
+        pending += io_chain_reader_pending(&session->io_buf_2_readers_[3]);
+    }
+    if (NULL != session->view_) {
+        pending += io_chain_reader_pending(&session->io_buf_2_readers_[4]);
+    }
+    if (NULL != session->redact_) {
+        pending += io_chain_reader_pending(&session->redact_reader_);
+    }
+    return pending;
+}
+
+/**
+ * @brief Sets the deadlines that follow new data in the log.
+ * @details The commit is due one period after the first data it would commit, the index
+ * catches up within @ref PS_INDEX_POLL_NS, and ends its segment once the log has not grown for
+ * @ref PS_INDEX_IDLE_NS. With no new data, none is set, and an idle session wakes nothing up.
+ * @param session the session.
+ */
+static void session_schedule(struct ps_session_t *session) {
+    uint64_t written, now;
+    if (NULL == session->log_) {
+        return;
+    }
+    written = ps_log_written(session->log_);
+    if (written == session->scheduled_) {
+        return;
+    }
+    session->scheduled_ = written;
+    if (0 != session->config_->rotate_.size_ && written >= session->config_->rotate_.size_) {
+        session->rotate_due_ = 1;
+    }
+    now = relay_now();
+    if (0 != session->sync_interval_ns_ && !nt_timer_armed(&session->sync_timer_)) {
+        nt_timer_arm(&session->timers_, &session->sync_timer_, now + session->sync_interval_ns_);
+    }
+    if (NULL != session->index_) {
+        if (!nt_timer_armed(&session->index_poll_timer_)) {
+            nt_timer_arm(&session->timers_, &session->index_poll_timer_, now + PS_INDEX_POLL_NS);
+        }
+        nt_timer_arm(&session->timers_, &session->index_idle_timer_, now + PS_INDEX_IDLE_NS);
+    }
+}
+
+/**
+ * @brief Writes the child's output to the log, the plain text log and the recording, and
+ * publishes it to the live viewers.
+ * @param session the session.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int session_write_log(struct ps_session_t *session) {
+    int result;
+    session_redact(session);
+    if (NULL != session->view_) {
+        ps_view_publish(session->view_, &session->io_buf_2_readers_[4]);
+    }
+    if (NULL != session->journal_) {
+        return ps_journal_write(session->journal_, &session->io_buf_2_readers_[1]);
+    }
+    result = ps_log_write(session->log_, &session->io_buf_2_readers_[1]);
+    if (NULL != session->index_) {
+        ps_index_advance(session->index_, ps_log_written(session->log_));
+    }
+    session_schedule(session);
+    if (0 == result && NULL != session->text_) {
+        result = ps_text_write(session->text_, &session->io_buf_2_readers_[2]);
+    }
+    if (0 == result && NULL != session->cast_) {
+        result = ps_cast_write(session->cast_, &session->io_buf_2_readers_[3]);
+    }
+    return result;
+}
+
+/**
+ * @brief Keeps a reader attached to a chain only while there is a writer for what it reads.
+ * @param chain the chain.
+ * @param reader the reader.
+ * @param writer the writer, may be @c NULL.
+ */
+static void session_follow(struct yanzc_chain_t *chain, struct yanzc_chain_reader_t *reader,
+                           const void *writer) {
+    if (NULL == writer) {
+        io_chain_reader_detach(reader);
+    } else if (NULL == reader->chain_) {
+        io_chain_reader_attach(chain, reader);
+    }
+}
+
+/**
+ * @brief Ends the current segment of the log and starts the next one.
+ * @details Called between two writes, once the logs have everything read from the child so
+ * far, so that the segments neither miss nor repeat a byte. The boundary is taken from the log
+ * stream, bytes the redactor still holds go to the new segment. The parts of the new segment are
+ * opened right away, the old ones are handed over to the sealer. A part of the new segment
+ * failing to open goes without, the segment is not ended at all if the log fails to.
+ * @param session the session.
+ * @return 0 on success, @c errno value otherwise.
+ */
+static int session_rotate(struct ps_session_t *session) {
+    const struct ps_config_t *config = session->config_;
+    ps_log_config_t log_config = config->log_;
+    uint64_t base = session->log_stream_->offset_write_;
+    log_config.budget_ = &session->budget_;
+    ps_seal_job_t job = {.log_ = session->log_,
+                         .index_ = session->index_,
+                         .text_ = session->text_,
+                         .cast_ = session->cast_,
+                         .cmd_ = session->cmd_,
+                         .end_ = base - session->log_base_};
+    char *name = ps_rotate_name(session->first_name_, session->segment_ + 1);
+    ps_log_t log;
+    session->rotate_due_ = 0;
+    if (0 != config->rotate_.age_ns_) {
+        nt_timer_arm(&session->timers_, &session->rotate_timer_,
+                     relay_now() + config->rotate_.age_ns_);
+    }
+    if (NULL == name) {
+        return ENOMEM;
+    }
+    log_config.file_name_ = name;
+    log = ps_log_open(&log_config);
+    if (NULL == log) {
+        int error = errno;
+        LOG_DEBUG("%s: %d %s", name, error, strerror(error));
+        nt_pool_free(name);
+        return error;
+    }
+    session_note_memory(session, 1);
+    ++session->segment_;
+    session->log_ = log;
+    session->meta_ = ps_log_meta(log);
+    session->log_base_ = base;
+    session->scheduled_ = 0;
+    session->output_ns_ = 0;
+    session->text_ = config->text_ ? ps_text_open(name) : NULL;
+    session->index_ = 0 != config->index_ ? ps_index_open(name, config->index_) : NULL;
+    session->cmd_ = ps_cmd_open(name, config->prompt_, base);
+    session->cast_ = config->cast_ ? ps_cast_open(name, session->win_size_.ws_row,
+                                                  session->win_size_.ws_col)
+                                   : NULL;
+    if ((config->text_ && NULL == session->text_) || (config->cast_ && NULL == session->cast_) ||
+        (0 != config->index_ && NULL == session->index_) || NULL == session->cmd_) {
+        LOG_DEBUG("%s: %d %s", name, errno, strerror(errno));
+    }
+    session_follow(session->log_stream_, &session->io_buf_2_readers_[2], session->text_);
+    session_follow(session->log_stream_, &session->io_buf_2_readers_[3], session->cast_);
+    session_follow(session->io_buf_2_, &session->cmd_reader_, session->cmd_);
+    nt_timer_cancel(&session->timers_, &session->index_poll_timer_);
+    nt_timer_cancel(&session->timers_, &session->index_idle_timer_);
+    ps_meta_append(session->meta_, PS_META_RESIZE, 0, session->win_size_.ws_row,
+                   session->win_size_.ws_col);
+    nt_pool_free(name);
+    ps_sealer_submit(session->sealer_, &job);
+    return 0;
+}
+
+/**
+ * @brief Returns the descriptor the output of the child is logged to.
+ * @param session the session.
+ * @return The descriptor of the log or of the journal.
+ */
+static int session_log_fd(const struct ps_session_t *session) {
+    return NULL != session->journal_ ? ps_journal_fd(session->journal_)
+                                     : ps_log_fd(session->log_);
+}
+
+/**
+ * @brief Finds the highest descriptor the relay waits for.
+ * @param session the session.
+ * @param fd_in the master part of the pseudo terminal.
+ * @return One more than the highest descriptor.
+ */
+static int session_maxfd(const struct ps_session_t *session, int fd_in) {
+    int fds[] = {fd_in, session_log_fd(session),
+                 NULL != session->meta_ ? ps_meta_fd(session->meta_) : -1,
+                 session->winch_pipe_[0], STDIN_FILENO, STDOUT_FILENO,
+                 NULL != session->view_ ? ps_view_fd(session->view_) : -1};
+    size_t fd_idx;
+    int maxfd = 0;
+    for (fd_idx = 0; fd_idx < sizeof(fds) / sizeof(fds[0]); ++fd_idx) {
+        if (maxfd < fds[fd_idx]) {
+            maxfd = fds[fd_idx];
+        }
+    }
+    return maxfd + 1;
+}
+
+/**
+ * @brief Writes everything pending to the logs.
+ * @param session the session.
+ */
+static void session_flush_log(struct ps_session_t *session) {
+    while (session_log_pending(session) > 0 && 0 == session_write_log(session)) {
+    }
+}
+
+/**
+ * @brief Propagates a change of the terminal size to the child.
+ * @details Called when the self-pipe is readable. The new size is set on the master, which
+ * makes the kernel send @c SIGWINCH to the child's foreground process group, and recorded
+ * in the metadata together with the log offset it takes effect at. The output read before
+ * the resize goes to the asciicast recording first, so that the events come in order.
+ * @param session the session.
+ */
+static void session_resize(struct ps_session_t *session) {
+    char drain[64];
+    struct winsize win_size;
+    while (read(session->winch_pipe_[0], drain, sizeof(drain)) > 0) {
+    }
+    if (0 == ioctl(STDIN_FILENO, TIOCGWINSZ, &win_size) &&
+        (win_size.ws_row != session->win_size_.ws_row ||
+         win_size.ws_col != session->win_size_.ws_col) &&
+        0 == ioctl(session->fd_master_, TIOCSWINSZ, &win_size)) {
+        session->win_size_ = win_size;
+        if (NULL != session->journal_) {
+            /* The journal has no offsets, the output read before the resize goes in first */
+            session_redact(session);
+            ps_journal_write(session->journal_, &session->io_buf_2_readers_[1]);
+            ps_journal_resize(session->journal_, win_size.ws_row, win_size.ws_col);
+        } else {
+            ps_meta_append(session->meta_, PS_META_RESIZE,
+                           session->log_stream_->offset_write_ - session->log_base_,
+                           win_size.ws_row, win_size.ws_col);
+        }
+        if (NULL != session->cast_) {
+            session_redact(session);
+            ps_cast_write(session->cast_, &session->io_buf_2_readers_[3]);
+            ps_cast_resize(session->cast_, win_size.ws_row, win_size.ws_col);
+        }
+    }
+}
+
+/**
+ * @brief Flushes the output the child has left behind.
+ * @details Once the child is gone, its last output may still sit in the pseudo terminal
+ * and in the chain. The pseudo terminal is read until it reports an error, which it does
+ * when the slave part is closed and drained. Everything is then written out. The drain
+ * gives up if nothing moves for a second.
+ * @param session the session.
+ */
+static void session_drain(struct ps_session_t *session) {
+    struct yanzc_chain_t *chain = session->io_buf_2_;
+    int master_open = 1;
+    while (master_open || session_display_pending(session) > 0) {
+        unsigned long start = chain->offset_write_;
+        fd_set readset, writeset;
+        struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+        FD_ZERO(&readset);
+        FD_ZERO(&writeset);
+        if (master_open && io_chain_is_space_for_writes(chain)) {
+            FD_SET(session->fd_master_, &readset);
+        }
+        if (session_display_pending(session) > 0) {
+            FD_SET(STDOUT_FILENO, &writeset);
+        }
+        if (select(session->fd_master_ + 1, &readset, &writeset, NULL, &timeout) <= 0) {
+            break;
+        }
+        if (FD_ISSET(session->fd_master_, &readset) &&
+            0 != from_fd_to_chain(session->fd_master_, chain)) {
+            master_open = 0;
+        }
+        session_output(session, start);
+        if (FD_ISSET(STDOUT_FILENO, &writeset) && 0 != session_write_display(session)) {
+            break;
+        }
+        session_flush_log(session);
+    }
+    session_flush_log(session);
+    if (NULL != session->redact_) {
+        /* Whatever the redactor still holds is not a secret, the output is over */
+        io_chain_append(session->io_buf_3_, session->redact_stage_,
+                        nt_redact_finish(session->redact_, session->redact_stage_));
+        session_flush_log(session);
+    }
+}
+
 /**
  * @brief Master/slave communication routine.
  * @details
  * @param[in] fd_in - handle of the master part of the pseudo terminal. @n
  * We use this handle to read standard input of a child process and to write
  * to its standard output.
+ * @param[in] config configuration of the session.
  * @return
  */
-static int pass_all(int fd_in) {
+static int pass_all(int fd_in, const struct ps_config_t *config) {
     fd_set readset, readset_copy;
     fd_set writeset, writeset_copy;
     int maxfd;
     int fd_log;
+    int input_open = 1;
     sigset_t blockset;
 
-    char *log_file_name = strdup(file_name);
-    fd_log = mkstemp(log_file_name);
-    if (fd_log < 0 || evutil_make_socket_nonblocking(fd_log) < 0) {
-        perror("mkstemp");
+    struct ps_session_t *session = session_new(fd_in, config);
+    if (NULL == session) {
         return -1;
     }
-    struct yanzc_buffer_t *io_buf_1 = io_buffer_new(IO_TO_CHILD_BUFSIZE);
-    struct yanzc_buffer_t *io_buf_2 = io_buffer_new(IO_FROM_CHILD_BUFSIZE);
-
-    struct yanz_read_slice_t io_buf_1_read_slice = io_buffer_get_read_slice(io_buf_1, 0);
-    struct yanz_read_slice_t io_buf_2_read_slices[2] = {io_buffer_get_read_slice(io_buf_2, 0),
-                                                        io_buffer_get_read_slice(io_buf_2, 0)};
+    /* Only now, so that the threads of the session stay off the processor of the relay */
+    ps_latency_t latency = NULL;
+    uint64_t spin_ns = 1000ULL * config->latency_.spin_us_, spin_until = 0;
+    if (config->latency_.cpu_ >= 0 && NULL == (latency = ps_latency_start(&config->latency_))) {
+        perror("ps_latency_start");
+        session_free(session);
+        return -1;
+    }
+    fd_log = session_log_fd(session);
+    struct yanzc_buffer_t *io_buf_1 = session->io_buf_1_;
+    struct yanzc_chain_t *io_buf_2 = session->io_buf_2_;
+    struct yanz_read_slice_t *io_buf_1_read_slice = &session->io_buf_1_read_slice_;
 
     /* Set SIGCHLD handler */
     struct sigaction sa = {.sa_handler = NULL, .sa_flags = SA_SIGINFO};
@@ -190,6 +1182,11 @@ static int pass_all(int fd_in) {
     sigemptyset(&sa.sa_mask);
     sigaction(SIGCHLD, &sa, NULL);
 
+    /* Set SIGWINCH handler, restarting whatever it interrupts */
+    struct sigaction sa_winch = {.sa_handler = handle_winch, .sa_flags = SA_RESTART};
+    sigemptyset(&sa_winch.sa_mask);
+    sigaction(SIGWINCH, &sa_winch, NULL);
+
     /* SIGCHLD is still blocked */
     /* We set the signal mask to unblock SIGCHLD and then we pass it */
     /* to the pselect() call - this is the only way to reliably handle */
@@ -197,6 +1194,7 @@ static int pass_all(int fd_in) {
     sigemptyset(&blockset);
     sigfillset(&blockset);
     sigdelset(&blockset, SIGCHLD);
+    sigdelset(&blockset, SIGWINCH);
 
     LOG_DEBUG("%ld", (long int)quit);
 
@@ -206,8 +1204,13 @@ static int pass_all(int fd_in) {
     FD_ZERO(&writeset_copy);
 
     FD_SET(fd_in, &writeset_copy);
-    FD_SET(fd_in, &readset_copy);
-    FD_SET(STDIN_FILENO, &readset_copy);
+    FD_SET(session->winch_pipe_[0], &readset_copy);
+    if (NULL != session->view_) {
+        FD_SET(ps_view_fd(session->view_), &readset_copy);
+    }
+
+    /* The descriptors only change with the segment of the log, so does the highest one */
+    maxfd = session_maxfd(session, fd_in);
 
     /* Main loop
      * We multiplex between a number of file descriptors:
@@ -226,32 +1229,86 @@ static int pass_all(int fd_in) {
         /* Copy descriptor sets */
         memcpy(&readset, &readset_copy, sizeof(fd_set));
         memcpy(&writeset, &writeset_copy, sizeof(fd_set));
-        /* Find the maximum fd */
-        int idx;
-        maxfd = 0;
-        for (idx = 0; idx < FD_SETSIZE; ++idx) {
-            if (FD_ISSET(idx, &writeset_copy) || FD_ISSET(idx, &readset_copy)) {
-                if (maxfd < idx) {
-                    maxfd = idx;
-                }
+        /* Stop reading the child's output while the chain is at its limit, or the session
+         * has no room left in its memory budget for another read, and for the next segment of
+         * the log once it is due; the child stalls until slower readers catch up.
+         */
+        if (nt_budget_room(&session->budget_) <
+            session->read_charge_ + (session->rotate_due_ ? session->segment_charge_ : 0)) {
+            if (!nt_timer_armed(&session->memory_timer_)) {
+                nt_timer_arm(&session->timers_, &session->memory_timer_,
+                             relay_now() + MEMORY_RETRY_NS);
             }
+        } else if (io_chain_is_space_for_writes(io_buf_2)) {
+            FD_SET(fd_in, &readset);
+        }
+        /* Likewise, the input waits while the child does not take it, keeping room for what
+         * session_end_input() sends */
+        if (input_open && io_buffer_get_size_for_writes(io_buf_1) >= INPUT_END_MAX) {
+            FD_SET(STDIN_FILENO, &readset);
+        }
+        if (NULL != session->meta_ && ps_meta_pending(session->meta_) > 0) {
+            FD_SET(ps_meta_fd(session->meta_), &writeset);
         }
-        ++maxfd;
 
-        /* Do the multiplexing */
-        result = pselect(maxfd, &readset, &writeset, NULL, NULL, &blockset);
+        /* Do the multiplexing, polling for a while first after something was relayed, and
+         * waiting no longer than the next deadline.
+         */
+        uint64_t now = relay_now(), next = nt_timerwheel_next(&session->timers_);
+        struct timespec timeout = {0, 0};
+        if (0 != spin_ns && now < spin_until) {
+            /* A poll is progress as much as a wait, output keeps the relay spinning */
+            ps_latency_wait_begin(latency);
+            result = pselect(maxfd, &readset, &writeset, NULL, &timeout, &blockset);
+            ps_latency_wait_end(latency);
+        } else {
+            if (NT_TIMERWHEEL_NEVER != next && next > now) {
+                timeout.tv_sec = (time_t)((next - now) / 1000000000ULL);
+                timeout.tv_nsec = (long)((next - now) % 1000000000ULL);
+            }
+            ps_latency_wait_begin(latency);
+            result = pselect(maxfd, &readset, &writeset, NULL,
+                             NT_TIMERWHEEL_NEVER != next ? &timeout : NULL, &blockset);
+            ps_latency_wait_end(latency);
+        }
+        if (NT_TIMERWHEEL_NEVER != next) {
+            nt_timerwheel_run(&session->timers_, relay_now());
+        }
         if (result > 0) {
+            spin_until = 0 != spin_ns ? relay_now() + spin_ns : 0;
+            /* Has the terminal been resized? */
+            if (FD_ISSET(session->winch_pipe_[0], &readset)) {
+                session_resize(session);
+            }
+            /* Has a viewer come along? */
+            if (NULL != session->view_ && FD_ISSET(ps_view_fd(session->view_), &readset)) {
+                ps_view_accept(session->view_);
+            }
+            /* Can we write the metadata file? */
+            if (NULL != session->meta_ && FD_ISSET(ps_meta_fd(session->meta_), &writeset)) {
+                if (0 != ps_meta_flush(session->meta_)) {
+                    quit = 1;
+                }
+            }
             /* Is there something to read from standard input? */
             if (FD_ISSET(STDIN_FILENO, &readset)) {
                 /* Copy it to the buffer 1 */
                 result = from_fd_to_buffer(STDIN_FILENO, io_buf_1);
                 if (0 == result) {
+                    if (io_buf_1->offset_write_ > 0) {
+                        session->last_input_ = io_buf_1->data_[io_buf_1->offset_write_ - 1];
+                    }
                     /* Signal that buffer 1 can be copied:
                      * - to the log file
                      * - to the master part of the pseudo terminal.
                      */
                     FD_SET(fd_log, &writeset_copy);
                     FD_SET(fd_in, &writeset_copy);
+                } else if (session->headless_) {
+                    /* The input file is over, the child learns it like from a terminal */
+                    input_open = 0;
+                    session_end_input(session);
+                    FD_SET(fd_in, &writeset_copy);
                 } else {
                     quit = 1;
                 }
@@ -259,12 +1316,12 @@ static int pass_all(int fd_in) {
             /* Can we write the child processe's terminal? */
             if (FD_ISSET(fd_in, &writeset)) {
                 /* Copy data form the buffer 1 to this terminal */
-                result = from_buffer_to_fd(&io_buf_1_read_slice, fd_in);
+                result = from_buffer_to_fd(io_buf_1_read_slice, fd_in);
                 if (0 == result) {
                     /* If all was written, then signal that we no longer need
                      * to write to the standard master terminal.
                      */
-                    if (io_buf_1_read_slice.offset_read_ == io_buf_2->offset_write_) {
+                    if (io_buf_1_read_slice->offset_read_ == io_buf_1->offset_write_) {
                         FD_CLR(fd_in, &writeset_copy);
                     }
                 } else {
@@ -273,37 +1330,41 @@ static int pass_all(int fd_in) {
             }
             /* Is there something to read from child's processes terminal? */
             if (FD_ISSET(fd_in, &readset)) {
-                /* Copy it to the buffer 2 */
-                result = from_fd_to_buffer(fd_in, io_buf_2);
+                /* Append it to the chain 2 */
+                unsigned long start = io_buf_2->offset_write_;
+                result = from_fd_to_chain(fd_in, io_buf_2);
                 if (0 == result) {
-                    /* Signal that we need to write to the standard output */
-                    FD_SET(STDOUT_FILENO, &writeset_copy);
+                    session_output(session, start);
+                    /* Signal that we need to write to the standard output and the log */
+                    if (!session->headless_) {
+                        FD_SET(STDOUT_FILENO, &writeset_copy);
+                    }
+                    FD_SET(fd_log, &writeset_copy);
                 } else {
                     quit = 1;
                 }
             }
             /* Can we write to the standard output? */
             if (FD_ISSET(STDOUT_FILENO, &writeset)) {
-                /* Copy data form the buffer 2 to the standard output */
-                result = from_buffer_to_fd(&io_buf_2_read_slices[0], STDOUT_FILENO);
+                /* Copy data form the chain 2 to the standard output */
+                result = session_write_display(session);
                 if (0 == result) {
-                    if (io_buf_2_read_slices[0].offset_read_ == io_buf_2->offset_write_) {
+                    if (0 == session_display_pending(session)) {
                         /* If all was written, then signal that we no longer need
                          * to write to the standard output.
                          */
                         FD_CLR(STDOUT_FILENO, &writeset_copy);
                     }
-                    FD_SET(fd_log, &writeset_copy);
                 } else {
                     quit = 1;
                 }
             }
             /* Can we write to the log file? */
             if (FD_ISSET(fd_log, &writeset)) {
-                /* Copy data form the buffer 2 to the log file */
-                result = from_buffer_to_fd(&io_buf_2_read_slices[1], fd_log);
+                /* Copy data form the chain 2 to the log files */
+                result = session_write_log(session);
                 if (0 == result) {
-                    if (io_buf_2_read_slices[1].offset_read_ == io_buf_2->offset_write_) {
+                    if (0 == session_log_pending(session)) {
                         /* If all was written, then signal that we no longer need
                          * to write to the log file.
                          */
@@ -313,9 +1374,7 @@ static int pass_all(int fd_in) {
                     quit = 1;
                 }
             }
-            io_buffer_realign(io_buf_1, &io_buf_1_read_slice, 1);
-            io_buffer_realign(io_buf_2, io_buf_2_read_slices,
-                              sizeof(io_buf_2_read_slices) / sizeof(io_buf_2_read_slices[0]));
+            io_buffer_realign(io_buf_1, io_buf_1_read_slice, 1);
         } else if (-1 == result) {
             if (EINTR == errno) {
                 continue;
@@ -325,27 +1384,48 @@ static int pass_all(int fd_in) {
             }
         } else {
         }
+        /* A segment of the log ends once the old one has everything read so far */
+        if (session->rotate_due_ && 0 == session_log_pending(session) &&
+            nt_budget_room(&session->budget_) >= session->segment_charge_ &&
+            0 == session_rotate(session)) {
+            FD_CLR(fd_log, &writeset_copy);
+            fd_log = ps_log_fd(session->log_);
+            maxfd = session_maxfd(session, fd_in);
+        }
     } while (0 == quit);
-    fsync(fd_log);
-    close(fd_log);
-    free(io_buf_1);
-    free(io_buf_2);
-    free(log_file_name);
-    LOG_DEBUG("%d", (int)quit);
+    if (0 != ps_latency_stop(latency)) {
+        fprintf(stderr, "pseudoshell: the relay ran for %d ms without waiting, it was moved off"
+                        " SCHED_FIFO\r\n", PS_LATENCY_WATCHDOG_MS);
+    }
+    session_drain(session);
+    LOG_DEBUG("display skipped %llu bytes", (unsigned long long)session->display_skipped_);
+    session_free(session);
+    nt_pool_stats_t pool_stats;
+    nt_pool_get_stats(&pool_stats);
+    LOG_DEBUG("%d slabs %zu/%zu bytes %zu/%zu", (int)quit, pool_stats.slabs_in_use_,
+              pool_stats.slabs_high_water_, pool_stats.bytes_in_use_,
+              pool_stats.bytes_high_water_);
     return -1;
 }
 
 /**
  * @brief Returns a valid shell executable name.
  * @details First, it takes a look at the @c SHELL environment variable.
- * If this one is not set, then it checks if there are some standard shell
+ * If this one is not set or empty, then it checks if there are some standard shell
  * executables accessible, i.e. it exists and it can be executed.
- * @return Returns a copy of the shell exectuable name it has found or the NULL
+ * The answer is looked for once and kept, further calls cost nothing.
+ * @return Returns the shell exectuable name it has found or the NULL
  * if there's no such executable found.
  */
-char *get_shell_name(void) {
-    const char *shell = getenv("SHELL");
-    if (NULL == shell) {
+const char *get_shell_name(void) {
+    static const char *s_shell = NULL;
+    if (NULL == s_shell) {
+        s_shell = getenv("SHELL");
+        if (NULL != s_shell && '\0' == s_shell[0]) {
+            s_shell = NULL;
+        }
+    }
+    if (NULL == s_shell) {
         size_t idx;
         static const char *shell_candidates[] = {
             "/usr/local/bin/bash", "/usr/local/bin/sh", "/usr/local/bin/tcsh", "/bin/bash",
@@ -353,13 +1433,93 @@ char *get_shell_name(void) {
         };
         for (idx = 0; idx < sizeof(shell_candidates) / sizeof(shell_candidates[0]); ++idx) {
             if (0 == access(shell_candidates[idx], R_OK | X_OK)) {
-                return strdup(shell_candidates[idx]);
+                s_shell = shell_candidates[idx];
+                break;
             }
         }
-    } else {
-        return strdup(shell);
     }
-    return NULL;
+    return s_shell;
+}
+
+/**
+ * @brief Starts the child process on a new pseudo terminal.
+ * @param argv the command and its arguments, the shell if @c argv[0] is @c NULL.
+ * @param envp environment of the child.
+ * @param win_size initial size of the pseudo terminal.
+ * @param sigmask signal mask of the child.
+ * @param[out] master master part of the pseudo terminal.
+ * @return Process of the child, -1 on error.
+ * @sa ps_pty_spawn()
+ */
+static pid_t spawn_child(char *argv[], char *envp[], const struct winsize *win_size,
+                         const sigset_t *sigmask, int *master) {
+    char *shell_argv[] = {(char *)get_shell_name(), NULL};
+    ps_pty_t pty;
+    int result;
+    if (NULL == argv[0]) {
+        if (NULL == shell_argv[0]) {
+            errno = ENOENT;
+            return -1;
+        }
+        argv = shell_argv;
+    }
+    result = ps_pty_open(&pty, win_size);
+    if (0 == result) {
+        LOG_DEBUG("%s %s", argv[0], pty.name_);
+        result = ps_pty_spawn(&pty, argv, envp, sigmask);
+        if (0 != result) {
+            ps_pty_close(&pty);
+        }
+    }
+    if (0 != result) {
+        errno = result;
+        return -1;
+    }
+    *master = pty.master_;
+    return pty.pid_;
+}
+
+/**
+ * @brief Prints command line synopsis.
+ * @param argv0 name of the program.
+ */
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [-H] [-O] [-t] [-d durability] [-L dir | -o file] [-p extent]"
+                    " [-s lag]\n"
+                    "       [-R patterns] [-I segment] [-P prompt] [-a] [-V ring] [-B [-i input]]\n"
+                    "       [-l cpu[,fifo[:priority]][,spin[:us]]]\n"
+                    "       [-S size:count[k|m],age:count[s|m|h]] [-M budget] [-J journal]\n"
+                    "       [command [argument...]]\n"
+                    "  -H  back the buffer pool with huge pages\n"
+                    "  -O  write the log with O_DIRECT, bypassing the page cache\n"
+                    "  -d  log durability: none (default), interval[:ms] or bytes[:count[k|m]]\n"
+                    "  -L  directory to create log_XXXXXX in, the current one by default\n"
+                    "  -o  log file name, overwritten if it exists\n"
+                    "  -p  log preallocation extent, count[k|m] or 0, %lum by default\n"
+                    "  -s  let a slow display skip ahead once it is count[k|m] behind\n"
+                    "  -t  write a plain text copy of the log, without escape sequences\n"
+                    "  -a  write an asciicast v2 recording next to the log\n"
+                    "  -R  file of patterns to redact from the logs\n"
+                    "  -I  log index segment size, count[k|m] or 0 not to index, %luk by default\n"
+                    "  -P  regular expression matching the prompt, for shells without OSC 133\n"
+                    "  -V  let pstool view watch the session live through a count[k|m] ring\n"
+                    "  -B  headless: no terminal needed, the output only goes to the log and the\n"
+                    "      exit status is that of the command\n"
+                    "  -i  file the input comes from in headless mode, /dev/null by default;\n"
+                    "      once it is over, the last line is ended and the command gets an end\n"
+                    "      of file, as from Ctrl+D on a terminal\n"
+                    "  -l  relay on a processor of its own, the rest of the session on the\n"
+                    "      others; fifo runs it under SCHED_FIFO, priority %d by default, spin\n"
+                    "      has it poll for us, %d by default, before it waits again\n"
+                    "  -S  start a new segment of the log, name.1, name.2 and so on, once the\n"
+                    "      current one reaches the size or the age, whichever comes first\n"
+                    "  -M  memory the session may hold, count[k|m]; once it is used up the\n"
+                    "      child's output is no longer read until the logs catch up\n"
+                    "  -J  append the output to a journal shared with other sessions instead,\n"
+                    "      without a log, index or any other file; pstool demux reads it back\n"
+                    "The command is the shell from SHELL unless given.\n",
+            argv0, PS_LOG_DEFAULT_PREALLOC >> 20, PS_INDEX_DEFAULT_SEGMENT >> 10,
+            PS_LATENCY_DEFAULT_PRIORITY, PS_LATENCY_DEFAULT_SPIN_US);
 }
 
 /**
@@ -372,23 +1532,170 @@ char *get_shell_name(void) {
  */
 int main(int argc, char *argv[], char *envp[]) {
     int master;
-    (void)(argc);
-    (void)(argv);
+    int opt;
     struct termios stdin_data, stdin_data_copy;
     struct winsize win_size;
     sigset_t blockset, orig_set;
+    nt_pool_config_t pool_config = {.arena_size_ = NT_POOL_DEFAULT_ARENA_SIZE, .hugepages_ = 0};
+    struct ps_config_t config = {
+        .log_ = {.durability_ = PS_LOG_SYNC_NONE, .prealloc_ = PS_LOG_DEFAULT_PREALLOC},
+        .display_lag_ = 0,
+        .index_ = PS_INDEX_DEFAULT_SEGMENT,
+        .latency_ = {.cpu_ = -1}};
+    ps_log_config_t *log_config = &config.log_;
+    const char *redact_file_name = NULL;
+    const char *input_file_name = NULL;
+    regex_t prompt_check;
 
-    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
-        perror("isatty");
+    while (-1 != (opt = getopt(argc, argv, "+HOd:L:o:p:s:taR:I:P:V:Bi:l:S:M:J:"))) {
+        switch (opt) {
+        case 'H':
+            pool_config.hugepages_ = 1;
+            break;
+        case 'O':
+            log_config->direct_ = 1;
+            break;
+        case 'L':
+            log_config->dir_ = optarg;
+            break;
+        case 'o':
+            log_config->file_name_ = optarg;
+            break;
+        case 't':
+            config.text_ = 1;
+            break;
+        case 'a':
+            config.cast_ = 1;
+            break;
+        case 'B':
+            config.headless_ = 1;
+            break;
+        case 'i':
+            input_file_name = optarg;
+            break;
+        case 'R':
+            redact_file_name = optarg;
+            break;
+        case 's':
+            if (0 != ps_log_parse_size(optarg, &config.display_lag_)) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'p':
+            if (0 == strcmp(optarg, "0")) {
+                log_config->prealloc_ = 0;
+            } else if (0 != ps_log_parse_size(optarg, &log_config->prealloc_)) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'P':
+            if (0 != regcomp(&prompt_check, optarg, REG_EXTENDED | REG_NOSUB)) {
+                fprintf(stderr, "%s: not an extended regular expression\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            regfree(&prompt_check);
+            config.prompt_ = optarg;
+            break;
+        case 'I':
+            if (0 == strcmp(optarg, "0")) {
+                config.index_ = 0;
+            } else if (0 != ps_log_parse_size(optarg, &config.index_) ||
+                       config.index_ > UINT32_MAX) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'V':
+            if (0 != ps_log_parse_size(optarg, &config.view_) || 0 == config.view_) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'd':
+            if (0 != ps_log_parse_durability(optarg, log_config)) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'l':
+            if (0 != ps_latency_parse(optarg, &config.latency_)) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'S':
+            if (0 != ps_rotate_parse(optarg, &config.rotate_)) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'M':
+            if (0 != ps_log_parse_size(optarg, &config.memory_)) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'J':
+            config.journal_ = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (NULL != input_file_name && !config.headless_) {
+        usage(argv[0]);
         exit(EXIT_FAILURE);
     }
-    LOG_DEBUG("%s", ttyname(STDIN_FILENO));
-
-    if (0 != ioctl(STDIN_FILENO, TIOCGWINSZ, &win_size) || 0 != tcgetattr(STDIN_FILENO, &stdin_data)) {
-        perror("ioctl || tcgetattr");
+    /* A journal is all the session writes, nothing that goes with a log of its own */
+    if (NULL != config.journal_ &&
+        (config.text_ || config.cast_ || 0 != config.view_ || NULL != config.prompt_ ||
+         0 != config.rotate_.size_ || 0 != config.rotate_.age_ns_ || NULL != log_config->dir_ ||
+         NULL != log_config->file_name_ || log_config->direct_ ||
+         PS_LOG_SYNC_NONE != log_config->durability_)) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (0 != nt_pool_configure(&pool_config)) {
+        perror("nt_pool_configure");
+        exit(EXIT_FAILURE);
+    }
+    /* Patterns are compiled into the pool, hence only once it is configured */
+    if (NULL != redact_file_name && NULL == (config.redact_ = nt_redact_load(redact_file_name))) {
+        perror(redact_file_name);
         exit(EXIT_FAILURE);
     }
-    memcpy(&stdin_data_copy, &stdin_data, sizeof(struct termios));
+
+    if (config.headless_) {
+        /* No terminal around: the input comes from a file, the pseudo terminal has a fixed size */
+        const char *name = NULL != input_file_name ? input_file_name : "/dev/null";
+        int fd_input = open(name, O_RDONLY);
+        if (fd_input < 0 || dup2(fd_input, STDIN_FILENO) < 0) {
+            perror(name);
+            exit(EXIT_FAILURE);
+        }
+        if (STDIN_FILENO != fd_input) {
+            close(fd_input);
+        }
+        memset(&win_size, 0, sizeof(win_size));
+        win_size.ws_row = HEADLESS_ROWS;
+        win_size.ws_col = HEADLESS_COLS;
+    } else {
+        if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+            perror("isatty");
+            exit(EXIT_FAILURE);
+        }
+        LOG_DEBUG("%s", ttyname(STDIN_FILENO));
+
+        if (0 != ioctl(STDIN_FILENO, TIOCGWINSZ, &win_size) ||
+            0 != tcgetattr(STDIN_FILENO, &stdin_data)) {
+            perror("ioctl || tcgetattr");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(&stdin_data_copy, &stdin_data, sizeof(struct termios));
+    }
 
     /*
      * Safety precaution.
@@ -400,40 +1707,42 @@ int main(int argc, char *argv[], char *envp[]) {
     sigaddset(&blockset, SIGCHLD);
     sigprocmask(SIG_BLOCK, &blockset, &orig_set);
 
-    /*
-     * Nobody knows how much space should be reserved for name.
-     * Therefore, we pass NULL for the 'name' parameter, as this is the only secure value we can
-     * pass. We also do not do anyting special about the slave part of the terminal,
-     * we are quite happy with the default settings, hence NULL for 'term' parameter.
-     */
-    pid_t cpid = forkpty(&master, NULL, NULL, &win_size);
-    if (0 == cpid) {
-        /* In the child process */
-        LOG_DEBUG("%s", ttyname(STDIN_FILENO));
-        /* Restore original signal mask */
-        sigprocmask(SIG_SETMASK, &orig_set, NULL);
-        /* Execute the shell process. */
-        char *shell = get_shell_name();
-        if (NULL != shell) {
-            LOG_DEBUG( "%s", shell);
-            char *shell_argp[] = {shell, NULL};
-            execve(shell, shell_argp, envp);
-        }
-        /* If we got that far, it means that execve() failed. We log an error and bail out */
-        LOG_DEBUG("%d %s", errno, strerror(errno));
+    /* The child and the threads of the session inherit this */
+    if (config.latency_.cpu_ >= 0 && 0 != (errno = ps_latency_isolate(&config.latency_))) {
+        perror("ps_latency_isolate");
         exit(EXIT_FAILURE);
-    } else if (cpid > 0) {
+    }
+
+    /* The command is what is left of the command line, the shell if nothing is */
+    pid_t cpid = spawn_child(&argv[optind], envp, &win_size, &orig_set, &master);
+    if (cpid > 0) {
         /* In the parent process */
         int status;
+        int ready;
         LOG_DEBUG("isatty(%d)=%d", master, isatty(master));
-        cfmakeraw(&stdin_data);
-        if (0 == tcsetattr(STDIN_FILENO, TCSANOW, &stdin_data)
-            && 0 == evutil_make_socket_nonblocking(STDIN_FILENO)
-            && 0 == evutil_make_socket_nonblocking(STDOUT_FILENO)
-            && 0 == evutil_make_socket_nonblocking(master)) {
-            pass_all(master);
-            tcsetattr(STDIN_FILENO, TCSANOW, &stdin_data_copy);
+        if (config.headless_) {
+            /* Nothing to put in raw mode, nothing relayed to the standard output */
+            ready = 0 == evutil_make_socket_nonblocking(STDIN_FILENO)
+                    && 0 == evutil_make_socket_nonblocking(master);
+        } else {
+            cfmakeraw(&stdin_data);
+            ready = 0 == tcsetattr(STDIN_FILENO, TCSANOW, &stdin_data)
+                    && 0 == evutil_make_socket_nonblocking(STDIN_FILENO)
+                    && 0 == evutil_make_socket_nonblocking(STDOUT_FILENO)
+                    && 0 == evutil_make_socket_nonblocking(master);
+        }
+        if (ready) {
+            pass_all(master, &config);
+            if (!config.headless_) {
+                tcsetattr(STDIN_FILENO, TCSANOW, &stdin_data_copy);
+            }
+            /* Should the relay end first, e.g. on a hang-up, this hangs up the child */
+            close(master);
             waitpid(cpid, &status, 0);
+            if (config.headless_) {
+                /* A batch job is only as successful as its command */
+                exit(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+            }
             exit(EXIT_SUCCESS);
         } else {
             perror("parent ");
@@ -441,7 +1750,7 @@ int main(int argc, char *argv[], char *envp[]) {
             exit(EXIT_FAILURE);
         }
     } else {
-        perror("fork");
+        perror(optind < argc ? argv[optind] : "spawn");
         exit(EXIT_FAILURE);
     }
     return 0;
@@ -0,0 +1,1239 @@
+/**
+ * @file pstool.c
+ * @brief Companion utility for logs recorded by pseudoshell.
+ * @details A single executable with a sub-command per task, in the spirit of @c git or
+ * @c ip. Every sub-command works on the log files and the metadata written next to them
+ * and shares the code pseudoshell uses to write them.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "compiler-defs.h"
+#include "nt-pool.h"
+#include "nt-strip.h"
+#include "ps-analyze.h"
+#include "ps-cast.h"
+#include "ps-cmd.h"
+#include "ps-index.h"
+#include "ps-journal.h"
+#include "ps-meta.h"
+#include "ps-replay.h"
+#include "ps-sum.h"
+#include "ps-view.h"
+
+/** @brief Largest piece of a log read at once. */
+#define TOOL_CHUNK (64UL << 10)
+
+/**
+ * @brief Checks logs for a torn tail and truncates it.
+ * @details Usage: <tt>pstool recover [-n] log...</tt>, where @c -n only reports.
+ * @return @c EXIT_SUCCESS if every log could be checked.
+ */
+static int cmd_recover(int argc, char *argv[]) {
+    int opt;
+    int dry_run = 0;
+    int result = EXIT_SUCCESS;
+    while (-1 != (opt = getopt(argc, argv, "n"))) {
+        switch (opt) {
+        case 'n':
+            dry_run = 1;
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    for (; optind < argc; ++optind) {
+        const char *name = argv[optind];
+        ps_meta_check_t check;
+        if (0 != ps_meta_check(name, &check)) {
+            perror(name);
+            result = EXIT_FAILURE;
+        } else if (check.clean_) {
+            printf("%s: clean, %llu bytes\n", name, (unsigned long long)check.log_size_);
+        } else if (0 == check.durability_) {
+            printf("%s: not closed cleanly, written without durability, %llu bytes kept\n",
+                   name, (unsigned long long)check.log_size_);
+        } else {
+            printf("%s: not closed cleanly, %llu of %llu bytes committed\n", name,
+                   (unsigned long long)check.committed_, (unsigned long long)check.log_size_);
+            if (!dry_run && (ps_meta_truncate_tail(name, &check) < 0 ||
+                             0 != ps_sum_truncate(name, check.committed_))) {
+                perror(name);
+                result = EXIT_FAILURE;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Options and state of a query.
+ */
+struct query_t {
+    const char *text_;     /**< String searched for */
+    size_t len_;           /**< Its length */
+    const char *host_;     /**< Host the sessions were recorded on, @c NULL for any */
+    uint64_t after_ns_;    /**< Hits ending before that are left out */
+    uint64_t before_ns_;   /**< Hits starting after that are left out */
+    int exact_;            /**< Non-zero to confirm hits by reading the log */
+    int ignore_case_;      /**< Non-zero to confirm hits regardless of letter case */
+    const char *log_name_; /**< Log being searched */
+    unsigned long hits_;   /**< Number of hits found */
+};
+
+/**
+ * @brief Parses a local time given as @c YYYY-MM-DD, optionally followed by @c HH:MM[:SS].
+ * @return 0 on success, -1 if the time is malformed.
+ */
+static int parse_time(const char *spec, uint64_t *time_ns) {
+    static const char *const formats[] = {"%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d"};
+    size_t idx;
+    for (idx = 0; idx < ARRAY_SIZE(formats); ++idx) {
+        struct tm tm;
+        const char *end;
+        memset(&tm, 0, sizeof(tm));
+        end = strptime(spec, formats[idx], &tm);
+        if (NULL != end && '\0' == *end) {
+            tm.tm_isdst = -1;
+            *time_ns = (uint64_t)mktime(&tm) * 1000000000ULL;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Formats a time in nanoseconds since the epoch as a local time.
+ */
+static const char *format_time(uint64_t time_ns, char *buf, size_t len) {
+    time_t seconds = (time_t)(time_ns / 1000000000ULL);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm);
+    return buf;
+}
+
+/**
+ * @brief Finds a string in a line, optionally regardless of letter case.
+ */
+static int line_matches(const struct query_t *query, const uint8_t *line, size_t len) {
+    if (!query->ignore_case_) {
+        return NULL != memmem(line, len, query->text_, query->len_);
+    }
+    for (; len >= query->len_; ++line, --len) {
+        if (0 == strncasecmp((const char *)line, query->text_, query->len_)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads the part of a log a hit covers and prints its lines holding the string.
+ * @details The log is stripped a line at a time, so each line is reported with the log offset
+ * of its end, like <tt>grep -b</tt> does with its start.
+ * @return Number of lines found.
+ */
+static unsigned long query_confirm(struct query_t *query, const ps_index_segment_t *hit) {
+    static nt_strip_t strip;
+    uint8_t *raw = nt_pool_alloc(TOOL_CHUNK);
+    uint8_t *text = nt_pool_alloc(NT_STRIP_OUTPUT_SIZE(TOOL_CHUNK));
+    unsigned long found = 0;
+    uint64_t offset = hit->start_;
+    int fd = open(query->log_name_, O_RDONLY | O_CLOEXEC);
+    nt_strip_init(&strip);
+    while (fd >= 0 && NULL != raw && NULL != text && offset < hit->end_) {
+        size_t chunk = hit->end_ - offset < TOOL_CHUNK ? (size_t)(hit->end_ - offset) : TOOL_CHUNK;
+        ssize_t result = pread(fd, raw, chunk, (off_t)offset);
+        size_t pos = 0;
+        if (result <= 0) {
+            break;
+        }
+        while (pos < (size_t)result) {
+            const uint8_t *newline = memchr(raw + pos, '\n', (size_t)result - pos);
+            size_t piece =
+                NULL != newline ? (size_t)(newline - raw) + 1 - pos : (size_t)result - pos;
+            size_t len = nt_strip_feed(&strip, raw + pos, piece, text);
+            size_t start = 0;
+            pos += piece;
+            if (offset + pos == hit->end_) {
+                len += nt_strip_finish(&strip, text + len);
+            }
+            /* Whatever came out is whole lines, unless a line grew too long to carry */
+            while (start < len) {
+                const uint8_t *end = memchr(text + start, '\n', len - start);
+                size_t line_len = NULL != end ? (size_t)(end - text) - start : len - start;
+                if (line_matches(query, text + start, line_len)) {
+                    printf("%s:%llu: %.*s\n", query->log_name_, (unsigned long long)(offset + pos),
+                           (int)line_len, text + start);
+                    ++found;
+                }
+                start += line_len + 1;
+            }
+        }
+        offset += (uint64_t)result;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    nt_pool_free(text);
+    nt_pool_free(raw);
+    return found;
+}
+
+/**
+ * @brief Reports a hit of the index.
+ */
+static int query_hit(void *context, const ps_index_header_t *header,
+                     const ps_index_segment_t *hit) {
+    struct query_t *query = context;
+    char start[32], end[32];
+    if ((NULL != query->host_ && 0 != strcmp(query->host_, header->host_)) ||
+        hit->end_ns_ < query->after_ns_ || hit->start_ns_ > query->before_ns_) {
+        return 0;
+    }
+    if (query->exact_) {
+        query->hits_ += query_confirm(query, hit);
+        return 0;
+    }
+    printf("%s %s %s..%s bytes %llu-%llu\n", query->log_name_, header->host_,
+           format_time(hit->start_ns_, start, sizeof(start)),
+           format_time(hit->end_ns_, end, sizeof(end)), (unsigned long long)hit->start_,
+           (unsigned long long)hit->end_);
+    ++query->hits_;
+    return 0;
+}
+
+/**
+ * @brief Searches the index of a single log.
+ * @param query the query.
+ * @param name name of the log or of its index.
+ * @return 0 on success, -1 if the index cannot be read.
+ */
+static int query_log(struct query_t *query, const char *name) {
+    size_t len = strlen(name);
+    size_t suffix_len = sizeof(PS_INDEX_SUFFIX) - 1;
+    char *log_name = strdup(name);
+    char *index_name = malloc(len + suffix_len + 1);
+    int result = -1;
+    if (NULL != log_name && NULL != index_name) {
+        if (len > suffix_len && 0 == strcmp(name + len - suffix_len, PS_INDEX_SUFFIX)) {
+            log_name[len - suffix_len] = '\0';
+            strcpy(index_name, name);
+        } else {
+            sprintf(index_name, "%s%s", name, PS_INDEX_SUFFIX);
+        }
+        query->log_name_ = log_name;
+        result = ps_index_search(index_name, query->text_, query->len_, query_hit, query);
+        if (0 != result) {
+            perror(index_name);
+        }
+    }
+    free(index_name);
+    free(log_name);
+    return result;
+}
+
+/**
+ * @brief Searches the indexes of all the logs in a directory.
+ * @return 0 on success, -1 if the directory or one of the indexes cannot be read.
+ */
+static int query_dir(struct query_t *query, const char *dir_name) {
+    size_t suffix_len = sizeof(PS_INDEX_SUFFIX) - 1;
+    struct dirent **entries;
+    int n_entries = scandir(dir_name, &entries, NULL, alphasort);
+    int result = 0;
+    int idx;
+    if (n_entries < 0) {
+        perror(dir_name);
+        return -1;
+    }
+    for (idx = 0; idx < n_entries; ++idx) {
+        const char *entry = entries[idx]->d_name;
+        size_t len = strlen(entry);
+        if (len > suffix_len && 0 == strcmp(entry + len - suffix_len, PS_INDEX_SUFFIX)) {
+            char *path = malloc(strlen(dir_name) + len + 2);
+            if (NULL == path) {
+                result = -1;
+            } else {
+                sprintf(path, "%s/%s", dir_name, entry);
+                result |= query_log(query, path);
+                free(path);
+            }
+        }
+        free(entries[idx]);
+    }
+    free(entries);
+    return result;
+}
+
+/**
+ * @brief Finds the sessions, and the parts of them, where a string was output.
+ * @details Usage: <tt>pstool query [-e] [-i] [-H host] [-a time] [-b time] string log|dir...</tt>.
+ * Only the indexes are read, unless @c -e asks to confirm the hits against the logs and
+ * print the matching lines; @c -i makes that confirmation ignore letter case. Times are
+ * local, @c YYYY-MM-DD[ HH:MM[:SS]].
+ * @return @c EXIT_SUCCESS if something was found, as @c grep does.
+ */
+static int cmd_query(int argc, char *argv[]) {
+    struct query_t query = {.before_ns_ = UINT64_MAX};
+    int opt;
+    int result = 0;
+    while (-1 != (opt = getopt(argc, argv, "eiH:a:b:"))) {
+        switch (opt) {
+        case 'e':
+            query.exact_ = 1;
+            break;
+        case 'i':
+            query.ignore_case_ = 1;
+            break;
+        case 'H':
+            query.host_ = optarg;
+            break;
+        case 'a':
+        case 'b':
+            if (0 != parse_time(optarg, 'a' == opt ? &query.after_ns_ : &query.before_ns_)) {
+                fprintf(stderr, "%s: not a YYYY-MM-DD[ HH:MM[:SS]] time\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind < 2) {
+        fprintf(stderr, "query: a string and at least a log are expected\n");
+        return EXIT_FAILURE;
+    }
+    query.text_ = argv[optind];
+    query.len_ = strlen(query.text_);
+    for (++optind; optind < argc; ++optind) {
+        struct stat st;
+        if (0 == stat(argv[optind], &st) && S_ISDIR(st.st_mode)) {
+            result |= query_dir(&query, argv[optind]);
+        } else {
+            result |= query_log(&query, argv[optind]);
+        }
+    }
+    if (0 != result) {
+        return 2;
+    }
+    return 0 != query.hits_ ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Opens the companion file of a log.
+ * @return The descriptor or -1, with an error printed.
+ */
+static int open_companion(const char *log_name, const char *suffix) {
+    char *name = malloc(strlen(log_name) + strlen(suffix) + 1);
+    int fd = -1;
+    if (NULL != name) {
+        sprintf(name, "%s%s", log_name, suffix);
+        fd = open(name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            perror(name);
+        }
+        free(name);
+    }
+    return fd;
+}
+
+/**
+ * @brief Copies a part of a log to the standard output, as it was shown.
+ * @return 0 on success, -1 on error.
+ */
+static int copy_log(int log_fd, uint64_t start, uint64_t end) {
+    static uint8_t buf[TOOL_CHUNK];
+    while (start < end) {
+        size_t chunk = end - start < sizeof(buf) ? (size_t)(end - start) : sizeof(buf);
+        ssize_t result = pread(log_fd, buf, chunk, (off_t)start);
+        if (result <= 0 || (size_t)result != fwrite(buf, 1, (size_t)result, stdout)) {
+            return -1;
+        }
+        start += (uint64_t)result;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads the command line of a command, stripped and on a single line.
+ */
+static void read_command_line(int log_fd, const ps_cmd_record_t *record, char *line,
+                              size_t size) {
+    static nt_strip_t strip;
+    static uint8_t raw[NT_STRIP_LINE_MAX];
+    static uint8_t text[NT_STRIP_OUTPUT_SIZE(NT_STRIP_LINE_MAX)];
+    size_t len = record->output_ - record->input_ < sizeof(raw)
+                     ? (size_t)(record->output_ - record->input_)
+                     : sizeof(raw);
+    ssize_t result = pread(log_fd, raw, len, (off_t)record->input_);
+    size_t idx, fill = 0;
+    nt_strip_init(&strip);
+    len = result > 0 ? nt_strip_feed(&strip, raw, (size_t)result, text) : 0;
+    len += nt_strip_finish(&strip, text + len);
+    for (idx = 0; idx < len && fill + 1 < size; ++idx) {
+        line[fill++] = (text[idx] < 0x20) ? ' ' : (char)text[idx];
+    }
+    while (fill > 0 && ' ' == line[fill - 1]) {
+        --fill;
+    }
+    line[fill] = '\0';
+}
+
+/**
+ * @brief Lists the commands run in a session, or shows the output of one of them.
+ * @details Usage: <tt>pstool commands [-n number] log</tt>. The list gives, for each command,
+ * its number, when it started, how long it ran, its exit status and its command line. With
+ * @c -n, the output of that command is copied to the standard output as it was shown, escape
+ * sequences included; the command is looked up in the command table directly.
+ * @return @c EXIT_SUCCESS on success.
+ */
+static int cmd_commands(int argc, char *argv[]) {
+    ps_cmd_record_t record;
+    ps_cmd_header_t header;
+    unsigned long long number = 0;
+    int show = 0, opt, cmd_fd, log_fd;
+    int result = EXIT_FAILURE;
+    uint64_t idx;
+    while (-1 != (opt = getopt(argc, argv, "n:"))) {
+        switch (opt) {
+        case 'n':
+            number = strtoull(optarg, NULL, 10);
+            show = 1;
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1) {
+        fprintf(stderr, "commands: a single log is expected\n");
+        return EXIT_FAILURE;
+    }
+    cmd_fd = open_companion(argv[optind], PS_CMD_SUFFIX);
+    log_fd = open(argv[optind], O_RDONLY | O_CLOEXEC);
+    if (log_fd < 0) {
+        perror(argv[optind]);
+    } else if (cmd_fd >= 0 && (sizeof(header) != pread(cmd_fd, &header, sizeof(header), 0) ||
+                               PS_CMD_MAGIC != header.magic_ ||
+                               sizeof(record) != header.record_size_)) {
+        fprintf(stderr, "%s%s: not a command table\n", argv[optind], PS_CMD_SUFFIX);
+    } else if (cmd_fd >= 0 && show) {
+        if (0 != ps_cmd_read(cmd_fd, number, &record)) {
+            fprintf(stderr, "%s: no command %llu\n", argv[optind], number);
+        } else if (0 == copy_log(log_fd, record.output_, record.end_)) {
+            result = EXIT_SUCCESS;
+        }
+    } else if (cmd_fd >= 0) {
+        for (idx = 0; 0 == ps_cmd_read(cmd_fd, idx, &record); ++idx) {
+            char start[32], status[16], line[80];
+            if (PS_CMD_STATUS_UNKNOWN == record.status_) {
+                strcpy(status, "?");
+            } else {
+                snprintf(status, sizeof(status), "%d", (int)record.status_);
+            }
+            read_command_line(log_fd, &record, line, sizeof(line));
+            printf("%4llu %s %10.3fs %4s  %s\n", (unsigned long long)idx,
+                   format_time(record.start_ns_, start, sizeof(start)),
+                   (double)(record.end_ns_ - record.start_ns_) / 1e9, status, line);
+        }
+        result = EXIT_SUCCESS;
+    }
+    if (log_fd >= 0) {
+        close(log_fd);
+    }
+    if (cmd_fd >= 0) {
+        close(cmd_fd);
+    }
+    return result;
+}
+
+/**
+ * @brief Converts a log into an asciicast v2 recording.
+ * @details Usage: <tt>pstool cast [-j jobs] [-o file] log</tt>. The recording goes to the
+ * standard output, or to @c file. The log is encoded on @c jobs threads, as many as there
+ * are processors online by default.
+ * @return @c EXIT_SUCCESS on success.
+ */
+static int cmd_cast(int argc, char *argv[]) {
+    const char *out_name = NULL;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt, fd = STDOUT_FILENO;
+    int result = EXIT_FAILURE;
+    while (-1 != (opt = getopt(argc, argv, "j:o:"))) {
+        switch (opt) {
+        case 'j':
+            jobs = strtol(optarg, NULL, 10);
+            break;
+        case 'o':
+            out_name = optarg;
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1 || jobs < 1) {
+        fprintf(stderr, "cast: a single log and at least one job are expected\n");
+        return EXIT_FAILURE;
+    }
+    if (NULL != out_name &&
+        (fd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+        perror(out_name);
+        return EXIT_FAILURE;
+    }
+    if (0 != ps_cast_convert(argv[optind], fd, (unsigned int)jobs)) {
+        perror(argv[optind]);
+    } else {
+        result = EXIT_SUCCESS;
+    }
+    if (NULL != out_name) {
+        close(fd);
+    }
+    return result;
+}
+
+/**
+ * @brief Turns an asciicast v2 recording into a log.
+ * @details Usage: <tt>pstool import recording log</tt>. The log gets metadata of its own, and
+ * the other commands read it like a session log.
+ * @return @c EXIT_SUCCESS on success.
+ */
+static int cmd_import(int argc, char *argv[]) {
+    int fd, result = EXIT_FAILURE;
+    if (3 != argc) {
+        fprintf(stderr, "import: a recording and a log are expected\n");
+        return EXIT_FAILURE;
+    }
+    fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (0 != ps_cast_import(fd, argv[2])) {
+        perror(argv[1]);
+    } else {
+        result = EXIT_SUCCESS;
+    }
+    close(fd);
+    return result;
+}
+
+/** @brief Default number of commands listed by the analyzer. */
+#define ANALYZE_DEFAULT_TOP (10)
+
+/**
+ * @brief A growing list of log names.
+ */
+struct log_list_t {
+    char **names_;    /**< The names, allocated */
+    size_t count_;    /**< Their number */
+    size_t capacity_; /**< Room in @c names_ */
+};
+
+/**
+ * @brief Appends a name to a list of logs.
+ * @param list the list.
+ * @param dir directory the log is in, @c NULL if @p name is a path already.
+ * @param name name of the log.
+ * @param len length of @p name to take.
+ * @return 0 on success, -1 if out of memory.
+ */
+static int log_list_add(struct log_list_t *list, const char *dir, const char *name, size_t len) {
+    size_t dir_len = NULL != dir ? strlen(dir) + 1 : 0;
+    char *path;
+    if (list->count_ == list->capacity_) {
+        size_t capacity = 0 == list->capacity_ ? 256 : 2 * list->capacity_;
+        char **names = realloc(list->names_, capacity * sizeof(char *));
+        if (NULL == names) {
+            return -1;
+        }
+        list->names_ = names;
+        list->capacity_ = capacity;
+    }
+    path = malloc(dir_len + len + 1);
+    if (NULL == path) {
+        return -1;
+    }
+    if (NULL != dir) {
+        sprintf(path, "%s/", dir);
+    }
+    memcpy(path + dir_len, name, len);
+    path[dir_len + len] = '\0';
+    list->names_[list->count_++] = path;
+    return 0;
+}
+
+/**
+ * @brief Adds the logs of a directory, those that have metadata, to a list.
+ * @return 0 on success, -1 on error.
+ */
+static int log_list_add_dir(struct log_list_t *list, const char *dir_name) {
+    size_t suffix_len = sizeof(PS_META_SUFFIX) - 1;
+    struct dirent **entries;
+    int n_entries = scandir(dir_name, &entries, NULL, alphasort);
+    int result = 0;
+    int idx;
+    if (n_entries < 0) {
+        perror(dir_name);
+        return -1;
+    }
+    for (idx = 0; idx < n_entries; ++idx) {
+        const char *entry = entries[idx]->d_name;
+        size_t len = strlen(entry);
+        if (0 == result && len > suffix_len &&
+            0 == strcmp(entry + len - suffix_len, PS_META_SUFFIX)) {
+            result = log_list_add(list, dir_name, entry, len - suffix_len);
+        }
+        free(entries[idx]);
+    }
+    free(entries);
+    return result;
+}
+
+static void log_list_free(struct log_list_t *list) {
+    while (list->count_ > 0) {
+        free(list->names_[--list->count_]);
+    }
+    free(list->names_);
+}
+
+/**
+ * @brief Formats a number of bytes with a binary unit.
+ */
+static const char *format_size(uint64_t bytes, char *buf, size_t len) {
+    static const char *const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = (double)bytes;
+    size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < ARRAY_SIZE(units)) {
+        value /= 1024.0;
+        ++unit;
+    }
+    snprintf(buf, len, 0 == unit ? "%.0f %s" : "%.1f %s", value, units[unit]);
+    return buf;
+}
+
+/**
+ * @brief Formats a duration as hours, minutes and seconds.
+ */
+static const char *format_duration(uint64_t time_ns, char *buf, size_t len) {
+    unsigned long long seconds = time_ns / 1000000000ULL;
+    snprintf(buf, len, "%llu:%02llu:%02llu", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    return buf;
+}
+
+/**
+ * @brief Computes statistics over an archive of logs.
+ * @details Usage: <tt>pstool analyze [-j jobs] [-n top] [-g seconds] log|dir...</tt>.
+ * Directories stand for the logs in them that have metadata. Logs are analysed on @c jobs
+ * threads, as many as there are processors online by default. The report gives the output,
+ * the duration, the peak output rate and the pauses of at least @c seconds, 5 by default,
+ * of the sessions, the most memory they held if they noted it, then the @c top commands run
+ * the most.
+ * @return @c EXIT_SUCCESS on success.
+ */
+static int cmd_analyze(int argc, char *argv[]) {
+    ps_analyze_config_t config = {.idle_ns_ = PS_ANALYZE_DEFAULT_IDLE_NS,
+                                  .jobs_ = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN)};
+    struct log_list_t list = {NULL, 0, 0};
+    ps_analyze_command_t *top;
+    ps_analyze_stats_t stats;
+    size_t n_top = ANALYZE_DEFAULT_TOP, idx;
+    char size[3][32], duration[3][32];
+    struct stat path_stat;
+    int opt, result = EXIT_FAILURE;
+    while (-1 != (opt = getopt(argc, argv, "j:n:g:"))) {
+        switch (opt) {
+        case 'j':
+            config.jobs_ = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            n_top = strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            config.idle_ns_ = (uint64_t)(strtod(optarg, NULL) * 1e9);
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind == argc || 0 == config.jobs_ || 0 == config.idle_ns_) {
+        fprintf(stderr, "analyze: logs, at least one job and a pause are expected\n");
+        return EXIT_FAILURE;
+    }
+    for (; optind < argc; ++optind) {
+        const char *name = argv[optind];
+        int added = 0 == stat(name, &path_stat) && S_ISDIR(path_stat.st_mode)
+                        ? log_list_add_dir(&list, name)
+                        : log_list_add(&list, NULL, name, strlen(name));
+        if (0 != added) {
+            log_list_free(&list);
+            return EXIT_FAILURE;
+        }
+    }
+    top = calloc(n_top + 1, sizeof(ps_analyze_command_t));
+    if (NULL == top) {
+        log_list_free(&list);
+        return EXIT_FAILURE;
+    }
+    errno = ps_analyze((const char *const *)list.names_, list.count_, &config, &stats, top,
+                       &n_top);
+    if (0 != errno) {
+        perror("analyze");
+    } else {
+        uint64_t sessions = 0 != stats.sessions_ ? stats.sessions_ : 1;
+        printf("sessions     %llu, %llu without valid metadata\n",
+               (unsigned long long)stats.sessions_, (unsigned long long)stats.unreadable_);
+        printf("output       %s in total, %s per session on average, %s at most\n",
+               format_size(stats.bytes_, size[0], sizeof(size[0])),
+               format_size(stats.bytes_ / sessions, size[1], sizeof(size[1])),
+               format_size(stats.largest_, size[2], sizeof(size[2])));
+        printf("duration     %s in total, %s per session on average, %s at most\n",
+               format_duration(stats.duration_ns_, duration[0], sizeof(duration[0])),
+               format_duration(stats.duration_ns_ / sessions, duration[1], sizeof(duration[1])),
+               format_duration(stats.longest_ns_, duration[2], sizeof(duration[2])));
+        printf("peak rate    %s/s at most, %s/s per session on average\n",
+               format_size(stats.peak_rate_, size[0], sizeof(size[0])),
+               format_size(stats.peak_rate_sum_ / sessions, size[1], sizeof(size[1])));
+        printf("idle gaps    %llu, %s in total, %s at most\n",
+               (unsigned long long)stats.idle_gaps_,
+               format_duration(stats.idle_ns_, duration[0], sizeof(duration[0])),
+               format_duration(stats.longest_idle_ns_, duration[1], sizeof(duration[1])));
+        if (0 != stats.noted_) {
+            printf("memory       %s at most, %s per session on average, %llu sessions noted\n",
+                   format_size(stats.memory_, size[0], sizeof(size[0])),
+                   format_size(stats.memory_sum_ / stats.noted_, size[1], sizeof(size[1])),
+                   (unsigned long long)stats.noted_);
+        }
+        printf("commands     %llu, %llu failed\n", (unsigned long long)stats.commands_,
+               (unsigned long long)stats.failed_);
+        for (idx = 0; idx < n_top; ++idx) {
+            printf("%12llu %s\n", (unsigned long long)top[idx].count_, top[idx].name_);
+        }
+        result = EXIT_SUCCESS;
+    }
+    free(top);
+    log_list_free(&list);
+    return result;
+}
+
+/**
+ * @brief Verifies logs against their block checksums.
+ * @details Usage: <tt>pstool verify [-j jobs] log|dir...</tt>. Directories stand for the logs
+ * in them that have metadata. Blocks are checked on @c jobs threads, as many as there are
+ * processors online by default. Each log gets a line, followed by the ranges of bytes that
+ * failed, if any.
+ * @return @c EXIT_SUCCESS if every log could be checked and none failed.
+ */
+static int cmd_verify(int argc, char *argv[]) {
+    unsigned int jobs = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    struct log_list_t list = {NULL, 0, 0};
+    ps_sum_result_t *results;
+    struct stat path_stat;
+    size_t idx, range;
+    int opt, result = EXIT_FAILURE;
+    while (-1 != (opt = getopt(argc, argv, "j:"))) {
+        switch (opt) {
+        case 'j':
+            jobs = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind == argc || 0 == jobs) {
+        fprintf(stderr, "verify: logs and at least one job are expected\n");
+        return EXIT_FAILURE;
+    }
+    for (; optind < argc; ++optind) {
+        const char *name = argv[optind];
+        int added = 0 == stat(name, &path_stat) && S_ISDIR(path_stat.st_mode)
+                        ? log_list_add_dir(&list, name)
+                        : log_list_add(&list, NULL, name, strlen(name));
+        if (0 != added) {
+            log_list_free(&list);
+            return EXIT_FAILURE;
+        }
+    }
+    results = calloc(list.count_ + 1, sizeof(ps_sum_result_t));
+    if (NULL == results) {
+        log_list_free(&list);
+        return EXIT_FAILURE;
+    }
+    errno = ps_sum_verify((const char *const *)list.names_, list.count_, jobs, results);
+    if (0 != errno) {
+        perror("verify");
+    } else {
+        result = EXIT_SUCCESS;
+    }
+    for (idx = 0; 0 == errno && idx < list.count_; ++idx) {
+        const ps_sum_result_t *log = &results[idx];
+        if (0 != log->error_) {
+            fprintf(stderr, "%s: %s\n", list.names_[idx], strerror(log->error_));
+            result = EXIT_FAILURE;
+            continue;
+        }
+        printf("%s: %s, %llu bytes checked", list.names_[idx], 0 == log->n_bad_ ? "ok" : "CORRUPT",
+               (unsigned long long)log->covered_);
+        if (log->size_ > log->covered_) {
+            printf(", %llu more %s", (unsigned long long)(log->size_ - log->covered_),
+                   log->closed_ ? "written after it was closed"
+                                : "not covered, not closed cleanly");
+        }
+        printf("\n");
+        for (range = 0; range < log->n_bad_; ++range) {
+            const ps_sum_range_t *bad = &log->bad_[range];
+            if (bad->start_ >= log->size_) {
+                printf("  %llu-%llu missing\n", (unsigned long long)bad->start_,
+                       (unsigned long long)bad->end_ - 1);
+            } else if (bad->end_ > log->size_) {
+                printf("  %llu-%llu corrupt, %llu-%llu missing\n",
+                       (unsigned long long)bad->start_, (unsigned long long)log->size_ - 1,
+                       (unsigned long long)log->size_, (unsigned long long)bad->end_ - 1);
+            } else {
+                printf("  %llu-%llu corrupt\n", (unsigned long long)bad->start_,
+                       (unsigned long long)bad->end_ - 1);
+            }
+        }
+        if (0 != log->n_bad_) {
+            result = EXIT_FAILURE;
+        }
+    }
+    ps_sum_result_free(results, list.count_);
+    free(results);
+    log_list_free(&list);
+    return result;
+}
+
+/** @brief Initial number of slots of the session table of demux, a power of two. */
+#define DEMUX_INITIAL_SLOTS (64)
+
+/**
+ * @brief What demux knows of a session of a journal.
+ */
+struct demux_session_t {
+    uint64_t id_;        /**< Identifier of the session, 0 for a free slot */
+    char label_[64];     /**< Label from the start record, empty if it was lost */
+    uint64_t records_;   /**< Number of records read */
+    uint64_t bytes_;     /**< Bytes of output */
+    uint64_t first_ns_;  /**< Time of the first record */
+    uint64_t last_ns_;   /**< Time of the last record */
+    uint64_t next_seq_;  /**< Number the next record should have */
+    uint64_t missing_;   /**< Records missing from the sequence */
+    int ended_;          /**< Non-zero once the end record was read */
+    int fd_;             /**< Output file with @c -o, -1 while closed */
+    int created_;        /**< Non-zero once the output file was created */
+};
+
+/**
+ * @brief Sessions of a journal, by identifier, in an open addressing table.
+ */
+struct demux_table_t {
+    struct demux_session_t *slots_; /**< The slots */
+    size_t size_;                   /**< Number of slots, a power of two */
+    size_t count_;                  /**< Number of sessions */
+};
+
+/**
+ * @brief Finds a session in the table, adding it if it is not there yet.
+ * @details The identifiers are random, their low bits are a good enough hash. The table is
+ * kept at most half full.
+ * @return The session, @c NULL if memory ran out.
+ */
+static struct demux_session_t *demux_find(struct demux_table_t *table, uint64_t id) {
+    size_t idx;
+    if (2 * (table->count_ + 1) > table->size_) {
+        struct demux_table_t grown = {NULL, 0 != table->size_ ? 2 * table->size_
+                                                               : DEMUX_INITIAL_SLOTS, 0};
+        grown.slots_ = calloc(grown.size_, sizeof(struct demux_session_t));
+        if (NULL == grown.slots_) {
+            return NULL;
+        }
+        for (idx = 0; idx < table->size_; ++idx) {
+            if (0 != table->slots_[idx].id_) {
+                *demux_find(&grown, table->slots_[idx].id_) = table->slots_[idx];
+            }
+        }
+        free(table->slots_);
+        *table = grown;
+    }
+    for (idx = (size_t)id & (table->size_ - 1); 0 != table->slots_[idx].id_;
+         idx = (idx + 1) & (table->size_ - 1)) {
+        if (id == table->slots_[idx].id_) {
+            return &table->slots_[idx];
+        }
+    }
+    table->slots_[idx].id_ = id;
+    table->slots_[idx].fd_ = -1;
+    ++table->count_;
+    return &table->slots_[idx];
+}
+
+/**
+ * @brief Closes the output files of all sessions.
+ */
+static void demux_close_all(struct demux_table_t *table) {
+    size_t idx;
+    for (idx = 0; idx < table->size_; ++idx) {
+        if (table->slots_[idx].fd_ >= 0) {
+            close(table->slots_[idx].fd_);
+            table->slots_[idx].fd_ = -1;
+        }
+    }
+}
+
+/**
+ * @brief Writes output of a session to its file in a directory.
+ * @details The file is named after the session and created on its first output. Files are
+ * kept open while there are descriptors to spare, and all closed once there are none left.
+ * @return 0 on success, -1 otherwise.
+ */
+static int demux_write(struct demux_table_t *table, struct demux_session_t *session,
+                       const char *dir, const uint8_t *data, size_t len) {
+    while (session->fd_ < 0) {
+        char name[PATH_MAX];
+        snprintf(name, sizeof(name), "%s/%016llx", dir, (unsigned long long)session->id_);
+        session->fd_ = open(name, O_WRONLY | O_CREAT | O_CLOEXEC |
+                                      (session->created_ ? O_APPEND : O_TRUNC), 0644);
+        if (session->fd_ < 0 && EMFILE == errno && table->count_ > 1) {
+            demux_close_all(table);
+        } else if (session->fd_ < 0) {
+            perror(name);
+            return -1;
+        }
+        session->created_ = 1;
+    }
+    while (len > 0) {
+        ssize_t written = write(session->fd_, data, len);
+        if (written < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            perror("demux");
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+/**
+ * @brief Splits a shared journal into the sessions it holds.
+ * @details Usage: <tt>pstool demux [-s session] [-o dir] journal</tt>. Without options the
+ * sessions are listed, with the records missing from each and the bytes of the journal that
+ * had to be skipped as damaged. With @c -s the output of the session with that identifier
+ * goes to the standard output, with @c -o the output of every session goes to a file of that
+ * directory named after it. The records of the sessions may interleave in any way.
+ * @return @c EXIT_SUCCESS on success.
+ */
+static int cmd_demux(int argc, char *argv[]) {
+    struct demux_table_t table = {NULL, 0, 0};
+    ps_journal_cursor_t cursor = {NULL, 0, 0, 0};
+    ps_journal_record_t record;
+    const uint8_t *payload;
+    const char *dir = NULL;
+    uint64_t wanted = 0;
+    struct stat journal_stat;
+    void *map = MAP_FAILED;
+    int opt, fd, found = 0, result = EXIT_FAILURE;
+    size_t idx;
+    while (-1 != (opt = getopt(argc, argv, "s:o:"))) {
+        switch (opt) {
+        case 's':
+            wanted = strtoull(optarg, NULL, 16);
+            break;
+        case 'o':
+            dir = optarg;
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1 || (0 != wanted && NULL != dir)) {
+        fprintf(stderr, "demux: a single journal and at most one of -s and -o are expected\n");
+        return EXIT_FAILURE;
+    }
+    fd = open(argv[optind], O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || 0 != fstat(fd, &journal_stat)) {
+        perror(argv[optind]);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+    cursor.size_ = (size_t)journal_stat.st_size;
+    if (0 != cursor.size_) {
+        map = mmap(NULL, cursor.size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == map) {
+            perror(argv[optind]);
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        madvise(map, cursor.size_, MADV_SEQUENTIAL);
+        cursor.data_ = map;
+    }
+    close(fd);
+    result = EXIT_SUCCESS;
+    while (EXIT_SUCCESS == result && ps_journal_next(&cursor, &record, &payload)) {
+        struct demux_session_t *session = demux_find(&table, record.session_);
+        found |= record.session_ == wanted;
+        if (NULL == session) {
+            errno = ENOMEM;
+            perror("demux");
+            result = EXIT_FAILURE;
+            break;
+        }
+        if (0 == session->records_++) {
+            session->first_ns_ = record.time_ns_;
+        }
+        session->last_ns_ = record.time_ns_;
+        if (record.seq_ > session->next_seq_) {
+            session->missing_ += record.seq_ - session->next_seq_;
+        }
+        session->next_seq_ = record.seq_ + 1;
+        switch (record.type_) {
+        case PS_JOURNAL_START:
+            snprintf(session->label_, sizeof(session->label_), "%.*s", (int)record.length_,
+                     (const char *)payload);
+            break;
+        case PS_JOURNAL_OUTPUT:
+            session->bytes_ += record.length_;
+            if (record.session_ == wanted &&
+                record.length_ != fwrite(payload, 1, record.length_, stdout)) {
+                result = EXIT_FAILURE;
+            } else if (NULL != dir &&
+                       0 != demux_write(&table, session, dir, payload, record.length_)) {
+                result = EXIT_FAILURE;
+            }
+            break;
+        case PS_JOURNAL_END:
+            session->ended_ = 1;
+            break;
+        default:
+            break;
+        }
+    }
+    if (0 != wanted && !found) {
+        fprintf(stderr, "%s: no session %016llx\n", argv[optind], (unsigned long long)wanted);
+        result = EXIT_FAILURE;
+    }
+    if (EXIT_SUCCESS == result && 0 == wanted && NULL == dir) {
+        for (idx = 0; idx < table.size_; ++idx) {
+            const struct demux_session_t *session = &table.slots_[idx];
+            char start[32], duration[32], size[32];
+            if (0 == session->id_) {
+                continue;
+            }
+            printf("%016llx %-24s %s %s %10s %llu records, %llu missing, %s\n",
+                   (unsigned long long)session->id_,
+                   '\0' != session->label_[0] ? session->label_ : "?",
+                   format_time(session->first_ns_, start, sizeof(start)),
+                   format_duration(session->last_ns_ - session->first_ns_, duration,
+                                   sizeof(duration)),
+                   format_size(session->bytes_, size, sizeof(size)),
+                   (unsigned long long)session->records_, (unsigned long long)session->missing_,
+                   session->ended_ ? "ended" : "open");
+        }
+        printf("%zu sessions\n", table.count_);
+    }
+    if (0 != cursor.skipped_) {
+        fprintf(stderr, "%s: %llu bytes skipped as damaged\n", argv[optind],
+                (unsigned long long)cursor.skipped_);
+    }
+    demux_close_all(&table);
+    free(table.slots_);
+    if (MAP_FAILED != map) {
+        munmap(map, cursor.size_);
+    }
+    return result;
+}
+
+/** @brief Set once a replay server is told to stop. */
+static volatile sig_atomic_t s_serve_stop = 0;
+
+/**
+ * @brief Tells the replay server to stop.
+ */
+static void handle_serve_stop(int signal) {
+    (void)(signal);
+    s_serve_stop = 1;
+}
+
+/**
+ * @brief Serves recorded sessions to replay clients.
+ * @details Usage: <tt>pstool serve [-r dir] [-c clients] socket</tt>. The logs of @c dir,
+ * the current directory by default, are served to @c clients clients at once,
+ * @ref PS_REPLAY_DEFAULT_CLIENTS by default, connecting to @c socket. The server runs until
+ * interrupted, then says what it did.
+ * @return @c EXIT_SUCCESS once interrupted.
+ */
+static int cmd_serve(int argc, char *argv[]) {
+    ps_replay_config_t config = {.root_ = ".", .max_clients_ = PS_REPLAY_DEFAULT_CLIENTS};
+    struct sigaction sa = {.sa_handler = handle_serve_stop};
+    ps_replay_stats_t stats;
+    sigset_t blockset, waitset;
+    char size[2][32];
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "r:c:"))) {
+        switch (opt) {
+        case 'r':
+            config.root_ = optarg;
+            break;
+        case 'c':
+            config.max_clients_ = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 1 || 0 == config.max_clients_) {
+        fprintf(stderr, "serve: a single socket and at least one client are expected\n");
+        return EXIT_FAILURE;
+    }
+    config.socket_name_ = argv[optind];
+    /* The signals that stop the server only get through while it waits */
+    sigemptyset(&blockset);
+    sigaddset(&blockset, SIGINT);
+    sigaddset(&blockset, SIGTERM);
+    sigprocmask(SIG_BLOCK, &blockset, &waitset);
+    sigdelset(&waitset, SIGINT);
+    sigdelset(&waitset, SIGTERM);
+    config.sigmask_ = &waitset;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    errno = ps_replay_serve(&config, &s_serve_stop, &stats);
+    if (0 != errno) {
+        perror(config.socket_name_);
+        return EXIT_FAILURE;
+    }
+    printf("%llu clients served, %llu refused, %llu logs opened, %s sent at once, %s paced\n",
+           (unsigned long long)stats.clients_, (unsigned long long)stats.refused_,
+           (unsigned long long)stats.recordings_,
+           format_size(stats.bulk_, size[0], sizeof(size[0])),
+           format_size(stats.paced_, size[1], sizeof(size[1])));
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Replays a session from a replay server.
+ * @details Usage: <tt>pstool replay [-f seconds] [-x speed] socket log</tt>. The output of
+ * the session goes to the standard output, at once up to @c seconds into the session, 0 by
+ * default, then @c speed times as fast as it was recorded, 1 by default, or all at once with
+ * a speed of 0. The log is named relative to the directory the server serves.
+ * @return @c EXIT_SUCCESS once the session is over.
+ */
+static int cmd_replay(int argc, char *argv[]) {
+    double from = 0.0, speed = 1.0;
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "f:x:"))) {
+        switch (opt) {
+        case 'f':
+            from = strtod(optarg, NULL);
+            break;
+        case 'x':
+            speed = strtod(optarg, NULL);
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 2 || from < 0.0 || speed < 0.0 || speed > 1e6) {
+        fprintf(stderr, "replay: a socket, a log, a time and a speed of 0 or more are expected\n");
+        return EXIT_FAILURE;
+    }
+    errno = ps_replay_request(argv[optind], argv[optind + 1], (uint64_t)(from * 1e3),
+                              (unsigned int)(speed * 1e3 + 0.5), STDOUT_FILENO);
+    if (0 != errno) {
+        perror(argv[optind + 1]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Watches a session live.
+ * @details Usage: <tt>pstool view log</tt>. The session has to be started with @c -V.
+ * @return @c EXIT_SUCCESS once the session is over.
+ */
+static int cmd_view(int argc, char *argv[]) {
+    if (2 != argc) {
+        fprintf(stderr, "view: a single log is expected\n");
+        return EXIT_FAILURE;
+    }
+    errno = ps_view_follow(argv[1], STDOUT_FILENO);
+    if (0 != errno) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief A sub-command.
+ */
+static const struct pstool_command_t {
+    const char *name_;                     /**< Name given on the command line */
+    int (*main_)(int argc, char *argv[]);  /**< Entry point, gets argv from the name on */
+    const char *synopsis_;                 /**< One line help */
+} s_commands[] = {
+    {"recover", cmd_recover, "recover [-n] log...  truncate the torn tail of crashed logs"},
+    {"query", cmd_query,
+     "query [-e] [-i] [-H host] [-a time] [-b time] string log|dir...  find where a string"
+     " was output"},
+    {"commands", cmd_commands,
+     "commands [-n number] log  list the commands of a session, or show the output of one"},
+    {"cast", cmd_cast, "cast [-j jobs] [-o file] log  convert a log to an asciicast v2 recording"},
+    {"import", cmd_import, "import recording log  turn an asciicast v2 recording into a log"},
+    {"view", cmd_view, "view log  watch a session started with -V live"},
+    {"analyze", cmd_analyze,
+     "analyze [-j jobs] [-n top] [-g seconds] log|dir...  compute statistics over many logs"},
+    {"verify", cmd_verify,
+     "verify [-j jobs] log|dir...  check logs against their block checksums"},
+    {"demux", cmd_demux,
+     "demux [-s session] [-o dir] journal  list the sessions of a shared journal, or split it"},
+    {"serve", cmd_serve,
+     "serve [-r dir] [-c clients] socket  serve the logs of a directory to replay clients"},
+    {"replay", cmd_replay,
+     "replay [-f seconds] [-x speed] socket log  replay a session from a replay server"},
+};
+
+static void usage(const char *argv0) {
+    size_t idx;
+    fprintf(stderr, "Usage: %s command [options]\n", argv0);
+    for (idx = 0; idx < ARRAY_SIZE(s_commands); ++idx) {
+        fprintf(stderr, "  %s\n", s_commands[idx].synopsis_);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t idx;
+    if (argc > 1) {
+        for (idx = 0; idx < ARRAY_SIZE(s_commands); ++idx) {
+            if (0 == strcmp(argv[1], s_commands[idx].name_)) {
+                return s_commands[idx].main_(argc - 1, argv + 1);
+            }
+        }
+    }
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
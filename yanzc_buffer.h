@@ -1,7 +1,8 @@
 /**
  * @file yanzc_buffer.h
  * @brief Yet Another Zero Copy Buffer
- * @details Header file for Yet Another Zero Copy Buffer
+ * @details Header file for Yet Another Zero Copy Buffer. The helpers are defined here as
+ * static inline, so that each file including it gets copies the compiler can inline.
  * @author Tomasz Ostaszewski (ato013)
  * @date 2015-Apr-02
  * @par History
@@ -16,6 +17,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "yandu_log.h"
+#include "nt-budget.h"
+#include "nt-pool.h"
 
 struct io_buffer_t;
 
@@ -56,28 +59,63 @@ typedef struct yanzc_buffer_t {
      * @brief Pointer to the location where data is stored.
      */
     uint8_t *data_;
+    /**
+     * @brief Budget the buffer is charged to, @c NULL if none.
+     */
+    nt_budget_t *budget_;
 } yanzc_buffer_t;
 
-struct yanzc_buffer_t *io_buffer_new(unsigned int size) {
+/**
+ * @brief Creates a buffer able to hold @c size bytes, charged to a memory budget.
+ * @details The buffer and its data are carved from a single block of the slab pool.
+ * @param size capacity of the buffer.
+ * @param budget the budget, may be @c NULL.
+ * @return The buffer or @c NULL.
+ * @sa io_buffer_free()
+ */
+static inline struct yanzc_buffer_t *io_buffer_new_charged(unsigned int size,
+                                                           nt_budget_t *budget) {
     struct yanzc_buffer_t *retval;
     size_t alloc_size = sizeof(struct yanzc_buffer_t) + sizeof(uint8_t) * size;
-    retval = (struct yanzc_buffer_t *)malloc(alloc_size);
+    retval = (struct yanzc_buffer_t *)nt_budget_alloc(budget, alloc_size);
     if (NULL != retval) {
         memset(retval, 0, alloc_size);
         retval->data_ = (uint8_t *)retval + sizeof(struct yanzc_buffer_t);
         retval->buf_size_ = size;
+        retval->budget_ = budget;
     }
     return retval;
 }
 
-struct yanz_read_slice_t io_buffer_get_read_slice(struct yanzc_buffer_t *io_buf,
-                                                  unsigned long initial_offset) {
+/**
+ * @brief Creates a buffer able to hold @c size bytes.
+ * @param size capacity of the buffer.
+ * @return The buffer or @c NULL.
+ * @sa io_buffer_new_charged()
+ */
+static inline struct yanzc_buffer_t *io_buffer_new(unsigned int size) {
+    return io_buffer_new_charged(size, NULL);
+}
+
+/**
+ * @brief Releases a buffer created with @ref io_buffer_new() or @ref io_buffer_new_charged().
+ * @param io_buf the buffer, may be @c NULL.
+ */
+static inline void io_buffer_free(struct yanzc_buffer_t *io_buf) {
+    if (NULL != io_buf) {
+        nt_budget_free(io_buf->budget_, io_buf);
+    }
+}
+
+static inline struct yanz_read_slice_t io_buffer_get_read_slice(struct yanzc_buffer_t *io_buf,
+                                                                unsigned long initial_offset) {
     struct yanz_read_slice_t retval = {.offset_read_ = initial_offset, .buffer_ = io_buf};
     return retval;
 }
 
-int io_buffer_realign(struct yanzc_buffer_t *io_buf, struct yanz_read_slice_t *read_slices,
-                      size_t read_slices_size) {
+static inline int io_buffer_realign(struct yanzc_buffer_t *io_buf,
+                                    struct yanz_read_slice_t *read_slices,
+                                    size_t read_slices_size) {
     size_t idx;
     for (idx = 0; idx < read_slices_size; ++idx) {
         if (io_buf->offset_write_ != read_slices[idx].offset_read_) {
@@ -91,39 +129,41 @@ int io_buffer_realign(struct yanzc_buffer_t *io_buf, struct yanz_read_slice_t *r
     return 1;
 }
 
-int io_buffer_is_space_for_writes(const struct yanzc_buffer_t *p_buf) {
+static inline int io_buffer_is_space_for_writes(const struct yanzc_buffer_t *p_buf) {
     return p_buf->buf_size_ > p_buf->offset_write_;
 }
 
-unsigned long io_buffer_get_size_for_writes(const struct yanzc_buffer_t *p_buf) {
+static inline unsigned long io_buffer_get_size_for_writes(const struct yanzc_buffer_t *p_buf) {
     return p_buf->buf_size_ - p_buf->offset_write_;
 }
 
-void io_buffer_move_write_offset(struct yanzc_buffer_t *p_buf, unsigned long by) {
+static inline void io_buffer_move_write_offset(struct yanzc_buffer_t *p_buf, unsigned long by) {
     p_buf->offset_write_ += by;
 }
 
-uint8_t *io_buffer_get_buf_for_writes(struct yanzc_buffer_t *p_buf) {
+static inline uint8_t *io_buffer_get_buf_for_writes(struct yanzc_buffer_t *p_buf) {
     return &p_buf->data_[p_buf->offset_write_];
 }
 
-void yanz_read_slice_move_read_offset(struct yanz_read_slice_t *old_offset, unsigned long by) {
+static inline void yanz_read_slice_move_read_offset(struct yanz_read_slice_t *old_offset,
+                                                    unsigned long by) {
     old_offset->offset_read_ += by;
 }
 
-int yanz_read_slice_is_space_for_reads(const struct yanz_read_slice_t *p_read_slice) {
+static inline int yanz_read_slice_is_space_for_reads(const struct yanz_read_slice_t *p_read_slice) {
     return p_read_slice->buffer_->offset_write_ > p_read_slice->offset_read_;
 }
 
-unsigned long yanz_read_slice_get_size_for_reads(const struct yanz_read_slice_t *p_read_slice) {
+static inline unsigned long
+yanz_read_slice_get_size_for_reads(const struct yanz_read_slice_t *p_read_slice) {
     return p_read_slice->buffer_->offset_write_ - p_read_slice->offset_read_;
 }
 
-uint8_t *yanz_read_slice_get_buf(const struct yanz_read_slice_t *p_read_slice) {
+static inline uint8_t *yanz_read_slice_get_buf(const struct yanz_read_slice_t *p_read_slice) {
     return &p_read_slice->buffer_->data_[p_read_slice->offset_read_];
 }
 
-int from_fd_to_buffer(int fd, struct yanzc_buffer_t *io_buf) {
+static inline int from_fd_to_buffer(int fd, struct yanzc_buffer_t *io_buf) {
     if (io_buffer_is_space_for_writes(io_buf)) {
         int result = 0;
         do {
@@ -142,7 +182,7 @@ int from_fd_to_buffer(int fd, struct yanzc_buffer_t *io_buf) {
     return 0;
 }
 
-int from_buffer_to_fd(struct yanz_read_slice_t *p_read_slice, int fd) {
+static inline int from_buffer_to_fd(struct yanz_read_slice_t *p_read_slice, int fd) {
     if (yanz_read_slice_is_space_for_reads(p_read_slice)) {
         int result = 0;
         do {
@@ -0,0 +1,266 @@
+/**
+ * @file yanzc_chain.c
+ * @brief Yet Another Zero Copy Buffer - segmented mode
+ * @details Implementation file for the segmented flavour of Yet Another Zero Copy Buffer.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ */
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "yanzc_chain.h"
+#include "nt-pool.h"
+
+/**
+ * @brief Maximal number of segments passed to a single @c writev() call.
+ */
+#define CHAIN_IOV_MAX (64)
+
+static yanzc_segment_t *segment_get(yanzc_chain_t *chain) {
+    yanzc_segment_t *seg = chain->spare_;
+    if (NULL != seg) {
+        chain->spare_ = NULL;
+    } else {
+        seg = nt_budget_alloc(chain->budget_, sizeof(yanzc_segment_t) + chain->seg_size_);
+        if (NULL == seg) {
+            return NULL;
+        }
+    }
+    seg->next_ = NULL;
+    seg->offset_ = chain->offset_write_;
+    seg->fill_ = 0;
+    seg->refs_ = 0;
+    return seg;
+}
+
+static int can_add_segment(const yanzc_chain_t *chain) {
+    return 0 == chain->max_segments_ || chain->n_segments_ < chain->max_segments_;
+}
+
+/**
+ * @brief Links a segment at the end of the chain.
+ */
+static void segment_link(yanzc_chain_t *chain, yanzc_segment_t *seg) {
+    seg->offset_ = chain->tail_->offset_ + chain->tail_->fill_;
+    chain->tail_->next_ = seg;
+    chain->tail_ = seg;
+    ++chain->n_segments_;
+}
+
+/**
+ * @brief Returns segments no reader refers to anymore.
+ * @details Readers only move forward, so an unreferenced head segment lies behind every
+ * reader. One segment is kept as a spare for the next write, the rest goes back to the pool.
+ */
+static void chain_release(yanzc_chain_t *chain) {
+    while (chain->head_ != chain->tail_ && 0 == chain->head_->refs_) {
+        yanzc_segment_t *seg = chain->head_;
+        chain->head_ = seg->next_;
+        --chain->n_segments_;
+        if (NULL == chain->spare_) {
+            seg->next_ = NULL;
+            seg->fill_ = 0;
+            seg->refs_ = 0;
+            chain->spare_ = seg;
+        } else {
+            nt_budget_free(chain->budget_, seg);
+        }
+    }
+}
+
+yanzc_chain_t *io_chain_new(unsigned int seg_size, unsigned int max_segments) {
+    return io_chain_new_charged(seg_size, max_segments, NULL);
+}
+
+yanzc_chain_t *io_chain_new_charged(unsigned int seg_size, unsigned int max_segments,
+                                    nt_budget_t *budget) {
+    yanzc_chain_t *chain;
+    if (seg_size <= sizeof(yanzc_segment_t)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    chain = nt_budget_alloc(budget, sizeof(yanzc_chain_t));
+    if (NULL != chain) {
+        memset(chain, 0, sizeof(yanzc_chain_t));
+        chain->seg_size_ = seg_size - sizeof(yanzc_segment_t);
+        chain->max_segments_ = max_segments;
+        chain->budget_ = budget;
+        chain->head_ = chain->tail_ = segment_get(chain);
+        if (NULL == chain->head_) {
+            nt_budget_free(budget, chain);
+            return NULL;
+        }
+        chain->n_segments_ = 1;
+    }
+    return chain;
+}
+
+void io_chain_free(yanzc_chain_t *chain) {
+    if (NULL != chain) {
+        yanzc_segment_t *seg = chain->head_;
+        while (NULL != seg) {
+            yanzc_segment_t *next = seg->next_;
+            nt_budget_free(chain->budget_, seg);
+            seg = next;
+        }
+        nt_budget_free(chain->budget_, chain->spare_);
+        nt_budget_free(chain->budget_, chain);
+    }
+}
+
+void io_chain_reader_attach(yanzc_chain_t *chain, yanzc_chain_reader_t *reader) {
+    reader->chain_ = chain;
+    reader->segment_ = chain->tail_;
+    reader->offset_read_ = chain->offset_write_;
+    ++chain->tail_->refs_;
+}
+
+void io_chain_reader_detach(yanzc_chain_reader_t *reader) {
+    if (NULL != reader->chain_) {
+        --reader->segment_->refs_;
+        chain_release(reader->chain_);
+        reader->chain_ = NULL;
+        reader->segment_ = NULL;
+    }
+}
+
+int io_chain_is_space_for_writes(const yanzc_chain_t *chain) {
+    return chain->tail_->fill_ < chain->seg_size_ || can_add_segment(chain);
+}
+
+unsigned long io_chain_get_size_for_writes(const yanzc_chain_t *chain) {
+    if (0 == chain->max_segments_) {
+        return ULONG_MAX;
+    }
+    return (unsigned long)(chain->max_segments_ - chain->n_segments_) * chain->seg_size_ +
+           (chain->seg_size_ - chain->tail_->fill_);
+}
+
+unsigned long io_chain_reader_pending(const yanzc_chain_reader_t *reader) {
+    return reader->chain_->offset_write_ - reader->offset_read_;
+}
+
+int io_chain_reader_get_iov(const yanzc_chain_reader_t *reader, struct iovec *iov, int iov_size) {
+    const yanzc_segment_t *seg = reader->segment_;
+    unsigned long start = reader->offset_read_ - seg->offset_;
+    int n = 0;
+    for (; NULL != seg && n < iov_size; seg = seg->next_, start = 0) {
+        if (seg->fill_ > start) {
+            iov[n].iov_base = (void *)&seg->data_[start];
+            iov[n].iov_len = seg->fill_ - start;
+            ++n;
+        }
+    }
+    return n;
+}
+
+void io_chain_reader_advance(yanzc_chain_reader_t *reader, unsigned long by) {
+    yanzc_chain_t *chain = reader->chain_;
+    yanzc_segment_t *seg = reader->segment_;
+    reader->offset_read_ += by;
+    while (NULL != seg->next_ && reader->offset_read_ >= seg->offset_ + chain->seg_size_) {
+        --seg->refs_;
+        seg = seg->next_;
+        ++seg->refs_;
+    }
+    if (seg != reader->segment_) {
+        reader->segment_ = seg;
+        chain_release(chain);
+    }
+}
+
+unsigned long io_chain_append(yanzc_chain_t *chain, const void *buf, unsigned long len) {
+    const uint8_t *src = buf;
+    unsigned long done = 0;
+    while (done < len) {
+        yanzc_segment_t *tail = chain->tail_;
+        unsigned long room = chain->seg_size_ - tail->fill_;
+        if (0 == room) {
+            yanzc_segment_t *seg;
+            if (!can_add_segment(chain) || NULL == (seg = segment_get(chain))) {
+                break;
+            }
+            segment_link(chain, seg);
+            continue;
+        }
+        if (room > len - done) {
+            room = len - done;
+        }
+        memcpy(&tail->data_[tail->fill_], src + done, room);
+        tail->fill_ += room;
+        chain->offset_write_ += room;
+        done += room;
+    }
+    return done;
+}
+
+int from_fd_to_chain(int fd, yanzc_chain_t *chain) {
+    struct iovec iov[2];
+    unsigned long tail_room = chain->seg_size_ - chain->tail_->fill_;
+    int n = 0;
+    ssize_t result;
+    if (tail_room > 0) {
+        iov[n].iov_base = &chain->tail_->data_[chain->tail_->fill_];
+        iov[n].iov_len = tail_room;
+        ++n;
+    }
+    /* Offer a whole spare segment as well, so a burst is taken in a single call */
+    if (can_add_segment(chain) && NULL == chain->spare_) {
+        chain->spare_ = segment_get(chain);
+    }
+    if (can_add_segment(chain) && NULL != chain->spare_) {
+        iov[n].iov_base = &chain->spare_->data_[0];
+        iov[n].iov_len = chain->seg_size_;
+        ++n;
+    }
+    if (0 == n) {
+        return 0;
+    }
+    do {
+        result = readv(fd, iov, n);
+    } while (-1 == result && EINTR == errno);
+    if (result > 0) {
+        unsigned long in_tail = (unsigned long)result;
+        if (in_tail > tail_room) {
+            in_tail = tail_room;
+        }
+        chain->tail_->fill_ += in_tail;
+        chain->offset_write_ += in_tail;
+        if ((unsigned long)result > in_tail) {
+            yanzc_segment_t *seg = chain->spare_;
+            chain->spare_ = NULL;
+            segment_link(chain, seg);
+            seg->fill_ = result - in_tail;
+            chain->offset_write_ += seg->fill_;
+        }
+    } else if (-1 == result && EAGAIN == errno) {
+        return 0;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int from_chain_to_fd(yanzc_chain_reader_t *reader, int fd) {
+    struct iovec iov[CHAIN_IOV_MAX];
+    int n = io_chain_reader_get_iov(reader, iov, CHAIN_IOV_MAX);
+    if (n > 0) {
+        ssize_t result;
+        do {
+            result = writev(fd, iov, n);
+        } while (-1 == result && EINTR == errno);
+        if (result > 0) {
+            io_chain_reader_advance(reader, (unsigned long)result);
+        } else if (-1 == result && EAGAIN == errno) {
+            return 0;
+        } else {
+            return errno;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,219 @@
+/**
+ * @file yanzc_chain.h
+ * @brief Yet Another Zero Copy Buffer - segmented mode
+ * @details Header file for the segmented flavour of Yet Another Zero Copy Buffer. Instead of
+ * a single contiguous block, data is kept in a linked chain of fixed-size segments taken from
+ * the slab pool. A burst of data is absorbed by appending segments rather than by copying,
+ * and each segment goes back to the pool as soon as every reader has moved past it.
+ * @author Tomasz Ostaszewski (ato013)
+ * @date 2026-Oct-18
+ * @par History
+ * <pre>
+ * </pre>
+ */
+#ifndef YANZC_CHAIN_H
+#define YANZC_CHAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "nt-budget.h"
+
+/**
+ * @brief A single segment of a chain.
+ */
+typedef struct yanzc_segment_t {
+    /**
+     * @brief Next segment in the chain, @c NULL for the tail.
+     */
+    struct yanzc_segment_t *next_;
+    /**
+     * @brief Stream offset of the first byte of this segment.
+     */
+    unsigned long offset_;
+    /**
+     * @brief Number of bytes written to this segment.
+     */
+    unsigned int fill_;
+    /**
+     * @brief Number of readers whose cursor is inside this segment.
+     */
+    unsigned int refs_;
+    /**
+     * @brief Segment payload.
+     */
+    uint8_t data_[];
+} yanzc_segment_t;
+
+/**
+ * @brief Segmented zero copy buffer definition.
+ * @details A chain has a single writer and any number of readers. Offsets are
+ * stream offsets, i.e. they count all the bytes ever written to the chain.
+ */
+typedef struct yanzc_chain_t {
+    /**
+     * @brief Payload capacity of a single segment.
+     */
+    unsigned int seg_size_;
+    /**
+     * @brief Maximal number of segments the chain may hold, 0 means no limit.
+     */
+    unsigned int max_segments_;
+    /**
+     * @brief Number of segments currently in the chain.
+     */
+    unsigned int n_segments_;
+    /**
+     * @brief Oldest segment still referenced.
+     */
+    yanzc_segment_t *head_;
+    /**
+     * @brief Segment being written to.
+     */
+    yanzc_segment_t *tail_;
+    /**
+     * @brief An empty segment kept for the next write.
+     */
+    yanzc_segment_t *spare_;
+    /**
+     * @brief Write offset.
+     * @details Stream offset where the next data will be written.
+     */
+    unsigned long offset_write_;
+    /**
+     * @brief Budget the chain and its segments are charged to, @c NULL if none.
+     */
+    nt_budget_t *budget_;
+} yanzc_chain_t;
+
+/**
+ * @brief Defines a reader of a chain.
+ * @details A reader holds a reference to the segment its cursor is in, which keeps that
+ * segment and all the following ones alive.
+ */
+typedef struct yanzc_chain_reader_t {
+    /**
+     * @brief Points to the next byte being read, as a stream offset.
+     */
+    unsigned long offset_read_;
+    /**
+     * @brief Segment the cursor is in.
+     */
+    yanzc_segment_t *segment_;
+    /**
+     * @brief The chain the reader reads from.
+     */
+    yanzc_chain_t *chain_;
+} yanzc_chain_reader_t;
+
+/**
+ * @brief Creates a chain.
+ * @param seg_size size of a pool block backing a single segment, including the segment
+ * header.
+ * @param max_segments maximal number of segments, 0 means no limit.
+ * @return The chain or @c NULL.
+ * @sa io_chain_free()
+ */
+yanzc_chain_t *io_chain_new(unsigned int seg_size, unsigned int max_segments);
+
+/**
+ * @brief Creates a chain charged to a memory budget.
+ * @details Segments are charged as they are taken from the pool and released as they go back,
+ * the spare one included.
+ * @param seg_size size of a pool block backing a single segment, including the segment
+ * header.
+ * @param max_segments maximal number of segments, 0 means no limit.
+ * @param budget the budget, may be @c NULL.
+ * @return The chain or @c NULL.
+ * @sa io_chain_free()
+ */
+yanzc_chain_t *io_chain_new_charged(unsigned int seg_size, unsigned int max_segments,
+                                    nt_budget_t *budget);
+
+/**
+ * @brief Releases a chain and all its segments.
+ * @details All readers must be detached by then.
+ * @param chain the chain, may be @c NULL.
+ */
+void io_chain_free(yanzc_chain_t *chain);
+
+/**
+ * @brief Attaches a reader to a chain.
+ * @details The reader's cursor is placed at the current write offset, so it sees all
+ * the data written from now on.
+ * @param chain the chain.
+ * @param[out] reader the reader.
+ */
+void io_chain_reader_attach(yanzc_chain_t *chain, yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Detaches a reader from a chain, dropping its segment reference.
+ * @param reader the reader.
+ */
+void io_chain_reader_detach(yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Checks whether there is room for writing without exceeding the segment limit.
+ * @param chain the chain.
+ * @return Non-zero if a write can be accepted.
+ */
+int io_chain_is_space_for_writes(const yanzc_chain_t *chain);
+
+/**
+ * @brief Returns the number of bytes that can be written without exceeding the segment limit.
+ * @param chain the chain.
+ * @return Number of bytes, @c ULONG_MAX for a chain without a limit.
+ */
+unsigned long io_chain_get_size_for_writes(const yanzc_chain_t *chain);
+
+/**
+ * @brief Returns the number of bytes a reader has not consumed yet.
+ * @param reader the reader.
+ * @return Number of pending bytes.
+ */
+unsigned long io_chain_reader_pending(const yanzc_chain_reader_t *reader);
+
+/**
+ * @brief Fills an I/O vector with data pending for a reader, without consuming it.
+ * @param reader the reader.
+ * @param[out] iov the vector.
+ * @param iov_size capacity of the vector.
+ * @return Number of entries filled.
+ */
+int io_chain_reader_get_iov(const yanzc_chain_reader_t *reader, struct iovec *iov, int iov_size);
+
+/**
+ * @brief Moves a reader's cursor forward.
+ * @details Segments every reader has passed are returned to the pool.
+ * @param reader the reader.
+ * @param by number of bytes, not more than @ref io_chain_reader_pending().
+ */
+void io_chain_reader_advance(yanzc_chain_reader_t *reader, unsigned long by);
+
+/**
+ * @brief Appends a copy of a memory block to a chain.
+ * @param chain the chain.
+ * @param buf data to be appended.
+ * @param len length of the data.
+ * @return Number of bytes appended, less than @c len if the segment limit was hit.
+ */
+unsigned long io_chain_append(yanzc_chain_t *chain, const void *buf, unsigned long len);
+
+/**
+ * @brief Reads from a descriptor into a chain, scattering across segments.
+ * @param fd descriptor to read from.
+ * @param chain the chain.
+ * @return 0 on success or if the read would block, -1 on end of file or an error.
+ */
+int from_fd_to_chain(int fd, yanzc_chain_t *chain);
+
+/**
+ * @brief Writes data pending for a reader to a descriptor, gathering across segments.
+ * @param reader the reader.
+ * @param fd descriptor to write to.
+ * @return 0 on success or if the write would block, @c errno value otherwise.
+ */
+int from_chain_to_fd(yanzc_chain_reader_t *reader, int fd);
+
+#endif /* YANZC_CHAIN_H */